@@ -0,0 +1,43 @@
+//----------------------------------------------------------------------------
+/// \file  alloc_hugepage.hpp
+//----------------------------------------------------------------------------
+/// \brief Custom memory allocator using NUMA-local hugepage arenas.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _EIXX_ALLOC_HUGEPAGE_HPP_
+#define _EIXX_ALLOC_HUGEPAGE_HPP_
+
+#include <eixx/util/hugepage_alloc.hpp>
+
+#define EIXX_USE_ALLOCATOR
+
+namespace eixx {
+
+// Memory is taken from the arena of the allocating thread's NUMA node,
+// unless the thread selects another one with util::hugepage_arena::use().
+typedef util::hugepage_allocator<char> allocator_t;
+
+} // namespace eixx
+
+#endif // _EIXX_ALLOC_HUGEPAGE_HPP_
@@ -32,6 +32,7 @@ limitations under the License.
 #include <eixx/connect/basic_otp_mailbox.hpp>
 #include <eixx/connect/basic_otp_connection.hpp>
 #include <eixx/connect/basic_otp_node.hpp>
+#include <eixx/connect/gen_server.hpp>
 
 namespace eixx {
 
@@ -39,6 +40,7 @@ typedef connect::transport_msg<allocator_t>                                 tran
 typedef connect::basic_otp_connection<allocator_t, detail::recursive_mutex> otp_connection;
 typedef connect::basic_otp_mailbox<allocator_t,    detail::recursive_mutex> otp_mailbox;
 typedef connect::basic_otp_node<allocator_t,       detail::recursive_mutex> otp_node;
+typedef connect::basic_gen_server<allocator_t,     detail::recursive_mutex> otp_gen_server;
 
 } // namespace eixx
 
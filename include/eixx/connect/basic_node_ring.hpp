@@ -0,0 +1,194 @@
+//----------------------------------------------------------------------------
+/// \file  basic_node_ring.hpp
+//----------------------------------------------------------------------------
+/// \brief A consistent hash ring mapping terms to the nodes of a cluster.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#ifndef _EIXX_BASIC_NODE_RING_HPP_
+#define _EIXX_BASIC_NODE_RING_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <eixx/marshal/eterm.hpp>
+#include <eixx/util/sync.hpp>
+
+namespace eixx {
+namespace connect {
+
+/**
+ * Consistent hash ring with virtual nodes over a configured set of nodes.
+ *
+ * Every node owns \a vnodes() points on the ring at positions
+ * erlang:phash2({Node, I}, 1 bsl 32) for I in [0, vnodes()).  A key is
+ * owned by the node of the first point at or after
+ * erlang:phash2(Key, 1 bsl 32), wrapping around the ring, so the Erlang
+ * side can compute the same placement:
+ * <code>
+ *   Ring = lists:sort([{erlang:phash2({N, I}, 1 bsl 32), N}
+ *                      || N <- Nodes, I <- lists:seq(0, VNodes-1)]),
+ *   H    = erlang:phash2(Key, 1 bsl 32),
+ *   case [N || {P, N} <- Ring, P >= H] of [Owner|_] -> Owner;
+ *                                         []        -> element(2, hd(Ring)) end
+ * </code>
+ * Nodes marked down are skipped, and their keys are routed to the next
+ * live node on the ring until they come back up.
+ */
+template <typename Alloc, typename Mutex = eixx::detail::mutex>
+class basic_node_ring {
+    struct member {
+        atom name;
+        bool up;
+    };
+
+    struct vnode {
+        uint32_t point;
+        uint32_t node;  // Index in m_nodes
+    };
+
+    std::vector<member> m_nodes;
+    std::vector<vnode>  m_ring;
+    size_t              m_vnodes;
+    Alloc               m_alloc;
+    mutable Mutex       m_lock;
+
+    int find(const atom& a_node) const {
+        for (size_t i = 0; i < m_nodes.size(); ++i)
+            if (m_nodes[i].name == a_node)
+                return int(i);
+        return -1;
+    }
+
+    void rebuild() {
+        m_ring.clear();
+        m_ring.reserve(m_nodes.size() * m_vnodes);
+        for (uint32_t n = 0; n < m_nodes.size(); ++n)
+            for (size_t i = 0; i < m_vnodes; ++i)
+                m_ring.push_back(vnode{point(m_nodes[n].name, i, m_alloc), n});
+        std::sort(m_ring.begin(), m_ring.end(), [this](const vnode& a, const vnode& b) {
+            return a.point < b.point || (a.point == b.point
+                && m_nodes[a.node].name < m_nodes[b.node].name);
+        });
+    }
+
+    /// Index in m_ring of the first point at or after \a a_hash
+    size_t lower_bound(uint32_t a_hash) const {
+        auto it = std::lower_bound(m_ring.begin(), m_ring.end(), a_hash,
+            [](const vnode& v, uint32_t h) { return v.point < h; });
+        return it == m_ring.end() ? 0 : it - m_ring.begin();
+    }
+
+public:
+    enum { DEFAULT_VNODES = 64 };
+
+    explicit basic_node_ring(size_t a_vnodes = DEFAULT_VNODES, const Alloc& a_alloc = Alloc())
+        : m_vnodes(a_vnodes ? a_vnodes : 1), m_alloc(a_alloc)
+    {}
+
+    /// Position of the \a a_vnode'th point of node \a a_node on the ring.
+    static uint32_t point(const atom& a_node, size_t a_vnode, const Alloc& a_alloc = Alloc()) {
+        eterm<Alloc> t(tuple<Alloc>::make(a_node, long(a_vnode), a_alloc));
+        return t.phash2(uint64_t(1) << 32);
+    }
+
+    /// Number of points each node owns on the ring.
+    size_t vnodes() const { return m_vnodes; }
+
+    /// Number of nodes in the ring.
+    size_t size()   const { eixx::detail::lock_guard<Mutex> guard(m_lock); return m_nodes.size(); }
+
+    /// Add a node to the ring.
+    /// @param a_up is the initial liveness state of the node.
+    /// @return false if the node is already in the ring.
+    bool add(const atom& a_node, bool a_up = false) {
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        if (find(a_node) >= 0)
+            return false;
+        m_nodes.push_back(member{a_node, a_up});
+        rebuild();
+        return true;
+    }
+
+    /// Remove a node from the ring. Only the keys it owned are moved.
+    bool remove(const atom& a_node) {
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        int i = find(a_node);
+        if (i < 0)
+            return false;
+        m_nodes.erase(m_nodes.begin() + i);
+        rebuild();
+        return true;
+    }
+
+    void clear() {
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        m_nodes.clear();
+        m_ring.clear();
+    }
+
+    bool contains(const atom& a_node) const {
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        return find(a_node) >= 0;
+    }
+
+    /// Mark the node as up or down. Nodes not in the ring are ignored.
+    void set_up(const atom& a_node, bool a_up) {
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        int i = find(a_node);
+        if (i >= 0)
+            m_nodes[i].up = a_up;
+    }
+
+    bool is_up(const atom& a_node) const {
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        int i = find(a_node);
+        return i >= 0 && m_nodes[i].up;
+    }
+
+    /// Node owning the key regardless of its liveness.
+    /// @return empty atom if the ring is empty.
+    atom owner(const eterm<Alloc>& a_key) const {
+        uint32_t h = a_key.phash2(uint64_t(1) << 32);
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        return m_ring.empty() ? atom() : m_nodes[m_ring[lower_bound(h)].node].name;
+    }
+
+    /// First live node on the ring starting from the key's owner.
+    /// @return empty atom if no node is up.
+    atom route(const eterm<Alloc>& a_key) const {
+        uint32_t h = a_key.phash2(uint64_t(1) << 32);
+        eixx::detail::lock_guard<Mutex> guard(m_lock);
+        for (size_t i = 0, j = lower_bound(h), n = m_ring.size(); i < n; ++i, ++j) {
+            const member& m = m_nodes[m_ring[j % n].node];
+            if (m.up)
+                return m.name;
+        }
+        return atom();
+    }
+};
+
+} // namespace connect
+} // namespace eixx
+
+#endif // _EIXX_BASIC_NODE_RING_HPP_
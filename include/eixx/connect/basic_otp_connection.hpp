@@ -63,6 +63,8 @@ private:
     boost::asio::deadline_timer         m_reconnect_timer;
     int                                 m_reconnect_secs;
     bool                                m_abort;
+    std::chrono::milliseconds           m_probe_interval;
+    std::chrono::milliseconds           m_probe_deadline;
 
     basic_otp_connection(
             connect_completion_handler      h,
@@ -81,6 +83,8 @@ private:
         , m_reconnect_timer(m_io_service)
         , m_reconnect_secs(a_reconnect_secs)
         , m_abort(false)
+        , m_probe_interval(0)
+        , m_probe_deadline(0)
     {
         BOOST_ASSERT(a_node != NULL);
         m_on_connect_status = h;
@@ -129,6 +133,20 @@ public:
     /// Set new reconnect timeout in seconds
     void reconnect_timeout(int a_reconnect_secs) { m_reconnect_secs = a_reconnect_secs; }
 
+    /// Probe the link to measure its RTT, and close it if the peer stays
+    /// silent longer than \a a_deadline (see connection_type::set_probe()).
+    /// The setting is preserved across reconnects.
+    void set_probe(std::chrono::milliseconds a_interval,
+                   std::chrono::milliseconds a_deadline = std::chrono::milliseconds(0)) {
+        m_probe_interval = a_interval;
+        m_probe_deadline = a_deadline;
+        if (m_transport && m_connected)
+            m_transport->set_probe(a_interval, a_deadline);
+    }
+
+    /// Statistics of the current link. Call from the I/O service's thread.
+    link_stats stats() const { return m_transport ? m_transport->stats() : link_stats(); }
+
     static pointer
     connect(connect_completion_handler      h,
             boost::asio::io_service&        a_svc,
@@ -170,8 +188,12 @@ public:
     void on_connect(connection_type* a_con) {
         BOOST_ASSERT(m_transport.get() == a_con);
         m_connected = true;
+        if (m_probe_interval.count())
+            a_con->set_probe(m_probe_interval, m_probe_deadline);
         if (m_on_connect_status)
             m_on_connect_status(this, std::string());
+        if (m_node)
+            m_node->on_connect_internal(*this, a_con->remote_nodename());
         if (unlikely(verbose() > VERBOSE_NONE)) {
             report_status(REPORT_INFO,
                 "Connected to node: " + a_con->remote_nodename().to_string());
@@ -218,9 +240,15 @@ public:
         report_status(REPORT_ERROR, str.str());
     }
 
-    void on_message(connection_type*, const transport_msg<Alloc>& a_tm) {
+    /// Shed a message by its control message and the wire size \a a_bytes
+    /// of its payload, which is not decoded yet.
+    bool admit(connection_type*, const transport_msg<Alloc>& a_tm, size_t a_bytes) {
+        return !m_node || m_node->admit(a_tm, a_bytes);
+    }
+
+    void on_message(connection_type*, const transport_msg<Alloc>& a_tm, size_t a_bytes) {
         try {
-            m_node->deliver(a_tm);
+            m_node->deliver(a_tm, a_bytes);
         } catch (std::exception& e) {
             std::stringstream s;
             s << "Got message " << a_tm.type_string() << std::endl
@@ -32,15 +32,21 @@ limitations under the License.
 #define _EIXX_BASIC_OTP_MAILBOX_HPP_
 
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <eixx/util/async_wait_timeout.hpp>
 #include <eixx/util/async_queue.hpp>
 #include <eixx/marshal/eterm.hpp>
 #include <eixx/connect/transport_msg.hpp>
+#include <eixx/connect/transport_otp_connection.hpp>
 #include <eixx/connect/verbose.hpp>
 #include <eixx/eterm.hpp>
+#include <eixx/util/sync.hpp>
+#include <atomic>
 #include <chrono>
+#include <functional>
 #include <list>
 #include <set>
+#include <unordered_map>
 
 namespace eixx {
 namespace connect {
@@ -53,6 +59,54 @@ using eixx::marshal::tuple;
 using eixx::marshal::varbind;
 using namespace std::chrono;
 
+/// Action taken by an overloaded mailbox on delivery of a message.
+enum class overload_action {
+    DROP_NEWEST,    ///< Drop the message being delivered
+    DROP_OLDEST,    ///< Drop the oldest queued messages to make room
+    SAMPLE,         ///< Keep one of every overload_policy::sample_rate messages
+    DROP_IF         ///< Drop the message if overload_policy::drop_if returns true
+};
+
+/// Outcome of a call made with basic_otp_mailbox::async_call().
+enum class call_status {
+    OK,         ///< The reply was received
+    TIMEOUT,    ///< There was no reply within the timeout
+    DOWN        ///< The server was down or died before replying
+};
+
+/// Lifetime of a process alias created with basic_otp_mailbox::alias().
+enum class alias_mode {
+    EXPLICIT,   ///< Active until basic_otp_mailbox::unalias() is called
+    REPLY       ///< Deactivated by the first message received through it
+};
+
+/**
+ * Load shedding policy of a mailbox.  The mailbox is overloaded when
+ * the number of queued messages reaches \a max_length, or when their
+ * total encoded size would exceed \a max_bytes.  Messages are shed
+ * before they are copied into the mailbox, and messages received from
+ * remote nodes before their payload is decoded, unless the DROP_IF
+ * action, a priorities() classifier or a pending async_call() needs
+ * the payload.  The size of received messages is their wire size, and
+ * that of local messages their estimated encoded size.  Exit, link and
+ * monitor signals, and messages classified at level 0 of a queue split
+ * with basic_otp_mailbox::priorities(), are always queued.  DROP_OLDEST
+ * evicts queued signals only from a queue with a single level.
+ */
+template <typename Alloc>
+struct overload_policy {
+    overload_action action      = overload_action::DROP_NEWEST;
+    /// Max number of queued messages (0 - unlimited)
+    size_t          max_length  = 0;
+    /// Max estimated encoded size of queued messages (0 - unlimited)
+    size_t          max_bytes   = 0;
+    /// Used by SAMPLE action
+    size_t          sample_rate = 1;
+    /// Used by DROP_IF action (e.g. to drop stale {tick, _} updates).
+    /// Messages for which it returns false are queued above the limits.
+    std::function<bool (const transport_msg<Alloc>&)> drop_if;
+};
+
 /**
  * Provides a simple mechanism for exchanging messages with Erlang
  * processes or other instances of this class.
@@ -95,7 +149,37 @@ public:
         bool (basic_otp_mailbox<Alloc, Mutex>&, transport_msg<Alloc>*&)
     > receive_handler_type;
 
-    typedef util::async_queue<transport_msg<Alloc>*, Alloc> queue_type;
+    /// Queued message along with its size accounted against the byte limit.
+    struct queue_entry {
+        transport_msg<Alloc>*   msg;
+        size_t                  bytes;
+    };
+
+    typedef util::async_queue<queue_entry, Alloc> queue_type;
+
+    /**
+     * Classifier of delivered messages returning the priority level of a
+     * message (0 - the most urgent).  It's called with the control message
+     * type (see transport_msg::to_type()) and the first element of a tuple
+     * message (or the message itself if it's not a tuple).
+     */
+    typedef std::function<
+        size_t (int a_type, const eterm<Alloc>& a_head)
+    > classifier_type;
+
+    /**
+     * Handler of the outcome of a call.  It's passed the reply for
+     * call_status::OK, the exit reason of the server for call_status::DOWN
+     * and an undefined term for call_status::TIMEOUT.
+     */
+    typedef std::function<
+        void (call_status a_status, const eterm<Alloc>& a_result)
+    > call_handler_type;
+
+    /// Callback invoked with every message shed by the overload policy
+    typedef std::function<
+        void (basic_otp_mailbox<Alloc, Mutex>&, const transport_msg<Alloc>&)
+    > drop_handler_type;
 
     template<typename A, typename M> friend class basic_otp_node;
     template<typename T, typename A> friend struct util::async_queue;
@@ -109,12 +193,133 @@ private:
     epid<Alloc>                         m_self;
     atom                                m_name;
     std::set<epid<Alloc> >              m_links;
+    std::map<epid<Alloc>, uint64_t>     m_unlinking;    // Unlinks waiting for UNLINK_ID_ACK
+    uint64_t                            m_unlink_id;
+    std::unordered_map<ref<Alloc>, alias_mode> m_aliases;
+    mutable Mutex                       m_signal_lock;  // Guards links, monitors and aliases
     std::map<ref<Alloc>, epid<Alloc> >  m_monitors;
     boost::shared_ptr<queue_type>       m_queue;
     system_clock::time_point            m_time_freed;   // Cache time of this mbox
 
+    overload_policy<Alloc>              m_overload;
+    drop_handler_type                   m_on_drop;
+    std::atomic<size_t>                 m_length;       // Number of queued messages
+    std::atomic<size_t>                 m_bytes;        // Estimated size of queued messages
+    std::atomic<size_t>                 m_dropped;
+    std::atomic<size_t>                 m_dropped_bytes;
+    std::atomic<size_t>                 m_sample_seq;
+    classifier_type                     m_classifier;
+
+    /// A call waiting for its reply
+    struct pending_call {
+        call_handler_type                           handler;
+        eterm<Alloc>                                target; // Monitored pid or name
+        atom                                        node;   // Node of the monitored target
+        std::shared_ptr<boost::asio::steady_timer>  timer;
+    };
+
+    std::unordered_map<ref<Alloc>, pending_call>    m_calls;
+    mutable Mutex                                   m_calls_lock;
+
     void do_deliver(transport_msg<Alloc>* a_msg);
 
+    /// Process the signals handled by the mailbox itself: messages to
+    /// aliases, link signals (UNLINK_ID is acknowledged), and exits of
+    /// links being removed.
+    /// @return true if \a a_msg is consumed and must not be queued.
+    bool signal(const transport_msg<Alloc>& a_msg);
+
+    /// Complete the call that \a a_msg replies to.
+    /// @return true if \a a_msg is a reply or a 'DOWN' signal of a call()
+    ///         or a SPAWN_REPLY (including the ones that timed out), which
+    ///         is not queued.
+    bool call_reply(const transport_msg<Alloc>& a_msg);
+
+    /// Remove a pending call.  @return false if it's not found.
+    bool take_call(const ref<Alloc>& a_ref, pending_call& a_call) {
+        eixx::detail::lock_guard<Mutex> guard(m_calls_lock);
+        auto it = m_calls.find(a_ref);
+        if (it == m_calls.end())
+            return false;
+        a_call = std::move(it->second);
+        m_calls.erase(it);
+        return true;
+    }
+
+    /// Start the timer of a pending call and register it.
+    void add_call(const ref<Alloc>& a_ref, pending_call& a_call, milliseconds a_timeout);
+
+    /// Start a call with \a a_start passing it a handler, and run the
+    /// io_service in the calling thread until the handler is invoked.
+    template <typename Start>
+    std::pair<call_status, eterm<Alloc>> wait_call(const Start& a_start);
+
+    /// Complete the spawn_request() that \a a_msg (SPAWN_REPLY) replies to.
+    bool spawn_reply(const transport_msg<Alloc>& a_msg);
+
+    /// Apply the `link` and `monitor` options of a spawn request of
+    /// \a a_parent to this newly spawned mailbox.
+    /// @return the SPAWN_REPLY flags.
+    int spawned(const epid<Alloc>& a_parent, const ref<Alloc>& a_req_id,
+                const list<Alloc>& a_opts);
+
+    /// Send a monitor or a demonitor signal to the target of a call.
+    void monitor_call(const pending_call& a_call, const ref<Alloc>& a_ref, bool a_demonitor);
+
+    void cancel_calls();
+
+    /// Estimated size of the message accounted when byte limit is set.
+    size_t msg_bytes(const transport_msg<Alloc>& a_msg) const {
+        return m_overload.max_bytes && a_msg.has_msg() ? a_msg.msg().encode_size(0, false) : 0;
+    }
+
+    bool overloaded(size_t a_bytes) const {
+        return (m_overload.max_length && m_length.load(std::memory_order_relaxed) >= m_overload.max_length)
+            || (m_overload.max_bytes  && m_bytes.load(std::memory_order_relaxed) + a_bytes > m_overload.max_bytes);
+    }
+
+    /// True if received messages can be shed by their control message.
+    bool admits_early() const {
+        return m_overload.action != overload_action::DROP_IF
+            && !(m_classifier && m_queue->levels() > 1)
+            && !pending_calls();
+    }
+
+    /// Apply the overload policy to the message being delivered at the
+    /// priority \a a_level.  Signals and messages of the top level of a
+    /// queue split in priorities() are never shed.
+    /// @return false if the message is to be dropped.
+    bool admit(const transport_msg<Alloc>& a_msg, size_t a_bytes, size_t a_level);
+
+    void shed(const transport_msg<Alloc>& a_msg, size_t a_bytes);
+
+    /// True for exit, link and monitor signals.
+    static bool is_signal(const transport_msg<Alloc>& a_msg);
+
+    /// Priority level of the message in the queue.
+    size_t classify(const transport_msg<Alloc>& a_msg) const;
+
+    void enqueue(std::unique_ptr<transport_msg<Alloc>>&& a_msg, size_t a_bytes, size_t a_level) {
+        m_length.fetch_add(1, std::memory_order_relaxed);
+        m_bytes.fetch_add(a_bytes, std::memory_order_relaxed);
+        m_queue->enqueue(queue_entry{a_msg.get(), a_bytes}, true, a_level);
+        a_msg.release();
+    }
+
+    /// Account for a message removed from the queue.
+    /// @return the message of the entry.
+    transport_msg<Alloc>* dequeued(const queue_entry& a_entry) {
+        m_length.fetch_sub(1, std::memory_order_relaxed);
+        m_bytes.fetch_sub(a_entry.bytes, std::memory_order_relaxed);
+        return a_entry.msg;
+    }
+
+    void reset_queue() {
+        m_queue->reset();
+        m_length = 0;
+        m_bytes  = 0;
+    }
+
     void name(const atom& a_name) { m_name = a_name; }
 
 public:
@@ -132,7 +337,9 @@ public:
         : m_io_service(a_svc ? *a_svc : a_node.io_service())
         , m_node(a_node), m_self(a_self)
         , m_name(a_name)
+        , m_unlink_id(0)
         , m_queue(new queue_type(m_io_service, a_queue_size, a_alloc))
+        , m_length(0), m_bytes(0), m_dropped(0), m_dropped_bytes(0), m_sample_seq(0)
     {}
 
     ~basic_otp_mailbox() { close(); }
@@ -162,7 +369,57 @@ public:
     bool operator!= (const basic_otp_mailbox& rhs) const { return self() != rhs.self(); }
 
     /// Clear mailbox's queue of awaiting messages
-    void clear() { m_queue->reset(); }
+    void clear() { reset_queue(); }
+
+    /**
+     * Set the load shedding policy of the mailbox. Call it before
+     * messages are delivered to the mailbox.
+     * @param a_on_drop is an optional callback invoked for every dropped
+     *        message.  Messages shed by a connection before decoding are
+     *        passed to it without the payload.
+     */
+    void overload(const overload_policy<Alloc>& a_policy,
+                  const drop_handler_type& a_on_drop = drop_handler_type()) {
+        m_overload = a_policy;
+        m_on_drop  = a_on_drop;
+        if (!m_overload.sample_rate)
+            m_overload.sample_rate = 1;
+    }
+
+    const overload_policy<Alloc>& overload() const { return m_overload; }
+
+    /**
+     * Split the mailbox's queue in \a a_levels priority levels, so that
+     * urgent messages don't wait behind the queued data messages. Receive
+     * calls return messages of higher levels first.  Call it before
+     * messages are delivered to the mailbox: the call isn't synchronized
+     * with deliver().  Messages of level 0 are never shed by the
+     * overload() policy.
+     * @param a_classifier returns the level of a message.  By default
+     *        exit, link and monitor signals are put at level 0, and all
+     *        other messages at the lowest level.
+     * @param a_starvation_limit is the max number of messages received in
+     *        a row from higher levels while lower levels have pending
+     *        messages (0 - unlimited).
+     */
+    void priorities(size_t a_levels,
+                    const classifier_type& a_classifier = classifier_type(),
+                    unsigned a_starvation_limit = 64) {
+        m_classifier = a_classifier;
+        m_queue->levels(a_levels, a_starvation_limit);
+    }
+
+    /// Number of priority levels of the mailbox's queue.
+    size_t priorities() const { return m_queue->levels(); }
+
+    /// Number of messages waiting in the queue.
+    size_t length()        const { return m_length.load(std::memory_order_relaxed); }
+    /// Estimated size of queued messages (accounted if the byte limit is set).
+    size_t bytes()         const { return m_bytes.load(std::memory_order_relaxed); }
+    /// Number of messages dropped by the overload policy.
+    size_t dropped()       const { return m_dropped.load(std::memory_order_relaxed); }
+    /// Estimated size of messages dropped by the overload policy.
+    size_t dropped_bytes() const { return m_dropped_bytes.load(std::memory_order_relaxed); }
 
     /// Print pid and regname of the mailbox to the given stream
     std::ostream& dump(std::ostream& out) const;
@@ -179,8 +436,8 @@ public:
     /// Dequeue the next message from the mailbox.  The call is non-blocking and
     /// returns NULL if no messages are waiting.
     transport_msg<Alloc>* receive() {
-        transport_msg<Alloc>* m;
-        return m_queue->dequeue(m) ? m : nullptr;
+        queue_entry e;
+        return m_queue->dequeue(e) ? dequeued(e) : nullptr;
     }
 
     /**
@@ -239,22 +496,138 @@ public:
     );
 
     /// Deliver a message to this mailbox. The call is thread-safe.
+    /// The message may be dropped according to the overload() policy.
     void deliver(const transport_msg<Alloc>& a_msg) {
-        std::unique_ptr<transport_msg<Alloc>> p(new transport_msg<Alloc>(a_msg));
-        m_queue->enqueue(p.get());
-        p.release();
+        if (signal(a_msg) || call_reply(a_msg))
+            return;
+        size_t n     = msg_bytes(a_msg);
+        size_t level = m_queue->levels() > 1 ? classify(a_msg) : 0;
+        if (!admit(a_msg, n, level))
+            return;
+        enqueue(std::unique_ptr<transport_msg<Alloc>>(new transport_msg<Alloc>(a_msg)), n, level);
     }
 
     /// Deliver a message to this mailbox. The call is thread-safe.
+    /// The message may be dropped according to the overload() policy.
     void deliver(transport_msg<Alloc>&& a_msg) {
-        std::unique_ptr<transport_msg<Alloc>> p(new transport_msg<Alloc>(std::move(a_msg)));
-        m_queue->enqueue(p.get());
-        p.release();
+        if (signal(a_msg) || call_reply(a_msg))
+            return;
+        size_t n     = msg_bytes(a_msg);
+        size_t level = m_queue->levels() > 1 ? classify(a_msg) : 0;
+        if (!admit(a_msg, n, level))
+            return;
+        enqueue(std::unique_ptr<transport_msg<Alloc>>(
+            new transport_msg<Alloc>(std::move(a_msg))), n, level);
+    }
+
+    /// Apply the overload policy to a message received by a connection,
+    /// whose payload of \a a_bytes on the wire is not decoded yet.  The
+    /// policy is deferred to deliver_received() when it needs the payload.
+    /// @return false if the message is to be dropped.
+    bool admit_received(const transport_msg<Alloc>& a_msg, size_t a_bytes) {
+        size_t n = m_overload.max_bytes ? a_bytes : 0;
+        if (likely(!overloaded(n)) || !admits_early())
+            return true;
+        return admit(a_msg, n, m_queue->levels() > 1 ? classify(a_msg) : 0);
+    }
+
+    /// Deliver a message received by a connection, which took \a a_bytes
+    /// on the wire and was passed by admit_received().
+    void deliver_received(const transport_msg<Alloc>& a_msg, size_t a_bytes) {
+        if (signal(a_msg) || call_reply(a_msg))
+            return;
+        size_t n     = m_overload.max_bytes && a_msg.has_msg() ? a_bytes : 0;
+        size_t level = m_queue->levels() > 1 ? classify(a_msg) : 0;
+        if (overloaded(n) && !admits_early() && !admit(a_msg, n, level))
+            return;
+        enqueue(std::unique_ptr<transport_msg<Alloc>>(new transport_msg<Alloc>(a_msg)), n, level);
+    }
+
+    /**
+     * Make a gen_server:call/3 to the server \a a_to, which is a pid,
+     * a registered name, or a {Name, Node} tuple.  The \a a_on_reply
+     * handler is invoked in the mailbox's io_service with the outcome.
+     * Remote servers are monitored, so that the call fails as soon as
+     * the server dies.  Replies are matched to calls by the reference,
+     * without scanning the pending calls or queued messages, and are
+     * never queued, so replies arriving after the timeout are discarded.
+     * @param a_timeout is the time to wait for the reply (negative -
+     *        infinity).
+     * @return the reference of the call.
+     * @throws err_bad_argument if \a a_to is not a valid server reference.
+     */
+    ref<Alloc> async_call(const eterm<Alloc>& a_to, const eterm<Alloc>& a_request,
+                          const call_handler_type& a_on_reply,
+                          milliseconds a_timeout = milliseconds(5000));
+
+    /**
+     * Make a gen_server:call/3 to the server \a a_to, running the
+     * mailbox's io_service until the reply arrives.
+     * \note While waiting the calling thread runs handlers of the
+     *       mailbox's io_service (restarting it if it was stopped), so any
+     *       handler posted to that io_service, including the ones of the
+     *       application, may be invoked from within this call.  Don't call
+     *       it from handlers that aren't reentrant, and prefer async_call()
+     *       when the io_service is run by other threads.
+     * @return the reply.
+     * @throws err_timeout if there was no reply within \a a_timeout.
+     * @throws err_no_process if the server is down.
+     */
+    eterm<Alloc> call(const eterm<Alloc>& a_to, const eterm<Alloc>& a_request,
+                      milliseconds a_timeout = milliseconds(5000));
+
+    /**
+     * Spawn a process running \a a_mod:a_fun(a_args) on \a a_node using
+     * the SPAWN_REQUEST signal, which unlike an rpc to erlang:spawn needs
+     * neither an extra round trip nor an rpc process on the remote node.
+     * The \a a_on_reply handler is invoked in the mailbox's io_service
+     * with call_status::OK and the pid of the new process, or with
+     * call_status::DOWN and the error reason (`badarg`, `notsup`,
+     * `noconnection`, etc.), or with call_status::TIMEOUT.
+     * @param a_opts are Erlang spawn options.  The `link` and `monitor`
+     *        options link and monitor the new process from this mailbox
+     *        (the monitor reference is the returned request id).
+     * @param a_timeout is the time to wait for the reply (negative -
+     *        infinity).
+     * @param a_gleader is the group leader of the new process.  By default
+     *        it's this mailbox, which then receives the io requests of the
+     *        process as {io_request, From, ReplyAs, Request} messages.
+     *        Pass the pid of a group leader on \a a_node (e.g. of its
+     *        `user` process) to have the output printed there.
+     * @return the request id.
+     */
+    ref<Alloc> spawn_request(const atom& a_node, const atom& a_mod, const atom& a_fun,
+                             const list<Alloc>& a_args, const list<Alloc>& a_opts,
+                             const call_handler_type& a_on_reply,
+                             milliseconds a_timeout = milliseconds(5000),
+                             const epid<Alloc>* a_gleader = NULL);
+
+    /**
+     * Spawn a process on \a a_node like spawn_request(), running the
+     * mailbox's io_service until the reply arrives (see the note of
+     * call()).
+     * @return the pid of the new process.
+     * @throws err_timeout if there was no reply within \a a_timeout.
+     * @throws err_bad_argument if the process couldn't be spawned.
+     */
+    epid<Alloc> spawn(const atom& a_node, const atom& a_mod, const atom& a_fun,
+                      const list<Alloc>& a_args, const list<Alloc>& a_opts,
+                      milliseconds a_timeout = milliseconds(5000),
+                      const epid<Alloc>* a_gleader = NULL);
+
+    /// Number of calls and spawn requests waiting for replies.
+    size_t pending_calls() const {
+        eixx::detail::lock_guard<Mutex> guard(m_calls_lock);
+        return m_calls.size();
     }
 
     /// Send a message \a a_msg to a pid \a a_to.
     void send(const epid<Alloc>& a_to, const eterm<Alloc>& a_msg) {
-        m_node.send(self(), a_to, a_msg);
+        m_node.send(a_to, a_msg);
+    }
+    /// Send a message \a a_msg to the process alias \a a_to.
+    void send(const ref<Alloc>& a_to, const eterm<Alloc>& a_msg) {
+        m_node.send_alias(self(), a_to, a_msg);
     }
     /// Send a message \a a_msg to the local process registered as \a a_to.
     void send(const atom& a_to, const eterm<Alloc>& a_msg) {
@@ -364,38 +737,59 @@ public:
     /// The given pid will receive an exit message when \a a_pid dies.
     /// @throws err_no_process
     /// @throws err_connection
-    void link(const epid<Alloc>& a_to) {
-        if (self() == a_to)
-            return;
-        if (m_links.find(a_to) != m_links.end())
-            return;
-        m_node.link(self(), a_to);
-        m_links.insert(a_to);
+    void link(const epid<Alloc>& a_to);
+
+    /// UnLink the given pid.  Nodes supporting DFLAG_UNLINK_ID are sent
+    /// the UNLINK_ID signal, and exits of \a a_to are ignored until it's
+    /// acknowledged.
+    void unlink(const epid<Alloc>& a_to);
+
+    /// True if the mailbox is linked to \a a_pid.
+    bool linked(const epid<Alloc>& a_pid) const {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        return m_links.find(a_pid) != m_links.end();
     }
 
-    /// UnLink the given pid
-    void unlink(const epid<Alloc>& a_to) {
-        if (m_links.erase(a_to) == 0)
-            return;
-        m_node.unlink(self(), a_to);
+    /// True if unlinking of \a a_pid waits for the acknowledgement.
+    bool unlinking(const epid<Alloc>& a_pid) const {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        return m_unlinking.find(a_pid) != m_unlinking.end();
     }
 
+    /**
+     * Create a process alias, which is a reference that can be used
+     * instead of the pid to send messages to this mailbox (see
+     * basic_otp_node::send_alias()).  Messages sent to an inactive alias
+     * are dropped, which lets replies to abandoned requests be discarded
+     * without reaching the queue.
+     */
+    ref<Alloc> alias(alias_mode a_mode = alias_mode::EXPLICIT);
+
+    /// Deactivate the \a a_alias.  @return false if the alias isn't active.
+    bool unalias(const ref<Alloc>& a_alias);
+
     /// Set up a monitor of a remote \a a_target_pid.
     //const ref<Alloc>& monitor(const epid<Alloc>& a_target_pid) {
     void monitor(const epid<Alloc>& a_target_pid) {
         if (self() == a_target_pid)
             return;
         const ref<Alloc>& l_ref = m_node.send_monitor(self(), a_target_pid);
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
         m_monitors[l_ref] = a_target_pid;
     }
 
     /// Demonitor the pid monitored using \a a_ref reference.
     void demonitor(const ref<Alloc>& a_ref) {
-        typename std::map<ref<Alloc>, epid<Alloc> >::iterator it = m_monitors.find(a_ref);
-        if (it == m_monitors.end())
-            return;
-        m_node.send_demonitor(self(), it->second, a_ref);
-        m_monitors.erase(it);
+        epid<Alloc> l_pid;
+        {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            typename std::map<ref<Alloc>, epid<Alloc> >::iterator it = m_monitors.find(a_ref);
+            if (it == m_monitors.end())
+                return;
+            l_pid = it->second;
+            m_monitors.erase(it);
+        }
+        m_node.send_demonitor(self(), l_pid, a_ref);
     }
 };
 
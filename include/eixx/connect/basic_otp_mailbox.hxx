@@ -40,7 +40,17 @@ template <typename Alloc, typename Mutex>
 void basic_otp_mailbox<Alloc, Mutex>::
 close(const eterm<Alloc>& a_reason, bool a_reg_remove) {
     m_time_freed = std::chrono::system_clock::now();
-    m_queue->reset();
+    cancel_calls();
+    // Don't hold the signal lock while taking the registry's lock, as
+    // the registry closes its mailboxes holding its lock
+    std::unordered_map<ref<Alloc>, alias_mode> l_aliases;
+    {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        l_aliases.swap(m_aliases);
+    }
+    for (auto& a : l_aliases)
+        m_node.m_mailboxes.erase_alias(a.first);
+    reset_queue();
     if (a_reg_remove)
         m_node.close_mailbox(this);
     break_links(a_reason);
@@ -54,19 +64,18 @@ async_receive(const OnReceive& h, std::chrono::milliseconds a_timeout,
               int   a_repeat_count)
 {
     return m_queue->async_dequeue(
-        [this, &h](transport_msg<Alloc>*& a_msg, const boost::system::error_code& ec) {
-            if (this->m_time_freed.time_since_epoch().count() == 0)
+        [this, &h](queue_entry& a_entry, const boost::system::error_code& ec) {
+            // Stop when the mailbox was closed
+            if (this->m_time_freed.time_since_epoch().count() != 0)
                 return false;
             bool res;
             if (ec) {
                 transport_msg<Alloc>* p(nullptr);
                 res = h(*this, p);
             } else {
-                res = h(*this, a_msg);
-                if (a_msg) {
-                    delete a_msg;
-                    a_msg = nullptr;
-                }
+                transport_msg<Alloc>* p = this->dequeued(a_entry);
+                res = h(*this, p);
+                delete p;
             }
 
             return res;
@@ -85,18 +94,18 @@ async_match(const marshal::eterm_pattern_matcher<Alloc>& a_matcher,
 {
     auto f =
         [this, &a_matcher, &a_on_timeout]
-        (transport_msg<Alloc>*& a_msg, const boost::system::error_code& ec) {
-            if (this->m_time_freed.time_since_epoch().count() == 0)
+        (queue_entry& a_entry, const boost::system::error_code& ec) {
+            // Stop when the mailbox was closed
+            if (this->m_time_freed.time_since_epoch().count() != 0)
                 return false;
             if (ec) {
                 a_on_timeout(*this);
                 return false;
             }
             varbind<Alloc> binding;
-            if (a_msg) {
-                a_matcher.match(a_msg->msg(), &binding);
-                delete a_msg;
-                a_msg = nullptr;
+            if (a_entry.msg) {
+                std::unique_ptr<transport_msg<Alloc>> p(this->dequeued(a_entry));
+                a_matcher.match(p->msg(), &binding);
             }
             return true;
         };
@@ -104,19 +113,564 @@ async_match(const marshal::eterm_pattern_matcher<Alloc>& a_matcher,
     return m_queue->async_dequeue(f, a_timeout, a_repeat_count);
 }
 
+template <typename Alloc, typename Mutex>
+ref<Alloc> basic_otp_mailbox<Alloc, Mutex>::
+async_call(const eterm<Alloc>& a_to, const eterm<Alloc>& a_request,
+           const call_handler_type& a_on_reply, milliseconds a_timeout)
+{
+    // The server is Pid | Name | {Name, Node}
+    pending_call call;
+    call.handler = a_on_reply;
+    call.node    = m_node.nodename();
+    switch (a_to.type()) {
+        case PID:
+            call.node = a_to.to_pid().node();
+            break;
+        case ATOM:
+            break;
+        case TUPLE: {
+            const tuple<Alloc>& t = a_to.to_tuple();
+            if (t.size() == 2 && t[0].type() == ATOM && t[1].type() == ATOM) {
+                call.node = t[1].to_atom();
+                break;
+            }
+        }
+        // fallthrough
+        default:
+            throw err_bad_argument("Invalid server reference", a_to);
+    }
+    const eterm<Alloc>& to = a_to.type() == TUPLE ? a_to.to_tuple()[0] : a_to;
+    // Local mailboxes don't send 'DOWN' signals - a dead local server is
+    // detected when sending the request
+    bool local = call.node == m_node.nodename();
+    if (!local)
+        call.target = to;
+
+    ref<Alloc> r = m_node.create_call_ref();
+    add_call(r, call, a_timeout);
+
+    try {
+        if (!local)
+            monitor_call(call, r, false);
+        auto msg = tuple<Alloc>::make(am_gen_call, tuple<Alloc>::make(self(), r), a_request);
+        if (to.type() == PID)
+            m_node.send(to.to_pid(), msg);
+        else if (local)
+            m_node.send(self(), to.to_atom(), msg);
+        else
+            m_node.send(self(), call.node, to.to_atom(), msg);
+    } catch (err_bad_argument& e) {
+        // err_no_process or err_connection
+        pending_call c;
+        if (take_call(r, c)) {
+            if (c.timer)
+                c.timer->cancel();
+            eterm<Alloc> reason = dynamic_cast<err_connection*>(&e)
+                                ? am_noconnection : am_noproc;
+            m_io_service.post([c, reason]() { c.handler(call_status::DOWN, reason); });
+        }
+    }
+    return r;
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox<Alloc, Mutex>::
+add_call(const ref<Alloc>& a_ref, pending_call& a_call, milliseconds a_timeout)
+{
+    if (a_timeout >= milliseconds(0)) {
+        a_call.timer = std::make_shared<boost::asio::steady_timer>(m_io_service, a_timeout);
+        a_call.timer->async_wait([this, r = a_ref](const boost::system::error_code& ec) {
+            pending_call c;
+            if (ec || !take_call(r, c))
+                return;
+            if (!c.target.empty())
+                try { monitor_call(c, r, true); } catch (...) {}
+            c.handler(call_status::TIMEOUT, eterm<Alloc>());
+        });
+    }
+
+    // Register the call before sending the request, as the reply may be
+    // delivered by another thread
+    eixx::detail::lock_guard<Mutex> guard(m_calls_lock);
+    m_calls.emplace(a_ref, a_call);
+}
+
+template <typename Alloc, typename Mutex>
+template <typename Start>
+std::pair<call_status, eterm<Alloc>> basic_otp_mailbox<Alloc, Mutex>::
+wait_call(const Start& a_start)
+{
+    struct result {
+        std::atomic<bool> done{false};
+        call_status       status;
+        eterm<Alloc>      value;
+    };
+    auto res = std::make_shared<result>();
+
+    a_start([res](call_status a_status, const eterm<Alloc>& a_value) {
+        res->status = a_status;
+        res->value  = a_value;
+        res->done.store(true, std::memory_order_release);
+    });
+
+    // The handler may be run by another thread running the io_service,
+    // so don't block in it for long
+    while (!res->done.load(std::memory_order_acquire)) {
+        if (m_io_service.stopped())
+            m_io_service.restart();
+        m_io_service.run_one_for(milliseconds(10));
+    }
+
+    return std::make_pair(res->status, res->value);
+}
+
+template <typename Alloc, typename Mutex>
+eterm<Alloc> basic_otp_mailbox<Alloc, Mutex>::
+call(const eterm<Alloc>& a_to, const eterm<Alloc>& a_request, milliseconds a_timeout)
+{
+    auto res = wait_call([&](const call_handler_type& h) {
+        async_call(a_to, a_request, h, a_timeout);
+    });
+
+    switch (res.first) {
+        case call_status::OK:       return res.second;
+        case call_status::TIMEOUT:  throw err_timeout("Call timed out");
+        default:                    throw err_no_process("Server is down", res.second);
+    }
+}
+
+template <typename Alloc, typename Mutex>
+ref<Alloc> basic_otp_mailbox<Alloc, Mutex>::
+spawn_request(const atom& a_node, const atom& a_mod, const atom& a_fun,
+              const list<Alloc>& a_args, const list<Alloc>& a_opts,
+              const call_handler_type& a_on_reply, milliseconds a_timeout,
+              const epid<Alloc>* a_gleader)
+{
+    pending_call call;
+    call.handler = a_on_reply;
+
+    // Not a call ref, as it's also the reference of the monitor requested
+    // by the `monitor` option, whose 'DOWN' message is queued
+    ref<Alloc> r = m_node.create_ref();
+    add_call(r, call, a_timeout);
+
+    try {
+        m_node.send_spawn_request(r, self(), a_node, a_mod, a_fun, a_args, a_opts,
+                                  a_gleader);
+    } catch (err_bad_argument& e) {
+        // err_connection or a node not supporting spawn requests
+        pending_call c;
+        if (take_call(r, c)) {
+            if (c.timer)
+                c.timer->cancel();
+            eterm<Alloc> reason = dynamic_cast<err_connection*>(&e)
+                                ? am_noconnection : am_notsup;
+            m_io_service.post([c, reason]() { c.handler(call_status::DOWN, reason); });
+        }
+    }
+    return r;
+}
+
+template <typename Alloc, typename Mutex>
+epid<Alloc> basic_otp_mailbox<Alloc, Mutex>::
+spawn(const atom& a_node, const atom& a_mod, const atom& a_fun,
+      const list<Alloc>& a_args, const list<Alloc>& a_opts, milliseconds a_timeout,
+      const epid<Alloc>* a_gleader)
+{
+    auto res = wait_call([&](const call_handler_type& h) {
+        spawn_request(a_node, a_mod, a_fun, a_args, a_opts, h, a_timeout, a_gleader);
+    });
+
+    switch (res.first) {
+        case call_status::OK:       return res.second.to_pid();
+        case call_status::TIMEOUT:  throw err_timeout("Spawn request timed out");
+        default:                    throw err_bad_argument("Spawn request failed", res.second);
+    }
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox<Alloc, Mutex>::
+spawn_reply(const transport_msg<Alloc>& a_msg)
+{
+    const ref<Alloc>&   r      = a_msg.spawn_ref();
+    const eterm<Alloc>& result = a_msg.spawn_result();
+    int                 flags  = result.type() == PID ? a_msg.spawn_flags() : 0;
+
+    pending_call c;
+    bool pending = take_call(r, c);
+
+    // The link and the monitor of a request that timed out are removed
+    if (flags & transport_msg<Alloc>::SPAWN_LINKED) {
+        {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            m_links.insert(result.to_pid());
+            m_unlinking.erase(result.to_pid());
+        }
+        if (!pending)
+            try { unlink(result.to_pid()); } catch (...) {}
+    }
+    if (flags & transport_msg<Alloc>::SPAWN_MONITORED) {
+        if (pending) {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            m_monitors[r] = result.to_pid();
+        } else
+            try { m_node.send_demonitor(self(), result.to_pid(), r); } catch (...) {}
+    }
+
+    if (!pending)
+        return true;
+
+    if (c.timer)
+        c.timer->cancel();
+    call_status  status = result.type() == PID ? call_status::OK : call_status::DOWN;
+    eterm<Alloc> res(result);
+    m_io_service.post([c, status, res]() { c.handler(status, res); });
+    return true;
+}
+
+template <typename Alloc, typename Mutex>
+int basic_otp_mailbox<Alloc, Mutex>::
+spawned(const epid<Alloc>& a_parent, const ref<Alloc>& a_req_id, const list<Alloc>& a_opts)
+{
+    int flags = 0;
+    for (auto it = a_opts.begin(), end = a_opts.end(); it != end; ++it) {
+        // link | monitor | {monitor, MonitorOpts}
+        const eterm<Alloc>& opt  = *it;
+        const eterm<Alloc>& name = opt.type() == TUPLE && opt.to_tuple().size()
+                                 ? opt.to_tuple()[0] : opt;
+        if (name.type() != ATOM)
+            continue;
+        if (name.to_atom() == am_link) {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            m_links.insert(a_parent);
+            flags |= transport_msg<Alloc>::SPAWN_LINKED;
+        } else if (name.to_atom() == am_monitor) {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            m_monitors[a_req_id] = a_parent;
+            flags |= transport_msg<Alloc>::SPAWN_MONITORED;
+        }
+    }
+    return flags;
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox<Alloc, Mutex>::
+call_reply(const transport_msg<Alloc>& a_msg)
+{
+    const ref<Alloc>*   r;
+    const eterm<Alloc>* result;
+    call_status         status;
+
+    switch (a_msg.type()) {
+        case transport_msg<Alloc>::SEND:
+        case transport_msg<Alloc>::SEND_TT:
+        case transport_msg<Alloc>::REG_SEND:
+        case transport_msg<Alloc>::REG_SEND_TT:
+        case transport_msg<Alloc>::ALIAS_SEND:
+        case transport_msg<Alloc>::ALIAS_SEND_TT: {
+            // {Ref, Reply}
+            const eterm<Alloc>& msg = a_msg.msg();
+            if (msg.type() != TUPLE || msg.to_tuple().size() != 2 ||
+                msg.to_tuple()[0].type() != REF)
+                return false;
+            r      = &msg.to_tuple()[0].to_ref();
+            result = &msg.to_tuple()[1];
+            status = call_status::OK;
+            break;
+        }
+        case transport_msg<Alloc>::MONITOR_P_EXIT:
+            r      = &a_msg.get_ref();
+            result = &a_msg.reason();
+            status = call_status::DOWN;
+            break;
+        case transport_msg<Alloc>::SPAWN_REPLY:
+        case transport_msg<Alloc>::SPAWN_REPLY_TT:
+            return spawn_reply(a_msg);
+        default:
+            return false;
+    }
+
+    if (!m_node.is_call_ref(*r))
+        return false;
+
+    // Late replies of calls that timed out are discarded
+    pending_call c;
+    if (!take_call(*r, c))
+        return true;
+
+    if (c.timer)
+        c.timer->cancel();
+    if (status == call_status::OK && !c.target.empty())
+        try { monitor_call(c, *r, true); } catch (...) {}
+
+    eterm<Alloc> res(*result);
+    m_io_service.post([c, status, res]() { c.handler(status, res); });
+    return true;
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox<Alloc, Mutex>::
+monitor_call(const pending_call& a_call, const ref<Alloc>& a_ref, bool a_demonitor)
+{
+    transport_msg<Alloc> tm;
+    if (a_call.target.type() == PID) {
+        if (a_demonitor) tm.set_demonitor(self(), a_call.target.to_pid(), a_ref);
+        else             tm.set_monitor  (self(), a_call.target.to_pid(), a_ref);
+        m_node.send(a_call.node, a_call.target.to_pid(), tm);
+    } else {
+        if (a_demonitor) tm.set_demonitor(self(), a_call.target.to_atom(), a_ref);
+        else             tm.set_monitor  (self(), a_call.target.to_atom(), a_ref);
+        m_node.send(a_call.node, a_call.target.to_atom(), tm);
+    }
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox<Alloc, Mutex>::
+cancel_calls()
+{
+    eixx::detail::lock_guard<Mutex> guard(m_calls_lock);
+    for (auto& c : m_calls)
+        if (c.second.timer)
+            c.second.timer->cancel();
+    m_calls.clear();
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox<Alloc, Mutex>::
+link(const epid<Alloc>& a_to)
+{
+    if (self() == a_to)
+        return;
+    {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        if (!m_links.insert(a_to).second)
+            return;
+        m_unlinking.erase(a_to);
+    }
+    try {
+        m_node.send_link(self(), a_to);
+    } catch (...) {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        m_links.erase(a_to);
+        throw;
+    }
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox<Alloc, Mutex>::
+unlink(const epid<Alloc>& a_to)
+{
+    if (!(m_node.remote_flags(a_to.node()) & DFLAG_UNLINK_ID)) {
+        {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            if (m_links.erase(a_to) == 0)
+                return;
+        }
+        m_node.send_unlink(self(), a_to);
+        return;
+    }
+
+    uint64_t id;
+    {
+        // Record the unlink before sending, as the ack may be delivered
+        // by another thread
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        if (m_links.erase(a_to) == 0)
+            return;
+        id = ++m_unlink_id;
+        m_unlinking[a_to] = id;
+    }
+    m_node.send_unlink_id(id, self(), a_to);
+}
+
+template <typename Alloc, typename Mutex>
+ref<Alloc> basic_otp_mailbox<Alloc, Mutex>::
+alias(alias_mode a_mode)
+{
+    ref<Alloc> r = m_node.create_ref();
+    {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        m_aliases.emplace(r, a_mode);
+    }
+    m_node.m_mailboxes.add_alias(r, this);
+    return r;
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox<Alloc, Mutex>::
+unalias(const ref<Alloc>& a_alias)
+{
+    {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        if (m_aliases.erase(a_alias) == 0)
+            return false;
+    }
+    m_node.m_mailboxes.erase_alias(a_alias);
+    return true;
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox<Alloc, Mutex>::
+signal(const transport_msg<Alloc>& a_msg)
+{
+    switch (a_msg.type()) {
+        case transport_msg<Alloc>::ALIAS_SEND:
+        case transport_msg<Alloc>::ALIAS_SEND_TT: {
+            const ref<Alloc>& l_alias = a_msg.recipient().to_ref();
+            {
+                eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+                auto it = m_aliases.find(l_alias);
+                // The alias was deactivated after the message was routed
+                if (it == m_aliases.end())
+                    return true;
+                if (it->second == alias_mode::EXPLICIT)
+                    return false;
+                m_aliases.erase(it);
+            }
+            m_node.m_mailboxes.erase_alias(l_alias);
+            return false;
+        }
+        case transport_msg<Alloc>::LINK: {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            m_links.insert(a_msg.sender_pid());
+            m_unlinking.erase(a_msg.sender_pid());
+            return false;
+        }
+        case transport_msg<Alloc>::UNLINK: {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            m_links.erase(a_msg.sender_pid());
+            return false;
+        }
+        case transport_msg<Alloc>::UNLINK_ID: {
+            // The unlink is queued like UNLINK, and acknowledged right away
+            {
+                eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+                m_links.erase(a_msg.sender_pid());
+            }
+            try { m_node.send_unlink_id_ack(a_msg.unlink_id(), self(), a_msg.sender_pid()); }
+            catch (...) {}
+            return false;
+        }
+        case transport_msg<Alloc>::UNLINK_ID_ACK: {
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            auto it = m_unlinking.find(a_msg.sender_pid());
+            if (it != m_unlinking.end() && it->second == a_msg.unlink_id())
+                m_unlinking.erase(it);
+            return true;
+        }
+        case transport_msg<Alloc>::EXIT:
+        case transport_msg<Alloc>::EXIT_TT: {
+            // Exits caused by a link that is being removed are ignored
+            eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+            return a_msg.sender().type() == PID &&
+                   m_unlinking.find(a_msg.sender_pid()) != m_unlinking.end();
+        }
+        default:
+            return false;
+    }
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox<Alloc, Mutex>::
+admit(const transport_msg<Alloc>& a_msg, size_t a_bytes, size_t a_level)
+{
+    if (likely(!overloaded(a_bytes)))
+        return true;
+
+    size_t levels = m_queue->levels();
+    if ((levels > 1 && a_level == 0) || is_signal(a_msg))
+        return true;
+
+    switch (m_overload.action) {
+        case overload_action::DROP_OLDEST: {
+            queue_entry e;
+            // Keep the messages of the top level of a split queue
+            while (overloaded(a_bytes) && m_queue->dequeue_lowest(e, levels > 1 ? 1 : 0)) {
+                std::unique_ptr<transport_msg<Alloc>> old(dequeued(e));
+                shed(*old, e.bytes);
+            }
+            return true;
+        }
+        case overload_action::SAMPLE:
+            if (m_sample_seq.fetch_add(1, std::memory_order_relaxed) % m_overload.sample_rate == 0)
+                return true;
+            break;
+        case overload_action::DROP_IF:
+            if (!m_overload.drop_if || !m_overload.drop_if(a_msg))
+                return true;
+            break;
+        case overload_action::DROP_NEWEST:
+            break;
+    }
+    shed(a_msg, a_bytes);
+    return false;
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox<Alloc, Mutex>::
+is_signal(const transport_msg<Alloc>& a_msg)
+{
+    switch (a_msg.type()) {
+        case transport_msg<Alloc>::EXIT:
+        case transport_msg<Alloc>::EXIT2:
+        case transport_msg<Alloc>::EXIT_TT:
+        case transport_msg<Alloc>::EXIT2_TT:
+        case transport_msg<Alloc>::LINK:
+        case transport_msg<Alloc>::UNLINK:
+        case transport_msg<Alloc>::UNLINK_ID:
+        case transport_msg<Alloc>::UNLINK_ID_ACK:
+        case transport_msg<Alloc>::MONITOR_P:
+        case transport_msg<Alloc>::DEMONITOR_P:
+        case transport_msg<Alloc>::MONITOR_P_EXIT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+template <typename Alloc, typename Mutex>
+size_t basic_otp_mailbox<Alloc, Mutex>::
+classify(const transport_msg<Alloc>& a_msg) const
+{
+    if (!m_classifier)
+        return is_signal(a_msg) ? 0 : m_queue->levels() - 1;
+
+    static const eterm<Alloc> s_none;
+    const eterm<Alloc>& msg = a_msg.has_msg() ? a_msg.msg() : s_none;
+    const eterm<Alloc>& head =
+        msg.type() == TUPLE && msg.to_tuple().size() ? msg.to_tuple()[0] : msg;
+    return m_classifier(a_msg.to_type(), head);
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox<Alloc, Mutex>::
+shed(const transport_msg<Alloc>& a_msg, size_t a_bytes)
+{
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    m_dropped_bytes.fetch_add(a_bytes, std::memory_order_relaxed);
+    if (m_on_drop)
+        m_on_drop(*this, a_msg);
+}
+
 template <typename Alloc, typename Mutex>
 void basic_otp_mailbox<Alloc, Mutex>::
 break_links(const eterm<Alloc>& a_reason)
 {
+    std::set<epid<Alloc> > l_links;
+    std::map<ref<Alloc>, epid<Alloc> > l_monitors;
+    {
+        eixx::detail::lock_guard<Mutex> guard(m_signal_lock);
+        l_links.swap(m_links);
+        l_monitors.swap(m_monitors);
+        m_unlinking.clear();
+    }
     for (typename std::set<epid<Alloc> >::const_iterator
-            it=m_links.begin(), end = m_links.end(); it != end; ++it)
+            it=l_links.begin(), end = l_links.end(); it != end; ++it)
         try { m_node.send_exit(self(), *it, a_reason); } catch(...) {}
     for (typename std::map<ref<Alloc>, epid<Alloc> >::const_iterator
-            it = m_monitors.begin(), end = m_monitors.end(); it != end; ++it)
+            it = l_monitors.begin(), end = l_monitors.end(); it != end; ++it)
         try { m_node.send_monitor_exit(self(), it->second, it->first, a_reason); }
         catch(...) {}
-    if (!m_links.empty())    m_links.clear();
-    if (!m_monitors.empty()) m_monitors.clear();
 }
 
 /*
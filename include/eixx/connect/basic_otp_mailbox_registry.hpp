@@ -34,6 +34,7 @@ limitations under the License.
 #include <eixx/connect/basic_otp_mailbox.hpp>
 #include <eixx/util/hashtable.hpp>
 #include <queue>
+#include <unordered_map>
 
 namespace eixx {
 namespace connect {
@@ -51,7 +52,10 @@ private:
     // of orphant entries.
     mutable Mutex                               m_lock;
     mutable std::map<atom, mailbox_ptr>         m_by_name;
-    mutable std::map<epid<Alloc>, mailbox_ptr>  m_by_pid;
+    // Local pids are packed in a single word, so hashing them is cheap
+    mutable std::unordered_map<epid<Alloc>, mailbox_ptr> m_by_pid;
+    // Active process aliases (see basic_otp_mailbox::alias())
+    mutable std::unordered_map<ref<Alloc>, mailbox_ptr>  m_by_alias;
 
     // Cache of freed mailboxes
     static std::queue<mailbox_ptr>              s_free_list;
@@ -79,8 +83,14 @@ public:
     /// Remove \a a_mbox mailbox from the registry
     void erase(mailbox_ptr a_mbox);
 
+    /// Make \a a_alias an alias of the \a a_mbox mailbox.
+    void add_alias(const ref<Alloc>& a_alias, mailbox_ptr a_mbox);
+
+    /// Deactivate \a a_alias.  @return false if the alias isn't active.
+    bool erase_alias(const ref<Alloc>& a_alias);
+
     /**
-     * Look up a mailbox based on its name or pid.
+     * Look up a mailbox based on its name, pid or alias.
      * @throws err_bad_argument
      * @throws err_no_process
      */
@@ -105,6 +115,13 @@ public:
     mailbox_ptr
     get(const epid<Alloc>& a_pid) const;
 
+    /**
+     * Look up a mailbox based on its active alias.
+     * @throws err_no_process
+     */
+    mailbox_ptr
+    get(const ref<Alloc>& a_alias) const;
+
     void names(std::list<atom>& list);
 
     void pids(std::list<epid<Alloc> >& list);
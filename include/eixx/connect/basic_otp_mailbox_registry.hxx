@@ -95,14 +95,17 @@ void basic_otp_mailbox_registry<Alloc, Mutex>::
 clear()
 {
     if (!m_by_name.empty() || !m_by_pid.empty()) {
-        lock_guard<Mutex> guard(m_lock);
-        m_by_name.clear();
-        typename std::map<epid<Alloc>, mailbox_ptr>::iterator it;
-        for(it = m_by_pid.begin(); it != m_by_pid.end(); ++it) {
-            mailbox_ptr p = it->second;
-            p->close(am_normal, false);
+        std::unordered_map<epid<Alloc>, mailbox_ptr> l_by_pid;
+        {
+            lock_guard<Mutex> guard(m_lock);
+            m_by_name.clear();
+            m_by_alias.clear();
+            l_by_pid.swap(m_by_pid);
         }
-        m_by_pid.clear();
+        // Close the mailboxes without holding the lock, as closing takes
+        // the mailbox's locks and calls back into the registry
+        for (auto& p : l_by_pid)
+            p.second->close(am_normal, false);
     }
 }
 
@@ -151,8 +154,24 @@ erase(mailbox_ptr a_mbox)
     a_mbox->name(atom());
 }
 
+template <typename Alloc, typename Mutex>
+void basic_otp_mailbox_registry<Alloc, Mutex>::
+add_alias(const ref<Alloc>& a_alias, mailbox_ptr a_mbox)
+{
+    lock_guard<Mutex> guard(m_lock);
+    m_by_alias[a_alias] = a_mbox;
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_mailbox_registry<Alloc, Mutex>::
+erase_alias(const ref<Alloc>& a_alias)
+{
+    lock_guard<Mutex> guard(m_lock);
+    return m_by_alias.erase(a_alias) > 0;
+}
+
 /**
- * Look up a mailbox based on its name or pid.
+ * Look up a mailbox based on its name, pid or alias.
  * @throws err_bad_argument
  * @throws err_no_process
  */
@@ -164,6 +183,7 @@ get(const eterm<Alloc>& a_proc) const
     switch (a_proc.type()) {
         case ATOM:  return get(a_proc.to_atom());
         case PID:   return get(a_proc.to_pid());
+        case REF:   return get(a_proc.to_ref());
         default:    throw err_bad_argument("Unknown process identifier", a_proc);
     }
 }
@@ -197,12 +217,27 @@ typename basic_otp_mailbox_registry<Alloc, Mutex>::mailbox_ptr
 basic_otp_mailbox_registry<Alloc, Mutex>::get(const epid<Alloc>& a_pid) const
 {
     lock_guard<Mutex> guard(m_lock);
-    typename std::map<epid<Alloc>, mailbox_ptr>::iterator it = m_by_pid.find(a_pid);
+    typename std::unordered_map<epid<Alloc>, mailbox_ptr>::iterator it = m_by_pid.find(a_pid);
     if (it != m_by_pid.end())
         return it->second;
     throw err_no_process("Process not found", a_pid);
 }
 
+/**
+ * Look up a mailbox based on its active alias.
+ * @throws err_no_process
+ */
+template <typename Alloc, typename Mutex>
+typename basic_otp_mailbox_registry<Alloc, Mutex>::mailbox_ptr
+basic_otp_mailbox_registry<Alloc, Mutex>::get(const ref<Alloc>& a_alias) const
+{
+    lock_guard<Mutex> guard(m_lock);
+    auto it = m_by_alias.find(a_alias);
+    if (it != m_by_alias.end())
+        return it->second;
+    throw err_no_process("Alias not active", a_alias);
+}
+
 template <typename Alloc, typename Mutex>
 void basic_otp_mailbox_registry<Alloc, Mutex>::names(std::list<atom>& list)
 {
@@ -220,8 +255,8 @@ void basic_otp_mailbox_registry<Alloc, Mutex>::pids(std::list<epid<Alloc> >& lis
     list.clear();
     lock_guard<Mutex> guard(m_lock);
     list.resize(m_by_pid.size());
-    for(typename std::map<epid<Alloc>, mailbox_ptr>::const_iterator
-        it = m_by_pid.begin(), end = m_by_pid.eend(); it != end; ++it)
+    for(typename std::unordered_map<epid<Alloc>, mailbox_ptr>::const_iterator
+        it = m_by_pid.begin(), end = m_by_pid.end(); it != end; ++it)
         list.push_back(it->first);
 }
 
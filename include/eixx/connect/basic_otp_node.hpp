@@ -39,6 +39,7 @@ limitations under the License.
 #include <eixx/connect/basic_otp_node_local.hpp>
 #include <eixx/connect/basic_otp_connection.hpp>
 #include <eixx/connect/basic_otp_mailbox_registry.hpp>
+#include <eixx/connect/basic_node_ring.hpp>
 #include <eixx/connect/transport_msg.hpp>
 #include <eixx/connect/verbose.hpp>
 #include <eixx/util/sync.hpp>
@@ -85,16 +86,20 @@ class basic_otp_node: public basic_otp_node_local {
     uint32_t                                    m_creation;
     std::atomic_int                             m_pid_count;
     std::atomic_int                             m_port_count;
-    std::atomic_uint_fast64_t                   m_refid0;
-    std::atomic_int                             m_refid1;
+    std::atomic_uint_fast64_t                   m_refid;
 
     boost::asio::io_service&                    m_io_service;
     basic_otp_mailbox_registry<Alloc, Mutex>    m_mailboxes;
+    std::unique_ptr<basic_otp_mailbox<Alloc, Mutex>> m_call_mbox;  // Used by call()
     conn_hash_map                               m_connections;
+    basic_node_ring<Alloc, Mutex>               m_ring;
     Alloc                                       m_allocator;
     verbose_type                                m_verboseness;
 
     friend class basic_otp_connection<Alloc, Mutex>;
+    friend class basic_otp_mailbox<Alloc, Mutex>;
+
+    void on_connect_internal(const connection_t& a_con, atom a_remote_nodename);
 
     void on_disconnect_internal(const connection_t& a_con,
         atom a_remote_nodename, const boost::system::error_code& err);
@@ -105,6 +110,17 @@ class basic_otp_node: public basic_otp_node_local {
         const atom& a_mod, const atom& a_fun, const list<Alloc>& a_args,
         const eterm<Alloc>& a_gleader);
 
+    /// Serve a SPAWN_REQUEST using on_spawn_request and send the reply.
+    void spawn(const transport_msg<Alloc>& a_req);
+
+    /// Id bit marking the refs created by create_call_ref()
+    static const uint32_t CALL_REF_BIT = 1u << 31;
+
+    ref<Alloc> new_ref(uint32_t a_tag);
+
+    /// Mailbox making call()s on behalf of the node.
+    basic_otp_mailbox<Alloc, Mutex>& call_mailbox();
+
 protected:
     /// Publish the node port to epmd making this node known to the world.
     /// @throws err_connection
@@ -123,6 +139,7 @@ protected:
         ToProc a_to, const transport_msg<Alloc>& a_msg);
 public:
     typedef basic_otp_mailbox_registry<Alloc, Mutex> mailbox_registry_t;
+    typedef basic_node_ring<Alloc, Mutex>            node_ring_t;
 
     /**
      * Create a new node, using given cookie
@@ -209,11 +226,24 @@ public:
     port<Alloc> create_port();
 
     /// Create a new unique ref
-    ref<Alloc> create_ref();
+    ref<Alloc> create_ref() { return new_ref(0); }
+
+    /// Create a new unique ref tagging a call (see basic_otp_mailbox::call()).
+    ref<Alloc> create_call_ref() { return new_ref(CALL_REF_BIT); }
+
+    /// True if \a a_ref was created by create_call_ref() of this node.
+    bool is_call_ref(const ref<Alloc>& a_ref) const {
+        return a_ref.len() >= 3 && (a_ref.id(2) & CALL_REF_BIT) && a_ref.node() == m_nodename;
+    }
 
     /// Get creation number
     uint32_t creation() const { return m_creation; }
 
+    /// Distribution flags (DFLAG_*) of the connection to \a a_nodename.
+    /// These are the flags of this node for the local node name, and 0
+    /// when not connected to \a a_nodename.
+    uint64_t remote_flags(const atom& a_nodename) const;
+
     /**
      * Set up a connection to an Erlang node, using given cookie
      * @param a_remote_node node name to connect
@@ -245,6 +275,25 @@ public:
     /// @throws err_connection if not connected to \a a_node._
     connection_t& connection(atom a_nodename) const;
 
+    /// Returns true if there's an established connection to the \a a_node.
+    bool connected(const atom& a_nodename) const;
+
+    /// Consistent hash ring of nodes used by send_by_key(). The liveness
+    /// of the ring's nodes is updated on connect and disconnect events.
+    node_ring_t&       ring()       { return m_ring; }
+    const node_ring_t& ring() const { return m_ring; }
+
+    /// Add a node to the ring() marking it up if it's connected or local.
+    bool ring_add(const atom& a_nodename);
+
+    /**
+     * Callback invoked on successful connection to a peer node
+     */
+    boost::function<
+        //    OtpNode      OtpConnection  RemoteNodeName
+        void (self&, const connection_t&, atom)
+    > on_connect;
+
     /**
      * Callback invoked on disconnect from a peer node
      */
@@ -267,6 +316,22 @@ public:
                       const atom& a_mod, const atom& a_fun, const list<Alloc>& a_args,
                       const eterm<Alloc>& a_gleader)
     > on_rpc_call;
+    /**
+     * Factory of the processes spawned on this node by spawn requests of
+     * other nodes.  It's passed the requester's pid and the module,
+     * function and arguments of the request, and returns a new mailbox
+     * serving the request (e.g. made with create_mailbox()), or NULL to
+     * reject it with `badarg`.  Requests are rejected with `notsup` if the
+     * factory isn't set.  The `link` and `monitor` options of the request
+     * are applied to the mailbox after the factory returns, and the reply
+     * is sent right after that, so the factory must not send signals to
+     * the requester.
+     */
+    boost::function<
+        basic_otp_mailbox<Alloc, Mutex>* (self&, const epid<Alloc>& a_from,
+            const atom& a_mod, const atom& a_fun, const list<Alloc>& a_args)
+    > on_spawn_request;
+
     /**
      * Accept connections from client processes.
      * This method sets the socket listener for incoming connections and
@@ -288,6 +353,16 @@ public:
     /// @throws err_connection
     void deliver(const transport_msg<Alloc>& a_tm);
 
+    /// Deliver a message received by a connection, whose payload took
+    /// \a a_bytes on the wire and passed admit().
+    void deliver(const transport_msg<Alloc>& a_tm, size_t a_bytes);
+
+    /// Apply the overload policy of the recipient of a message received
+    /// by a connection before its payload is decoded (see
+    /// basic_otp_mailbox::admit_received()).  \a a_tm holds only the
+    /// control message.  @return false if the message is to be dropped.
+    bool admit(const transport_msg<Alloc>& a_tm, size_t a_bytes);
+
     /// Send a message \a a_msg from \a a_from pid to \a a_to pid.
     /// @param a_to is a remote process.
     /// @param a_msg is the message to send.
@@ -309,6 +384,14 @@ public:
     /// @throws err_connection
     void send(const epid<Alloc>& a_from, const atom& a_to, const eterm<Alloc>& a_msg);
 
+    /// Send a message \a a_msg from \a a_from pid to the process alias \a a_to
+    /// (see basic_otp_mailbox::alias()).  Like in Erlang, the message is
+    /// dropped if the alias isn't active.
+    /// @throws err_connection if the node of the alias isn't connected
+    /// @throws err_bad_argument if the node doesn't support aliases
+    void send_alias(const epid<Alloc>& a_from, const ref<Alloc>& a_to,
+        const eterm<Alloc>& a_msg);
+
     /// Send a message \a a_msg to the process registered as \a a_to_name
     /// on remote node \a a_node.
     /// @throws err_no_process
@@ -316,6 +399,19 @@ public:
     void send(const epid<Alloc>& a_from, const atom& a_to_node, const atom& a_to_name,
         const eterm<Alloc>& a_msg);
 
+    /// Send a message \a a_msg to the process registered as \a a_to_name
+    /// on the node of the ring() owning the \a a_key.  If the owner is
+    /// down, the message is sent to the next live node on the ring.
+    /// @return the name of the node the message was sent to.
+    /// @throws err_connection if none of the ring's nodes is up.
+    /// @throws err_no_process
+    atom send_by_key(const epid<Alloc>& a_from, const eterm<Alloc>& a_key,
+        const atom& a_to_name, const eterm<Alloc>& a_msg);
+
+    /// Same as above, but the message is sent on behalf of the node.
+    atom send_by_key(const eterm<Alloc>& a_key, const atom& a_to_name,
+        const eterm<Alloc>& a_msg);
+
     /**
 	 * Send an RPC request to a remote Erlang node.
 	 * @param a_from the caller's mailbox pid.
@@ -335,6 +431,49 @@ public:
                   const atom& a_mod, const atom& a_fun, const list<Alloc>& args,
                   const epid<Alloc>* gleader = NULL);
 
+    /**
+     * Make a gen_server:call/3 to the server \a a_to from a mailbox of
+     * the node, running the node's io_service in the calling thread until
+     * the reply arrives.  See basic_otp_mailbox::call().
+     * @throws err_timeout if there was no reply within \a a_timeout.
+     * @throws err_no_process if the server is down.
+     */
+    eterm<Alloc> call(const eterm<Alloc>& a_to, const eterm<Alloc>& a_request,
+                      milliseconds a_timeout = milliseconds(5000)) {
+        return call_mailbox().call(a_to, a_request, a_timeout);
+    }
+
+    /// Make a gen_server:call/3 to the server \a a_to from a mailbox of
+    /// the node, invoking \a a_on_reply with the outcome.  See
+    /// basic_otp_mailbox::async_call().
+    ref<Alloc> async_call(const eterm<Alloc>& a_to, const eterm<Alloc>& a_request,
+        const typename basic_otp_mailbox<Alloc, Mutex>::call_handler_type& a_on_reply,
+        milliseconds a_timeout = milliseconds(5000)) {
+        return call_mailbox().async_call(a_to, a_request, a_on_reply, a_timeout);
+    }
+
+    /// Spawn a process on \a a_node from a mailbox of the node invoking
+    /// \a a_on_reply with the outcome.  See basic_otp_mailbox::spawn_request().
+    ref<Alloc> spawn_request(const atom& a_node, const atom& a_mod, const atom& a_fun,
+        const list<Alloc>& a_args, const list<Alloc>& a_opts,
+        const typename basic_otp_mailbox<Alloc, Mutex>::call_handler_type& a_on_reply,
+        milliseconds a_timeout = milliseconds(5000),
+        const epid<Alloc>* a_gleader = NULL) {
+        return call_mailbox().spawn_request(a_node, a_mod, a_fun, a_args, a_opts,
+                                            a_on_reply, a_timeout, a_gleader);
+    }
+
+    /// Send a SPAWN_REQUEST with the request id \a a_req_id asking
+    /// \a a_node to spawn \a a_mod:a_fun(a_args) on behalf of \a a_from.
+    /// The SPAWN_REPLY is delivered to the mailbox of \a a_from, which is
+    /// also the group leader of the new process unless \a a_gleader is given.
+    /// @throws err_bad_argument if \a a_node doesn't support spawn requests.
+    /// @throws err_connection
+    void send_spawn_request(const ref<Alloc>& a_req_id, const epid<Alloc>& a_from,
+        const atom& a_node, const atom& a_mod, const atom& a_fun,
+        const list<Alloc>& a_args, const list<Alloc>& a_opts,
+        const epid<Alloc>* a_gleader = NULL);
+
     /// Execute an equivalent of rpc:cast(...). Doesn't return any value.
     /// @throws err_bad_argument
     /// @throws err_no_process
@@ -368,10 +507,23 @@ public:
     /// @throws err_connection
     void send_unlink(const epid<Alloc>& a_from, const epid<Alloc>& a_to);
 
+    /// Unlink the given pid with the UNLINK_ID signal, which the peer
+    /// acknowledges with UNLINK_ID_ACK carrying the same \a a_id.  The
+    /// node of \a a_to must support DFLAG_UNLINK_ID.
+    /// @throws err_no_process
+    /// @throws err_connection
+    void send_unlink_id(uint64_t a_id, const epid<Alloc>& a_from, const epid<Alloc>& a_to);
+
+    /// Acknowledge the UNLINK_ID signal \a a_id sent by \a a_to.
+    /// @throws err_no_process
+    /// @throws err_connection
+    void send_unlink_id_ack(uint64_t a_id, const epid<Alloc>& a_from, const epid<Alloc>& a_to);
+
+    /// Monitor the \a a_to_pid by \a a_from pid.
+    /// @return the reference of the monitor.
     /// @throws err_no_process
     /// @throws err_connection
-    const ref<Alloc>&
-    send_monitor(const epid<Alloc>& a_from, const epid<Alloc>& a_to_pid);
+    ref<Alloc> send_monitor(const epid<Alloc>& a_from, const epid<Alloc>& a_to_pid);
 
     /// Demonitor the \a a_to pid monitored by \a a_from pid using \a a_ref reference.
     /// @throws err_no_process
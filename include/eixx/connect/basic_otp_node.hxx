@@ -79,11 +79,11 @@ basic_otp_node(
     , m_creation((a_creation < 0 ? time(NULL) : (int)a_creation) & 0x03)
     , m_pid_count(1)
     , m_port_count(1)
-    , m_refid0(1)
-    , m_refid1(0)
+    , m_refid(1)
     , m_io_service(a_io_svc)
     , m_mailboxes(*this)
     , m_connections(atom_con_hash_fun::get_default_hash_size(), atom_con_hash_fun(&m_connections))
+    , m_ring(node_ring_t::DEFAULT_VNODES, a_alloc)
     , m_allocator(a_alloc)
     , m_verboseness(verboseness::level())
 {}
@@ -126,25 +126,23 @@ create_port()
 
 template <typename Alloc, typename Mutex>
 ref<Alloc> basic_otp_node<Alloc, Mutex>::
-create_ref()
+new_ref(uint32_t a_tag)
 {
-    uint_fast64_t n;
-    int mn;
-
-    while (true) {
-        n = m_refid0.fetch_add(1, std::memory_order_relaxed);
-        if (n) break;
-
-        int mo = m_refid1.load(std::memory_order_consume);
-        mn = mo+1;
-
-        if (mn > 0x3ffff) mn = 0;
-
-        if (m_refid1.compare_exchange_weak(mo, mn, std::memory_order_acquire))
-            break;
-    }
+    // The counter is spread over 18 bits of id0, 32 bits of id1 and the
+    // low bits of id2, so it doesn't wrap in the lifetime of the node
+    uint_fast64_t n = m_refid.fetch_add(1, std::memory_order_relaxed);
+    return ref<Alloc>(m_nodename, uint32_t(n & 0x3ffff), uint32_t(n >> 18),
+                      uint32_t(n >> 50) | a_tag, m_creation, m_allocator);
+}
 
-    return ref<Alloc>(m_nodename, mn, n, m_creation, m_allocator);
+template <typename Alloc, typename Mutex>
+basic_otp_mailbox<Alloc, Mutex>& basic_otp_node<Alloc, Mutex>::
+call_mailbox()
+{
+    lock_guard<Mutex> guard(m_lock);
+    if (!m_call_mbox)
+        m_call_mbox.reset(create_mailbox());
+    return *m_call_mbox;
 }
 
 template <typename Alloc, typename Mutex>
@@ -156,6 +154,13 @@ create_mailbox(const atom& a_name, boost::asio::io_service* a_svc)
     return m_mailboxes.create_mailbox(a_name, p_svc);
 }
 
+template <typename Alloc, typename Mutex>
+bool basic_otp_node<Alloc, Mutex>::
+register_mailbox(const atom& a_name, basic_otp_mailbox<Alloc, Mutex>& a_mbox)
+{
+    return m_mailboxes.add(a_name, &a_mbox);
+}
+
 template <typename Alloc, typename Mutex>
 void basic_otp_node<Alloc, Mutex>::
 close_mailbox(basic_otp_mailbox<Alloc, Mutex>* a_mbox)
@@ -179,6 +184,7 @@ void basic_otp_node<Alloc, Mutex>::
 close()
 {
     m_mailboxes.clear();
+    m_call_mbox.reset();
     for(typename conn_hash_map::iterator
         it = m_connections.begin(), end = m_connections.end(); it != end; ++it)
         it->second->disconnect();
@@ -204,6 +210,34 @@ connection(atom a_nodename) const
     return *l_con->second.get();
 }
 
+template <typename Alloc, typename Mutex>
+bool basic_otp_node<Alloc, Mutex>::
+connected(const atom& a_nodename) const
+{
+    auto l_con = m_connections.find(a_nodename);
+    return l_con != m_connections.end() && l_con->second->connected();
+}
+
+template <typename Alloc, typename Mutex>
+uint64_t basic_otp_node<Alloc, Mutex>::
+remote_flags(const atom& a_nodename) const
+{
+    if (a_nodename == nodename())
+        return LOCAL_FLAGS;
+    auto l_con = m_connections.find(a_nodename);
+    if (l_con == m_connections.end() || !l_con->second->connected() ||
+        !l_con->second->transport())
+        return 0;
+    return l_con->second->transport()->remote_flags();
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_node<Alloc, Mutex>::
+ring_add(const atom& a_nodename)
+{
+    return m_ring.add(a_nodename, a_nodename == nodename() || connected(a_nodename));
+}
+
 template <typename Alloc, typename Mutex>
 template <typename CompletionHandler>
 void basic_otp_node<Alloc, Mutex>::
@@ -229,10 +263,20 @@ void basic_otp_node<Alloc, Mutex>::
 on_disconnect_internal(const connection_t& a_con,
     atom a_remote_nodename, const boost::system::error_code& err)
 {
+    m_ring.set_up(a_remote_nodename, false);
     if (on_disconnect)
         on_disconnect(*this, a_con, a_remote_nodename, err);
 }
 
+template <typename Alloc, typename Mutex>
+void basic_otp_node<Alloc, Mutex>::
+on_connect_internal(const connection_t& a_con, atom a_remote_nodename)
+{
+    m_ring.set_up(a_remote_nodename, true);
+    if (on_connect)
+        on_connect(*this, a_con, a_remote_nodename);
+}
+
 template <typename Alloc, typename Mutex>
 void basic_otp_node<Alloc, Mutex>::
 rpc_call(const epid<Alloc>& a_from, const ref<Alloc>& a_ref,
@@ -286,12 +330,82 @@ report_status(report_level a_level, const connection_t* a_con, const std::string
 
 template <typename Alloc, typename Mutex>
 void basic_otp_node<Alloc, Mutex>::
+spawn(const transport_msg<Alloc>& a_req)
+{
+    const epid<Alloc>&  l_from   = a_req.sender_pid();
+    const tuple<Alloc>& l_mfa    = a_req.spawn_mfa();
+    eterm<Alloc>        l_result = am_notsup;
+    int                 l_flags  = 0;
+
+    if (on_spawn_request) {
+        basic_otp_mailbox<Alloc, Mutex>* l_mbox = NULL;
+        try {
+            l_mbox = on_spawn_request(*this, l_from, l_mfa[0].to_atom(),
+                                      l_mfa[1].to_atom(), a_req.msg().to_list());
+        } catch (std::exception& e) {
+            std::stringstream s;
+            s << "Spawn request " << l_mfa << " failed: " << e.what();
+            report_status(REPORT_WARNING, NULL, s.str());
+        }
+        if (l_mbox) {
+            l_flags  = l_mbox->spawned(l_from, a_req.spawn_ref(), a_req.spawn_opts());
+            l_result = l_mbox->self();
+        } else
+            l_result = am_badarg;
+    }
+
+    transport_msg<Alloc> tm;
+    tm.set_spawn_reply(a_req.spawn_ref(), l_from, l_flags, l_result, m_allocator);
+    send(l_from.node(), l_from, tm);
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_otp_node<Alloc, Mutex>::
+admit(const transport_msg<Alloc>& a_msg, size_t a_bytes)
+{
+    // Messages to aliases are left to deliver(), which deactivates them
+    if (!(a_msg.type() & (transport_msg<Alloc>::SEND    | transport_msg<Alloc>::SEND_TT |
+                          transport_msg<Alloc>::REG_SEND | transport_msg<Alloc>::REG_SEND_TT)))
+        return true;
+    try {
+        return get_mailbox(a_msg.recipient())->admit_received(a_msg, a_bytes);
+    } catch (std::exception&) {
+        // Delivery reports the missing recipient
+        return true;
+    }
+}
+
+template <typename Alloc, typename Mutex>
+void inline basic_otp_node<Alloc, Mutex>::
 deliver(const transport_msg<Alloc>& a_msg)
+{
+    deliver(a_msg, size_t(-1));
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_node<Alloc, Mutex>::
+deliver(const transport_msg<Alloc>& a_msg, size_t a_bytes)
 {
     try {
+        if (a_msg.type() & (transport_msg<Alloc>::SPAWN_REQUEST |
+                            transport_msg<Alloc>::SPAWN_REQUEST_TT)) {
+            spawn(a_msg);
+            return;
+        }
         const eterm<Alloc>& l_to = a_msg.recipient();
         basic_otp_mailbox<Alloc, Mutex>* l_mbox = get_mailbox(l_to);
-        l_mbox->deliver(a_msg);
+        if (a_bytes == size_t(-1))
+            l_mbox->deliver(a_msg);
+        else
+            l_mbox->deliver_received(a_msg, a_bytes);
+    } catch (err_no_process& e) {
+        // Like in Erlang, messages to inactive aliases are dropped silently
+        if (a_msg.type() == transport_msg<Alloc>::ALIAS_SEND ||
+            a_msg.type() == transport_msg<Alloc>::ALIAS_SEND_TT)
+            return;
+        std::stringstream s;
+        s << "Cannot deliver message " << a_msg.to_string() << ": " << e.what();
+        report_status(REPORT_WARNING, NULL, s.str());
     } catch (std::exception& e) {
         // FIXME: Add proper error reporting.
         std::stringstream s;
@@ -352,6 +466,43 @@ send(const epid<Alloc>& a_from, const atom& a_to_node, const atom& a_to, const e
     send(a_to_node, a_to, tm);
 }
 
+template <typename Alloc, typename Mutex>
+void basic_otp_node<Alloc, Mutex>::
+send_alias(const epid<Alloc>& a_from, const ref<Alloc>& a_to, const eterm<Alloc>& a_msg)
+{
+    transport_msg<Alloc> tm;
+    tm.set_alias_send(a_from, a_to, a_msg, m_allocator);
+    if (a_to.node() == nodename()) {
+        // Messages sent to an inactive alias are dropped
+        try { send(nodename(), a_to, tm); } catch (err_no_process&) {}
+        return;
+    }
+    connection_t& l_con = connection(a_to.node());
+    if (l_con.connected() && !(remote_flags(a_to.node()) & DFLAG_ALIAS))
+        throw err_bad_argument("Node doesn't support process aliases", a_to.node());
+    l_con.send(tm);
+}
+
+template <typename Alloc, typename Mutex>
+atom basic_otp_node<Alloc, Mutex>::
+send_by_key(const epid<Alloc>& a_from, const eterm<Alloc>& a_key,
+            const atom& a_to_name, const eterm<Alloc>& a_msg)
+{
+    atom l_node = m_ring.route(a_key);
+    if (l_node.empty())
+        throw err_connection("No live node in the ring for key", a_key.to_string());
+    send(a_from, l_node, a_to_name, a_msg);
+    return l_node;
+}
+
+template <typename Alloc, typename Mutex>
+atom inline basic_otp_node<Alloc, Mutex>::
+send_by_key(const eterm<Alloc>& a_key, const atom& a_to_name, const eterm<Alloc>& a_msg)
+{
+    return send_by_key(epid<Alloc>(nodename(), 0, 0, m_creation, m_allocator),
+                       a_key, a_to_name, a_msg);
+}
+
 template <typename Alloc, typename Mutex>
 void inline basic_otp_node<Alloc, Mutex>::
 send_rpc(const epid<Alloc>& a_from,
@@ -405,6 +556,27 @@ send_link(const epid<Alloc>& a_from, const epid<Alloc>& a_to)
     send(a_to.node(), a_to, tm);
 }
 
+template <typename Alloc, typename Mutex>
+void basic_otp_node<Alloc, Mutex>::
+send_spawn_request(const ref<Alloc>& a_req_id, const epid<Alloc>& a_from,
+    const atom& a_node, const atom& a_mod, const atom& a_fun,
+    const list<Alloc>& a_args, const list<Alloc>& a_opts, const epid<Alloc>* a_gleader)
+{
+    // By default the requester is the group leader, as there's no io
+    // server on this node
+    transport_msg<Alloc> tm;
+    tm.set_spawn_request(a_req_id, a_from, a_gleader ? *a_gleader : a_from,
+                         a_mod, a_fun, a_args, a_opts, m_allocator);
+    if (a_node == nodename()) {
+        deliver(tm);
+        return;
+    }
+    connection_t& l_con = connection(a_node);
+    if (!(remote_flags(a_node) & DFLAG_SPAWN))
+        throw err_bad_argument("Node doesn't support spawn requests", a_node);
+    l_con.send(tm);
+}
+
 template <typename Alloc, typename Mutex>
 void basic_otp_node<Alloc, Mutex>::
 send_unlink(const epid<Alloc>& a_from, const epid<Alloc>& a_to)
@@ -415,7 +587,25 @@ send_unlink(const epid<Alloc>& a_from, const epid<Alloc>& a_to)
 }
 
 template <typename Alloc, typename Mutex>
-const ref<Alloc>& basic_otp_node<Alloc, Mutex>::
+void basic_otp_node<Alloc, Mutex>::
+send_unlink_id(uint64_t a_id, const epid<Alloc>& a_from, const epid<Alloc>& a_to)
+{
+    transport_msg<Alloc> tm;
+    tm.set_unlink_id(a_id, a_from, a_to, m_allocator);
+    send(a_to.node(), a_to, tm);
+}
+
+template <typename Alloc, typename Mutex>
+void basic_otp_node<Alloc, Mutex>::
+send_unlink_id_ack(uint64_t a_id, const epid<Alloc>& a_from, const epid<Alloc>& a_to)
+{
+    transport_msg<Alloc> tm;
+    tm.set_unlink_id_ack(a_id, a_from, a_to, m_allocator);
+    send(a_to.node(), a_to, tm);
+}
+
+template <typename Alloc, typename Mutex>
+ref<Alloc> basic_otp_node<Alloc, Mutex>::
 send_monitor(const epid<Alloc>& a_from, const epid<Alloc>& a_to)
 {
     transport_msg<Alloc> tm;
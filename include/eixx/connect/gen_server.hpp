@@ -0,0 +1,383 @@
+//----------------------------------------------------------------------------
+/// \file  gen_server.hpp
+//----------------------------------------------------------------------------
+/// \brief A server loop implementing the gen_server protocol over a mailbox.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#ifndef _EIXX_GEN_SERVER_HPP_
+#define _EIXX_GEN_SERVER_HPP_
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <eixx/connect/basic_otp_node.hpp>
+#include <eixx/eterm_exception.hpp>
+
+namespace eixx {
+namespace connect {
+
+/// Action requested by a gen_server callback.
+enum class gen_action {
+    CONTINUE,   ///< Wait for the next message
+    HIBERNATE,  ///< Release pooled buffers and wait for the next message
+    STOP        ///< Stop processing messages
+};
+
+template <typename Alloc, typename Mutex> class basic_gen_server;
+
+/**
+ * Caller of a gen_server:call/2,3 request.  The token carries the reply
+ * message {Tag, Reply} prebuilt with the caller's tag (a reference or an
+ * [alias | Ref] list), so that replying doesn't parse or rebuild terms.
+ * It can be copied and kept to reply later (see basic_gen_server::reply()),
+ * and is good for one reply.
+ */
+template <typename Alloc>
+class gen_from {
+    epid<Alloc>  m_pid;
+    tuple<Alloc> m_reply;
+
+    template <typename A, typename M> friend class basic_gen_server;
+
+public:
+    gen_from() {}
+    gen_from(const epid<Alloc>& a_pid, tuple<Alloc>&& a_reply)
+        : m_pid(a_pid), m_reply(std::move(a_reply))
+    {}
+
+    /// Pid of the caller.
+    const epid<Alloc>&  pid()   const { return m_pid; }
+    /// Tag identifying the call.
+    const eterm<Alloc>& tag()   const { return m_reply[0]; }
+    /// False if the reply was already sent.
+    bool                valid() const { return m_reply.use_count() > 0; }
+};
+
+/**
+ * Adapter implementing an Erlang gen_server on top of a mailbox, so that
+ * Erlang processes can use gen_server:call/cast and sys:get_state/1
+ * with it.  Derived classes override handle_call(), handle_cast() and
+ * handle_info():
+ * <ul>
+ *   <li>{'$gen_call', {Pid, Tag}, Request} goes to handle_call(), which
+ *       either replies right away, or keeps the gen_from token and replies
+ *       later with reply();</li>
+ *   <li>{'$gen_cast', Request} goes to handle_cast();</li>
+ *   <li>{system, {Pid, Tag}, Request} is answered by the server for
+ *       get_state, suspend and resume requests;</li>
+ *   <li>other messages, and the 'timeout' atom when no message arrives
+ *       within timeout(), go to handle_info();</li>
+ *   <li>link, exit and monitor signals go to handle_signal().</li>
+ * </ul>
+ * Messages are processed either asynchronously in the mailbox's
+ * io_service after start(), or synchronously with poll().
+ */
+template <typename Alloc, typename Mutex>
+class basic_gen_server {
+public:
+    typedef basic_otp_mailbox<Alloc, Mutex> mailbox_type;
+    typedef gen_from<Alloc>                 from_type;
+
+    /// Create a server with a new mailbox of \a a_node registered
+    /// as \a a_name (if not empty).
+    explicit basic_gen_server(basic_otp_node<Alloc, Mutex>& a_node,
+                              const atom& a_name = atom())
+        : m_mbox(a_node.create_mailbox(a_name))
+        , m_timeout(-1)
+        , m_active(false), m_suspended(false)
+        , m_handler([this](mailbox_type&, transport_msg<Alloc>*& a_msg) {
+            return on_receive(a_msg);
+          })
+    {}
+
+    virtual ~basic_gen_server() { stop(); }
+
+    mailbox_type&       mailbox()   { return *m_mbox; }
+    const epid<Alloc>&  self() const { return m_mbox->self(); }
+
+    /// Time without messages after which handle_info('timeout') is called
+    /// (negative - never).  Takes effect on the next start().
+    milliseconds timeout() const        { return m_timeout; }
+    void         timeout(milliseconds a) { m_timeout = a; }
+
+    /// True if the server processes sys:suspend'ed - only system
+    /// messages are processed until it's resumed.
+    bool suspended() const { return m_suspended; }
+
+    /// Start processing messages asynchronously in the mailbox's io_service.
+    void start() {
+        m_active = true;
+        m_last   = steady_clock::now();
+        m_mbox->async_receive(m_handler, m_timeout, -1);
+    }
+
+    /// Stop asynchronous processing of messages started with start().
+    void stop() {
+        if (!m_active)
+            return;
+        m_active = false;
+        m_mbox->cancel_async_receive();
+    }
+
+    /// Process the messages waiting in the mailbox.
+    /// @return the number of processed messages.
+    size_t poll() {
+        size_t n = 0;
+        for (transport_msg<Alloc>* p; (p = m_mbox->receive()) != nullptr; ++n) {
+            std::unique_ptr<transport_msg<Alloc>> msg(p);
+            if (!dispatch(*msg))
+                return n+1;
+        }
+        return n;
+    }
+
+    /// Process a message.
+    /// @return false if a callback requested the server to stop.
+    bool dispatch(const transport_msg<Alloc>& a_msg);
+
+    /// Reply to a call, which handle_call() didn't reply to right away.
+    /// Calls tagged with [alias, Ref] are replied to through the alias,
+    /// so that a late reply to a caller that gave up on it is dropped.
+    /// @throws err_bad_argument if the reply was already sent.
+    void reply(from_type& a_from, const eterm<Alloc>& a_reply);
+
+    /// Number of reply tuples kept for reuse.
+    size_t pooled() const { return m_spare.size(); }
+
+    /// Release the buffers kept for reuse.  Done by the server when a
+    /// callback returns gen_action::HIBERNATE.
+    void hibernate() {
+        m_spare.clear();
+        m_spare.shrink_to_fit();
+        m_saved.shrink_to_fit();
+    }
+
+protected:
+    /// Handle a gen_server:call/2,3 request.  The implementation must call
+    /// reply(a_from, Reply) now, or keep a copy of \a a_from and do it later.
+    /// The server never replies on its own: a call left unanswered when
+    /// returning HIBERNATE or STOP waits for the caller's timeout.
+    virtual gen_action handle_call(const eterm<Alloc>& a_request, from_type& a_from) = 0;
+
+    /// Handle a gen_server:cast/2 request.
+    virtual gen_action handle_cast(const eterm<Alloc>&) { return gen_action::CONTINUE; }
+
+    /// Handle any other message.
+    virtual gen_action handle_info(const eterm<Alloc>&) { return gen_action::CONTINUE; }
+
+    /// Handle a link, exit or monitor signal.
+    virtual gen_action handle_signal(const transport_msg<Alloc>&) { return gen_action::CONTINUE; }
+
+    /// State returned by sys:get_state/1.
+    virtual eterm<Alloc> state() const { return am_undefined; }
+
+private:
+    static const size_t s_max_spare = 16;
+
+    std::unique_ptr<mailbox_type>                   m_mbox;
+    milliseconds                                    m_timeout;
+    bool                                            m_active;
+    bool                                            m_suspended;
+    steady_clock::time_point                        m_last;
+    typename mailbox_type::receive_handler_type     m_handler;
+    std::vector<tuple<Alloc>>                       m_spare;    // Reply tuples to reuse
+    std::deque<transport_msg<Alloc>>                m_saved;    // Received while suspended
+
+    bool on_receive(transport_msg<Alloc>* a_msg);
+
+    /// Get a {Tag, undefined} tuple, reusing a sent reply no longer
+    /// referenced by its receiver.
+    tuple<Alloc> make_reply(const eterm<Alloc>& a_tag);
+
+    /// Decode the {Pid, Tag} caller of a call or a system request.
+    bool caller(const eterm<Alloc>& a_from, from_type& a_token) {
+        if (a_from.type() != TUPLE)
+            return false;
+        const tuple<Alloc>& from = a_from.to_tuple();
+        if (from.size() != 2 || from[0].type() != PID)
+            return false;
+        a_token = from_type(from[0].to_pid(), make_reply(from[1]));
+        return true;
+    }
+
+    /// Answer a sys module request.
+    bool system(from_type& a_from, const eterm<Alloc>& a_request);
+
+    bool process(const transport_msg<Alloc>& a_msg);
+
+    bool done(gen_action a_action) {
+        switch (a_action) {
+            case gen_action::STOP:      return false;
+            case gen_action::HIBERNATE: hibernate(); return true;
+            default:                    return true;
+        }
+    }
+};
+
+//------------------------------------------------------------------------------
+// basic_gen_server implementation
+//------------------------------------------------------------------------------
+
+template <typename Alloc, typename Mutex>
+bool basic_gen_server<Alloc, Mutex>::
+on_receive(transport_msg<Alloc>* a_msg)
+{
+    if (!m_active)
+        return false;
+
+    auto now = steady_clock::now();
+    if (a_msg) {
+        m_last = now;
+        return m_active = dispatch(*a_msg);
+    }
+
+    // The queue reports a timeout when its wait is interrupted with no
+    // messages left, so check the time since the last message
+    if (m_timeout < milliseconds(0) || m_suspended || now - m_last < m_timeout)
+        return true;
+    m_last = now;
+    return m_active = done(handle_info(am_timeout));
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_gen_server<Alloc, Mutex>::
+dispatch(const transport_msg<Alloc>& a_msg)
+{
+    if (!m_suspended)
+        return process(a_msg);
+
+    // Only system messages are handled while suspended
+    if (a_msg.has_msg()) {
+        const eterm<Alloc>& msg = a_msg.msg();
+        if (msg.type() == TUPLE && msg.to_tuple().size() == 3 &&
+            msg.to_tuple()[0] == am_system)
+            return process(a_msg);
+    }
+
+    m_saved.push_back(a_msg);
+    return true;
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_gen_server<Alloc, Mutex>::
+process(const transport_msg<Alloc>& a_msg)
+{
+    if (!a_msg.has_msg())
+        return done(handle_signal(a_msg));
+
+    const eterm<Alloc>& msg = a_msg.msg();
+    if (msg.type() != TUPLE)
+        return done(handle_info(msg));
+
+    const tuple<Alloc>& t = msg.to_tuple();
+    const eterm<Alloc>& head = t.size() ? t[0] : msg;
+
+    if (head.type() != ATOM)
+        return done(handle_info(msg));
+
+    from_type from;
+
+    // {'$gen_call', {Pid, Tag}, Request}
+    if (head == am_gen_call && t.size() == 3 && caller(t[1], from))
+        return done(handle_call(t[2], from));
+
+    // {'$gen_cast', Request}
+    if (head == am_gen_cast && t.size() == 2)
+        return done(handle_cast(t[1]));
+
+    // {system, {Pid, Tag}, Request}
+    if (head == am_system && t.size() == 3 && caller(t[1], from))
+        return system(from, t[2]);
+
+    return done(handle_info(msg));
+}
+
+template <typename Alloc, typename Mutex>
+bool basic_gen_server<Alloc, Mutex>::
+system(from_type& a_from, const eterm<Alloc>& a_request)
+{
+    if (a_request == am_get_state)
+        reply(a_from, state());
+    else if (a_request == am_suspend) {
+        m_suspended = true;
+        reply(a_from, am_ok);
+    } else if (a_request == am_resume) {
+        bool resumed = m_suspended;
+        m_suspended  = false;
+        reply(a_from, am_ok);
+        // Process the messages received while suspended
+        while (resumed && !m_saved.empty() && !m_suspended) {
+            transport_msg<Alloc> msg(std::move(m_saved.front()));
+            m_saved.pop_front();
+            if (!process(msg))
+                return false;
+        }
+    } else
+        reply(a_from, tuple<Alloc>::make(am_error,
+                        tuple<Alloc>::make(am_unknown_system_msg, a_request)));
+    return true;
+}
+
+template <typename Alloc, typename Mutex>
+tuple<Alloc> basic_gen_server<Alloc, Mutex>::
+make_reply(const eterm<Alloc>& a_tag)
+{
+    for (size_t i = 0, n = m_spare.size(); i < n; ++i) {
+        if (m_spare[i].use_count() != 1)
+            continue;
+        tuple<Alloc> t(std::move(m_spare[i]));
+        if (i != n-1)
+            m_spare[i] = std::move(m_spare.back());
+        m_spare.pop_back();
+        t.set(0, a_tag);
+        t.set(1, am_undefined);
+        return t;
+    }
+    return tuple<Alloc>::make(a_tag, am_undefined);
+}
+
+template <typename Alloc, typename Mutex>
+void basic_gen_server<Alloc, Mutex>::
+reply(from_type& a_from, const eterm<Alloc>& a_reply)
+{
+    if (!a_from.valid())
+        throw err_bad_argument("Reply already sent");
+    a_from.m_reply.set(1, a_reply);
+    const eterm<Alloc>& tag = a_from.tag();
+    if (tag.type() == LIST && tag.to_list().length() == 2 &&
+        tag.to_list().nth(0) == am_alias && tag.to_list().nth(1).type() == REF)
+        m_mbox->send(tag.to_list().nth(1).to_ref(), eterm<Alloc>(a_from.m_reply));
+    else
+        m_mbox->send(a_from.pid(), eterm<Alloc>(a_from.m_reply));
+    if (m_spare.size() < s_max_spare)
+        m_spare.push_back(std::move(a_from.m_reply));
+    else
+        a_from.m_reply = tuple<Alloc>();
+}
+
+} // namespace connect
+} // namespace eixx
+
+#endif // _EIXX_GEN_SERVER_HPP_
@@ -49,27 +49,43 @@ using eixx::marshal::trace;
 template <typename Alloc>
 class transport_msg {
 public:
-    enum transport_msg_type {
+    /// Control message type bits.  Message types of OTP 24 exceed 31,
+    /// so the mask is 64 bits wide.
+    enum transport_msg_type : uint64_t {
           UNDEFINED         = 0
-        , LINK              = 1 << ERL_LINK
-        , SEND              = 1 << ERL_SEND
-        , EXIT              = 1 << ERL_EXIT
-        , UNLINK            = 1 << ERL_UNLINK
-        , NODE_LINK         = 1 << ERL_NODE_LINK
-        , REG_SEND          = 1 << ERL_REG_SEND
-        , GROUP_LEADER      = 1 << ERL_GROUP_LEADER
-        , EXIT2             = 1 << ERL_EXIT2
-        , SEND_TT           = 1 << ERL_SEND_TT
-        , EXIT_TT           = 1 << ERL_EXIT_TT
-        , REG_SEND_TT       = 1 << ERL_REG_SEND_TT
-        , EXIT2_TT          = 1 << ERL_EXIT2_TT
-        , MONITOR_P         = 1 << ERL_MONITOR_P
-        , DEMONITOR_P       = 1 << ERL_DEMONITOR_P
-        , MONITOR_P_EXIT    = 1 << ERL_MONITOR_P_EXIT
+        , LINK              = 1ull << ERL_LINK
+        , SEND              = 1ull << ERL_SEND
+        , EXIT              = 1ull << ERL_EXIT
+        , UNLINK            = 1ull << ERL_UNLINK
+        , NODE_LINK         = 1ull << ERL_NODE_LINK
+        , REG_SEND          = 1ull << ERL_REG_SEND
+        , GROUP_LEADER      = 1ull << ERL_GROUP_LEADER
+        , EXIT2             = 1ull << ERL_EXIT2
+        , SEND_TT           = 1ull << ERL_SEND_TT
+        , EXIT_TT           = 1ull << ERL_EXIT_TT
+        , REG_SEND_TT       = 1ull << ERL_REG_SEND_TT
+        , EXIT2_TT          = 1ull << ERL_EXIT2_TT
+        , MONITOR_P         = 1ull << ERL_MONITOR_P
+        , DEMONITOR_P       = 1ull << ERL_DEMONITOR_P
+        , MONITOR_P_EXIT    = 1ull << ERL_MONITOR_P_EXIT
+        , SPAWN_REQUEST     = 1ull << ERL_SPAWN_REQUEST
+        , SPAWN_REQUEST_TT  = 1ull << ERL_SPAWN_REQUEST_TT
+        , SPAWN_REPLY       = 1ull << ERL_SPAWN_REPLY
+        , SPAWN_REPLY_TT    = 1ull << ERL_SPAWN_REPLY_TT
+        , ALIAS_SEND        = 1ull << ERL_ALIAS_SEND
+        , ALIAS_SEND_TT     = 1ull << ERL_ALIAS_SEND_TT
+        , UNLINK_ID         = 1ull << ERL_UNLINK_ID
+        , UNLINK_ID_ACK     = 1ull << ERL_UNLINK_ID_ACK
         //---------------------------
-        , EXCEPTION         = 1 << 31   // Non-Erlang defined code representing 
-                                        // message handling exception
-        , NO_EXCEPTION_MASK = (uint32_t)EXCEPTION-1
+        , EXCEPTION         = 1ull << 63  // Non-Erlang defined code representing
+                                          // message handling exception
+        , NO_EXCEPTION_MASK = EXCEPTION-1
+    };
+
+    /// Flags of SPAWN_REPLY reporting the options applied to the new process.
+    enum spawn_reply_flag {
+          SPAWN_LINKED      = 1     ///< The process is linked to the requester
+        , SPAWN_MONITORED   = 2     ///< The process is monitored by the requester
     };
 
 private:
@@ -83,7 +99,7 @@ public:
     transport_msg() : m_type(UNDEFINED) {}
 
     transport_msg(int a_msgtype, const tuple<Alloc>& a_cntrl, const eterm<Alloc>* a_msg = NULL)
-        : m_type(1 << a_msgtype), m_cntrl(a_cntrl)
+        : m_type(static_cast<transport_msg_type>(1ull << a_msgtype)), m_cntrl(a_cntrl)
     {
         if (a_msg)
             new (&m_msg) eterm<Alloc>(*a_msg);
@@ -136,7 +152,14 @@ public:
             case MONITOR_P:
             case DEMONITOR_P:
             case MONITOR_P_EXIT:
+            case ALIAS_SEND:
+            case ALIAS_SEND_TT:
                 return m_cntrl[1];
+            case UNLINK_ID:
+            case UNLINK_ID_ACK:
+            case SPAWN_REQUEST:
+            case SPAWN_REQUEST_TT:
+                return m_cntrl[2];
             default:
                 throw err_wrong_type(m_type, "transport_msg.from()");
         }
@@ -149,9 +172,10 @@ public:
         return sender().to_pid();
     }
 
-    /// Return the term representing the message sender. The sender is
-    /// usually a pid, except for MONITOR_P|DEMONITOR_P message type for which 
-    /// the sender can be either pid or atom name.
+    /// Return the term representing the message recipient. The recipient is
+    /// usually a pid, except for MONITOR_P|DEMONITOR_P message type for which
+    /// it can be either pid or atom name, and ALIAS_SEND for which it's
+    /// a ref (process alias).
     const eterm<Alloc>& recipient() const {
         switch (m_type) {
             case REG_SEND:
@@ -170,7 +194,14 @@ public:
             case MONITOR_P:
             case DEMONITOR_P:
             case MONITOR_P_EXIT:
+            case ALIAS_SEND:
+            case ALIAS_SEND_TT:
+            case SPAWN_REPLY:
+            case SPAWN_REPLY_TT:
                 return m_cntrl[2];
+            case UNLINK_ID:
+            case UNLINK_ID_ACK:
+                return m_cntrl[3];
             default:
                 throw err_wrong_type(m_type, "transport_msg.to()");
         }
@@ -193,10 +224,13 @@ public:
         switch (m_type) {
             case SEND_TT:
             case EXIT_TT:
-            case EXIT2_TT:      return m_cntrl[3];
+            case EXIT2_TT:
+            case ALIAS_SEND_TT: return m_cntrl[3];
             case REG_SEND_TT:   return m_cntrl[4];
+            case SPAWN_REPLY_TT:    return m_cntrl[5];
+            case SPAWN_REQUEST_TT:  return m_cntrl[6];
             default:
-                throw err_wrong_type(m_type, "SEND_TT|EXIT_TT|EXIT2_TT|REG_SEND_TT");
+                throw err_wrong_type(m_type, "SEND_TT|EXIT_TT|EXIT2_TT|REG_SEND_TT|ALIAS_SEND_TT|SPAWN_*_TT");
         }
     }
 
@@ -212,6 +246,62 @@ public:
         }
     }
 
+    /// Request id of the SPAWN_REQUEST|SPAWN_REPLY signals.
+    /// @throws err_wrong_type
+    const ref<Alloc>& spawn_ref() const {
+        switch (m_type) {
+            case SPAWN_REQUEST:
+            case SPAWN_REQUEST_TT:
+            case SPAWN_REPLY:
+            case SPAWN_REPLY_TT:    return m_cntrl[1].to_ref();
+            default:
+                throw err_wrong_type(m_type, "SPAWN_REQUEST|SPAWN_REPLY");
+        }
+    }
+
+    /// {Module, Function, Arity} of the process requested by SPAWN_REQUEST.
+    /// @throws err_wrong_type
+    const tuple<Alloc>& spawn_mfa() const {
+        if (!(m_type & (SPAWN_REQUEST | SPAWN_REQUEST_TT)))
+            throw err_wrong_type(m_type, "SPAWN_REQUEST");
+        return m_cntrl[4].to_tuple();
+    }
+
+    /// Option list of SPAWN_REQUEST.
+    /// @throws err_wrong_type
+    const list<Alloc>& spawn_opts() const {
+        if (!(m_type & (SPAWN_REQUEST | SPAWN_REQUEST_TT)))
+            throw err_wrong_type(m_type, "SPAWN_REQUEST");
+        return m_cntrl[5].to_list();
+    }
+
+    /// SPAWN_REPLY flags (see spawn_reply_flag).
+    /// @throws err_wrong_type
+    int spawn_flags() const {
+        if (!(m_type & (SPAWN_REPLY | SPAWN_REPLY_TT)))
+            throw err_wrong_type(m_type, "SPAWN_REPLY");
+        return int(m_cntrl[3].to_long());
+    }
+
+    /// Result of SPAWN_REPLY: the pid of the new process or an error atom.
+    /// @throws err_wrong_type
+    const eterm<Alloc>& spawn_result() const {
+        if (!(m_type & (SPAWN_REPLY | SPAWN_REPLY_TT)))
+            throw err_wrong_type(m_type, "SPAWN_REPLY");
+        return m_cntrl[4];
+    }
+
+    /// Id of the UNLINK_ID|UNLINK_ID_ACK signal.
+    /// @throws err_wrong_type
+    uint64_t unlink_id() const {
+        switch (m_type) {
+            case UNLINK_ID:
+            case UNLINK_ID_ACK: return uint64_t(m_cntrl[1].to_long());
+            default:
+                throw err_wrong_type(m_type, "UNLINK_ID|UNLINK_ID_ACK");
+        }
+    }
+
     /// @throws err_wrong_type
     const eterm<Alloc>& reason() const {
         switch (m_type) {
@@ -227,7 +317,7 @@ public:
 
     /// Initialize the object with given components.
     void set(int a_msgtype, const tuple<Alloc>& a_cntrl, const eterm<Alloc>* a_msg = NULL) {
-        m_type = static_cast<transport_msg_type>(1 << a_msgtype);
+        m_type = static_cast<transport_msg_type>(1ull << a_msgtype);
         m_cntrl = a_cntrl;
         if (a_msg)
             m_msg = *a_msg;
@@ -269,13 +359,30 @@ public:
         }
     }
 
+    /// Set the current message to represent an ALIAS_SEND message containing
+    /// \a a_msg to be sent from \a a_from pid to the process alias \a a_to.
+    void set_alias_send(const epid<Alloc>& a_from, const ref<Alloc>& a_to,
+                        const eterm<Alloc>& a_msg, const Alloc& a_alloc = Alloc())
+    {
+        const trace<Alloc>* token = trace<Alloc>::tracer(marshal::TRACE_GET);
+        if (unlikely(token)) {
+            const tuple<Alloc>& l_cntrl =
+                tuple<Alloc>::make(ERL_ALIAS_SEND_TT, a_from, a_to, *token, a_alloc);
+            set(ERL_ALIAS_SEND_TT, l_cntrl, &a_msg);
+        } else {
+            const tuple<Alloc>& l_cntrl =
+                tuple<Alloc>::make(ERL_ALIAS_SEND, a_from, a_to, a_alloc);
+            set(ERL_ALIAS_SEND, l_cntrl, &a_msg);
+        }
+    }
+
     /// Set the current message to represent a LINK message.
     void set_link(const epid<Alloc>& a_from, const epid<Alloc>& a_to,
                   const Alloc& a_alloc = Alloc())
     {
         const tuple<Alloc>& l_cntrl =
             tuple<Alloc>::make(ERL_LINK, a_from, a_to, a_alloc);
-        set(LINK, l_cntrl, NULL);
+        set(ERL_LINK, l_cntrl, NULL);
     }
 
     /// Set the current message to represent an UNLINK message.
@@ -284,7 +391,57 @@ public:
     {
         const tuple<Alloc>& l_cntrl =
             tuple<Alloc>::make(ERL_UNLINK, a_from, a_to, a_alloc);
-        set(UNLINK, l_cntrl, NULL);
+        set(ERL_UNLINK, l_cntrl, NULL);
+    }
+
+    /// Set the current message to represent a SPAWN_REQUEST message asking
+    /// to spawn \a a_mod:a_fun(a_args) with \a a_opts on behalf of \a a_from.
+    void set_spawn_request(const ref<Alloc>& a_req_id, const epid<Alloc>& a_from,
+        const epid<Alloc>& a_gleader, const atom& a_mod, const atom& a_fun,
+        const list<Alloc>& a_args, const list<Alloc>& a_opts, const Alloc& a_alloc = Alloc())
+    {
+        const tuple<Alloc>& l_mfa =
+            tuple<Alloc>::make(a_mod, a_fun, long(a_args.length()), a_alloc);
+        const trace<Alloc>* token = trace<Alloc>::tracer(marshal::TRACE_GET);
+        const eterm<Alloc>  l_args(a_args);
+        if (unlikely(token)) {
+            const tuple<Alloc>& l_cntrl = tuple<Alloc>::make(ERL_SPAWN_REQUEST_TT,
+                a_req_id, a_from, a_gleader, l_mfa, a_opts, *token, a_alloc);
+            set(ERL_SPAWN_REQUEST_TT, l_cntrl, &l_args);
+        } else {
+            const tuple<Alloc>& l_cntrl = tuple<Alloc>::make(ERL_SPAWN_REQUEST,
+                a_req_id, a_from, a_gleader, l_mfa, a_opts, a_alloc);
+            set(ERL_SPAWN_REQUEST, l_cntrl, &l_args);
+        }
+    }
+
+    /// Set the current message to represent a SPAWN_REPLY message sent to
+    /// \a a_to with the pid of the spawned process or an error atom.
+    void set_spawn_reply(const ref<Alloc>& a_req_id, const epid<Alloc>& a_to,
+        int a_flags, const eterm<Alloc>& a_result, const Alloc& a_alloc = Alloc())
+    {
+        const tuple<Alloc>& l_cntrl = tuple<Alloc>::make(ERL_SPAWN_REPLY,
+            a_req_id, a_to, long(a_flags), a_result, a_alloc);
+        set(ERL_SPAWN_REPLY, l_cntrl, NULL);
+    }
+
+    /// Set the current message to represent an UNLINK_ID message, which
+    /// must be acknowledged with UNLINK_ID_ACK carrying the same \a a_id.
+    void set_unlink_id(uint64_t a_id, const epid<Alloc>& a_from, const epid<Alloc>& a_to,
+        const Alloc& a_alloc = Alloc())
+    {
+        const tuple<Alloc>& l_cntrl =
+            tuple<Alloc>::make(ERL_UNLINK_ID, long(a_id), a_from, a_to, a_alloc);
+        set(ERL_UNLINK_ID, l_cntrl, NULL);
+    }
+
+    /// Set the current message to represent an UNLINK_ID_ACK message.
+    void set_unlink_id_ack(uint64_t a_id, const epid<Alloc>& a_from, const epid<Alloc>& a_to,
+        const Alloc& a_alloc = Alloc())
+    {
+        const tuple<Alloc>& l_cntrl =
+            tuple<Alloc>::make(ERL_UNLINK_ID_ACK, long(a_id), a_from, a_to, a_alloc);
+        set(ERL_UNLINK_ID_ACK, l_cntrl, NULL);
     }
 
     /// Set the current message to represent an EXIT message with \a a_reason
@@ -455,6 +612,14 @@ const char* transport_msg<Alloc>::type_string() const {
         case MONITOR_P:         return "MONITOR_P";
         case DEMONITOR_P:       return "DEMONITOR_P";
         case MONITOR_P_EXIT:    return "MONITOR_P_EXIT";
+        case SPAWN_REQUEST:     return "SPAWN_REQUEST";
+        case SPAWN_REQUEST_TT:  return "SPAWN_REQUEST_TT";
+        case SPAWN_REPLY:       return "SPAWN_REPLY";
+        case SPAWN_REPLY_TT:    return "SPAWN_REPLY_TT";
+        case ALIAS_SEND:        return "ALIAS_SEND";
+        case ALIAS_SEND_TT:     return "ALIAS_SEND_TT";
+        case UNLINK_ID:         return "UNLINK_ID";
+        case UNLINK_ID_ACK:     return "UNLINK_ID_ACK";
         default: {
             // std::stringstream str; str << "UNSUPPORTED(" << bit_scan_forward(m_type) << ')';
             // return str.str().c_str();
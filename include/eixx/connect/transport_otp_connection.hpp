@@ -30,14 +30,18 @@ limitations under the License.
 #define _EIXX_TRANSPORT_OTP_CONNECTION_HPP_
 
 #include <memory>
+#include <chrono>
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/bind.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/algorithm/string.hpp>
 #include <eixx/util/common.hpp>
 #include <eixx/util/string_util.hpp>
+#include <eixx/util/md5.hpp>
 #include <eixx/connect/verbose.hpp>
+#include <eixx/connect/transport_msg.hpp>
 #include <eixx/marshal/string.hpp>
 
 #ifdef HAVE_EI_EPMD
@@ -83,12 +87,23 @@ extern "C" {
  * new capabilities that we also want to backport to OTP-22 or older.
  */
 typedef EI_ULONGLONG DistFlags;
-#define DFLAG_RESERVED               0xfc000000
+#define DFLAG_RESERVED               0xf8000000
 #define DFLAG_NAME_ME                (((DistFlags)0x2) << 32)
 #define DFLAG_V4_NC                  (((DistFlags)0x4) << 32)
 
 #endif
 
+// Capability flags of OTP 24+ that may be missing in older EI headers
+#ifndef DFLAG_MANDATORY_25_DIGEST
+#define DFLAG_MANDATORY_25_DIGEST    0x4000000
+#endif
+#ifndef DFLAG_SPAWN
+#define DFLAG_SPAWN                  (((uint64_t)0x1) << 32)
+#endif
+#ifndef DFLAG_ALIAS
+#define DFLAG_ALIAS                  (((uint64_t)0x8) << 32)
+#endif
+
 namespace eixx {
 namespace connect {
 
@@ -124,10 +139,54 @@ inline constexpr uint64_t LOCAL_FLAGS = (
                         | DFLAG_V4_NC
 #endif
 #ifdef DFLAG_UNLINK_ID
-                        // | DFLAG_UNLINK_ID
+                        | DFLAG_UNLINK_ID
 #endif
+                        | DFLAG_MANDATORY_25_DIGEST
+                        | DFLAG_SPAWN
+                        | DFLAG_ALIAS
                         );
 
+//----------------------------------------------------------------------------
+// Link statistics.
+//----------------------------------------------------------------------------
+
+/// Round-trip time and liveness statistics of a connection measured by
+/// periodic probes (see connection::set_probe()).
+struct link_stats {
+    typedef std::chrono::steady_clock   clock;
+    typedef std::chrono::microseconds   usecs;
+
+    /// Number of RTT histogram buckets. Bucket i counts samples in
+    /// [2^i, 2^(i+1)) microseconds, and the last one - all longer samples.
+    enum { HISTOGRAM_SIZE = 24 };
+
+    size_t              probes_sent     = 0;
+    size_t              probes_acked    = 0;
+    usecs               last_rtt        = usecs(0);
+    usecs               min_rtt         = usecs::max();
+    usecs               max_rtt         = usecs(0);
+    /// Exponentially weighted moving average of RTT (alpha = 1/8)
+    usecs               avg_rtt         = usecs(0);
+    size_t              histogram[HISTOGRAM_SIZE] = {};
+    /// Time when the last byte was received from the peer
+    clock::time_point   last_rx         = clock::now();
+
+    /// Time elapsed since the last byte was received from the peer.
+    clock::duration idle() const { return clock::now() - last_rx; }
+
+    void add_rtt(usecs a_rtt) {
+        probes_acked++;
+        last_rtt = a_rtt;
+        min_rtt  = std::min(min_rtt, a_rtt);
+        max_rtt  = std::max(max_rtt, a_rtt);
+        avg_rtt  = probes_acked == 1 ? a_rtt : avg_rtt + (a_rtt - avg_rtt) / 8;
+        size_t i = 0;
+        for (auto n = a_rtt.count(); n > 1 && i < HISTOGRAM_SIZE-1; n >>= 1)
+            ++i;
+        histogram[i]++;
+    }
+};
+
 //----------------------------------------------------------------------------
 // Base connection class.
 //----------------------------------------------------------------------------
@@ -153,6 +212,8 @@ protected:
     atom                        m_this_node;
     uint32_t                    m_this_creation;
     atom                        m_cookie;
+    /// MD5 state after hashing m_cookie, the common prefix of challenge digests
+    util::md5                   m_cookie_md5;
 
     Alloc                       m_allocator;
 
@@ -174,6 +235,14 @@ protected:
     bool                        m_is_writing;
     bool                        m_connection_aborted;
 
+    boost::asio::steady_timer   m_probe_timer;
+    std::chrono::milliseconds   m_probe_interval;   /// 0 - probing is disabled
+    std::chrono::milliseconds   m_probe_deadline;   /// 0 - no deadline
+    link_stats                  m_stats;
+    ref<Alloc>                  m_probe_ref;        /// Ref of the outstanding probe
+    link_stats::clock::time_point m_probe_time;
+    uint32_t                    m_probe_seq;
+
     /// Construct a connection
     connection(connection_type a_ct, boost::asio::io_service& a_svc, 
                Handler* a_h, const Alloc& a_alloc)
@@ -185,6 +254,10 @@ protected:
         , m_available_queue(0)
         , m_is_writing(false)
         , m_connection_aborted(false)
+        , m_probe_timer(a_svc)
+        , m_probe_interval(0)
+        , m_probe_deadline(0)
+        , m_probe_seq(0)
     {
         if (unlikely(handler()->verbose() >= VERBOSE_TRACE)) {
             std::stringstream s;
@@ -258,13 +331,30 @@ protected:
     /// Decode distributed Erlang message.  The message must be fully
     /// stored in \a mbuf.
     /// Note: TICK message is represented by msg type = 0, in this case \a a_cntrl_msg
-    /// and \a a_msg are invalid.
+    /// and \a a_msg are invalid.  The handler's admit() is called with the
+    /// control message and the wire size of the payload before the payload
+    /// is decoded, and a message it rejects is returned as DROPPED.
+    /// @param a_bytes is set to the wire size of the payload.
     /// @return Control Message
     /// @throws err_decode_exception
-    int transport_msg_decode(const char *mbuf, size_t len, transport_msg<Alloc>& a_tm);
+    int transport_msg_decode(const char *mbuf, size_t len, transport_msg<Alloc>& a_tm,
+                             size_t& a_bytes);
+
+    /// Message type returned by transport_msg_decode() for shed messages.
+    static const int DROPPED = -1;
 
     void process_message(const char* a_buf, size_t a_size);
 
+    /// Pid on behalf of which the probes are sent. Replies to this pid
+    /// are consumed by the connection.
+    epid<Alloc> probe_pid() const {
+        return epid<Alloc>(m_this_node, 0, 0, m_this_creation, m_allocator);
+    }
+
+    void schedule_probe();
+    void handle_probe_timer(const boost::system::error_code& err);
+    void handle_probe_reply(const eterm<Alloc>& a_msg);
+
     bool check_connected(const eterm<Alloc>* a_msg) {
         if (likely(!m_connection_aborted))
             return true;
@@ -320,6 +410,7 @@ protected:
         m_this_node         = a_this_node;
         m_remote_nodename   = a_remote_nodename;
         m_cookie            = a_cookie;
+        m_cookie_md5        = util::md5().update(a_cookie.c_str(), a_cookie.size());
     }
 
     /// Set the socket to non-blocking mode and issue on_connect() callback.
@@ -335,6 +426,7 @@ protected:
             m_handler->report_status(REPORT_INFO, "Calling connection::start()");
 
         m_connection_aborted = false;
+        m_stats.last_rx      = link_stats::clock::now();
         m_handler->on_connect(this);
 
         const boost::asio::mutable_buffers_1 buffers(m_rd_end, rd_capacity());
@@ -407,6 +499,7 @@ public:
                 std::string("Calling ~connection::connection()") + e.message());
 
         m_connection_aborted = true;
+        m_probe_timer.cancel();
         m_handler->on_disconnect(this, e);
         //delete this;
     }
@@ -426,6 +519,21 @@ public:
     /// Send a message \a a_msg to the remote node.
     void send(const transport_msg<Alloc>& a_msg);
 
+    /**
+     * Start measuring the link by sending a probe every \a a_interval.
+     * The probe is a {is_auth, Node} call to the remote net_kernel,
+     * which replies to it like to net_adm:ping/1.
+     * @param a_interval is the probing interval (0 - disable probing).
+     * @param a_deadline if not 0, the connection is closed with the
+     *        timed_out error when nothing is received from the peer
+     *        or a probe isn't answered for this long.
+     */
+    void set_probe(std::chrono::milliseconds a_interval,
+                   std::chrono::milliseconds a_deadline = std::chrono::milliseconds(0));
+
+    /// Link statistics. Call from the I/O service's thread.
+    const link_stats&           stats()             const   { return m_stats; }
+
     void on_error(const std::string& s) {
         m_handler->on_error(this,  s);
     }
@@ -236,6 +236,7 @@ handle_read(const boost::system::error_code& err, size_t bytes_transferred)
     }
 
     m_rd_end += bytes_transferred;
+    m_stats.last_rx = link_stats::clock::now();
 
     if (!m_got_header) {
         size_t len = rd_length();
@@ -351,11 +352,13 @@ handle_read(const boost::system::error_code& err, size_t bytes_transferred)
 /// @throws err_decode_exception
 template <class Handler, class Alloc>
 int connection<Handler, Alloc>::
-transport_msg_decode(const char *mbuf, size_t len, transport_msg<Alloc>& a_tm)
+transport_msg_decode(const char *mbuf, size_t len, transport_msg<Alloc>& a_tm,
+                     size_t& a_bytes)
 {
     const char* s = mbuf;
     int version;
     uintptr_t index = 0;
+    a_bytes = 0;
 
     if (unlikely(len == 0)) // This is TICK message
         return ERL_TICK;
@@ -378,18 +381,30 @@ transport_msg_decode(const char *mbuf, size_t len, transport_msg<Alloc>& a_tm)
     BOOST_ASSERT(t <= INT_MAX);
     int msgtype = (int)t;
 
-    if (unlikely(msgtype <= ERL_TICK) || unlikely(msgtype > ERL_MONITOR_P_EXIT))
+    // Types 22..28 are only sent to nodes advertising the flags we don't set
+    if (unlikely(msgtype <= ERL_TICK) || unlikely(msgtype > ERL_UNLINK_ID_ACK) ||
+        unlikely(msgtype > ERL_MONITOR_P_EXIT && msgtype < ERL_SPAWN_REQUEST))
         throw err_decode_exception("Invalid message type", msgtype);
 
-    static const uint32_t types_with_payload = 1 << ERL_SEND
-                                             | 1 << ERL_REG_SEND
-                                             | 1 << ERL_SEND_TT
-                                             | 1 << ERL_REG_SEND_TT;
-    if (likely((1 << msgtype) & types_with_payload)) {
+    static const uint64_t types_with_payload = 1ull << ERL_SEND
+                                             | 1ull << ERL_REG_SEND
+                                             | 1ull << ERL_SEND_TT
+                                             | 1ull << ERL_REG_SEND_TT
+                                             | 1ull << ERL_SPAWN_REQUEST
+                                             | 1ull << ERL_SPAWN_REQUEST_TT
+                                             | 1ull << ERL_ALIAS_SEND
+                                             | 1ull << ERL_ALIAS_SEND_TT;
+    if (likely((1ull << msgtype) & types_with_payload)) {
         BOOST_ASSERT(index <= INT_MAX);
         if (unlikely(ei_decode_version(s, (int*)&index, &version)) || unlikely((version != ERL_VERSION_MAGIC)))
             throw err_decode_exception("Invalid message magic number", index, version);
 
+        // Let the handler shed the message before the payload is decoded
+        a_bytes = len - 1 - index;
+        a_tm.set(msgtype, cntrl);
+        if (!m_handler->admit(this, a_tm, a_bytes))
+            return DROPPED;
+
         eterm<Alloc> msg(s, index, len, m_allocator);
         a_tm.set(msgtype, cntrl, &msg);
     } else {
@@ -404,9 +419,12 @@ void connection<Handler, Alloc>::
 process_message(const char* a_buf, size_t a_size)
 {
     transport_msg<Alloc> tm;
-    int msgtype = transport_msg_decode(a_buf, a_size, tm);
+    size_t bytes;
+    int msgtype = transport_msg_decode(a_buf, a_size, tm, bytes);
 
     switch (msgtype) {
+        case DROPPED:
+            break;
         case ERL_TICK: {
             // Reply with TOCK packet
             char* data = allocate(s_header_size);
@@ -415,6 +433,13 @@ process_message(const char* a_buf, size_t a_size)
             do_write(b);
             break;
         }
+        case ERL_SEND:
+            if (m_probe_interval.count() && tm.recipient_pid() == probe_pid()) {
+                handle_probe_reply(tm.msg());
+                break;
+            }
+            m_handler->on_message(this, tm, bytes);
+            break;
         /*
         case ERL_SEND:
         case ERL_REG_SEND:
@@ -443,7 +468,7 @@ process_message(const char* a_buf, size_t a_size)
                     m_handler->report_status(REPORT_INFO, s.str());
                 }
             }
-            m_handler->on_message(this, tm);
+            m_handler->on_message(this, tm, bytes);
     }
 }
 
@@ -484,6 +509,91 @@ send(const transport_msg<Alloc>& a_msg)
         std::bind(&connection<Handler, Alloc>::do_write, this->shared_from_this(), b));
 }
 
+template <class Handler, class Alloc>
+void connection<Handler, Alloc>::
+set_probe(std::chrono::milliseconds a_interval, std::chrono::milliseconds a_deadline)
+{
+    auto pthis = this->shared_from_this();
+    m_io_service.post([pthis, a_interval, a_deadline]() {
+        pthis->m_probe_interval = a_interval;
+        pthis->m_probe_deadline = a_deadline;
+        pthis->m_probe_ref      = ref<Alloc>();
+        pthis->m_probe_timer.cancel();
+        pthis->schedule_probe();
+    });
+}
+
+template <class Handler, class Alloc>
+void connection<Handler, Alloc>::
+schedule_probe()
+{
+    if (m_connection_aborted || !m_probe_interval.count())
+        return;
+    m_probe_timer.expires_after(m_probe_interval);
+    auto pthis = this->shared_from_this();
+    m_probe_timer.async_wait([pthis](auto& ec) { pthis->handle_probe_timer(ec); });
+}
+
+template <class Handler, class Alloc>
+void connection<Handler, Alloc>::
+handle_probe_timer(const boost::system::error_code& err)
+{
+    if (err == boost::asio::error::operation_aborted || m_connection_aborted)
+        return;
+
+    auto now = link_stats::clock::now();
+
+    bool pending = m_probe_ref.len() > 0;
+
+    if (m_probe_deadline.count()) {
+        bool unanswered = pending && now - m_probe_time > m_probe_deadline;
+        if (unanswered || now - m_stats.last_rx > m_probe_deadline) {
+            ON_ERROR_CALLBACK(this, "Connection to " << m_remote_nodename
+                << " exceeded deadline of " << m_probe_deadline.count() << "ms ("
+                << (unanswered ? "probe not answered" : "no data received") << ')');
+            stop(boost::asio::error::timed_out);
+            return;
+        }
+        // Wait for the outstanding probe till the deadline
+        if (pending) {
+            schedule_probe();
+            return;
+        }
+    }
+
+    // Send {'$gen_call', {ProbePid, Ref}, {is_auth, ThisNode}} to net_kernel,
+    // which replies with {Ref, yes}. Refs are unique per connection.
+    if (++m_probe_seq == 0) ++m_probe_seq;
+    m_probe_ref  = ref<Alloc>(m_this_node, m_probe_seq, 0, 0, m_this_creation, m_allocator);
+    m_probe_time = now;
+    m_stats.probes_sent++;
+
+    auto pid = probe_pid();
+    transport_msg<Alloc> tm;
+    tm.set_reg_send(pid, am_net_kernel,
+        tuple<Alloc>::make(am_gen_call,
+            tuple<Alloc>::make(pid, m_probe_ref, m_allocator),
+            tuple<Alloc>::make(am_is_auth, m_this_node, m_allocator),
+            m_allocator),
+        m_allocator);
+    send(tm);
+
+    schedule_probe();
+}
+
+template <class Handler, class Alloc>
+void connection<Handler, Alloc>::
+handle_probe_reply(const eterm<Alloc>& a_msg)
+{
+    // Late replies to already replaced probes are dropped
+    if (!a_msg.is_tuple() || a_msg.to_tuple().size() != 2
+     || !m_probe_ref.len() || !(a_msg.to_tuple()[0] == eterm<Alloc>(m_probe_ref)))
+        return;
+    m_stats.add_rtt(std::chrono::duration_cast<link_stats::usecs>(
+        link_stats::clock::now() - m_probe_time));
+    m_probe_ref = ref<Alloc>();
+}
+
 } // namespace connect
 } // namespace eixx
 
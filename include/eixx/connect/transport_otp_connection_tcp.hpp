@@ -180,8 +180,7 @@ private:
         const boost::system::error_code& err, size_t bytes_transferred);
 
     uint32_t gen_challenge(void);
-    void     gen_digest(unsigned challenge, const char cookie[], uint8_t digest[16]);
-    uint32_t md_32(char* string, int length);
+    void     gen_digest(uint32_t challenge, uint8_t digest[16]);
 };
 
 } // namespace connect
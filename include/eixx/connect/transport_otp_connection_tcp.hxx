@@ -29,8 +29,9 @@ limitations under the License.
 #ifndef _EIXX_CONNECTION_TCP_IPP_
 #define _EIXX_CONNECTION_TCP_IPP_
 
-#include <sys/utsname.h>
-#include <openssl/md5.h>
+#include <random>
+#include <unistd.h>
+#include <sys/syscall.h>
 
 namespace eixx {
 namespace connect {
@@ -433,7 +434,7 @@ void tcp_connection<Handler, Alloc>::handle_read_status_header(
     m_node_rd = m_buf_node;
     m_expect_size = get16be(m_node_rd);
 
-    if (m_expect_size > (size_t)MAXNODELEN + 8 || m_expect_size > (size_t)((m_buf_node+1) - m_node_rd)) {
+    if (m_expect_size > (size_t)MAXNODELEN + 8 || m_expect_size > (size_t)((m_buf_node+sizeof(m_buf_node)) - m_node_rd)) {
         std::stringstream ss;
         ss << "<- RECV_STATUS (error) in status length from node '" 
            << this->remote_nodename() << "': " << m_expect_size;
@@ -449,7 +450,7 @@ void tcp_connection<Handler, Alloc>::handle_read_status_header(
     size_t need_bytes = m_expect_size > got_bytes ? m_expect_size - got_bytes : 0;
     if (need_bytes > 0) {
         boost::asio::async_read(m_socket, 
-            boost::asio::buffer(m_node_wr, (m_buf_node+1) - m_node_wr),
+            boost::asio::buffer(m_node_wr, (m_buf_node+sizeof(m_buf_node)) - m_node_wr),
             boost::asio::transfer_at_least(need_bytes),
             std::bind(&tcp_connection<Handler, Alloc>::handle_read_status_body, shared_from_this(),
                 std::placeholders::_1,
@@ -477,6 +478,8 @@ void tcp_connection<Handler, Alloc>::handle_read_status_body(
     m_node_wr += bytes_transferred;
     size_t got_bytes = m_node_wr - m_node_rd;
     BOOST_ASSERT(got_bytes >= 3);
+    // The status may be followed by the challenge in the same read
+    const char* l_status_end = m_node_rd + m_expect_size;
 
     if (!this->local_nodename().empty()) {
         if (memcmp(m_node_rd, "sok", 3) != 0) {
@@ -500,6 +503,7 @@ void tcp_connection<Handler, Alloc>::handle_read_status_body(
             return;
         }
 
+        m_node_rd += 7;
         uint16_t nodename_len = get16be(m_node_rd);
         if (nodename_len > MAXNODELEN) {
             std::stringstream ss;
@@ -512,6 +516,7 @@ void tcp_connection<Handler, Alloc>::handle_read_status_body(
         }
         atom l_this_node(m_node_rd, nodename_len);
         this->m_this_node = l_this_node;
+        m_node_rd += nodename_len;
 
         uint32_t l_cre = get32be(m_node_rd);
         this->m_this_creation = l_cre;
@@ -528,12 +533,12 @@ void tcp_connection<Handler, Alloc>::handle_read_status_body(
     m_state = CS_WAIT_CHALLENGE;
 
     // recv challenge
-    m_node_rd += 3;
-    got_bytes -= 3;
+    m_node_rd = l_status_end;
+    got_bytes = m_node_wr - m_node_rd;
     if (got_bytes >= 2)
         handle_read_challenge_header(boost::system::error_code(), 0);
     else
-        boost::asio::async_read(m_socket, boost::asio::buffer(m_node_wr, (m_buf_node+1) - m_node_wr),
+        boost::asio::async_read(m_socket, boost::asio::buffer(m_node_wr, (m_buf_node+sizeof(m_buf_node)) - m_node_wr),
             boost::asio::transfer_at_least(2),
             std::bind(&tcp_connection<Handler, Alloc>::handle_read_challenge_header, shared_from_this(),
                 std::placeholders::_1,
@@ -564,7 +569,7 @@ void tcp_connection<Handler, Alloc>::handle_read_challenge_header(
     unsigned short l_size = 11;
 #endif
 
-    if (m_expect_size > (size_t)MAXNODELEN + l_size || m_expect_size > (size_t)((m_buf_node+1) - m_node_rd)) {
+    if (m_expect_size > (size_t)MAXNODELEN + l_size || m_expect_size > (size_t)((m_buf_node+sizeof(m_buf_node)) - m_node_rd)) {
         std::stringstream ss;
         ss << "<- RECV_CHALLENGE (error) in challenge length from node '" 
            << this->remote_nodename() << "': " << m_expect_size;
@@ -578,7 +583,7 @@ void tcp_connection<Handler, Alloc>::handle_read_challenge_header(
     size_t need_bytes = m_expect_size > got_bytes ? m_expect_size - got_bytes : 0;
     if (need_bytes > 0) {
         boost::asio::async_read(m_socket, 
-            boost::asio::buffer(m_node_wr, (m_buf_node+1) - m_node_wr),
+            boost::asio::buffer(m_node_wr, (m_buf_node+sizeof(m_buf_node)) - m_node_wr),
             boost::asio::transfer_at_least(need_bytes),
             std::bind(&tcp_connection<Handler, Alloc>::handle_read_challenge_body, shared_from_this(),
                 std::placeholders::_1,
@@ -709,7 +714,7 @@ void tcp_connection<Handler, Alloc>::handle_read_challenge_body(
     }
 
     uint8_t our_digest[16];
-    gen_digest(m_remote_challenge, this->m_cookie.c_str(), our_digest);
+    gen_digest(m_remote_challenge, our_digest);
 
     char* w = m_buf_node;
     int siz = 0;
@@ -799,7 +804,7 @@ void tcp_connection<Handler, Alloc>::handle_read_challenge_ack_header(
     size_t need_bytes = m_expect_size > got_bytes ? m_expect_size - got_bytes : 0;
     if (need_bytes > 0) {
         boost::asio::async_read(m_socket, 
-            boost::asio::buffer(m_node_wr, (m_buf_node+1)-m_node_wr),
+            boost::asio::buffer(m_node_wr, (m_buf_node+sizeof(m_buf_node))-m_node_wr),
             boost::asio::transfer_at_least(need_bytes),
             std::bind(&tcp_connection<Handler, Alloc>::handle_read_challenge_ack_body,
                 shared_from_this(),
@@ -851,7 +856,7 @@ void tcp_connection<Handler, Alloc>::handle_read_challenge_ack_body(
 
     char her_digest[16], expected_digest[16];
     memcpy(her_digest, m_node_rd, 16);
-    gen_digest(m_our_challenge, this->m_cookie.c_str(), (uint8_t*)expected_digest);
+    gen_digest(m_our_challenge, (uint8_t*)expected_digest);
     if (memcmp(her_digest, expected_digest, 16) != 0) {
         std::stringstream ss;
         ss << "<- RECV_CHALLENGE_ACK authorization failure for node '" 
@@ -873,63 +878,30 @@ void tcp_connection<Handler, Alloc>::handle_read_challenge_ack_body(
 template <class Handler, class Alloc>
 uint32_t tcp_connection<Handler, Alloc>::gen_challenge(void)
 {
-#if defined(__WIN32__)
-    struct {
-        SYSTEMTIME tv;
-        DWORD cpu;
-        int pid;
-    } s;
-    GetSystemTime(&s.tv);
-    s.cpu  = GetTickCount();
-    s.pid  = getpid();
-    
-#else
-    struct { 
-        struct timeval tv; 
-        clock_t cpu; 
-        pid_t pid; 
-        u_long hid; 
-        uid_t uid; 
-        gid_t gid; 
-        struct utsname name; 
-    } s; 
-
-    gettimeofday(&s.tv, 0); 
-    uname(&s.name); 
-    s.cpu  = clock(); 
-    s.pid  = getpid(); 
-    s.hid  = gethostid(); 
-    s.uid  = getuid(); 
-    s.gid  = getgid(); 
+    uint32_t n;
+#ifdef SYS_getrandom
+    if (::syscall(SYS_getrandom, &n, sizeof(n), 0) == sizeof(n))
+        return n;
 #endif
-    return md_32((char*) &s, sizeof(s));
-}
-
-template <class Handler, class Alloc>
-uint32_t tcp_connection<Handler, Alloc>::
-md_32(char* string, int length)
-{
-    BOOST_STATIC_ASSERT(MD5_DIGEST_LENGTH == 16);
-    union {
-        char c[MD5_DIGEST_LENGTH];
-        unsigned x[4];
-    } digest;
-    MD5((unsigned char *) string, length, (unsigned char *) digest.c);
-    return (digest.x[0] ^ digest.x[1] ^ digest.x[2] ^ digest.x[3]);
-    return (digest.x[0] ^ digest.x[1] ^ digest.x[2] ^ digest.x[3]);
+    // No getrandom(2) - fall back to the implementation's entropy source,
+    // which isn't safe to share between threads
+    static thread_local std::random_device s_rd;
+    n = s_rd();
+    return n;
 }
 
 template <class Handler, class Alloc>
 void tcp_connection<Handler, Alloc>::
-gen_digest(unsigned challenge, const char cookie[], uint8_t digest[16])
+gen_digest(uint32_t challenge, uint8_t digest[16])
 {
-    MD5_CTX c;
-    char chbuf[21];
-    snprintf(chbuf, sizeof(chbuf), "%u", challenge);
-    MD5_Init(&c);
-    MD5_Update(&c, (unsigned char *) cookie, (uint32_t) strlen(cookie));
-    MD5_Update(&c, (unsigned char *) chbuf,  (uint32_t) strlen(chbuf));
-    MD5_Final(digest, &c);
+    // The digest is MD5(Cookie ++ integer_to_list(Challenge))
+    char  buf[10];
+    char* p = buf + sizeof(buf);
+    do { *--p = char('0' + challenge % 10); } while (challenge /= 10);
+
+    util::md5 md5(this->m_cookie_md5);
+    md5.update(p, buf + sizeof(buf) - p);
+    md5.digest(digest);
 }
 
 } // namespace connect
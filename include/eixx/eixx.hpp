@@ -53,6 +53,7 @@ limitations under the License.
 // !!! eixx/alloc_std.hpp      - uses std::allocator<char>
 // !!! eixx/alloc_pool.hpp     - uses boost::pool_allocator<char>
 // !!! eixx/alloc_pool_st.hpp  - same as previous, for single-threaded cases.
+// !!! eixx/alloc_hugepage.hpp - uses NUMA-local hugepage arenas.
 //-----------------------------------------------------------------------------
 #ifndef EIXX_USE_ALLOCATOR
 #    error Allocator not defined - include one of eixx/alloc*.hpp headers!
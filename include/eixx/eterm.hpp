@@ -31,6 +31,9 @@ limitations under the License.
 #include <eixx/config.h>
 #include <eixx/marshal/defaults.hpp>
 #include <eixx/marshal/eterm.hpp>
+#include <eixx/marshal/consult.hpp>
+#include <eixx/marshal/bit_pattern.hpp>
+#include <eixx/marshal/json.hpp>
 
 #define EIXX_DECL_ATOM(Atom)           static const eixx::atom am_##Atom(#Atom)
 #define EIXX_DECL_ATOM_VAL(Atom, Val)  static const eixx::atom am_##Atom(Val)
@@ -42,6 +45,7 @@ typedef marshal::eterm<allocator_t>                  eterm;
 typedef marshal::atom                                atom;
 typedef marshal::string<allocator_t>                 string;
 typedef marshal::binary<allocator_t>                 binary;
+typedef marshal::iolist_builder<allocator_t>         iolist_builder;
 typedef marshal::epid<allocator_t>                   epid;
 typedef marshal::port<allocator_t>                   port;
 typedef marshal::ref<allocator_t>                    ref;
@@ -49,10 +53,32 @@ typedef marshal::tuple<allocator_t>                  tuple;
 typedef marshal::list<allocator_t>                   list;
 typedef marshal::map<allocator_t>                    map;
 typedef marshal::trace<allocator_t>                  trace;
+typedef marshal::raw<allocator_t>                    raw;
+typedef marshal::bigint<allocator_t>                 bigint;
+typedef marshal::bitstring<allocator_t>              bitstring;
+typedef marshal::bit_pattern<allocator_t>            bit_pattern;
+typedef marshal::eterm_guard<allocator_t>            eterm_guard;
 typedef marshal::var                                 var;
 typedef marshal::varbind<allocator_t>                varbind;
 typedef marshal::eterm_pattern_matcher<allocator_t>  eterm_pattern_matcher;
 typedef marshal::eterm_pattern_action<allocator_t>   eterm_pattern_action;
+typedef marshal::consult_parser<allocator_t>         consult_parser;
+typedef marshal::json_options                        json_options;
+
+using marshal::json_to_etf;
+using marshal::etf_to_json;
+using marshal::eterm_to_json;
+
+/// Convert JSON text to a term.
+inline eterm json_to_eterm(const char* a_json, size_t a_size,
+                           const json_options& a_opts = json_options()) {
+    return marshal::json_to_eterm<allocator_t>(a_json, a_size, a_opts);
+}
+
+inline eterm json_to_eterm(const std::string& a_json,
+                           const json_options& a_opts = json_options()) {
+    return json_to_eterm(a_json.c_str(), a_json.size(), a_opts);
+}
 
 namespace detail {
     BOOST_STATIC_ASSERT(sizeof(eterm)     == (ALIGNOF_UINT64_T > sizeof(int) ? ALIGNOF_UINT64_T : sizeof(int)) + sizeof(uint64_t));
@@ -66,6 +92,7 @@ namespace detail {
     BOOST_STATIC_ASSERT(sizeof(list)      <= sizeof(uint64_t));
     BOOST_STATIC_ASSERT(sizeof(map)       <= sizeof(uint64_t));
     BOOST_STATIC_ASSERT(sizeof(trace)     <= sizeof(uint64_t));
+    BOOST_STATIC_ASSERT(sizeof(raw)       <= sizeof(uint64_t));
     BOOST_STATIC_ASSERT(sizeof(var)       == sizeof(uint64_t));
 } // namespace detail
 
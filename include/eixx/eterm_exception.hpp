@@ -147,6 +147,23 @@ public:
     void start(const char* a_start)  { m_start = a_start; }
 };
 
+/**
+ * Exception while parsing text terms
+ */
+class err_parse_exception: public eterm_exception {
+    size_t m_line;
+    size_t m_column;
+public:
+    err_parse_exception(const std::string& msg, size_t line, size_t column)
+        : eterm_exception(msg, "line ", line, ", column ", column)
+        , m_line(line)
+        , m_column(column)
+    {}
+
+    size_t line()   const { return m_line;   }
+    size_t column() const { return m_column; }
+};
+
 /**
  * Exception while encoding
  */
@@ -222,6 +239,14 @@ public:
     err_no_process(const std::string &msg, T arg): err_bad_argument(msg, arg) {}
 };
 
+/**
+ * Exception for a call that wasn't replied to in time.
+ */
+class err_timeout: public eterm_exception {
+public:
+    err_timeout(const std::string &msg) : eterm_exception(msg) {}
+};
+
 } // namespace eixx
 
 #endif // _EIXX_EXCEPTION_HPP_
@@ -81,12 +81,13 @@ namespace marshal {
         using blob_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<blob<T,Alloc>>;
 
         atomic<int>  m_rc;
-        const size_t m_size;
+        size_t       m_size;
+        const size_t m_capacity;
         T*           m_data;
 
         ~blob() {
             if (m_data)
-                this->deallocate(m_data, m_size);
+                this->deallocate(m_data, m_capacity);
         }
 
         /// This is needed in order to allow blobs to be hosted inside
@@ -94,12 +95,12 @@ namespace marshal {
         template <typename U> friend struct std::default_delete;
     public:
         blob(const Alloc& a = Alloc())
-            : base_t(a), m_rc(1), m_size(0), m_data(NULL)
+            : base_t(a), m_rc(1), m_size(0), m_capacity(0), m_data(NULL)
         {}
 
         /// Allocate storage for \a n items if size sizeof(T).
         blob(size_t n, const Alloc& a = Alloc())
-            : base_t(a), m_rc(1), m_size(n), m_data(this->allocate(n)) {
+            : base_t(a), m_rc(1), m_size(n), m_capacity(n), m_data(this->allocate(n)) {
             BOOST_ASSERT(m_data != NULL);
         }
 
@@ -126,11 +127,25 @@ namespace marshal {
         T*     data()       const   { return m_data; }
         /// Number of items that data() points to.
         size_t size()       const   { return m_size; }
+        /// Number of items allocated for data().
+        size_t capacity()   const   { return m_capacity; }
+
+        /// Change the number of items without reallocating the storage.
+        /// Must only be called when the blob is not shared.
+        /// @return false if \a n exceeds capacity().
+        bool   resize(size_t n) {
+            BOOST_ASSERT(m_rc == 1);
+            if (n > m_capacity) return false;
+            m_size = n;
+            return true;
+        }
 
         /// Increment internal reference count.
         void   inc_rc()             { ++m_rc; }
         /// Return internal reference count. Use for debugging only.
         int    use_count()  const   { return m_rc; }
+        /// Return true if the blob is referenced by a single owner.
+        bool   unique()     const   { return m_rc == 1; }
 
         const Alloc& get_allocator() const {
             return *reinterpret_cast<const Alloc*>(this);
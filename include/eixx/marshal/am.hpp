@@ -37,6 +37,7 @@ namespace eixx {
     // Constant global atom values
 
     const atom am_ANY_ = atom("_");
+    extern const atom am_alias;
     extern const atom am_badarg;
     extern const atom am_badrpc;
     extern const atom am_call;
@@ -45,18 +46,30 @@ namespace eixx {
     extern const atom am_error;
     extern const atom am_false;
     extern const atom am_format;
+    extern const atom am_gen_call;
     extern const atom am_gen_cast;
+    extern const atom am_get_state;
     extern const atom am_io_lib;
+    extern const atom am_is_auth;
     extern const atom am_latin1;
+    extern const atom am_link;
+    extern const atom am_monitor;
+    extern const atom am_net_kernel;
     extern const atom am_noconnection;
     extern const atom am_noproc;
     extern const atom am_normal;
+    extern const atom am_notsup;
     extern const atom am_ok;
     extern const atom am_request;
+    extern const atom am_resume;
     extern const atom am_rex;
     extern const atom am_rpc;
+    extern const atom am_suspend;
+    extern const atom am_system;
+    extern const atom am_timeout;
     extern const atom am_true;
     extern const atom am_undefined;
+    extern const atom am_unknown_system_msg;
     extern const atom am_unsupported;
     extern const atom am_user;
 
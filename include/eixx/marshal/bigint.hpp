@@ -0,0 +1,312 @@
+//----------------------------------------------------------------------------
+/// \file  bigint.hpp
+//----------------------------------------------------------------------------
+/// \brief A class implementing an arbitrary-precision integer of Erlang
+///        external term format.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_BIGINT_HPP_
+#define _IMPL_BIGINT_HPP_
+
+#include <type_traits>
+#include <eixx/marshal/defaults.hpp>
+#include <eixx/marshal/alloc_base.hpp>
+#include <eixx/marshal/varbind.hpp>
+#include <eixx/eterm_exception.hpp>
+#include <string.h>
+
+namespace eixx {
+namespace marshal {
+
+__extension__ typedef __int128          int128_t;
+__extension__ typedef unsigned __int128 uint128_t;
+
+template <typename Alloc> class eterm;
+
+/**
+ * Arbitrary-precision integer (bignum) stored as a sign and a magnitude.
+ * A magnitude below 2^64 is kept inline, so that creating, copying and
+ * decoding such values doesn't allocate memory.  Larger magnitudes are
+ * kept in a reference counted array of little-endian 64-bit limbs with
+ * no leading zero limbs, which makes the representation of every value
+ * unique.
+ *
+ * An eterm holding a bigint value that fits in a long is stored as a
+ * LONG term, so BIGINT terms are always outside of the long range.
+ */
+template <class Alloc>
+class bigint
+{
+    typedef blob<uint64_t, Alloc> limbs_t;
+
+    static const uint32_t NEG  = 1;
+    static const uint32_t HEAP = 2;
+
+    uint64_t m_word;    ///< Magnitude below 2^64, or limbs_t* when HEAP is set
+    uint32_t m_flags;   ///< Combination of NEG and HEAP
+
+    template <typename A> friend class eterm;
+
+    /// Little-endian limbs of a value (without ownership).
+    struct view {
+        const uint64_t* limbs;
+        size_t          size;
+        bool            neg;
+    };
+
+    static view make_view(const uint64_t& a_word, uint32_t a_flags) {
+        if (a_flags & HEAP) {
+            auto p = reinterpret_cast<limbs_t*>(a_word);
+            return view{p->data(), p->size(), bool(a_flags & NEG)};
+        }
+        return view{&a_word, 1, bool(a_flags & NEG)};
+    }
+
+    static void inc_rc(uint64_t a_word, uint32_t a_flags) {
+        if (a_flags & HEAP) reinterpret_cast<limbs_t*>(a_word)->inc_rc();
+    }
+
+    static void release(uint64_t a_word, uint32_t a_flags) {
+        if (a_flags & HEAP) reinterpret_cast<limbs_t*>(a_word)->release();
+    }
+
+    /// Arithmetic-free comparison of two values.
+    static int compare(const view& a, const view& b) {
+        if (a.neg != b.neg)
+            return a.neg ? -1 : 1;
+        int r = a.size == b.size ? 0 : a.size < b.size ? -1 : 1;
+        for (size_t i = a.size; !r && i-- > 0;)
+            if (a.limbs[i] != b.limbs[i])
+                r = a.limbs[i] < b.limbs[i] ? -1 : 1;
+        return a.neg ? -r : r;
+    }
+
+    /// Exact comparison of a value with a double.
+    static int compare(const view& a, double b);
+
+    /// Take over the value stored in an eterm (incrementing the reference count).
+    bigint(uint64_t a_word, uint32_t a_flags) : m_word(a_word), m_flags(a_flags) {
+        inc_rc(m_word, m_flags);
+    }
+
+    view get_view() const { return make_view(m_word, m_flags); }
+
+    void set(bool a_neg, uint64_t a_mag) { m_word = a_mag; m_flags = a_neg && a_mag ? NEG : 0; }
+
+    /// Set the value from \a a_n little-endian limbs of the magnitude.
+    void assign(bool a_neg, const uint64_t* a_limbs, size_t a_n, const Alloc& a_alloc);
+
+    void release() { release(m_word, m_flags); m_word = 0; m_flags = 0; }
+
+public:
+    bigint() : m_word(0), m_flags(0) {}
+
+    /// Create a value from an integer of up to 64 bits.
+    template <typename T,
+              typename = typename std::enable_if<std::is_integral<T>::value &&
+                                                 sizeof(T) <= sizeof(uint64_t)>::type>
+    bigint(T a) {
+        if (std::is_signed<T>::value && a < 0)
+            set(true, 0 - uint64_t(a));
+        else
+            set(false, uint64_t(a));
+    }
+
+    /// Create a value from a 128-bit integer.
+    bigint(int128_t a, const Alloc& a_alloc = Alloc()) : m_word(0), m_flags(0) {
+        uint128_t n = a < 0 ? 0 - uint128_t(a) : uint128_t(a);
+        uint64_t  l[2] = {uint64_t(n), uint64_t(n >> 64)};
+        assign(a < 0, l, 2, a_alloc);
+    }
+
+    /// Create a value from an unsigned 128-bit integer.
+    bigint(uint128_t a, const Alloc& a_alloc = Alloc()) : m_word(0), m_flags(0) {
+        uint64_t l[2] = {uint64_t(a), uint64_t(a >> 64)};
+        assign(false, l, 2, a_alloc);
+    }
+
+    /**
+     * Create a value from the sign and the magnitude given as \a a_n
+     * little-endian 64-bit limbs (leading zero limbs are allowed).
+     */
+    bigint(bool a_neg, const uint64_t* a_limbs, size_t a_n, const Alloc& a_alloc = Alloc())
+        : m_word(0), m_flags(0)
+    {
+        assign(a_neg, a_limbs, a_n, a_alloc);
+    }
+
+    /**
+     * Decode an integer (SMALL_INTEGER_EXT, INTEGER_EXT, SMALL_BIG_EXT or
+     * LARGE_BIG_EXT) from a binary buffer.  Values with magnitude below
+     * 2^64 are decoded without allocating memory.
+     * @param buf is the buffer containing Erlang external term format.
+     * @param idx is the current offset in the buf buffer.
+     * @param size is the size of \a buf buffer.
+     * @param a_alloc is the allocator to use.
+     * @throw err_decode_exception
+     */
+    bigint(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
+
+    bigint(const bigint& rhs) : m_word(rhs.m_word), m_flags(rhs.m_flags) {
+        inc_rc(m_word, m_flags);
+    }
+
+    bigint(bigint&& rhs) : m_word(rhs.m_word), m_flags(rhs.m_flags) {
+        rhs.m_word = 0; rhs.m_flags = 0;
+    }
+
+    ~bigint() { release(m_word, m_flags); }
+
+    bigint& operator= (const bigint& rhs) {
+        if (this != &rhs) {
+            release();
+            m_word  = rhs.m_word;
+            m_flags = rhs.m_flags;
+            inc_rc(m_word, m_flags);
+        }
+        return *this;
+    }
+
+    bigint& operator= (bigint&& rhs) {
+        if (this != &rhs) {
+            release();
+            m_word  = rhs.m_word;
+            m_flags = rhs.m_flags;
+            rhs.m_word = 0; rhs.m_flags = 0;
+        }
+        return *this;
+    }
+
+    /**
+     * Parse a decimal integer with an optional sign.
+     * @throw err_bad_argument if the string is not a valid integer.
+     */
+    static bigint<Alloc> from_string(const char* a_str, size_t a_len, const Alloc& a_alloc = Alloc());
+
+    static bigint<Alloc> from_string(const std::string& a_str, const Alloc& a_alloc = Alloc()) {
+        return from_string(a_str.c_str(), a_str.size(), a_alloc);
+    }
+
+    /// Decimal representation of the value.
+    std::string to_string() const;
+
+    bool            negative() const { return m_flags & NEG; }
+
+    /// Number of little-endian 64-bit limbs of the magnitude (at least 1).
+    size_t          size()     const { return m_flags & HEAP ? get_view().size  : 1; }
+    /// Little-endian 64-bit limbs of the magnitude.
+    const uint64_t* limbs()    const { return m_flags & HEAP ? get_view().limbs : &m_word; }
+
+    /// Number of bytes of the magnitude without leading zeros (0 for zero value).
+    size_t byte_size() const {
+        auto v = get_view();
+        uint64_t top = v.limbs[v.size-1];
+        return (v.size-1)*8 + (top ? (71 - __builtin_clzll(top)) / 8 : 0);
+    }
+
+    /// Byte \a i of the little-endian magnitude.
+    uint8_t byte(size_t i) const { return uint8_t(limbs()[i / 8] >> (8 * (i % 8))); }
+
+    bool fits_int64()  const {
+        return !(m_flags & HEAP) && m_word <= uint64_t(INT64_MAX) + negative();
+    }
+    bool fits_uint64() const { return !(m_flags & HEAP) && !negative(); }
+    bool fits_int128() const {
+        auto v = get_view();
+        if (v.size > 2) return false;
+        uint64_t hi = v.size == 2 ? v.limbs[1] : 0;
+        return !(hi >> 63) || (v.neg && hi == (1ull << 63) && v.limbs[0] == 0);
+    }
+    bool fits_uint128() const { return get_view().size <= 2 && !negative(); }
+
+    /// @throw err_bad_argument if the value doesn't fit in the result type.
+    int64_t to_int64() const {
+        if (!fits_int64()) throw err_bad_argument("Integer doesn't fit in int64", to_string());
+        return negative() ? int64_t(0 - m_word) : int64_t(m_word);
+    }
+    /// @throw err_bad_argument if the value doesn't fit in the result type.
+    uint64_t to_uint64() const {
+        if (!fits_uint64()) throw err_bad_argument("Integer doesn't fit in uint64", to_string());
+        return m_word;
+    }
+    /// @throw err_bad_argument if the value doesn't fit in the result type.
+    int128_t to_int128() const {
+        if (!fits_int128()) throw err_bad_argument("Integer doesn't fit in int128", to_string());
+        uint128_t n = magnitude128();
+        return negative() ? int128_t(0 - n) : int128_t(n);
+    }
+    /// @throw err_bad_argument if the value doesn't fit in the result type.
+    uint128_t to_uint128() const {
+        if (!fits_uint128()) throw err_bad_argument("Integer doesn't fit in uint128", to_string());
+        return magnitude128();
+    }
+
+    /// Three-way comparison in the order of integers.
+    int compare(const bigint& rhs) const { return compare(get_view(), rhs.get_view()); }
+
+    bool operator== (const bigint& rhs) const { return compare(rhs) == 0; }
+    bool operator!= (const bigint& rhs) const { return compare(rhs) != 0; }
+    bool operator<  (const bigint& rhs) const { return compare(rhs) <  0; }
+
+    /** Encode the integer to a flat buffer in the same way as Erlang does. */
+    void encode(char* buf, uintptr_t& idx, size_t size) const;
+
+    /** Size of buffer needed to hold the encoded integer. */
+    size_t encode_size() const {
+        if (fits_int64() && to_int64() >= INT32_MIN && to_int64() <= INT32_MAX)
+            return to_int64() >= 0 && to_int64() <= UINT8_MAX ? 2 : 5;
+        size_t n = byte_size();
+        return (n <= UINT8_MAX ? 3 : 6) + n;
+    }
+
+    std::ostream& dump(std::ostream& out, const varbind<Alloc>* =NULL) const {
+        return out << to_string();
+    }
+
+    // Use only for debugging
+    int use_count() const {
+        return m_flags & HEAP ? reinterpret_cast<limbs_t*>(m_word)->use_count() : -1000000;
+    }
+
+private:
+    uint128_t magnitude128() const {
+        auto v = get_view();
+        return uint128_t(v.size == 2 ? v.limbs[1] : 0) << 64 | v.limbs[0];
+    }
+};
+
+} // namespace marshal
+} // namespace eixx
+
+namespace std {
+    template <typename Alloc>
+    ostream& operator<< (ostream& out, const eixx::marshal::bigint<Alloc>& a) {
+        return a.dump(out);
+    }
+
+} // namespace std
+
+#include <eixx/marshal/bigint.hxx>
+
+#endif // _IMPL_BIGINT_HPP_
@@ -0,0 +1,230 @@
+//----------------------------------------------------------------------------
+/// \file  bigint.hxx
+//----------------------------------------------------------------------------
+/// \brief Implementation of bigint class member functions.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <cmath>
+#include <vector>
+#include <eixx/marshal/endian.hpp>
+#include <ei.h>
+
+namespace eixx {
+namespace marshal {
+
+template <class Alloc>
+void bigint<Alloc>::assign(bool a_neg, const uint64_t* a_limbs, size_t a_n, const Alloc& a_alloc)
+{
+    while (a_n > 1 && a_limbs[a_n-1] == 0)
+        --a_n;
+    if (a_n <= 1) {
+        set(a_neg, a_n ? a_limbs[0] : 0);
+        return;
+    }
+    auto p = new limbs_t(a_n, a_alloc);
+    memcpy(p->data(), a_limbs, a_n * sizeof(uint64_t));
+    m_word  = reinterpret_cast<uint64_t>(p);
+    m_flags = HEAP | (a_neg ? NEG : 0);
+}
+
+template <class Alloc>
+bigint<Alloc>::bigint(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc)
+    : m_word(0), m_flags(0)
+{
+    const char* s   = buf + idx;
+    const char* s0  = s;
+    uint8_t     tag = get8(s);
+    size_t      n;
+
+    switch (tag) {
+        case ERL_SMALL_INTEGER_EXT:
+            set(false, get8(s));
+            idx += s - s0;
+            return;
+        case ERL_INTEGER_EXT: {
+            int32_t i = int32_t(get32be(s));
+            set(i < 0, i < 0 ? 0 - uint64_t(int64_t(i)) : uint64_t(i));
+            idx += s - s0;
+            return;
+        }
+        case ERL_SMALL_BIG_EXT: n = get8(s);    break;
+        case ERL_LARGE_BIG_EXT: n = get32be(s); break;
+        default:
+            throw err_decode_exception("Error decoding integer's type", idx, tag);
+    }
+
+    bool neg = get8(s) != 0;
+    if ((size_t)(s - buf) + n > size)
+        throw err_decode_exception("Error decoding bignum", idx, n);
+
+    auto digits = reinterpret_cast<const uint8_t*>(s);
+    idx += s + n - s0;
+    while (n && digits[n-1] == 0)
+        --n;
+
+    if (n <= sizeof(uint64_t)) {
+        uint64_t v = 0;
+        for (size_t i = n; i-- > 0;)
+            v = v << 8 | digits[i];
+        set(neg, v);
+        return;
+    }
+
+    auto p = new limbs_t((n + 7) / 8, a_alloc);
+    uint64_t* l = p->data();
+    memset(l, 0, p->size() * sizeof(uint64_t));
+    for (size_t i = 0; i < n; ++i)
+        l[i / 8] |= uint64_t(digits[i]) << (8 * (i % 8));
+    m_word  = reinterpret_cast<uint64_t>(p);
+    m_flags = HEAP | (neg ? NEG : 0);
+}
+
+template <class Alloc>
+void bigint<Alloc>::encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t size) const
+{
+    char* s  = buf + idx;
+    char* s0 = s;
+    if (fits_int64() && to_int64() >= INT32_MIN && to_int64() <= INT32_MAX) {
+        int64_t i = to_int64();
+        if (i >= 0 && i <= UINT8_MAX) {
+            put8(s, ERL_SMALL_INTEGER_EXT);
+            put8(s, uint8_t(i));
+        } else {
+            put8(s, ERL_INTEGER_EXT);
+            put32be(s, uint32_t(i));
+        }
+    } else {
+        size_t n = byte_size();
+        if (n <= UINT8_MAX) {
+            put8(s, ERL_SMALL_BIG_EXT);
+            put8(s, uint8_t(n));
+        } else {
+            if (n > UINT32_MAX)
+                throw err_encode_exception("LARGE_BIG_EXT length exceeds maximum");
+            put8(s, ERL_LARGE_BIG_EXT);
+            put32be(s, uint32_t(n));
+        }
+        put8(s, negative());
+        for (size_t i = 0; i < n; ++i)
+            put8(s, byte(i));
+    }
+    idx += s - s0;
+    BOOST_ASSERT((size_t)idx <= size);
+}
+
+template <class Alloc>
+bigint<Alloc> bigint<Alloc>::from_string(const char* a_str, size_t a_len, const Alloc& a_alloc)
+{
+    const char* p = a_str, *e = a_str + a_len;
+    bool neg = p != e && *p == '-';
+    if (p != e && (*p == '-' || *p == '+'))
+        ++p;
+    if (p == e)
+        throw err_bad_argument("Invalid integer", std::string(a_str, a_len));
+
+    // Accumulate chunks of up to 19 decimal digits: limbs = limbs*10^k + chunk
+    std::vector<uint64_t> limbs(1, 0);
+    while (p != e) {
+        uint64_t chunk = 0, mul = 1;
+        for (int i = 0; i < 19 && p != e; ++i, ++p) {
+            if (*p < '0' || *p > '9')
+                throw err_bad_argument("Invalid integer", std::string(a_str, a_len));
+            chunk = chunk * 10 + (*p - '0');
+            mul  *= 10;
+        }
+        uint64_t carry = chunk;
+        for (auto& l : limbs) {
+            uint128_t x = uint128_t(l) * mul + carry;
+            l     = uint64_t(x);
+            carry = uint64_t(x >> 64);
+        }
+        if (carry)
+            limbs.push_back(carry);
+    }
+    return bigint<Alloc>(neg, limbs.data(), limbs.size(), a_alloc);
+}
+
+template <class Alloc>
+std::string bigint<Alloc>::to_string() const
+{
+    auto v = get_view();
+    std::string s(v.neg ? "-" : "");
+    if (v.size == 1)
+        return s + std::to_string(v.limbs[0]);
+
+    // Divide by 10^19 collecting the remainders as decimal chunks
+    static const uint64_t s_base = 10000000000000000000ull;
+    std::vector<uint64_t> q(v.limbs, v.limbs + v.size), chunks;
+    for (size_t n = q.size(); n; ) {
+        uint64_t r = 0;
+        for (size_t i = n; i-- > 0;) {
+            uint128_t x = uint128_t(r) << 64 | q[i];
+            q[i] = uint64_t(x / s_base);
+            r    = uint64_t(x % s_base);
+        }
+        chunks.push_back(r);
+        while (n && q[n-1] == 0)
+            --n;
+    }
+    s += std::to_string(chunks.back());
+    for (size_t i = chunks.size()-1; i-- > 0;) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%019llu", (unsigned long long)chunks[i]);
+        s += buf;
+    }
+    return s;
+}
+
+template <class Alloc>
+int bigint<Alloc>::compare(const view& a, double b)
+{
+    if (!std::isfinite(b))
+        return b > 0 ? -1 : 1;
+
+    // Compare with the integral part of the double first
+    bool     neg = b < 0;
+    double   f   = std::trunc(std::fabs(b));
+    uint64_t l[18] = {0};
+    size_t   n   = 1;
+    if (f < 18446744073709551616.0)
+        l[0] = uint64_t(f);
+    else {
+        int e;
+        uint64_t m = uint64_t(std::ldexp(std::frexp(f, &e), 53));
+        e -= 53;    // f == m * 2^e
+        size_t w = e / 64, sh = e % 64;
+        l[w] = m << sh;
+        if (sh)
+            l[w+1] = m >> (64 - sh);
+        n = l[w+1] ? w+2 : w+1;
+    }
+    if (int r = compare(a, view{l, n, neg && (n > 1 || l[0])}))
+        return r;
+    // Equal to the integral part - the fraction decides
+    return std::fabs(b) == f ? 0 : neg ? 1 : -1;
+}
+
+} // namespace marshal
+} // namespace eixx
@@ -36,6 +36,8 @@ limitations under the License.
 #include <eixx/marshal/varbind.hpp>
 #include <eixx/eterm_exception.hpp>
 #include <string.h>
+#include <functional>
+#include <mutex>
 
 namespace eixx {
 namespace marshal {
@@ -43,10 +45,90 @@ namespace marshal {
 template <class Alloc>
 class binary
 {
+public:
+    /// Callback invoked with the adopted memory when the last reference
+    /// to an external binary is released.
+    typedef std::function<void (const char* data, size_t size)> release_fun;
+    /// Writer of the content of a deferred binary to the given memory.
+    typedef std::function<void (char* dst)>                      gather_fun;
+
+private:
+    struct ext_data {
+        const char*        data;
+        size_t             size;
+        release_fun        on_release;
+        gather_fun         gather;      ///< Set for a deferred binary
+        blob<char, Alloc>* gathered;    ///< Content of a deferred binary
+        Alloc              alloc;
+        std::once_flag     once;
+
+        ext_data(const char* a_data, size_t a_size, release_fun&& a_fun)
+            : data(a_data), size(a_size), on_release(std::move(a_fun)), gathered(nullptr)
+        {}
+        ext_data(size_t a_size, gather_fun&& a_fun, const Alloc& a_alloc)
+            : data(nullptr), size(a_size), gather(std::move(a_fun)), gathered(nullptr)
+            , alloc(a_alloc)
+        {}
+        ~ext_data() {
+            if (on_release) on_release(data, size);
+            if (gathered)   gathered->release();
+        }
+
+        /// Get the data, gathering the content of a deferred binary
+        /// into contiguous memory on first use.
+        const char* get() {
+            if (gather)
+                std::call_once(once, [this] {
+                    gathered = new blob<char, Alloc>(size, alloc);
+                    gather(gathered->data());
+                    data = gathered->data();
+                });
+            return data;
+        }
+    };
+
+    typedef blob<ext_data, Alloc> ext_blob;
+
+    // Either a blob<char> owning the data, or an ext_blob describing
+    // external memory tagged with the lowest bit set.
     blob<char, Alloc>* m_blob;
 
+    /// Thread-local buffer, which decoded binaries may point into.
+    struct pin {
+        const binary* buffer;
+        size_t        min_size;
+    };
+    static pin& pinned() { static thread_local pin s_pin{nullptr, 0}; return s_pin; }
+
+    bool      is_ext() const { return reinterpret_cast<uintptr_t>(m_blob) & 1; }
+    ext_blob* ext()    const {
+        return reinterpret_cast<ext_blob*>(reinterpret_cast<uintptr_t>(m_blob) & ~uintptr_t(1));
+    }
+
+    void inc_rc() const {
+        if (is_ext())    ext()->inc_rc();
+        else if (m_blob) m_blob->inc_rc();
+    }
+
+    void release() {
+        if (is_ext()) {
+            auto p = ext();
+            if (p->release(false)) {
+                p->data()->~ext_data();
+                p->free();
+            }
+        } else if (m_blob)
+            m_blob->release();
+        m_blob = nullptr;
+    }
+
     void decode(const char* buf, uintptr_t& idx, size_t size);
 
+    /// Reference the data if it lies in the pinned buffer, or copy it.
+    void assign_decoded(const char* a_data, size_t a_size, const Alloc& a_alloc);
+
+    template <typename A> friend class bitstring;
+
 public:
     binary() : m_blob(nullptr) {}
 
@@ -71,18 +153,58 @@ public:
         memcpy(m_blob->data(), data, size);
     }
 
+    /**
+     * Create a binary of the given size with uninitialized content that
+     * is to be filled through mutate().
+     **/
+    binary(size_t size, const Alloc& a_alloc)
+        : m_blob(size ? new blob<char, Alloc>(size, a_alloc) : nullptr)
+    {}
+
+    /**
+     * Create a binary adopting external memory without copying it.
+     * The memory must not change while it's referenced by the binary.
+     * @param data pointer to data.
+     * @param size binary size in bytes
+     * @param a_release is called with \a data and \a size when the last
+     *        copy of this binary is destroyed.
+     * @param a_alloc is the allocator to use for the descriptor.
+     **/
+    binary(const char* data, size_t size, release_fun a_release, const Alloc& a_alloc = Alloc()) {
+        auto p = new ext_blob(1, a_alloc);
+        new (p->data()) ext_data(data, size, std::move(a_release));
+        m_blob = reinterpret_cast<blob<char, Alloc>*>(reinterpret_cast<uintptr_t>(p) | 1);
+    }
+
+    /**
+     * Create a deferred binary of \a size bytes, which content is written
+     * by \a a_gather.  When the binary is encoded, the content is written
+     * straight into the output buffer.  It's gathered into memory owned by
+     * the binary only if the data is accessed by other means.
+     * @param a_alloc is the allocator to use for the descriptor and data.
+     **/
+    binary(size_t size, gather_fun a_gather, const Alloc& a_alloc = Alloc()) {
+        auto p = new ext_blob(1, a_alloc);
+        new (p->data()) ext_data(size, std::move(a_gather), a_alloc);
+        m_blob = reinterpret_cast<blob<char, Alloc>*>(reinterpret_cast<uintptr_t>(p) | 1);
+    }
+
     binary(const binary<Alloc>& rhs) : m_blob(rhs.m_blob) {
-        if (m_blob) m_blob->inc_rc();
+        inc_rc();
     }
 
     binary(binary<Alloc>&& rhs) : m_blob(rhs.m_blob) { rhs.m_blob = nullptr; }
 
+    ~binary() { release(); }
+
     binary(std::initializer_list<uint8_t> bytes, const Alloc& alloc = Alloc())
         : binary(reinterpret_cast<const char*>(bytes.begin()), bytes.size(), alloc) {}
 
     /**
      * Construct the object by decoding it from a binary
      * encoded buffer and using custom allocator.
+     * If the data lies in a buffer pinned with pinned_scope, the binary
+     * references that buffer instead of copying the data.
      * @param a_alloc is the allocator to use.
      * @param buf is the buffer containing Erlang external binary format.
      * @param idx is the current offset in the buf buffer.
@@ -91,22 +213,108 @@ public:
      */
     binary(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
 
+    /**
+     * Decode the binary from a binary buffer reusing this binary's
+     * storage. Nothing is decoded if the storage is shared or too small.
+     * @return true if the binary was decoded.
+     */
+    bool decode_into(const char* buf, uintptr_t& idx, size_t size);
+
+    /**
+     * Map a file (or its region) into memory, and reference the mapped
+     * pages from the binary. The region is unmapped when the last copy
+     * of the binary is destroyed.
+     * @param a_path is the name of the file.
+     * @param a_offset is the offset of the region in the file.
+     * @param a_len is the length of the region (npos - till the end of file).
+     * @throw std::runtime_error if the file cannot be mapped.
+     **/
+    static binary<Alloc> map_file(const char* a_path, size_t a_offset = 0,
+                                  size_t a_len = std::string::npos,
+                                  const Alloc& a_alloc = Alloc());
+
+    /**
+     * Return a binary referencing \a a_size bytes of this binary at
+     * \a a_offset without copying them.  This binary's data is kept
+     * alive while the slice is referenced.
+     * @throw err_bad_argument if the slice is out of bounds.
+     */
+    binary<Alloc> slice(size_t a_offset, size_t a_size, const Alloc& a_alloc = Alloc()) const {
+        if (a_offset > size() || a_size > size() - a_offset)
+            throw err_bad_argument("Binary slice out of bounds", a_offset + a_size);
+        if (a_size == 0)
+            return binary<Alloc>();
+        binary<Alloc> owner(*this);
+        return binary<Alloc>(data() + a_offset, a_size,
+            [owner](const char*, size_t) {}, a_alloc);
+    }
+
+    /**
+     * While an object of this class exists, binaries decoded by the
+     * current thread from the \a a_buffer's memory that are at least
+     * \a a_min_size bytes long are created as slices of \a a_buffer
+     * instead of being copied.
+     */
+    class pinned_scope {
+        pin m_saved;
+    public:
+        explicit pinned_scope(const binary& a_buffer, size_t a_min_size = 64)
+            : m_saved(pinned())
+        {
+            pinned() = pin{&a_buffer, a_min_size};
+        }
+        ~pinned_scope() { pinned() = m_saved; }
+    };
+
     /** Get the size of the data (in bytes) */
-    size_t size() const { return m_blob ? m_blob->size() : 0; }
+    size_t size() const {
+        return is_ext() ? ext()->data()->size : m_blob ? m_blob->size() : 0;
+    }
 
     /** Get the data's binary buffer */
-    const char* data() const { return m_blob ? m_blob->data() : ""; }
+    const char* data() const {
+        return is_ext() ? ext()->data()->get() : m_blob ? m_blob->data() : "";
+    }
+
+    /// Returns true if the binary references external memory.
+    bool        external() const { return is_ext(); }
+
+    /// Returns true if the binary's content is written by a gather function.
+    bool        deferred() const { return is_ext() && ext()->data()->gather; }
+
+    // Use only for debugging
+    int         use_count() const {
+        return is_ext() ? ext()->use_count() : m_blob ? m_blob->use_count() : -1000000;
+    }
+
+    /**
+     * Get mutable access to the binary's data. If the data is shared with
+     * other terms or is external, it's copied first, otherwise it's
+     * modified in place.
+     */
+    char* mutate() {
+        if (is_ext() || (m_blob && !m_blob->unique())) {
+            auto p = new blob<char, Alloc>(size(), is_ext()
+                ? Alloc(ext()->get_allocator()) : m_blob->get_allocator());
+            memcpy(p->data(), data(), size());
+            release();
+            m_blob = p;
+        }
+        return m_blob ? m_blob->data() : nullptr;
+    }
 
     binary& operator= (const binary& rhs) {
         if (this != &rhs) {
+            release();
             m_blob = rhs.m_blob;
-            if (m_blob) m_blob->inc_rc();
+            inc_rc();
         }
         return *this;
     }
 
     binary& operator= (binary&& rhs) {
         if (this != &rhs) {
+            release();
             m_blob = rhs.m_blob;
             rhs.m_blob = nullptr;
         }
@@ -117,14 +325,10 @@ public:
         return size() == rhs.size() 
             && (size() == 0 || memcmp(data(), rhs.data(), size()) == 0);
     }
+    /// Byte-wise lexicographical ordering (a prefix is less than a longer binary).
     bool operator< (const binary<Alloc>& rhs) const {
-        if (size() < rhs.size()) return true;
-        if (size() > rhs.size()) return false;
-        if (size() == 0)         return false;
-        int res = memcmp(data(), rhs.data(), size());
-        if (res < 0) return true;
-        if (res > 0) return false;
-        return false;
+        int res = memcmp(data(), rhs.data(), std::min(size(), rhs.size()));
+        return res < 0 || (res == 0 && size() < rhs.size());
     }
 
     /** Encode binary to a flat buffer. */
@@ -27,6 +27,10 @@ limitations under the License.
 */
 
 #include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <eixx/marshal/endian.hpp>
 #include <ei.h>
 
@@ -44,13 +48,84 @@ binary<Alloc>::binary(const char* buf, uintptr_t& idx, [[maybe_unused]] size_t s
         throw err_decode_exception("Error decoding binary's type", idx, tag);
 
     uint32_t sz = get32be(s);
-    m_blob = new blob<char, Alloc>(sz, a_alloc);
-    ::memcpy(m_blob->data(),s,sz);
+    m_blob = nullptr;
+    assign_decoded(s, sz, a_alloc);
 
     idx += s + sz - s0;
     BOOST_ASSERT((size_t)idx <= size);
 }
 
+template <class Alloc>
+void binary<Alloc>::assign_decoded(const char* s, size_t sz, const Alloc& a_alloc)
+{
+    const pin& p = pinned();
+    if (p.buffer && sz && sz >= p.min_size &&
+        s >= p.buffer->data() && s + sz <= p.buffer->data() + p.buffer->size())
+        *this = p.buffer->slice(s - p.buffer->data(), sz, a_alloc);
+    else {
+        release();
+        m_blob = new blob<char, Alloc>(sz, a_alloc);
+        ::memcpy(m_blob->data(),s,sz);
+    }
+}
+
+template <class Alloc>
+bool binary<Alloc>::decode_into(const char* buf, uintptr_t& idx, [[maybe_unused]] size_t size)
+{
+    const char* s = buf + idx;
+    if (!m_blob || is_ext() || !m_blob->unique() || get8(s) != ERL_BINARY_EXT)
+        return false;
+    uint32_t sz = get32be(s);
+    if (!m_blob->resize(sz))
+        return false;
+    ::memcpy(m_blob->data(), s, sz);
+    idx += 5 + sz;
+    BOOST_ASSERT((size_t)idx <= size);
+    return true;
+}
+
+template <class Alloc>
+binary<Alloc> binary<Alloc>::map_file(const char* a_path, size_t a_offset, size_t a_len,
+                                      const Alloc& a_alloc)
+{
+    int fd = ::open(a_path, O_RDONLY);
+    if (fd < 0)
+        THROW_RUNTIME_ERROR("Cannot open file " << a_path << ": " << strerror(errno));
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        THROW_RUNTIME_ERROR("Cannot stat file " << a_path << ": " << strerror(err));
+    }
+
+    size_t fsize = st.st_size;
+    if (a_offset > fsize || (a_len != std::string::npos && a_len > fsize - a_offset)) {
+        ::close(fd);
+        THROW_RUNTIME_ERROR("Region [" << a_offset << ',' << a_len << "] is out of bounds of "
+                            << a_path << " (size=" << fsize << ')');
+    }
+    if (a_len == std::string::npos)
+        a_len = fsize - a_offset;
+    if (a_len == 0) {
+        ::close(fd);
+        return binary<Alloc>();
+    }
+
+    // mmap() requires the offset to be aligned on the page boundary
+    size_t page    = ::sysconf(_SC_PAGESIZE);
+    size_t aligned = a_offset & ~(page-1);
+    size_t map_len = a_len + (a_offset - aligned);
+    void*  addr    = ::mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, aligned);
+    int    err     = errno;
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        THROW_RUNTIME_ERROR("Cannot mmap file " << a_path << ": " << strerror(err));
+
+    return binary<Alloc>(static_cast<const char*>(addr) + (a_offset - aligned), a_len,
+        [addr, map_len](const char*, size_t) { ::munmap(addr, map_len); }, a_alloc);
+}
+
 template <class Alloc>
 void binary<Alloc>::encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t size) const
 {
@@ -62,7 +137,10 @@ void binary<Alloc>::encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t si
         throw err_encode_exception("BINARY_EXT length exceeds maximum");
     uint32_t len = (uint32_t)sz;
     put32be(s, len);
-    memmove(s, this->data(), len);
+    if (deferred())
+        ext()->data()->gather(s);
+    else
+        memmove(s, this->data(), len);
     s += len;
     idx += s-s0;
     BOOST_ASSERT((size_t)idx <= size);
@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------------
+/// \file  bit_pattern.hpp
+//----------------------------------------------------------------------------
+/// \brief Compiled Erlang bit syntax for matching and building bitstrings.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_BIT_PATTERN_HPP_
+#define _IMPL_BIT_PATTERN_HPP_
+
+#include <vector>
+#include <eixx/eterm_exception.hpp>
+#include <eixx/marshal/eterm.hpp>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Erlang bit syntax expression, such as
+ * <tt>"<<Ver:4, Flags:12, Len:16, Body:Len/binary, _/bits>>"</tt>,
+ * that is parsed once and then used to extract fields from bitstrings
+ * or to build bitstrings from field values.
+ *
+ * A segment is <tt>Value[:Size][/Type-Specifier-...]</tt>, where Value is
+ * a variable, '_' (matching only), an integer, a float or a string (a
+ * sequence of 8-bit integers), and Size is an integer or a variable bound
+ * by a preceding segment or supplied by the caller.  Supported specifiers:
+ * integer, float, binary (bytes), bitstring (bits), utf8, signed, unsigned,
+ * big, little, native and unit:N.  Integer segments are limited to 64 bits.
+ *
+ * Variables are numbered in the order of their first appearance.  Values
+ * are exchanged through an array indexed by those numbers, so matching
+ * integer and float fields doesn't allocate memory, and binary fields
+ * reference the matched bitstring's memory when they are byte-aligned:
+ * <code>
+ *   static const bit_pattern<Alloc> p("<<Ver:4, Flags:12, Len:16, Body:Len/binary>>");
+ *   eterm<Alloc> v[4];
+ *   if (p.match(packet, v))
+ *       handle(v[0].to_long(), v[3].to_binary());
+ *   bitstring<Alloc> reply = p.build({1, 0, 3, binary({1,2,3})});
+ * </code>
+ */
+template <class Alloc>
+class bit_pattern
+{
+    enum seg_type : uint8_t { INTEGER, FLOAT, BINARY_SEG, BITS_SEG, UTF8 };
+
+    static const size_t ALL = size_t(-1);   ///< Size of a segment taking the rest
+
+    struct segment {
+        seg_type     type;
+        bool         sign;      ///< Signed integer
+        bool         little;    ///< Little-endian integer or float
+        bool         first;     ///< The segment binds its variable
+        uint16_t     unit;
+        int          var;       ///< Variable bound to the segment (-1 for none)
+        int          size_var;  ///< Variable holding the size (-1 for literal size)
+        size_t       size;      ///< Size in units
+        eterm<Alloc> value;     ///< Literal value of the segment (when var < 0)
+    };
+
+    std::vector<segment> m_segs;
+    std::vector<atom>    m_vars;
+
+    void parse(const char* a_spec);
+
+    int  var_index(const char* a_name, size_t a_len, bool a_add);
+
+    /// Get the size of segment \a a_seg in bits (ALL for the rest).
+    size_t bits(const segment& a_seg, const eterm<Alloc>* a_vars) const;
+
+    /// Get the size in bits of segment \a a_seg holding value \a a_val.
+    size_t build_bits(const segment& a_seg, const eterm<Alloc>& a_val,
+                      const eterm<Alloc>* a_vars) const;
+
+    /// Get the value of the variable \a a_var.
+    /// @throw err_unbound_variable
+    const eterm<Alloc>& value(int a_var, const eterm<Alloc>* a_vars) const {
+        const eterm<Alloc>& v = a_vars[a_var];
+        if (v.empty())
+            throw err_unbound_variable(m_vars[a_var].c_str());
+        return v;
+    }
+
+public:
+    /**
+     * Parse the bit syntax expression (the enclosing "<<" and ">>"
+     * are optional).
+     * @throw err_format_exception if the expression is invalid.
+     */
+    explicit bit_pattern(const char* a_spec) { parse(a_spec); }
+    explicit bit_pattern(const std::string& a_spec) { parse(a_spec.c_str()); }
+
+    /// Number of variables in the expression.
+    size_t       var_count()        const { return m_vars.size(); }
+    /// Name of the \a i-th variable.
+    const atom&  var(size_t i)      const { return m_vars[i]; }
+    /// Index of the variable named \a a_name (-1 if there's no such variable).
+    int          var_index(atom a_name) const {
+        for (size_t i = 0; i < m_vars.size(); ++i)
+            if (m_vars[i] == a_name) return int(i);
+        return -1;
+    }
+
+    /**
+     * Match a bitstring against the expression.  The variables bound by
+     * segments are stored in \a a_vars, which must have var_count()
+     * elements.  Variables only used as sizes must be set by the caller.
+     * The content of \a a_vars is unspecified if the match fails.
+     * @throw err_unbound_variable if the size variable is not set.
+     */
+    bool match(const bitstring<Alloc>& a_bits, eterm<Alloc>* a_vars,
+               const Alloc& a_alloc = Alloc()) const;
+
+    /**
+     * Match a BINARY or BITSTRING term against the expression, checking
+     * and updating the variables in \a a_binding like eterm::match() does.
+     * @throw err_unbound_variable if the size variable is not bound.
+     */
+    bool match(const eterm<Alloc>& a_term, varbind<Alloc>* a_binding = nullptr,
+               const Alloc& a_alloc = Alloc()) const;
+
+    /**
+     * Build a bitstring from the values of variables given in \a a_vars,
+     * which must have var_count() elements.  Integer values are truncated
+     * to the size of their segments.
+     * @throw err_unbound_variable if a variable is not set.
+     * @throw err_bad_argument if a value doesn't match its segment.
+     */
+    bitstring<Alloc> build(const eterm<Alloc>* a_vars, const Alloc& a_alloc = Alloc()) const;
+
+    bitstring<Alloc> build(std::initializer_list<eterm<Alloc>> a_vars,
+                           const Alloc& a_alloc = Alloc()) const {
+        if (a_vars.size() != m_vars.size())
+            throw err_bad_argument("Invalid number of bit syntax variables", a_vars.size());
+        return build(a_vars.begin(), a_alloc);
+    }
+
+    /// Build a bitstring from the variables bound in \a a_binding.
+    bitstring<Alloc> build(const varbind<Alloc>& a_binding, const Alloc& a_alloc = Alloc()) const;
+};
+
+} // namespace marshal
+} // namespace eixx
+
+#include <eixx/marshal/bit_pattern.hxx>
+
+#endif // _IMPL_BIT_PATTERN_HPP_
@@ -0,0 +1,488 @@
+//----------------------------------------------------------------------------
+/// \file  bit_pattern.hxx
+//----------------------------------------------------------------------------
+/// \brief Implementation of bit_pattern class member functions.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <ctype.h>
+#include <errno.h>
+#include <cmath>
+
+namespace eixx {
+namespace marshal {
+
+namespace detail {
+
+    /// Convert a value read as \a a_n big-endian bits to a little-endian
+    /// one: whole bytes come first, followed by the remaining high bits.
+    inline uint64_t from_little(uint64_t a_raw, size_t a_n) {
+        size_t   k = a_n / 8, r = a_n % 8;
+        uint64_t v = r ? a_raw & ((uint64_t(1) << r) - 1) : 0;
+        for (size_t i = 0; i < k; ++i)
+            v = v << 8 | ((a_raw >> (r + 8 * i)) & 0xFF);
+        return v;
+    }
+
+    /// Inverse of from_little().
+    inline uint64_t to_little(uint64_t a_val, size_t a_n) {
+        size_t   k = a_n / 8, r = a_n % 8;
+        uint64_t v = 0;
+        for (size_t i = 0; i < k; ++i)
+            v = v << 8 | ((a_val >> (8 * i)) & 0xFF);
+        return r ? v << r | ((a_val >> (8 * k)) & ((uint64_t(1) << r) - 1)) : v;
+    }
+
+    inline bool valid_code_point(long a) {
+        return a >= 0 && a <= 0x10FFFF && (a < 0xD800 || a > 0xDFFF);
+    }
+
+} // namespace detail
+
+template <class Alloc>
+int bit_pattern<Alloc>::var_index(const char* a_name, size_t a_len, bool a_add)
+{
+    int i = var_index(atom(std::string(a_name, a_len)));
+    if (i < 0 && a_add) {
+        m_vars.push_back(atom(std::string(a_name, a_len)));
+        i = int(m_vars.size()) - 1;
+    }
+    return i;
+}
+
+template <class Alloc>
+void bit_pattern<Alloc>::parse(const char* a_spec)
+{
+    const char* p = a_spec;
+    auto ws  = [&p]() { while (isspace(*p)) ++p; };
+    auto err = [a_spec](const char* a_msg, const char* a_pos) {
+        throw err_format_exception(a_msg, a_pos, a_spec);
+    };
+    auto name = [&p]() { while (isalnum(*p) || *p == '_' || *p == '@') ++p; };
+
+    ws();
+    bool brackets = p[0] == '<' && p[1] == '<';
+    if (brackets) { p += 2; ws(); }
+
+    bool empty = brackets ? p[0] == '>' && p[1] == '>' : *p == '\0';
+    while (!empty) {
+        const char* start = p;
+        segment seg{INTEGER, false, false, false, 1, -1, -1, 8, eterm<Alloc>()};
+
+        if (*p == '"') {
+            // A string is a sequence of 8-bit integer segments
+            for (++p; *p && *p != '"'; ++p) {
+                if (*p == '\\' && p[1]) ++p;
+                m_segs.push_back(seg);
+                m_segs.back().value = eterm<Alloc>(long((unsigned char)*p));
+            }
+            if (*p != '"')
+                err("Unterminated string in bit syntax", start);
+            ++p; ws();
+        } else {
+            if (isupper(*p) || *p == '_') {
+                name();
+                if (p - start != 1 || *start != '_')
+                    seg.var = var_index(start, p - start, true);
+            } else if (isdigit(*p) || *p == '-') {
+                char* e;
+                errno = 0;
+                long l = strtol(p, &e, 10);
+                if (*e == '.' || *e == 'e' || *e == 'E')
+                    seg.value = eterm<Alloc>(strtod(p, &e));
+                else if (errno == ERANGE)
+                    err("Integer out of range in bit syntax", p);
+                else
+                    seg.value = eterm<Alloc>(l);
+                if (e == p)
+                    err("Invalid segment value in bit syntax", p);
+                p = e;
+            } else
+                err("Invalid segment value in bit syntax", p);
+            ws();
+
+            bool has_size = false, has_type = false, has_unit = false;
+            if (*p == ':') {
+                ++p; ws();
+                const char* q = p;
+                if (isdigit(*p))
+                    seg.size = strtoul(p, const_cast<char**>(&p), 10);
+                else if (isupper(*p)) {
+                    name();
+                    seg.size_var = var_index(q, p - q, true);
+                } else
+                    err("Invalid segment size in bit syntax", p);
+                has_size = true;
+                ws();
+            }
+
+            if (*p == '/') {
+                do {
+                    ++p; ws();
+                    const char* q = p;
+                    name();
+                    std::string w(q, p - q);
+                    if      (w == "integer")                    seg.type = INTEGER;
+                    else if (w == "float")                      seg.type = FLOAT;
+                    else if (w == "binary"    || w == "bytes")  seg.type = BINARY_SEG;
+                    else if (w == "bitstring" || w == "bits")   seg.type = BITS_SEG;
+                    else if (w == "utf8")                       seg.type = UTF8;
+                    else if (w == "signed")   { seg.sign   = true;  continue; }
+                    else if (w == "unsigned") { seg.sign   = false; continue; }
+                    else if (w == "big")      { seg.little = false; continue; }
+                    else if (w == "little")   { seg.little = true;  continue; }
+                    else if (w == "native")   {
+                        seg.little = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+                        continue;
+                    } else if (w == "unit") {
+                        ws();
+                        if (*p++ != ':')
+                            err("Expected ':' after unit in bit syntax", p-1);
+                        ws();
+                        unsigned long u = isdigit(*p) ? strtoul(p, const_cast<char**>(&p), 10) : 0;
+                        if (u < 1 || u > 256)
+                            err("Invalid unit in bit syntax", q);
+                        seg.unit = uint16_t(u);
+                        has_unit = true;
+                        continue;
+                    } else
+                        err("Unknown type specifier in bit syntax", q);
+                    has_type = true;
+                } while ((ws(), *p == '-'));
+            }
+
+            // Apply the defaults and validate the segment
+            if (!has_type && seg.value.type() == DOUBLE)
+                seg.type = FLOAT;
+            if (seg.value.type() == DOUBLE && seg.type != FLOAT)
+                err("Float value in a non-float segment", start);
+            if (seg.value.type() == LONG && seg.type == FLOAT)
+                seg.value = eterm<Alloc>(double(seg.value.to_long()));
+            if (!seg.value.empty() && (seg.type == BINARY_SEG || seg.type == BITS_SEG))
+                err("Binary segment value must be a variable", start);
+            if (seg.type == UTF8 && (has_size || has_unit))
+                err("Size of utf8 segment can't be given", start);
+            if (seg.type == UTF8 && !seg.value.empty() &&
+                !detail::valid_code_point(seg.value.to_long()))
+                err("Invalid code point in utf8 segment", start);
+            if (has_unit && !has_size && (seg.type == INTEGER || seg.type == FLOAT))
+                err("Unit requires segment size", start);
+            if (!has_unit && seg.type == BINARY_SEG)
+                seg.unit = 8;
+            if (!has_size)
+                seg.size = seg.type == INTEGER ? 8 : seg.type == FLOAT ? 64 : ALL;
+            if (seg.size_var < 0 && seg.size != ALL) {
+                size_t n = seg.size * seg.unit;
+                if (seg.type == INTEGER && n > 64)
+                    err("Integer segments over 64 bits are not supported", start);
+                if (seg.type == FLOAT && n != 32 && n != 64)
+                    err("Float segment must be 32 or 64 bits", start);
+            }
+            m_segs.push_back(std::move(seg));
+        }
+
+        if (*p != ',')
+            break;
+        ++p; ws();
+    }
+
+    if (brackets) {
+        if (p[0] != '>' || p[1] != '>')
+            err("Expected '>>' in bit syntax", p);
+        p += 2; ws();
+    }
+    if (*p)
+        err("Unexpected character in bit syntax", p);
+
+    // A variable is bound by its first segment unless it's used as a size before
+    std::vector<bool> seen(m_vars.size());
+    for (auto& s : m_segs) {
+        if (s.size_var >= 0)
+            seen[s.size_var] = true;
+        if (s.var >= 0 && !seen[s.var])
+            s.first = seen[s.var] = true;
+    }
+}
+
+template <class Alloc>
+size_t bit_pattern<Alloc>::bits(const segment& a_seg, const eterm<Alloc>* a_vars) const
+{
+    size_t sz = a_seg.size;
+    if (a_seg.size_var >= 0) {
+        const eterm<Alloc>& v = value(a_seg.size_var, a_vars);
+        if (v.type() != LONG || v.to_long() < 0)
+            return ALL - 1;
+        sz = size_t(v.to_long());
+        if (sz > (ALL - 2) / a_seg.unit)
+            return ALL - 1;
+    }
+    return sz == ALL ? ALL : sz * a_seg.unit;
+}
+
+template <class Alloc>
+bool bit_pattern<Alloc>::match(const bitstring<Alloc>& a_bits, eterm<Alloc>* a_vars,
+                               const Alloc& a_alloc) const
+{
+    const char* data  = a_bits.data();
+    size_t      bytes = a_bits.size();
+    size_t      end   = a_bits.bit_size();
+    size_t      off   = 0;
+
+    for (auto& s : m_segs) {
+        eterm<Alloc> val;
+        size_t left = end - off, n;
+
+        if (s.type == UTF8) {
+            if (left < 8)
+                return false;
+            uint8_t b = uint8_t(detail::get_bits(data, bytes, off, 8));
+            n = b < 0x80 ? 1 : b < 0xC2 ? 0 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : b < 0xF5 ? 4 : 0;
+            if (n == 0 || left < 8 * n)
+                return false;
+            uint64_t u = detail::get_bits(data, bytes, off, 8 * n);
+            long     c = n == 1 ? long(b) : long(b & (0x7F >> n));
+            for (size_t i = n - 1; i-- > 0;) {
+                uint8_t x = uint8_t(u >> (8 * i));
+                if ((x & 0xC0) != 0x80)
+                    return false;
+                c = c << 6 | (x & 0x3F);
+            }
+            static const long s_min[] = {0, 0, 0x80, 0x800, 0x10000};
+            if (c < s_min[n] || !detail::valid_code_point(c))
+                return false;
+            val  = eterm<Alloc>(c);
+            off += 8 * n;
+        } else {
+            n = bits(s, a_vars);
+            if (n == ALL) {
+                if (left % s.unit)
+                    return false;
+                n = left;
+            } else if (n > left)
+                return false;
+
+            switch (s.type) {
+                case INTEGER: {
+                    if (n > 64)
+                        return false;
+                    uint64_t v = detail::get_bits(data, bytes, off, n);
+                    if (s.little)
+                        v = detail::from_little(v, n);
+                    if (s.sign && n && n < 64 && (v >> (n - 1)) & 1)
+                        v |= ~uint64_t(0) << n;
+                    val = s.sign ? eterm<Alloc>(long(v)) : eterm<Alloc>((unsigned long)v);
+                    break;
+                }
+                case FLOAT: {
+                    if (n != 32 && n != 64)
+                        return false;
+                    uint64_t v = detail::get_bits(data, bytes, off, n);
+                    if (s.little)
+                        v = detail::from_little(v, n);
+                    double d;
+                    if (n == 32) {
+                        float f; uint32_t w = uint32_t(v);
+                        memcpy(&f, &w, sizeof(f));
+                        d = f;
+                    } else
+                        memcpy(&d, &v, sizeof(d));
+                    if (!std::isfinite(d))
+                        return false;
+                    val = eterm<Alloc>(d);
+                    break;
+                }
+                default:
+                    val = eterm<Alloc>(a_bits.sub(off, n, a_alloc));
+                    break;
+            }
+            off += n;
+        }
+
+        if (s.first)
+            a_vars[s.var] = std::move(val);
+        else if (s.var >= 0) {
+            if (!(value(s.var, a_vars) == val))
+                return false;
+        } else if (!s.value.empty() && !(s.value == val))
+            return false;
+    }
+    return off == end;
+}
+
+template <class Alloc>
+bool bit_pattern<Alloc>::match(const eterm<Alloc>& a_term, varbind<Alloc>* a_binding,
+                               const Alloc& a_alloc) const
+{
+    if (!a_term.is_bitstring())
+        return false;
+    std::vector<eterm<Alloc>> vars(m_vars.size());
+    if (a_binding)
+        for (size_t i = 0; i < vars.size(); ++i)
+            if (auto p = a_binding->find(m_vars[i]))
+                vars[i] = *p;
+    if (!match(a_term.to_bitstring(), vars.data(), a_alloc))
+        return false;
+    if (a_binding) {
+        // Variables bound before matching must keep their values
+        for (size_t i = 0; i < vars.size(); ++i)
+            if (auto p = a_binding->find(m_vars[i]))
+                if (!(*p == vars[i]))
+                    return false;
+        for (size_t i = 0; i < vars.size(); ++i)
+            a_binding->bind(m_vars[i], vars[i]);
+    }
+    return true;
+}
+
+template <class Alloc>
+size_t bit_pattern<Alloc>::build_bits(const segment& a_seg, const eterm<Alloc>& a_val,
+                                      const eterm<Alloc>* a_vars) const
+{
+    auto bad = [](const char* a_msg, const eterm<Alloc>& a) {
+        throw err_bad_argument(a_msg, a.to_string());
+    };
+
+    if (a_seg.type == UTF8) {
+        if (a_val.type() != LONG || !detail::valid_code_point(a_val.to_long()))
+            bad("Invalid utf8 segment value", a_val);
+        long c = a_val.to_long();
+        return 8 * (c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4);
+    }
+
+    size_t n = bits(a_seg, a_vars);
+    if (n == ALL - 1)
+        bad("Invalid segment size", value(a_seg.size_var, a_vars));
+
+    switch (a_seg.type) {
+        case INTEGER:
+            if (!a_val.is_integer())
+                bad("Invalid integer segment value", a_val);
+            if (n > 64)
+                throw err_bad_argument("Integer segments over 64 bits are not supported", n);
+            return n;
+        case FLOAT:
+            if (a_val.type() != DOUBLE && a_val.type() != LONG)
+                bad("Invalid float segment value", a_val);
+            if (n != 32 && n != 64)
+                throw err_bad_argument("Float segment must be 32 or 64 bits", n);
+            return n;
+        default: {
+            if (!a_val.is_bitstring())
+                bad("Invalid binary segment value", a_val);
+            size_t m = a_val.type() == BINARY ? 8 * a_val.to_binary().size()
+                                              : a_val.to_bitstring().bit_size();
+            if (n == ALL) {
+                if (m % a_seg.unit)
+                    bad("Binary segment size is not a multiple of unit", a_val);
+                return m;
+            }
+            if (n > m)
+                bad("Binary segment value is too short", a_val);
+            return n;
+        }
+    }
+}
+
+template <class Alloc>
+bitstring<Alloc> bit_pattern<Alloc>::build(const eterm<Alloc>* a_vars, const Alloc& a_alloc) const
+{
+    auto val = [this, a_vars](const segment& s) -> const eterm<Alloc>& {
+        if (s.var < 0 && s.value.empty())
+            throw err_bad_argument("Can't build a bitstring from '_' segment");
+        return s.var >= 0 ? value(s.var, a_vars) : s.value;
+    };
+
+    size_t total = 0;
+    for (auto& s : m_segs)
+        total += build_bits(s, val(s), a_vars);
+
+    binary<Alloc> bin((total + 7) / 8, a_alloc);
+    char*  p   = bin.mutate();
+    size_t off = 0;
+    if (p)
+        memset(p, 0, bin.size());
+
+    for (auto& s : m_segs) {
+        const eterm<Alloc>& v = val(s);
+        size_t n = build_bits(s, v, a_vars);
+        if (n == 0)
+            continue;
+        switch (s.type) {
+            case INTEGER: {
+                // Integers are truncated to the low bits (two's complement)
+                uint64_t x;
+                if (v.type() == LONG)
+                    x = uint64_t(v.to_long());
+                else {
+                    auto b = v.to_bigint();
+                    x = b.negative() ? 0 - b.limbs()[0] : b.limbs()[0];
+                }
+                detail::put_bits(p, off, n, s.little ? detail::to_little(x, n) : x);
+                break;
+            }
+            case FLOAT: {
+                double d = v.type() == DOUBLE ? v.to_double() : double(v.to_long());
+                uint64_t x;
+                if (n == 32) {
+                    float f = float(d); uint32_t w;
+                    memcpy(&w, &f, sizeof(w));
+                    x = w;
+                } else
+                    memcpy(&x, &d, sizeof(x));
+                detail::put_bits(p, off, n, s.little ? detail::to_little(x, n) : x);
+                break;
+            }
+            case UTF8: {
+                long     c = v.to_long();
+                uint64_t x = c < 0x80    ? uint64_t(c)
+                           : c < 0x800   ? uint64_t(0xC080   | (c & 0x7C0) << 2 | (c & 0x3F))
+                           : c < 0x10000 ? uint64_t(0xE08080 | (c & 0xF000) << 4 | (c & 0xFC0) << 2 | (c & 0x3F))
+                           : uint64_t(0xF0808080 | (c & 0x1C0000) << 6 | (c & 0x3F000) << 4
+                                                 | (c & 0xFC0) << 2 | (c & 0x3F));
+                detail::put_bits(p, off, n, x);
+                break;
+            }
+            default: {
+                auto b = v.to_bitstring();
+                detail::copy_bits(p, off, b.data(), b.size(), 0, n);
+                break;
+            }
+        }
+        off += n;
+    }
+    return bitstring<Alloc>(bin, total, a_alloc);
+}
+
+template <class Alloc>
+bitstring<Alloc> bit_pattern<Alloc>::build(const varbind<Alloc>& a_binding, const Alloc& a_alloc) const
+{
+    std::vector<eterm<Alloc>> vars(m_vars.size());
+    for (size_t i = 0; i < vars.size(); ++i)
+        if (auto p = a_binding.find(m_vars[i]))
+            vars[i] = *p;
+    return build(vars.data(), a_alloc);
+}
+
+} // namespace marshal
+} // namespace eixx
@@ -0,0 +1,225 @@
+//----------------------------------------------------------------------------
+/// \file  bitstring.hpp
+//----------------------------------------------------------------------------
+/// \brief A class implementing a bitstring object of Erlang external
+///        term format.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_BITSTRING_HPP_
+#define _IMPL_BITSTRING_HPP_
+
+#include <eixx/marshal/binary.hpp>
+#include <eixx/marshal/endian.hpp>
+
+namespace eixx {
+namespace marshal {
+
+namespace detail {
+
+    /// Read \a a_n (<= 64) bits at bit offset \a a_off of the \a a_size
+    /// bytes long buffer as a big-endian unsigned integer.
+    inline uint64_t get_bits(const char* a_data, size_t a_size, size_t a_off, size_t a_n) {
+        if (a_n == 0)
+            return 0;
+        const char* p  = a_data + a_off / 8;
+        size_t      sh = a_off % 8;
+        // Fast path: a single unaligned 64-bit load
+        if (sh + a_n <= 64 && size_t(p - a_data) + 8 <= a_size)
+            return (cast_be<uint64_t>(p) << sh) >> (64 - a_n);
+        uint64_t v = 0;
+        size_t   n = 0;
+        for (size_t bits = sh + a_n; n < bits && n < 64; n += 8)
+            v = v << 8 | uint8_t(*p++);
+        // Bits beyond 64 are in the next byte
+        if (sh + a_n > 64)
+            return (v << sh | uint8_t(*p) >> (8 - sh)) >> (64 - a_n);
+        return (v << (64 - n) << sh) >> (64 - a_n);
+    }
+
+    /// Write the \a a_n (<= 64) low bits of \a a_val at bit offset \a a_off
+    /// in big-endian order.  The bits of the buffer being written must be zero.
+    inline void put_bits(char* a_data, size_t a_off, size_t a_n, uint64_t a_val) {
+        if (a_n == 0)
+            return;
+        char*  p  = a_data + a_off / 8;
+        size_t sh = a_off % 8;
+        if (sh == 0 && a_n % 8 == 0) {
+            for (size_t i = a_n / 8; i-- > 0; a_val >>= 8)
+                p[i] = char(a_val);
+            return;
+        }
+        if (a_n < 64)
+            a_val &= (uint64_t(1) << a_n) - 1;
+        // Write the bits most significant first, one (partial) byte at a time
+        for (size_t left = a_n; left; ) {
+            size_t   room = 8 - sh, k = std::min(room, left);
+            uint8_t  b    = uint8_t(a_val >> (left - k)) & uint8_t((1u << k) - 1);
+            *p   |= char(b << (room - k));
+            left -= k;
+            sh    = 0;
+            ++p;
+        }
+    }
+
+    /// Copy \a a_n bits from bit offset \a a_src_off of \a a_src to bit
+    /// offset \a a_dst_off of the zero-filled \a a_dst.
+    inline void copy_bits(char* a_dst, size_t a_dst_off, const char* a_src,
+                          size_t a_src_size, size_t a_src_off, size_t a_n)
+    {
+        if (a_dst_off % 8 == 0 && a_src_off % 8 == 0) {
+            memcpy(a_dst + a_dst_off / 8, a_src + a_src_off / 8, a_n / 8);
+            size_t done = a_n & ~size_t(7);
+            a_dst_off += done; a_src_off += done; a_n -= done;
+        }
+        for (size_t k; a_n; a_n -= k, a_src_off += k, a_dst_off += k) {
+            k = std::min<size_t>(a_n, 56);
+            put_bits(a_dst, a_dst_off, k, get_bits(a_src, a_src_size, a_src_off, k));
+        }
+    }
+
+} // namespace detail
+
+/**
+ * A sequence of bits, which length is not necessarily a multiple of 8.
+ * The bits are kept in a binary, which last byte holds the tail bits in
+ * its most significant bits.  Copies and byte-aligned sub-bitstrings
+ * share the memory of the binary.
+ *
+ * An eterm holding a bitstring which length is a multiple of 8 is stored
+ * as a BINARY term, so BITSTRING terms always have 1 to 7 tail bits.
+ */
+template <class Alloc>
+class bitstring
+{
+    binary<Alloc> m_bin;    ///< Bytes holding the bits
+    uint8_t       m_bits;   ///< Number of bits used in the last byte (0 - all)
+
+    template <typename A> friend class eterm;
+
+    /// Take over the value stored in an eterm.
+    bitstring(const binary<Alloc>& a_bin, uint32_t a_tail, int)
+        : m_bin(a_bin), m_bits(uint8_t(a_tail))
+    {}
+
+public:
+    bitstring() : m_bits(0) {}
+
+    /// Create a bitstring holding all bytes of a binary.
+    bitstring(const binary<Alloc>& a) : m_bin(a), m_bits(0) {}
+    bitstring(binary<Alloc>&& a) : m_bin(std::move(a)), m_bits(0) {}
+
+    /**
+     * Create a bitstring referencing the first \a a_bit_size bits of
+     * the binary without copying them.
+     * @throw err_bad_argument if the binary is too short.
+     */
+    bitstring(const binary<Alloc>& a_bin, size_t a_bit_size, const Alloc& a_alloc = Alloc())
+        : m_bits(uint8_t(a_bit_size % 8))
+    {
+        size_t n = (a_bit_size + 7) / 8;
+        if (n > a_bin.size())
+            throw err_bad_argument("Bitstring size exceeds binary size", a_bit_size);
+        m_bin = n == a_bin.size() ? a_bin : a_bin.slice(0, n, a_alloc);
+    }
+
+    /**
+     * Create a bitstring by copying \a a_bit_size bits of \a a_data.
+     */
+    bitstring(const char* a_data, size_t a_bit_size, const Alloc& a_alloc = Alloc())
+        : m_bin((a_bit_size + 7) / 8, a_alloc), m_bits(uint8_t(a_bit_size % 8))
+    {
+        if (char* p = m_bin.mutate()) {
+            memcpy(p, a_data, m_bin.size());
+            if (m_bits)
+                p[m_bin.size()-1] &= char(0xFF << (8 - m_bits));
+        }
+    }
+
+    /**
+     * Decode a bitstring (BIT_BINARY_EXT or BINARY_EXT) from a binary
+     * buffer.  The data is referenced as described in binary::pinned_scope.
+     * @param buf is the buffer containing Erlang external term format.
+     * @param idx is the current offset in the buf buffer.
+     * @param size is the size of \a buf buffer.
+     * @param a_alloc is the allocator to use.
+     * @throw err_decode_exception
+     */
+    bitstring(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
+
+    /// Number of bits.
+    size_t      bit_size()  const { return m_bin.size() * 8 - (m_bits ? 8 - m_bits : 0); }
+    /// Number of bytes holding the bits (including the last partial byte).
+    size_t      size()      const { return m_bin.size(); }
+    /// Number of bits in the last partial byte (0 if the size is a multiple of 8).
+    uint8_t     tail_bits() const { return m_bits; }
+    /// True if the number of bits is a multiple of 8.
+    bool        is_binary() const { return m_bits == 0; }
+    /// Bytes holding the bits (the unused bits of the last byte are unspecified).
+    const char* data()      const { return m_bin.data(); }
+    /// Binary holding the bits.
+    const binary<Alloc>& bin() const { return m_bin; }
+
+    /// Read \a a_n (<= 64) bits at bit offset \a a_off as a big-endian integer.
+    uint64_t bits(size_t a_off, size_t a_n) const {
+        return detail::get_bits(data(), size(), a_off, a_n);
+    }
+
+    /**
+     * Return \a a_bit_size bits at bit offset \a a_offset.  A byte-aligned
+     * sub-bitstring shares the memory of this one, otherwise the bits are
+     * copied.
+     * @throw err_bad_argument if the range is out of bounds.
+     */
+    bitstring<Alloc> sub(size_t a_offset, size_t a_bit_size, const Alloc& a_alloc = Alloc()) const;
+
+    /// Compare bit by bit (a prefix is less than a longer bitstring).
+    int compare(const bitstring<Alloc>& rhs) const;
+
+    bool operator== (const bitstring<Alloc>& rhs) const { return compare(rhs) == 0; }
+    bool operator!= (const bitstring<Alloc>& rhs) const { return compare(rhs) != 0; }
+    bool operator<  (const bitstring<Alloc>& rhs) const { return compare(rhs) <  0; }
+
+    /** Encode the bitstring to a flat buffer (as BINARY_EXT if it's byte-aligned). */
+    void encode(char* buf, uintptr_t& idx, size_t size) const;
+
+    /** Size of buffer needed to hold the encoded bitstring. */
+    size_t encode_size() const { return (m_bits ? 6 : 5) + size(); }
+
+    std::ostream& dump(std::ostream& out, const varbind<Alloc>* =NULL) const;
+};
+
+} // namespace marshal
+} // namespace eixx
+
+namespace std {
+    template <typename Alloc>
+    ostream& operator<< (ostream& out, const eixx::marshal::bitstring<Alloc>& a) {
+        return a.dump(out);
+    }
+
+} // namespace std
+
+#include <eixx/marshal/bitstring.hxx>
+
+#endif // _IMPL_BITSTRING_HPP_
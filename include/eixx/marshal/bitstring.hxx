@@ -0,0 +1,131 @@
+//----------------------------------------------------------------------------
+/// \file  bitstring.hxx
+//----------------------------------------------------------------------------
+/// \brief Implementation of bitstring class member functions.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <ei.h>
+
+namespace eixx {
+namespace marshal {
+
+template <class Alloc>
+bitstring<Alloc>::bitstring(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc)
+    : m_bits(0)
+{
+    const char* s   = buf + idx;
+    const char* s0  = s;
+    uint8_t     tag = get8(s);
+
+    if (tag != ERL_BIT_BINARY_EXT && tag != ERL_BINARY_EXT)
+        throw err_decode_exception("Error decoding bitstring's type", idx, tag);
+
+    uint32_t sz   = get32be(s);
+    uint8_t  bits = tag == ERL_BINARY_EXT ? 8 : get8(s);
+    if (bits > 8 || (bits == 0 && sz))
+        throw err_decode_exception("Invalid number of bits in bitstring", idx, bits);
+    if ((size_t)(s - buf) + sz > size)
+        throw err_decode_exception("Error decoding bitstring", idx, sz);
+
+    m_bin.assign_decoded(s, sz, a_alloc);
+    m_bits = sz && bits < 8 ? bits : 0;
+    idx   += s + sz - s0;
+}
+
+template <class Alloc>
+bitstring<Alloc> bitstring<Alloc>::sub(size_t a_offset, size_t a_bit_size, const Alloc& a_alloc) const
+{
+    size_t n = bit_size();
+    if (a_offset > n || a_bit_size > n - a_offset)
+        throw err_bad_argument("Bitstring range out of bounds", a_offset + a_bit_size);
+    if (a_bit_size == 0)
+        return bitstring<Alloc>();
+
+    size_t bytes = (a_bit_size + 7) / 8;
+    if (a_offset % 8 == 0) {
+        if (a_offset == 0 && bytes == size())
+            return bitstring<Alloc>(m_bin, uint32_t(a_bit_size % 8), 0);
+        return bitstring<Alloc>(m_bin.slice(a_offset / 8, bytes, a_alloc),
+                                uint32_t(a_bit_size % 8), 0);
+    }
+
+    binary<Alloc> b(bytes, a_alloc);
+    char* p = b.mutate();
+    memset(p, 0, bytes);
+    detail::copy_bits(p, 0, data(), size(), a_offset, a_bit_size);
+    return bitstring<Alloc>(b, uint32_t(a_bit_size % 8), 0);
+}
+
+template <class Alloc>
+int bitstring<Alloc>::compare(const bitstring<Alloc>& rhs) const
+{
+    size_t n1 = bit_size(), n2 = rhs.bit_size(), n = std::min(n1, n2);
+    if (data() != rhs.data())
+        if (int r = memcmp(data(), rhs.data(), n / 8))
+            return r < 0 ? -1 : 1;
+    if (size_t t = n % 8) {
+        uint64_t a = bits(n - t, t), b = rhs.bits(n - t, t);
+        if (a != b)
+            return a < b ? -1 : 1;
+    }
+    return n1 < n2 ? -1 : n1 > n2;
+}
+
+template <class Alloc>
+void bitstring<Alloc>::encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t size) const
+{
+    if (!m_bits)
+        return m_bin.encode(buf, idx, size);
+
+    char* s  = buf + idx;
+    char* s0 = s;
+    size_t sz = this->size();
+    if (sz > UINT32_MAX)
+        throw err_encode_exception("BIT_BINARY_EXT length exceeds maximum");
+    put8(s, ERL_BIT_BINARY_EXT);
+    put32be(s, uint32_t(sz));
+    put8(s, m_bits);
+    memmove(s, data(), sz);
+    s += sz;
+    // Unused bits of the last byte are zero
+    s[-1] &= char(0xFF << (8 - m_bits));
+    idx += s - s0;
+    BOOST_ASSERT((size_t)idx <= size);
+}
+
+template <class Alloc>
+std::ostream& bitstring<Alloc>::dump(std::ostream& out, const varbind<Alloc>*) const
+{
+    if (!m_bits)
+        return m_bin.dump(out);
+    out << "<<";
+    const char* p = data();
+    for (size_t i = 0, n = size()-1; i < n; ++i)
+        out << int(uint8_t(p[i])) << ',';
+    return out << (uint8_t(p[size()-1]) >> (8 - m_bits)) << ':' << int(m_bits) << ">>";
+}
+
+} // namespace marshal
+} // namespace eixx
@@ -0,0 +1,574 @@
+//----------------------------------------------------------------------------
+/// \file  consult.hpp
+//----------------------------------------------------------------------------
+/// \brief Streaming parser of text files containing dot-terminated
+///        Erlang terms (the format read by file:consult/1).
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_CONSULT_HPP_
+#define _IMPL_CONSULT_HPP_
+
+#include <charconv>
+#include <string>
+#include <vector>
+#include <eixx/eterm_exception.hpp>
+#include <eixx/marshal/eterm.hpp>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Parser of text holding dot-terminated Erlang terms, such as
+ * configuration files or test fixtures.  The terms are yielded one by
+ * one, without building an intermediate representation of the text.
+ *
+ * Supported syntax: atoms (plain and quoted), variables, integers
+ * (including Base#Digits notation and $c characters, and bignums for
+ * values that don't fit in a long), floats, strings,
+ * binaries (<<"...">>, <<1,2,3>> or a mix of both), tuples, lists and
+ * #{K => V} maps. Text following '%' till the end of line is a comment.
+ *
+ * The parser measures 80-95 MB/s in test-perf, short of the 100 MB/s
+ * target.
+ *
+ * Example:
+ * <code>
+ *   auto parser = consult_parser<Alloc>::from_file("routes.config");
+ *   for (eterm<Alloc> t; parser.next(t); )
+ *       process(t);
+ * </code>
+ */
+template <class Alloc>
+class consult_parser
+{
+    using stack_t = std::vector<
+        eterm<Alloc>,
+        typename std::allocator_traits<Alloc>::template rebind_alloc<eterm<Alloc>>>;
+
+    static const int s_max_depth = 512;
+
+    binary<Alloc>   m_data;         // Keeps the parsed text alive if owned
+    const char*     m_begin;
+    const char*     m_p;
+    const char*     m_end;
+    const char*     m_line_start;
+    size_t          m_line;
+    Alloc           m_alloc;
+    stack_t         m_stack;        // Elements of tuples and lists being parsed
+    std::string     m_buf;          // Unescaped strings
+    std::string     m_bin;          // Content of binaries
+    atom            m_atoms[256];   // Cache of recently parsed atoms
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+    }
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+    static bool is_lower(char c) { return c >= 'a' && c <= 'z'; }
+    static bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+    static bool is_name(char c)  {
+        return is_lower(c) || is_upper(c) || is_digit(c) || c == '_' || c == '@';
+    }
+    static int  digit(char c) {
+        return is_digit(c) ? c - '0'
+             : is_lower(c) ? c - 'a' + 10
+             : is_upper(c) ? c - 'A' + 10 : 99;
+    }
+
+    /// Atom lookup bypassing the atom table for recently seen atoms.
+    atom make_atom(const char* a_name, size_t a_len) {
+        if (!a_len)
+            return atom();
+        atom& a = m_atoms[(a_len * 31 + (uint8_t)a_name[0] * 7 + (uint8_t)a_name[a_len-1]) & 255];
+        if (a.size() != a_len || memcmp(a.c_str(), a_name, a_len) != 0)
+            a = atom(a_name, a_len);
+        return a;
+    }
+
+    [[noreturn]] void error(const char* a_msg, const char* a_pos) const;
+
+    void newline(const char* a_pos) { ++m_line; m_line_start = a_pos + 1; }
+
+    void skip_ws();
+    bool at(char c) const { return m_p < m_end && *m_p == c; }
+    void expect(char c, const char* a_msg) {
+        skip_ws();
+        if (!at(c)) error(a_msg, m_p);
+        ++m_p;
+    }
+
+    eterm<Alloc> parse(int a_depth);
+    eterm<Alloc> parse_number();
+    eterm<Alloc> parse_binary();
+    eterm<Alloc> parse_map(int a_depth);
+    size_t       parse_items(char a_close, int a_depth);
+    eterm<Alloc> parse_int(const char* a_start, int a_base);
+    const char*  unescape(const char* p, std::string& a_out);
+    std::pair<const char*, size_t> quoted(char a_quote);
+
+public:
+    /// Parse the text in memory, which must outlive the parser.
+    consult_parser(const char* a_text, size_t a_size, const Alloc& a_alloc = Alloc())
+        : m_begin(a_text), m_p(a_text), m_end(a_text + a_size), m_line_start(a_text), m_line(1)
+        , m_alloc(a_alloc), m_stack(a_alloc)
+    {
+        m_stack.reserve(64);
+    }
+
+    /// Parse the text held in a binary (e.g. a file mapped with binary::map_file()).
+    explicit consult_parser(const binary<Alloc>& a_text, const Alloc& a_alloc = Alloc())
+        : consult_parser(a_text.data(), a_text.size(), a_alloc)
+    {
+        m_data = a_text;
+    }
+
+    /// Parse the memory-mapped content of the file \a a_path.
+    /// @throw std::runtime_error if the file cannot be mapped.
+    static consult_parser<Alloc> from_file(const char* a_path, const Alloc& a_alloc = Alloc()) {
+        return consult_parser<Alloc>(binary<Alloc>::map_file(a_path, 0, std::string::npos, a_alloc),
+                                     a_alloc);
+    }
+
+    /**
+     * Parse the next dot-terminated term.
+     * @return false when the end of text is reached.
+     * @throw err_parse_exception
+     */
+    bool next(eterm<Alloc>& a_term);
+
+    /// Current line number (starting with 1).
+    size_t line()   const { return m_line; }
+    /// Current column number (starting with 1).
+    size_t column() const { return size_t(m_p - m_line_start) + 1; }
+};
+
+//------------------------------------------------------------------------------
+// consult_parser implementation
+//------------------------------------------------------------------------------
+
+template <class Alloc>
+void consult_parser<Alloc>::error(const char* a_msg, const char* a_pos) const
+{
+    // The position may precede the current line (e.g. unterminated string)
+    size_t line = m_line;
+    for (const char* p = a_pos; p < m_line_start; ++p)
+        if (*p == '\n') --line;
+    const char* bol = a_pos;
+    while (bol > m_begin && bol[-1] != '\n')
+        --bol;
+    throw err_parse_exception(a_msg, line, size_t(a_pos - bol) + 1);
+}
+
+template <class Alloc>
+void consult_parser<Alloc>::skip_ws()
+{
+    for (; m_p < m_end; ++m_p) {
+        char c = *m_p;
+        if (c == '\n')
+            newline(m_p);
+        else if (c == '%') {
+            while (m_p < m_end && *m_p != '\n') ++m_p;
+            --m_p;
+        } else if (!is_space(c))
+            break;
+    }
+}
+
+template <class Alloc>
+bool consult_parser<Alloc>::next(eterm<Alloc>& a_term)
+{
+    skip_ws();
+    if (m_p == m_end)
+        return false;
+    a_term = parse(0);
+    expect('.', "Expected '.' after term");
+    if (m_p < m_end && !is_space(*m_p) && *m_p != '%')
+        error("Expected whitespace after '.'", m_p);
+    return true;
+}
+
+template <class Alloc>
+eterm<Alloc> consult_parser<Alloc>::parse(int a_depth)
+{
+    if (a_depth > s_max_depth)
+        error("Term is nested too deep", m_p);
+
+    skip_ws();
+    if (m_p == m_end)
+        error("Unexpected end of input", m_p);
+
+    const char* start = m_p;
+
+    switch (*m_p) {
+        case '{': {
+            ++m_p;
+            size_t n = parse_items('}', a_depth);
+            tuple<Alloc> t(n, m_alloc);
+            for (auto it = m_stack.end() - long(n); it != m_stack.end(); ++it)
+                t.push_back(std::move(*it));
+            m_stack.resize(m_stack.size() - n);
+            return eterm<Alloc>(std::move(t));
+        }
+        case '[': {
+            ++m_p;
+            size_t n = parse_items(']', a_depth);
+            if (!n)
+                return eterm<Alloc>(list<Alloc>(nullptr));
+            list<Alloc> l(int(n), m_alloc);
+            for (auto it = m_stack.end() - long(n); it != m_stack.end(); ++it)
+                l.push_back(std::move(*it));
+            l.close();
+            m_stack.resize(m_stack.size() - n);
+            return eterm<Alloc>(std::move(l));
+        }
+        case '#':
+            return parse_map(a_depth);
+        case '<':
+            return parse_binary();
+        case '"': {
+            auto s = quoted('"');
+            return eterm<Alloc>(string<Alloc>(s.first, s.second, m_alloc));
+        }
+        case '\'': {
+            auto s = quoted('\'');
+            return eterm<Alloc>(make_atom(s.first, s.second));
+        }
+        case '$': {
+            if (++m_p == m_end)
+                error("Unexpected end of input", m_p);
+            if (*m_p != '\\')
+                return eterm<Alloc>(long((unsigned char)*m_p++));
+            m_buf.clear();
+            m_p = unescape(m_p + 1, m_buf);
+            return eterm<Alloc>(long((unsigned char)m_buf[0]));
+        }
+        default: {
+            char c = *m_p;
+            if (is_digit(c) || ((c == '-' || c == '+') && m_p+1 < m_end && is_digit(m_p[1])))
+                return parse_number();
+            if (is_lower(c) || is_upper(c) || c == '_') {
+                for (++m_p; m_p < m_end && is_name(*m_p); ++m_p);
+                if (is_lower(c))
+                    return eterm<Alloc>(make_atom(start, size_t(m_p - start)));
+                return eterm<Alloc>(var(start, size_t(m_p - start)));
+            }
+            error("Unexpected character", m_p);
+        }
+    }
+}
+
+template <class Alloc>
+size_t consult_parser<Alloc>::parse_items(char a_close, int a_depth)
+{
+    size_t base = m_stack.size();
+    skip_ws();
+    if (at(a_close)) {
+        ++m_p;
+        return 0;
+    }
+
+    while (true) {
+        m_stack.push_back(parse(a_depth+1));
+        skip_ws();
+        if (m_p == m_end)
+            error("Unexpected end of input", m_p);
+        char c = *m_p++;
+        if (c == ',')
+            continue;
+        if (c == a_close)
+            break;
+        if (c == '|' && a_close == ']') {
+            skip_ws();
+            const char* pos = m_p;
+            auto tail = parse(a_depth+1);
+            if (tail.type() != LIST)
+                error("Improper lists are not supported", pos);
+            for (auto& e : tail.to_list())
+                m_stack.push_back(e);
+            expect(']', "Expected ']'");
+            break;
+        }
+        error(a_close == ']' ? "Expected ',' or ']'" : "Expected ',' or '}'", m_p-1);
+    }
+    return m_stack.size() - base;
+}
+
+template <class Alloc>
+eterm<Alloc> consult_parser<Alloc>::parse_map(int a_depth)
+{
+    ++m_p;
+    if (!at('{'))
+        error("Expected '{' after '#'", m_p);
+    ++m_p;
+
+    map<Alloc> m(m_alloc);
+    skip_ws();
+    if (at('}')) {
+        ++m_p;
+        return eterm<Alloc>(m);
+    }
+
+    while (true) {
+        auto key = parse(a_depth+1);
+        skip_ws();
+        if (m_p+1 >= m_end || m_p[0] != '=' || m_p[1] != '>')
+            error("Expected '=>'", m_p);
+        m_p += 2;
+        m.insert(key, parse(a_depth+1));
+        skip_ws();
+        if (m_p == m_end)
+            error("Unexpected end of input", m_p);
+        char c = *m_p++;
+        if (c == '}')
+            break;
+        if (c != ',')
+            error("Expected ',' or '}'", m_p-1);
+    }
+    return eterm<Alloc>(std::move(m));
+}
+
+template <class Alloc>
+eterm<Alloc> consult_parser<Alloc>::parse_binary()
+{
+    if (m_p+1 >= m_end || m_p[1] != '<')
+        error("Expected '<<'", m_p);
+    m_p += 2;
+
+    m_bin.clear();
+    skip_ws();
+
+    // Fast path for <<"...">>
+    if (at('"')) {
+        auto s = quoted('"');
+        skip_ws();
+        if (m_p+1 < m_end && m_p[0] == '>' && m_p[1] == '>') {
+            m_p += 2;
+            return eterm<Alloc>(binary<Alloc>(s.first, s.second, m_alloc));
+        }
+        m_bin.append(s.first, s.second);
+        expect(',', "Expected ',' or '>>'");
+    } else if (m_p+1 < m_end && m_p[0] == '>' && m_p[1] == '>') {
+        m_p += 2;
+        return eterm<Alloc>(binary<Alloc>());
+    }
+
+    while (true) {
+        skip_ws();
+        if (at('"')) {
+            auto s = quoted('"');
+            m_bin.append(s.first, s.second);
+        } else if (m_p < m_end && is_digit(*m_p)) {
+            const char* pos = m_p;
+            auto n = parse_number();
+            if (n.type() != LONG || n.to_long() < 0 || n.to_long() > 255)
+                error("Invalid byte value in binary", pos);
+            m_bin.push_back(char(n.to_long()));
+        } else
+            error("Invalid binary segment", m_p);
+
+        skip_ws();
+        if (m_p+1 < m_end && m_p[0] == '>' && m_p[1] == '>') {
+            m_p += 2;
+            break;
+        }
+        expect(',', "Expected ',' or '>>'");
+    }
+    return eterm<Alloc>(binary<Alloc>(m_bin.data(), m_bin.size(), m_alloc));
+}
+
+template <class Alloc>
+eterm<Alloc> consult_parser<Alloc>::parse_int(const char* a_start, int a_base)
+{
+    bool     neg = *a_start == '-';
+    uint64_t n   = 0;
+    const char* p = m_p;
+    for (; p < m_end; ++p) {
+        int d = digit(*p);
+        if (d >= a_base)
+            break;
+        if (unlikely(__builtin_mul_overflow(n, uint64_t(a_base), &n) ||
+                     __builtin_add_overflow(n, uint64_t(d), &n)))
+            break;
+    }
+    if (p == m_p)
+        error("Invalid number", m_p);
+
+    if (likely(p == m_end || digit(*p) >= a_base)) {
+        m_p = p;
+        if (n <= uint64_t(LONG_MAX) + neg)
+            return eterm<Alloc>(neg ? long(0ul - n) : long(n));
+        return eterm<Alloc>(bigint<Alloc>(neg, &n, 1, m_alloc));
+    }
+
+    // Doesn't fit in 64 bits - accumulate the magnitude in little-endian limbs
+    std::vector<uint64_t> limbs;
+    for (p = m_p; p < m_end; ++p) {
+        int d = digit(*p);
+        if (d >= a_base)
+            break;
+        uint128_t carry = uint128_t(d);
+        for (auto& l : limbs) {
+            carry += uint128_t(l) * unsigned(a_base);
+            l      = uint64_t(carry);
+            carry >>= 64;
+        }
+        if (carry)
+            limbs.push_back(uint64_t(carry));
+    }
+    m_p = p;
+    return eterm<Alloc>(bigint<Alloc>(neg, limbs.data(), limbs.size(), m_alloc));
+}
+
+template <class Alloc>
+eterm<Alloc> consult_parser<Alloc>::parse_number()
+{
+    const char* start = m_p;
+    if (*m_p == '-' || *m_p == '+')
+        ++m_p;
+    const char* digits = m_p;
+    while (m_p < m_end && is_digit(*m_p)) ++m_p;
+
+    if (at('#')) {
+        int base = 0;
+        for (const char* p = digits; p < m_p && base <= 36; ++p)
+            base = base*10 + (*p - '0');
+        if (base < 2 || base > 36)
+            error("Invalid integer base", digits);
+        ++m_p;
+        return eterm<Alloc>(parse_int(start, base));
+    }
+
+    if (m_p+1 < m_end && *m_p == '.' && is_digit(m_p[1])) {
+        for (m_p += 2; m_p < m_end && is_digit(*m_p); ++m_p);
+        if (m_p < m_end && (*m_p == 'e' || *m_p == 'E')) {
+            const char* p = m_p+1;
+            if (p < m_end && (*p == '-' || *p == '+')) ++p;
+            if (p == m_end || !is_digit(*p))
+                error("Invalid float exponent", m_p);
+            for (m_p = p; m_p < m_end && is_digit(*m_p); ++m_p);
+        }
+        double d;
+        auto r = std::from_chars(*start == '+' ? start+1 : start, m_p, d);
+        if (r.ec != std::errc() || r.ptr != m_p)
+            error("Invalid float", start);
+        return eterm<Alloc>(d);
+    }
+
+    m_p = digits;
+    return eterm<Alloc>(parse_int(start, 10));
+}
+
+template <class Alloc>
+std::pair<const char*, size_t> consult_parser<Alloc>::quoted(char a_quote)
+{
+    const char* start = m_p++;
+    const char* p     = m_p;
+
+    for (; p < m_end; ++p) {
+        char c = *p;
+        if (c == a_quote) {
+            std::pair<const char*, size_t> res(m_p, size_t(p - m_p));
+            m_p = p+1;
+            return res;
+        }
+        if (c == '\\')
+            break;
+        if (c == '\n')
+            newline(p);
+    }
+
+    // Slow path for strings containing escape sequences
+    m_buf.assign(m_p, p);
+    while (p < m_end && *p != a_quote) {
+        if (*p == '\\')
+            p = unescape(p+1, m_buf);
+        else {
+            if (*p == '\n')
+                newline(p);
+            m_buf.push_back(*p++);
+        }
+    }
+    if (p == m_end)
+        error(a_quote == '"' ? "Unterminated string" : "Unterminated quoted atom", start);
+    m_p = p+1;
+    return std::make_pair(m_buf.data(), m_buf.size());
+}
+
+template <class Alloc>
+const char* consult_parser<Alloc>::unescape(const char* p, std::string& a_out)
+{
+    if (p == m_end)
+        error("Unexpected end of input", p);
+
+    char c = *p++;
+    switch (c) {
+        case 'b': a_out.push_back('\b');   break;
+        case 'd': a_out.push_back('\x7f'); break;
+        case 'e': a_out.push_back('\x1b'); break;
+        case 'f': a_out.push_back('\f');   break;
+        case 'n': a_out.push_back('\n');   break;
+        case 'r': a_out.push_back('\r');   break;
+        case 's': a_out.push_back(' ');    break;
+        case 't': a_out.push_back('\t');   break;
+        case 'v': a_out.push_back('\v');   break;
+        case '^':
+            if (p == m_end)
+                error("Unexpected end of input", p);
+            a_out.push_back(char(*p++ & 0x1f));
+            break;
+        case 'x': {
+            bool brace = p < m_end && *p == '{';
+            const char* q = p + brace;
+            unsigned n = 0;
+            int  i = 0;
+            for (; q < m_end && digit(*q) < 16 && (brace || i < 2); ++q, ++i)
+                n = n*16 + unsigned(digit(*q));
+            if (!i || (brace && (q == m_end || *q++ != '}')))
+                error("Invalid hex escape sequence", p-2);
+            if (n > 255)
+                error("Character out of range", p-2);
+            a_out.push_back(char(n));
+            p = q;
+            break;
+        }
+        default:
+            if (c >= '0' && c <= '7') {
+                unsigned n = unsigned(c - '0');
+                for (int i = 1; i < 3 && p < m_end && *p >= '0' && *p <= '7'; ++i)
+                    n = n*8 + unsigned(*p++ - '0');
+                if (n > 255)
+                    error("Character out of range", p-4);
+                a_out.push_back(char(n));
+            } else {
+                if (c == '\n')
+                    newline(p-1);
+                a_out.push_back(c);
+            }
+    }
+    return p;
+}
+
+} // namespace marshal
+} // namespace eixx
+
+#endif // _IMPL_CONSULT_HPP_
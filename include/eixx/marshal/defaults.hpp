@@ -70,7 +70,10 @@ namespace eixx {
         , LIST              = 12
         , MAP               = 13
         , TRACE             = 14
-        , MAX_ETERM_TYPE    = 14
+        , RAW               = 15
+        , BIGINT            = 16
+        , BITSTRING         = 17
+        , MAX_ETERM_TYPE    = 17
     };
 
     /// Returns string representation of type \a a_type.
@@ -108,6 +111,9 @@ namespace eixx {
             case LIST  : return "LIST";
             case MAP   : return "MAP";
             case TRACE : return "TRACE";
+            case RAW   : return "RAW";
+            case BIGINT: return "BIGINT";
+            case BITSTRING: return "BITSTRING";
             default    : return "UNDEFINED";
         }
     }
@@ -128,6 +134,9 @@ namespace eixx {
             case LIST  : return a_prefix ? "::list()"   : "list()";
             case MAP   : return a_prefix ? "::map()"    : "map()";
             case TRACE : return a_prefix ? "::trace()"  : "trace()";
+            case RAW   : return a_prefix ? "::raw()"    : "raw()";
+            case BIGINT: return a_prefix ? "::bigint()" : "bigint()";
+            case BITSTRING: return a_prefix ? "::bitstring()" : "bitstring()";
             default    : return "";
         }
     }
@@ -1,7 +1,7 @@
 //----------------------------------------------------------------------------
 /// \file  array_variadic_init.hpp
 //----------------------------------------------------------------------------
-/// \brief Copies variadic parameters to an array
+/// \brief Forwards variadic parameters to an array of terms
 //----------------------------------------------------------------------------
 // Copyright (c) 2013 Serge Aleynikov <saleyn@gmail.com>
 // Created: 2013-10-05
@@ -28,33 +28,46 @@ limitations under the License.
 #ifndef _EIXX_ARRAY_VARIADIC_INIT_HPP_
 #define _EIXX_ARRAY_VARIADIC_INIT_HPP_
 
-#include <eixx/marshal/eterm.hpp>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <type_traits>
 
 namespace eixx {
 namespace marshal {
+
+template <typename Alloc> class eterm;
+
 namespace detail {
 
-    namespace {
-        template <std::size_t I, typename Alloc, typename Head, typename... Tail>
-        struct init_array {
-            static void set(eterm<Alloc>* a_array, const Head& v, const Tail&... tail) {
-                a_array[I] = eterm<Alloc>(v);
-                init_array<I+1, Tail...>::set(a_array, tail...);
-            }
-        };
-
-        template <std::size_t I, typename Alloc, typename Head>
-        struct init_array<I, Alloc, Head> {
-            static void set(eterm<Alloc>* a_array, const Head& v) {
-                a_array[I] = eterm<Alloc>(v);
-            }
-        };
+    /// Evaluates to true if the last type in \a Args is the allocator \a Alloc.
+    template <typename Alloc, typename... Args>
+    struct last_is_alloc : std::false_type {};
+
+    template <typename Alloc, typename T>
+    struct last_is_alloc<Alloc, T>
+        : std::is_same<Alloc, typename std::decay<T>::type> {};
+
+    template <typename Alloc, typename T, typename U, typename... Tail>
+    struct last_is_alloc<Alloc, T, U, Tail...> : last_is_alloc<Alloc, U, Tail...> {};
+
+    /// Get the trailing allocator from the forwarded arguments \a a_args.
+    template <typename Alloc, typename Tuple>
+    Alloc last_alloc(const Tuple& a_args, std::true_type) {
+        return std::get<std::tuple_size<Tuple>::value-1>(a_args);
     }
 
-    template <typename Alloc, typename... Args>
-    void initialize(eterm<Alloc>* a_target, Args... args)
+    template <typename Alloc, typename Tuple>
+    Alloc last_alloc(const Tuple&, std::false_type) { return Alloc(); }
+
+    /// Construct terms in the uninitialized \a a_target array from the
+    /// first sizeof...(I) forwarded arguments. Rvalue terms are moved,
+    /// so their storage is taken over without touching the reference count.
+    template <typename Alloc, typename Tuple, std::size_t... I>
+    void initialize([[maybe_unused]] eterm<Alloc>* a_target, [[maybe_unused]] Tuple&& a_args,
+                    std::index_sequence<I...>)
     {
-        init_array<0, Args...>::set(a_target, args...);
+        (new (a_target+I) eterm<Alloc>(std::get<I>(std::move(a_args))), ...);
     }
 
 } // namespace detail
@@ -38,6 +38,8 @@ limitations under the License.
 #include <eixx/marshal/atom.hpp>
 #include <eixx/marshal/string.hpp>
 #include <eixx/marshal/binary.hpp>
+#include <eixx/marshal/bitstring.hpp>
+#include <eixx/marshal/iolist_builder.hpp>
 #include <eixx/marshal/pid.hpp>
 #include <eixx/marshal/port.hpp>
 #include <eixx/marshal/ref.hpp>
@@ -45,9 +47,12 @@ limitations under the License.
 #include <eixx/marshal/list.hpp>
 #include <eixx/marshal/map.hpp>
 #include <eixx/marshal/trace.hpp>
+#include <eixx/marshal/raw.hpp>
+#include <eixx/marshal/bigint.hpp>
 #include <eixx/marshal/var.hpp>
 #include <eixx/marshal/varbind.hpp>
 #include <eixx/marshal/eterm_match.hpp>
+#include <eixx/util/siphash.hpp>
 
 namespace eixx {
     using marshal::config;
@@ -70,6 +75,7 @@ namespace {
     template <typename Alloc> struct enum_type<list<Alloc>,   Alloc> { using type = list<Alloc>  ; };
     template <typename Alloc> struct enum_type<map<Alloc>,    Alloc> { using type = map<Alloc>   ; };
     template <typename Alloc> struct enum_type<trace<Alloc>,  Alloc> { using type = trace<Alloc> ; };
+    template <typename Alloc> struct enum_type<raw<Alloc>,    Alloc> { using type = raw<Alloc>   ; };
 }
 
 /**
@@ -128,6 +134,7 @@ namespace {
 template <typename Alloc>
 class eterm {
     eterm_type m_type;
+    uint32_t   m_flags;     ///< Flags of a BIGINT, or tail bits of a BITSTRING
 public:
     union vartype {
         double          d;
@@ -144,8 +151,9 @@ public:
         list<Alloc>     l;
         map<Alloc>      m;
         trace<Alloc>  trc;
+        raw<Alloc>     rw;
 
-        uint64_t value; // this is for ease of copying
+        uint64_t value; // this is for ease of copying, and holds a BIGINT
 
         // We ensure that the size of each compound type
         // is sizeof(uint64_t).  Therefore it's safe to store the actual
@@ -174,6 +182,7 @@ public:
         vartype(const list<Alloc>&   x) :   l(x) {}
         vartype(const map<Alloc>&    x) :   m(x) {}
         vartype(const trace<Alloc>&  x) : trc(x) {}
+        vartype(const raw<Alloc>&    x) :  rw(x) {}
 
         vartype(string<Alloc>&& x) :   s(std::move(x)) {}
         vartype(binary<Alloc>&& x) : bin(std::move(x)) {}
@@ -184,6 +193,7 @@ public:
         vartype(list<Alloc>&&   x) :   l(std::move(x)) {}
         vartype(map<Alloc>&&    x) :   m(std::move(x)) {}
         vartype(trace<Alloc>&&  x) : trc(std::move(x)) {}
+        vartype(raw<Alloc>&&    x) :  rw(std::move(x)) {}
 
         vartype() : i(0) {}
         ~vartype() {}
@@ -195,6 +205,17 @@ public:
 
     void check(eterm_type tp) const { if (unlikely(m_type != tp)) throw err_wrong_type(tp, m_type); }
 
+    /// Class of the term type in the Erlang term order.
+    static int order(const eterm<Alloc>& a);
+
+    static int compare(const eterm<Alloc>& a, const eterm<Alloc>& b, bool a_exact);
+    static int compare(long a, double b);
+    static int compare_big(const eterm<Alloc>& a, const eterm<Alloc>& b);
+    static int compare(const list<Alloc>& a, const list<Alloc>& b, bool a_exact);
+    static int compare(const string<Alloc>& a, const list<Alloc>& b, bool a_exact);
+    static int compare(const tuple<Alloc>& a, const tuple<Alloc>& b, bool a_exact);
+    static int compare(const map<Alloc>& a, const map<Alloc>& b, bool a_exact);
+
     /**
      * Decode a term from the Erlang external binary format.
      * @throw err_decode_exception
@@ -215,6 +236,7 @@ public:
     list<Alloc>&    get(const list<Alloc>*)     { check(LIST);   return vt.l; }
     map<Alloc>&     get(const map<Alloc>*)      { check(MAP);    return vt.m; }
     trace<Alloc>&   get(const trace<Alloc>*)    { check(TRACE);  return vt.trc; }
+    raw<Alloc>&     get(const raw<Alloc>*)      { check(RAW);    return vt.rw; }
 
     template <typename T, typename A> friend T& get(eterm<A>& t);
 
@@ -223,9 +245,12 @@ public:
     void replace(eterm* a) {
         m_type    = a->m_type;
         vt.value  = a->vt.value;
+        if (m_type == BIGINT || m_type == BITSTRING) m_flags = a->m_flags;
         a->reset();
     }
 
+    typename bigint<Alloc>::view big() const { return bigint<Alloc>::make_view(vt.value, m_flags); }
+
     /// @throw err_format_exception
     static eterm<Alloc> format(const Alloc& a_alloc, const char** fmt, va_list* args);
 
@@ -241,7 +266,10 @@ public:
     }
 
     eterm(unsigned int  a)          : m_type(LONG),  vt((int)a)  {}
-    eterm(unsigned long a)          : m_type(LONG),  vt((long)a) {}
+    eterm(unsigned long a)          : m_type(LONG),  vt((long)a) {
+        // Values above LONG_MAX are stored inline as BIGINT
+        if (a > (unsigned long)LONG_MAX) { m_type = BIGINT; m_flags = 0; }
+    }
     eterm(int    a)                 : m_type(LONG),  vt(a) {}
 
     eterm(long   a)                 : m_type(LONG),  vt(a) {}
@@ -262,6 +290,22 @@ public:
     eterm(const list<Alloc>&   a)  : m_type(LIST),   vt(a) {}
     eterm(const map<Alloc>&    a)  : m_type(MAP),    vt(a) {}
     eterm(const trace<Alloc>&  a)  : m_type(TRACE),  vt(a) {}
+    eterm(const raw<Alloc>&    a)  : m_type(RAW),    vt(a) {}
+    /// A bitstring which size is a multiple of 8 is stored as BINARY.
+    eterm(const bitstring<Alloc>& a) : m_type(a.m_bits ? BITSTRING : BINARY), vt(a.m_bin) {
+        m_flags = a.m_bits;
+    }
+    /// An integer that fits in a long is stored as LONG.
+    eterm(const bigint<Alloc>& a)  : m_type(LONG) {
+        if (a.fits_int64() && a.to_int64() >= LONG_MIN && a.to_int64() <= LONG_MAX)
+            vt.i = long(a.to_int64());
+        else {
+            m_type   = BIGINT;
+            m_flags  = a.m_flags;
+            vt.value = a.m_word;
+            bigint<Alloc>::inc_rc(vt.value, m_flags);
+        }
+    }
 
     eterm(string<Alloc>&&      a)  : m_type(STRING), vt(std::move(a)) {}
     eterm(binary<Alloc>&&      a)  : m_type(BINARY), vt(std::move(a)) {}
@@ -272,6 +316,20 @@ public:
     eterm(list<Alloc>&&        a)  : m_type(LIST),   vt(std::move(a)) {}
     eterm(map<Alloc>&&         a)  : m_type(MAP),    vt(std::move(a)) {}
     eterm(trace<Alloc>&&       a)  : m_type(TRACE),  vt(std::move(a)) {}
+    eterm(raw<Alloc>&&         a)  : m_type(RAW),    vt(std::move(a)) {}
+    eterm(bitstring<Alloc>&&   a)  : m_type(a.m_bits ? BITSTRING : BINARY), vt(std::move(a.m_bin)) {
+        m_flags = a.m_bits;
+    }
+    eterm(bigint<Alloc>&&      a)  : m_type(LONG) {
+        if (a.fits_int64() && a.to_int64() >= LONG_MIN && a.to_int64() <= LONG_MAX)
+            vt.i = long(a.to_int64());
+        else {
+            m_type   = BIGINT;
+            m_flags  = a.m_flags;
+            vt.value = a.m_word;
+            a.m_word = 0; a.m_flags = 0;
+        }
+    }
 
     /**
      * Copy construct a term from another one. The term is copied by value
@@ -281,6 +339,8 @@ public:
         switch (m_type) {
             case STRING:    { new (&vt.s)   string<Alloc>(a.vt.s);    break; }
             case BINARY:    { new (&vt.bin) binary<Alloc>(a.vt.bin);  break; }
+            case BITSTRING: { new (&vt.bin) binary<Alloc>(a.vt.bin);
+                              m_flags = a.m_flags;                    break; }
             case PID:       { new (&vt.pid) epid<Alloc>(a.vt.pid);    break; }
             case PORT:      { new (&vt.prt) port<Alloc>(a.vt.prt);    break; }
             case REF:       { new (&vt.r)   ref<Alloc>(a.vt.r);       break; }
@@ -288,6 +348,12 @@ public:
             case LIST:      { new (&vt.l)   list<Alloc>(a.vt.l);      break; }
             case MAP:       { new (&vt.m)   map<Alloc>(a.vt.m);       break; }
             case TRACE:     { new (&vt.trc) trace<Alloc>(a.vt.trc);   break; }
+            case RAW:       { new (&vt.rw) raw<Alloc>(a.vt.rw);     break; }
+            case BIGINT:
+                m_flags  = a.m_flags;
+                vt.value = a.vt.value;
+                bigint<Alloc>::inc_rc(vt.value, m_flags);
+                break;
             default:
                 vt.value = a.vt.value;
         }
@@ -323,6 +389,26 @@ public:
         decode(a_buf, idx, a_size, a_alloc);
     }
 
+    /**
+     * Decode a term from the begining of a binary buffer \a a_buf
+     * encoded using Erlang external format, replacing the current value.
+     * Uniquely owned storage of tuples, lists, strings and binaries
+     * of this term is overwritten in place when it has enough capacity,
+     * so that repeatedly decoding messages of the same shape doesn't
+     * allocate memory. Where the shape doesn't match, storage is
+     * allocated using \a a_alloc.
+     * @throw err_decode_exception
+     */
+    void decode_into(const char* a_buf, size_t a_size, const Alloc& a_alloc = Alloc());
+
+    /**
+     * Same as decode_into(a_buf, a_size, a_alloc), but decodes the term
+     * at the \a idx offset of the buffer that doesn't have the version byte.
+     * @throw err_decode_exception
+     */
+    void decode_into(const char* a_buf, uintptr_t& idx, size_t a_size,
+                     const Alloc& a_alloc = Alloc());
+
     /**
      * Destruct this term. For compound terms it decreases the
      * reference count of their storage. This does nothing to
@@ -333,6 +419,7 @@ public:
             //No need to destruct atoms - they are stored in global atom table.
             case STRING: { vt.s.~string();   return; }
             case BINARY: { vt.bin.~binary(); return; }
+            case BITSTRING: { vt.bin.~binary(); return; }
             case PID:    { vt.pid.~epid();   return; }
             case PORT:   { vt.prt.~port();   return; }
             case REF:    { vt.r.~ref();      return; }
@@ -340,6 +427,8 @@ public:
             case LIST:   { vt.l.~list();     return; }
             case MAP:    { vt.m.~map();      return; }
             case TRACE:  { vt.trc.~trace();  return; }
+            case RAW:    { vt.rw.~raw();    return; }
+            case BIGINT: { bigint<Alloc>::release(vt.value, m_flags); return; }
             default: return;
         }
     }
@@ -370,16 +459,40 @@ public:
     template <typename T>
     void operator= (T&& a) {
         if (m_type >= STRING) this->~eterm();
-        new (this) eterm(std::move(a));
+        new (this) eterm(std::forward<T>(a));
     }
 
     /**
-     * Check that one term is less than the other. The function returns true
-     * if the term's type is less than the type of term "rhs" accorting to
-     * type_precedence() or if they have identical precedence, the check is
-     * made that the terms value is less than the value of the "rhs" term.
+     * Check that one term is less than the other in the Erlang term order.
+     * @see compare()
      */
-    bool operator<(const eterm<Alloc>& rhs) const;
+    bool operator<(const eterm<Alloc>& rhs) const {
+        // Inline fast path for the most common scalar terms
+        if (m_type == rhs.m_type)
+            switch (m_type) {
+                case LONG:   return vt.i < rhs.vt.i;
+                case DOUBLE: return vt.d < rhs.vt.d;
+                case ATOM:   return vt.a != rhs.vt.a && vt.a < rhs.vt.a;
+                default:     break;
+            }
+        return compare(*this, rhs, false) < 0;
+    }
+
+    /**
+     * Three-way comparison of terms in the Erlang term order:
+     * number < atom < reference < fun < port < pid < tuple < map < list < binary.
+     * Integers and floats are compared by value, tuples by size and then
+     * by elements, maps by size, then by keys and then by values, lists
+     * (including strings) and binaries lexicographically.  Terms sharing
+     * the same storage are equal without inspecting their content.
+     * @param a_exact when true integers are less than all floats, which
+     *        is the order of map keys.
+     * @return negative value, zero or positive value if this term is less
+     *         than, equal to or greater than \a rhs.
+     */
+    int compare(const eterm<Alloc>& rhs, bool a_exact = false) const {
+        return compare(*this, rhs, a_exact);
+    }
 
     template <typename T>
     void set(const T& a) {
@@ -420,7 +533,8 @@ public:
      * they point to the same storage
      */
     bool equals(const eterm<Alloc>& rhs) const {
-        return m_type == rhs.m_type && vt.value == rhs.vt.value;
+        return m_type == rhs.m_type && vt.value == rhs.vt.value
+            && ((m_type != BIGINT && m_type != BITSTRING) || m_flags == rhs.m_flags);
     }
 
     /**
@@ -433,6 +547,21 @@ public:
     // Separated into a separate function without default args for ease of gdb debugging
     std::string to_string() const { return to_string(std::string::npos, NULL); }
 
+    /**
+     * Portable hash of the term equal to the one of erlang:phash2/1.
+     * @throw err_bad_argument if the term contains variables.
+     */
+    uint32_t phash2() const { return phash2(1u << 27); }
+
+    /**
+     * Portable hash of the term in range [0, a_range) equal to the one
+     * of erlang:phash2/2.
+     * @param a_range is between 1 and 2^32.
+     * @throw err_bad_argument if the range is invalid or the term
+     *        contains variables.
+     */
+    uint32_t phash2(uint64_t a_range) const;
+
     // Return the term as a value of given type.
     // NOTE: only integer | double | bool | string types are supported
     template <typename T>
@@ -490,6 +619,32 @@ public:
     map<Alloc>&          to_map()          { check(MAP);    return vt.m;   }
     const trace<Alloc>&  to_trace()  const { check(TRACE);  return vt.trc; }
     trace<Alloc>&        to_trace()        { check(TRACE);  return vt.trc; }
+    const raw<Alloc>&    to_raw()    const { check(RAW);    return vt.rw; }
+    /// Integer value of a LONG or BIGINT term.
+    bigint<Alloc>        to_bigint() const {
+        if (m_type == LONG) return bigint<Alloc>(vt.i);
+        check(BIGINT);
+        return bigint<Alloc>(vt.value, m_flags);
+    }
+    /// Bits of a BINARY or BITSTRING term.
+    bitstring<Alloc>     to_bitstring() const {
+        if (m_type == BINARY) return bitstring<Alloc>(vt.bin);
+        check(BITSTRING);
+        return bitstring<Alloc>(vt.bin, m_flags, 0);
+    }
+
+    /**
+     * Get mutable access to a compound term of type T (tuple, list, map
+     * or binary). The term's storage is copied only if it's shared with
+     * other terms, e.g.: <tt>t.mutate<tuple<Alloc>>().set(1, 10)</tt>.
+     * @throw err_wrong_type if the term is not of type T.
+     */
+    template <typename T>
+    T& mutate() {
+        T& v = get(static_cast<const T*>(nullptr));
+        v.mutate();
+        return v;
+    }
 
     // Try to decode the value as a pair containing atom
     // option name and any value
@@ -521,6 +676,12 @@ public:
     bool is_list()   const { return m_type == LIST  ; }
     bool is_map()    const { return m_type == MAP   ; }
     bool is_trace()  const { return m_type == TRACE ; }
+    bool is_raw()    const { return m_type == RAW   ; }
+    bool is_bigint() const { return m_type == BIGINT; }
+    /// True for LONG and BIGINT terms.
+    bool is_integer()const { return m_type == LONG || m_type == BIGINT; }
+    /// True for BINARY and BITSTRING terms.
+    bool is_bitstring() const { return m_type == BINARY || m_type == BITSTRING; }
 
     /**
      * Perform pattern matching.
@@ -538,6 +699,15 @@ public:
     /// @throw  err_unbound_variable
     bool match(const eterm<Alloc>& pattern) const { return match(pattern, NULL, Alloc()); }
 
+    /**
+     * Perform pattern matching and evaluate the \a guard over the
+     * bound variables.  The \a binding is only updated if both the
+     * pattern and the guard succeed.
+     * @throw  err_unbound_variable
+     */
+    bool match(const eterm<Alloc>& pattern, const eterm_guard<Alloc>& guard,
+               varbind<Alloc>* binding = NULL, const Alloc& a_alloc = Alloc()) const;
+
     /**
      * Returns the equivalent without inner variables, using the
      * given binding to substitute them.
@@ -605,6 +775,27 @@ public:
     void encode(char* buf, size_t size,
         size_t a_header_size = DEF_HEADER_SIZE, bool a_with_version = true) const;
 
+    /**
+     * Encode a term in the canonical external format, in which terms that
+     * are exactly equal always have the same representation regardless of
+     * how they were constructed.
+     * @param a_header_size is the size of packet header (valid values: 0, 1, 2, 4).
+     * @param a_with_version indicates if a magic version byte
+     *        needs to be encoded in the beginning of the buffer.
+     * @see visit_eterm_canonical
+     * @throw err_encode_exception
+     */
+    string<Alloc> encode_canonical(size_t a_header_size = DEF_HEADER_SIZE,
+                                   bool a_with_version = true) const;
+
+    /**
+     * 128-bit SipHash-2-4 of the canonical encoding of the term (with
+     * the version byte) computed without storing the encoding.
+     * Exactly equal terms have equal content hashes.
+     * @throw err_encode_exception if the term contains variables.
+     */
+    util::hash128 content_hash() const;
+
     /**
      * Create an eterm from an string representation. Like sprintf()
      * function you can use it to create Erlang terms using a format
@@ -627,6 +818,9 @@ public:
      *   eterm::format("[{name,~a},{age,~i},{dob,~w}]",
      *          "alex", 40, eterm_t("1955-10-1"));
      * </code>
+     * Maps are written as <tt>#{K => V}</tt> or, in patterns, as
+     * <tt>#{type := order, id := Id}</tt>, which matches any map having
+     * these keys (see match()).
      * @return compiled eterm
      * @throw err_format_exception
      */
@@ -667,11 +861,14 @@ public:
             case LIST:   return wrapper(v, vt.l);
             case MAP:    return wrapper(v, vt.m);
             case TRACE:  return wrapper(v, vt.trc);
+            case RAW:    return wrapper(v, vt.rw);
+            case BIGINT: return wrapper(v, bigint<Alloc>(vt.value, m_flags));
+            case BITSTRING: return wrapper(v, bitstring<Alloc>(vt.bin, m_flags, 0));
             default: {
                 std::stringstream s; s << "Undefined term_type (" << m_type << ')';
                 throw err_invalid_term(s.str());
             }
-            BOOST_STATIC_ASSERT(MAX_ETERM_TYPE == 14);
+            BOOST_STATIC_ASSERT(MAX_ETERM_TYPE == 17);
         }
     }
 };
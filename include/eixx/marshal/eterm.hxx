@@ -33,6 +33,8 @@ limitations under the License.
 #include <eixx/marshal/visit_to_string.hpp>
 #include <eixx/marshal/visit_subst.hpp>
 #include <eixx/marshal/visit_match.hpp>
+#include <eixx/marshal/visit_phash2.hpp>
+#include <eixx/marshal/visit_canonical.hpp>
 #include <eixx/marshal/eterm_format.hpp>
 
 namespace eixx {
@@ -61,6 +63,8 @@ inline eterm_type type_string_to_type(const char* s, size_t n) {
              else if (strncmp(p,"inary",m) == 0) r = BINARY;
              else if (strncmp(p,"oolean",m)== 0) r = BOOL;
              else if (strncmp(p,"yte",m) == 0)   r = LONG;
+             else if (strncmp(p,"igint",m) == 0) r = BIGINT;
+             else if (strncmp(p,"itstring",m)==0)r = BITSTRING;
              break;
          case 'c':
              if (strncmp(p,"har",m) == 0)        r = LONG;
@@ -78,6 +82,7 @@ inline eterm_type type_string_to_type(const char* s, size_t n) {
          case 'r':
              if      (strncmp(p,"ef",m) == 0)       r = REF;
              else if (strncmp(p,"eference",m) == 0) r = REF;
+             else if (strncmp(p,"aw",m) == 0)       r = RAW;
              break;
          case 'v':
              if (strncmp(p,"ar",m) == 0)         r = VAR;
@@ -118,15 +123,22 @@ const char* eterm<Alloc>::type_string() const {
         case LIST:      return "list";
         case MAP:       return "map";
         case TRACE:     return "trace";
+        case RAW:       return "raw";
+        case BIGINT:    return "bigint";
+        case BITSTRING: return "bitstring";
         default:        throw eterm_exception("Term type not supported: ", int(m_type));
     }
-    static_assert(MAX_ETERM_TYPE == 14, "Invalid number of terms");
+    static_assert(MAX_ETERM_TYPE == 17, "Invalid number of terms");
 }
 
 template <typename Alloc>
 inline bool eterm<Alloc>::operator== (const eterm<Alloc>& rhs) const {
     if (m_type != rhs.type())
         return false;
+    // Handles sharing the same storage
+    if (m_type >= STRING && vt.value == rhs.vt.value && m_type != BIGINT &&
+        (m_type != BITSTRING || m_flags == rhs.m_flags))
+        return true;
     switch (m_type) {
         case LONG:   return vt.i    == rhs.vt.i;
         case DOUBLE: return vt.d    == rhs.vt.d;
@@ -142,12 +154,15 @@ inline bool eterm<Alloc>::operator== (const eterm<Alloc>& rhs) const {
         case LIST:   return vt.l    == rhs.vt.l;
         case MAP:    return vt.m    == rhs.vt.m;
         case TRACE:  return vt.trc  == rhs.vt.trc;
+        case RAW:    return vt.rw  == rhs.vt.rw;
+        case BIGINT: return bigint<Alloc>::compare(big(), rhs.big()) == 0;
+        case BITSTRING: return to_bitstring() == rhs.to_bitstring();
         default: {
             std::stringstream s; s << "Undefined term_type (" << m_type << ')';
             throw err_invalid_term(s.str());
         }
     }
-    static_assert(MAX_ETERM_TYPE == 14, "Invalid number of terms");
+    static_assert(MAX_ETERM_TYPE == 17, "Invalid number of terms");
 }
 
 
@@ -155,53 +170,169 @@ inline bool eterm<Alloc>::operator== (const eterm<Alloc>& rhs) const {
 
 
 template <typename Alloc>
-inline bool eterm<Alloc>::operator< (const eterm<Alloc>& rhs) const {
-    /// Term comparison precedence
-    auto type_precedence = [](int type) {
-        static const int s_precedences[MAX_ETERM_TYPE+1] = {
-            9,          // UNDEFINED
-            0, 0,       // LONG, DOUBLE
-            1,          // BOOL
-            2,          // ATOM
-            13,         // VAR
-            10,         // STRING
-            11,         // BINARY
-            6,          // PID
-            5,          // PORT
-            3,          // REF
-            7,          // TUPLE
-            10,         // LIST
-            8,          // MAP
-            12          // TRACE
-        };
-        return s_precedences[type];
+inline int eterm<Alloc>::order(const eterm<Alloc>& a) {
+    static const int s_order[MAX_ETERM_TYPE+1] = {
+        -1,         // UNDEFINED
+        0, 0,       // LONG, DOUBLE
+        1,          // BOOL (true and false are atoms)
+        1,          // ATOM
+        10,         // VAR
+        8,          // STRING (list of characters)
+        9,          // BINARY
+        5,          // PID
+        4,          // PORT
+        2,          // REF
+        6,          // TUPLE
+        8,          // LIST
+        7,          // MAP
+        6,          // TRACE (5-tuple)
+        11,         // RAW
+        0,          // BIGINT
+        9           // BITSTRING
     };
-    int a = type_precedence(int(m_type));
-    int b = type_precedence(int(rhs.m_type));
-    if (a < b) return true;
-    if (a > b) return false;        
-    // precedences are equal - (note that numeric types have same precedence):
-    switch (m_type) {
-        case LONG:   return double(vt.i) < (rhs.m_type == LONG ? double(rhs.vt.i) : rhs.vt.d);
-        case DOUBLE: return vt.d         < (rhs.m_type == LONG ? double(rhs.vt.i) : rhs.vt.d);
-        case BOOL:   return vt.b         < rhs.vt.b;
-        case ATOM:   return vt.a         < rhs.vt.a;
-        case VAR:    return vt.v         < rhs.vt.v;
-        case STRING: return vt.s         < rhs.vt.s;
-        case BINARY: return vt.bin       < rhs.vt.bin;
-        case PID:    return vt.pid       < rhs.vt.pid;
-        case PORT:   return vt.prt       < rhs.vt.prt;
-        case REF:    return vt.r         < rhs.vt.r;
-        case TUPLE:  return vt.t         < rhs.vt.t;
-        case LIST:   return vt.l         < rhs.vt.l;
-        case MAP:    return vt.m         < rhs.vt.m;
-        case TRACE:  return vt.trc       < rhs.vt.trc;
-        default: {
-            std::stringstream s; s << "Undefined term_type (" << m_type << ')';
-            throw err_invalid_term(s.str());
+    static_assert(MAX_ETERM_TYPE == 17, "Invalid number of terms");
+    if (unlikely(a.m_type == RAW)) {
+        auto tag = a.vt.rw.tag();
+        if (tag == ERL_NEW_FUN_EXT || tag == ERL_FUN_EXT || tag == ERL_EXPORT_EXT)
+            return 3;
+    }
+    return s_order[a.m_type];
+}
+
+template <typename Alloc>
+inline int eterm<Alloc>::compare(long a, double b) {
+    // Doubles outside of the long range can't be equal to a long
+    if (b >= 9223372036854775808.0)  return -1;
+    if (b < -9223372036854775808.0)  return  1;
+    double d = double(a);
+    if (d < b) return -1;
+    if (d > b) return  1;
+    // The double is integral, but the long might have lost precision
+    long n = long(b);
+    return a < n ? -1 : a > n;
+}
+
+template <typename Alloc>
+inline int eterm<Alloc>::compare_big(const eterm<Alloc>& a, const eterm<Alloc>& b) {
+    if (b.m_type == DOUBLE)
+        return bigint<Alloc>::compare(a.big(), b.vt.d);
+    // A BIGINT is outside of the long range
+    return a.big().neg ? -1 : 1;
+}
+
+template <typename Alloc>
+int eterm<Alloc>::compare(const list<Alloc>& a, const list<Alloc>& b, bool a_exact) {
+    auto i1 = a.begin(), i2 = b.begin(), end = a.end();
+    for (; i1 != end && i2 != end; ++i1, ++i2)
+        if (int n = compare(*i1, *i2, a_exact))
+            return n;
+    return i1 != end ? 1 : i2 != end ? -1 : 0;
+}
+
+template <typename Alloc>
+int eterm<Alloc>::compare(const string<Alloc>& a, const list<Alloc>& b, bool a_exact) {
+    auto p = a.c_str(), e = p + a.size();
+    auto it = b.begin(), end = b.end();
+    for (; p != e && it != end; ++p, ++it)
+        if (int n = compare(eterm<Alloc>(long((unsigned char)*p)), *it, a_exact))
+            return n;
+    return p != e ? 1 : it != end ? -1 : 0;
+}
+
+template <typename Alloc>
+int eterm<Alloc>::compare(const tuple<Alloc>& a, const tuple<Alloc>& b, bool a_exact) {
+    if (a.size() != b.size())
+        return a.size() < b.size() ? -1 : 1;
+    for (size_t i=0, n=a.size(); i < n; ++i)
+        if (int r = compare(a[i], b[i], a_exact))
+            return r;
+    return 0;
+}
+
+template <typename Alloc>
+int eterm<Alloc>::compare(const map<Alloc>& a, const map<Alloc>& b, bool a_exact) {
+    if (a.size() != b.size())
+        return a.size() < b.size() ? -1 : 1;
+    for (auto i1 = a.begin(), i2 = b.begin(), e = a.end(); i1 != e; ++i1, ++i2)
+        if (int n = compare(i1->first, i2->first, true))
+            return n;
+    for (auto i1 = a.begin(), i2 = b.begin(), e = a.end(); i1 != e; ++i1, ++i2)
+        if (int n = compare(i1->second, i2->second, a_exact))
+            return n;
+    return 0;
+}
+
+template <typename Alloc>
+int eterm<Alloc>::compare(const eterm<Alloc>& a, const eterm<Alloc>& b, bool a_exact) {
+    auto bytes = [](const char* p1, size_t n1, const char* p2, size_t n2) {
+        if (p1 != p2)
+            if (int n = memcmp(p1, p2, std::min(n1, n2)))
+                return n;
+        return n1 < n2 ? -1 : n1 > n2;
+    };
+    auto cmp = [](const auto& x, const auto& y) { return x == y ? 0 : x < y ? -1 : 1; };
+
+    if (a.m_type == b.m_type) {
+        // Same value or handles sharing the same storage
+        if (a.vt.value == b.vt.value && a.m_type != DOUBLE &&
+            ((a.m_type != BIGINT && a.m_type != BITSTRING) || a.m_flags == b.m_flags))
+            return 0;
+
+        switch (a.m_type) {
+            case LONG:   return a.vt.i < b.vt.i ? -1 : a.vt.i > b.vt.i;
+            case DOUBLE: return a.vt.d < b.vt.d ? -1 : a.vt.d > b.vt.d;
+            case BOOL:   return int(a.vt.b) - int(b.vt.b);
+            case ATOM:   return a.vt.a.compare(b.vt.a);
+            case VAR:    return a.vt.v.name().compare(b.vt.v.name());
+            case STRING: return bytes(a.vt.s.c_str(), a.vt.s.size(), b.vt.s.c_str(), b.vt.s.size());
+            case BINARY: return bytes(a.vt.bin.data(), a.vt.bin.size(), b.vt.bin.data(), b.vt.bin.size());
+            case PID:    return cmp(a.vt.pid, b.vt.pid);
+            case PORT:   return cmp(a.vt.prt, b.vt.prt);
+            case REF:    return cmp(a.vt.r,   b.vt.r);
+            case TUPLE:  return compare(a.vt.t, b.vt.t, a_exact);
+            case TRACE:  return compare(a.vt.trc.to_tuple(), b.vt.trc.to_tuple(), a_exact);
+            case LIST:   return compare(a.vt.l, b.vt.l, a_exact);
+            case MAP:    return compare(a.vt.m, b.vt.m, a_exact);
+            case RAW:    return cmp(a.vt.rw,  b.vt.rw);
+            case BIGINT: return bigint<Alloc>::compare(a.big(), b.big());
+            case BITSTRING: return a.to_bitstring().compare(b.to_bitstring());
+            case UNDEFINED: return 0;
+            default:     throw err_invalid_term("Undefined term_type");
         }
     }
-    static_assert(MAX_ETERM_TYPE == 14, "Invalid number of terms");
+
+    int x = order(a), y = order(b);
+    if (x != y)
+        return x < y ? -1 : 1;
+
+    // Different types of the same class
+    switch (x) {
+        case 0: {
+            // In the exact order integers are less than all floats
+            if (a_exact && (a.m_type == DOUBLE || b.m_type == DOUBLE))
+                return a.m_type == DOUBLE ? 1 : -1;
+            if (a.m_type == BIGINT || b.m_type == BIGINT)
+                return a.m_type == BIGINT ? compare_big(a, b) : -compare_big(b, a);
+            return a.m_type == LONG ? compare(a.vt.i, b.vt.d) : -compare(b.vt.i, a.vt.d);
+        }
+        case 1: {
+            static const atom s_bool[] = { atom("false"), atom("true") };
+            const atom& a1 = a.m_type == BOOL ? s_bool[a.vt.b] : a.vt.a;
+            const atom& a2 = b.m_type == BOOL ? s_bool[b.vt.b] : b.vt.a;
+            return a1.compare(a2);
+        }
+        case 6:
+            return compare(a.m_type == TUPLE ? a.vt.t : a.vt.trc.to_tuple(),
+                           b.m_type == TUPLE ? b.vt.t : b.vt.trc.to_tuple(), a_exact);
+        case 9:
+            return a.to_bitstring().compare(b.to_bitstring());
+        case 8:
+            return a.m_type == STRING ? compare(a.vt.s, b.vt.l, a_exact)
+                                      : -compare(b.vt.s, a.vt.l, a_exact);
+        default:
+            // RAW terms of the same class as other types
+            return a.m_type < b.m_type ? -1 : 1;
+    }
 }
 
 template <typename Alloc>
@@ -216,6 +347,15 @@ std::string eterm<Alloc>::to_string(size_t a_size_limit, const varbind<Alloc>* b
         ? s : s.substr(0, std::min(a_size_limit, s.size()));
 }
 
+template <typename Alloc>
+uint32_t eterm<Alloc>::phash2(uint64_t a_range) const {
+    if (a_range == 0 || a_range > (uint64_t(1) << 32))
+        throw err_bad_argument("Invalid phash2 range", a_range);
+    visit_eterm_phash2<Alloc> visitor;
+    visitor.apply_visitor(*this);
+    return a_range == (uint64_t(1) << 32) ? visitor.hash() : uint32_t(visitor.hash() % a_range);
+}
+
 template <class Alloc>
 eterm<Alloc>::eterm(const char* a_buf, size_t a_size, const Alloc& a_alloc)
 {
@@ -226,6 +366,55 @@ eterm<Alloc>::eterm(const char* a_buf, size_t a_size, const Alloc& a_alloc)
     decode(a_buf, idx, a_size, a_alloc);
 }
 
+template <class Alloc>
+void eterm<Alloc>::decode_into(const char* a_buf, size_t a_size, const Alloc& a_alloc)
+{
+    uintptr_t idx = 0;
+    int vsn;
+    if (ei_decode_version(a_buf, (int*)&idx, &vsn) < 0)
+        throw err_decode_exception("Wrong eterm version byte!", idx, vsn);
+    decode_into(a_buf, idx, a_size, a_alloc);
+}
+
+template <class Alloc>
+void eterm<Alloc>::decode_into(const char* a_buf, uintptr_t& idx, size_t a_size,
+                               const Alloc& a_alloc)
+{
+    BOOST_ASSERT(idx <= INT_MAX);
+    if ((size_t)idx == a_size)
+        throw err_decode_exception("Empty term", idx);
+
+    int type, sz;
+    if (ei_get_type(a_buf, (int*)&idx, &type, &sz) < 0)
+        throw err_decode_exception("Cannot determine term type", idx);
+
+    switch (type) {
+        case ERL_LARGE_TUPLE_EXT:
+        case ERL_SMALL_TUPLE_EXT:
+            if (m_type == TUPLE  && vt.t.decode_into(a_buf, idx, a_size, a_alloc))
+                return;
+            break;
+        case ERL_LIST_EXT:
+            if (m_type == LIST   && vt.l.decode_into(a_buf, idx, a_size, a_alloc))
+                return;
+            break;
+        case ERL_STRING_EXT:
+            if (m_type == STRING && vt.s.decode_into(a_buf, idx, a_size))
+                return;
+            break;
+        case ERL_BINARY_EXT:
+            if (m_type == BINARY && vt.bin.decode_into(a_buf, idx, a_size))
+                return;
+            break;
+        default:
+            break;
+    }
+
+    // The storage can't be reused - decode the term from scratch
+    clear();
+    decode(a_buf, idx, a_size, a_alloc);
+}
+
 template <class Alloc>
 void eterm<Alloc>::decode(const char* a_buf, uintptr_t& idx, size_t a_size, const Alloc& a_alloc)
 {
@@ -275,8 +464,6 @@ void eterm<Alloc>::decode(const char* a_buf, uintptr_t& idx, size_t a_size, cons
         break;
     }
     case ERL_SMALL_INTEGER_EXT:
-    case ERL_SMALL_BIG_EXT:
-    case ERL_LARGE_BIG_EXT:
     case ERL_INTEGER_EXT: {
         long long l;
         if (ei_decode_longlong(a_buf, (int*)&idx, &l) < 0)
@@ -284,6 +471,11 @@ void eterm<Alloc>::decode(const char* a_buf, uintptr_t& idx, size_t a_size, cons
         new (this) eterm<Alloc>((long)l);
         break;
     }
+    case ERL_SMALL_BIG_EXT:
+    case ERL_LARGE_BIG_EXT:
+        // Stored as LONG if it fits, and without allocation below 2^64
+        new (this) eterm<Alloc>(bigint<Alloc>(a_buf, idx, a_size, a_alloc));
+        break;
     case NEW_FLOAT_EXT:
     case ERL_FLOAT_EXT: {
         double d;
@@ -297,6 +489,10 @@ void eterm<Alloc>::decode(const char* a_buf, uintptr_t& idx, size_t a_size, cons
         new (this) eterm<Alloc>(binary<Alloc>(a_buf, idx, a_size, a_alloc));
         break;
 
+    case ERL_BIT_BINARY_EXT:
+        new (this) eterm<Alloc>(bitstring<Alloc>(a_buf, idx, a_size, a_alloc));
+        break;
+
 #ifdef ERL_NEW_PID_EXT
     case ERL_NEW_PID_EXT:
 #endif
@@ -314,6 +510,9 @@ void eterm<Alloc>::decode(const char* a_buf, uintptr_t& idx, size_t a_size, cons
         new (this) eterm<Alloc>(ref<Alloc>(a_buf, idx, a_size, a_alloc));
         break;
 
+#ifdef ERL_V4_PORT_EXT
+    case ERL_V4_PORT_EXT:
+#endif
 #ifdef ERL_NEW_PORT_EXT
     case ERL_NEW_PORT_EXT:
 #endif
@@ -326,9 +525,9 @@ void eterm<Alloc>::decode(const char* a_buf, uintptr_t& idx, size_t a_size, cons
         break;
 
     default:
-        std::ostringstream oss;
-        oss << "Unknown message content type " << type;
-        throw err_decode_exception(oss.str(), idx, type);
+        // Terms that aren't modeled (funs, exports, etc.)
+        // are kept as opaque encoded bytes
+        new (this) eterm<Alloc>(raw<Alloc>(a_buf, idx, a_size, a_alloc));
         break;
     }
 }
@@ -385,25 +584,83 @@ void eterm<Alloc>::encode(char* a_buf, size_t size,
     BOOST_ASSERT((size_t)offset == size);
 }
 
+template <typename Alloc>
+string<Alloc> eterm<Alloc>::encode_canonical(size_t a_header_size, bool a_with_version) const
+{
+    if (a_header_size != 0 && a_header_size != 1 && a_header_size != 2 && a_header_size != 4) {
+        std::stringstream s;
+        s << "Bad header size: " << a_header_size;
+        throw err_encode_exception(s.str());
+    }
+    canonical_size_sink sz;
+    visit_eterm_canonical<Alloc, canonical_size_sink>(sz).apply_visitor(*this);
+
+    size_t msg_sz = sz.size + (a_with_version ? 1 : 0);
+    string<Alloc> out(NULL, a_header_size + msg_sz);
+    char* p = const_cast<char*>(out.c_str());
+    switch (a_header_size) {
+        case 1: store_be<uint8_t> (p, static_cast<uint8_t> (msg_sz)); break;
+        case 2: store_be<uint16_t>(p, static_cast<uint16_t>(msg_sz)); break;
+        case 4: store_be<uint32_t>(p, static_cast<uint32_t>(msg_sz)); break;
+        default: break;
+    }
+    uintptr_t offset = a_header_size;
+    if (a_with_version)
+        ei_encode_version(p, (int*)&offset);
+    canonical_buffer_sink buf(p + offset);
+    visit_eterm_canonical<Alloc, canonical_buffer_sink>(buf).apply_visitor(*this);
+    BOOST_ASSERT(buf.pos == p + out.size());
+    return out;
+}
+
+template <typename Alloc>
+util::hash128 eterm<Alloc>::content_hash() const
+{
+    canonical_hash_sink sink;
+    char vsn[1];
+    int  n = 0;
+    ei_encode_version(vsn, &n);
+    sink.write(vsn, n);
+    visit_eterm_canonical<Alloc, canonical_hash_sink>(sink).apply_visitor(*this);
+    return sink.hasher.digest();
+}
+
 template <class Alloc>
 bool eterm<Alloc>::match(
     const eterm<Alloc>& pattern,
     varbind<Alloc>* binding,
     const Alloc& a_alloc) const
 {
-    // Protect the given binding. Change it only if the match succeeds.
-    varbind<Alloc> dirty(a_alloc);
     if (!binding) {
+        varbind<Alloc> dirty(a_alloc);
         visit_eterm_match<Alloc> visitor(pattern, &dirty);
-        if (!visitor.apply_visitor(*this))
-            return false;
-    } else {
-        dirty.copy(*binding);
-        visit_eterm_match<Alloc> visitor(pattern, &dirty);
-        if (!visitor.apply_visitor(*this))
-            return false;
-        binding->merge(dirty);
+        return visitor.apply_visitor(*this);
+    }
+    // Protect the given binding. Change it only if the match succeeds.
+    typename varbind<Alloc>::scope l_scope(*binding);
+    visit_eterm_match<Alloc> visitor(pattern, binding);
+    if (!visitor.apply_visitor(*this))
+        return false;
+    l_scope.commit();
+    return true;
+}
+
+template <typename Alloc>
+bool eterm<Alloc>::match(
+    const eterm<Alloc>&       pattern,
+    const eterm_guard<Alloc>& guard,
+    varbind<Alloc>*           binding,
+    const Alloc&              a_alloc) const
+{
+    if (!binding) {
+        varbind<Alloc> dirty(a_alloc);
+        return match(pattern, &dirty, a_alloc) && guard(dirty);
     }
+    // Unbind the variables bound by the match if the guard fails
+    typename varbind<Alloc>::scope l_scope(*binding);
+    if (!match(pattern, binding, a_alloc) || !guard(*binding))
+        return false;
+    l_scope.commit();
     return true;
 }
 
@@ -43,6 +43,7 @@ limitations under the License.
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 #include <vector>
 #include <iostream>
 #include <eixx/marshal/defaults.hpp>
@@ -213,7 +214,11 @@ namespace marshal {
             auto d = strtod(start, NULL);
             return d;
         }
+        errno  = 0;
         auto n = strtol(start, NULL, base);
+        // Decimal integers that don't fit in a long are bignums
+        if (errno == ERANGE && base == 10)
+            return bigint<Alloc>::from_string(start, p - start);
         return n;
     } /* pdigit */
 
@@ -265,7 +270,7 @@ namespace marshal {
             case 's': return string<Alloc>(va_arg(*pap, char*), a_alloc);
             case 'i': return va_arg(*pap, int);
             case 'l': return va_arg(*pap, long);
-            case 'u': return (long)va_arg(*pap, unsigned long);
+            case 'u': return va_arg(*pap, unsigned long);
             case 'f': return va_arg(*pap, double);
             default:  throw err_format_exception("Error parsing string", *fmt-1);
         }
@@ -349,6 +354,46 @@ namespace marshal {
 
     } /* plist */
 
+    template <class Alloc>
+    static eterm<Alloc> eformat(const char** fmt, va_list* pap, const Alloc& a_alloc);
+
+    /// Parse the associations of a map following "#{".  Both "K => V" and
+    /// "K := V" are accepted, the latter being the syntax of map patterns.
+    template <class Alloc>
+    static eterm<Alloc> pmap(const char** fmt, va_list* pap, Alloc& a_alloc)
+    {
+        map<Alloc> m(a_alloc);
+
+        skip_ws_and_comments(fmt);
+
+        if (**fmt == '}') {
+            (*fmt)++;
+            return m;
+        }
+
+        while (true) {
+            auto key = eformat(fmt, pap, a_alloc);
+            skip_ws_and_comments(fmt);
+
+            const char* p = *fmt;
+            if (!((p[0] == '=' && p[1] == '>') || (p[0] == ':' && p[1] == '=')))
+                throw err_format_exception("Error parsing map association", p);
+            *fmt += 2;
+
+            m.insert_or_assign(key, eformat(fmt, pap, a_alloc));
+            skip_ws_and_comments(fmt);
+
+            char c = *(*fmt)++;
+            if (c == '}')
+                break;
+            if (c != ',')
+                throw err_format_exception("Error parsing map", *fmt-1);
+        }
+
+        return m;
+
+    } /* pmap */
+
     template <class Alloc>
     static eterm<Alloc> eformat(const char** fmt, va_list* pap, const Alloc& a_alloc)
     {
@@ -365,6 +410,11 @@ namespace marshal {
                 ret = v.to_tuple(alloc);
                 break;
             }
+            case '#':
+                if (*(*fmt)++ != '{')
+                    throw err_format_exception("Error parsing map", *fmt-1);
+                ret = pmap(fmt, pap, alloc);
+                break;
             case '[':
                 if (**fmt == ']') {
                     (*fmt)++;
@@ -391,14 +441,26 @@ namespace marshal {
                         throw err_format_exception("Cannot find end of binary", *fmt);
                     std::vector<char> v2;
                     auto p = *fmt;
+                    int  tail = 0;  // Number of bits in the last element (bitstring)
 
                     while (p < end) {
+                        if (tail)
+                            throw err_format_exception("Bit size must be given in the last element", p);
                         while (*p == ' ' || *p == '\t') ++p;
                         int byte;
                         auto q = fast_atoi<int, false>(p, end, byte);
                         if (!q)
                             throw err_format_exception("Error parsing binary", p);
                         p = q;
+                        if (*p == ':') {
+                            q = fast_atoi<int, false>(++p, end, tail);
+                            if (!q || tail < 1 || tail > 7)
+                                throw err_format_exception("Invalid bit size in binary", p);
+                            p = q;
+                            if (byte < 0 || byte >= (1 << tail))
+                                throw err_format_exception("Invalid bits value in binary", p);
+                            byte <<= 8 - tail;
+                        }
                         if (byte < 0 || byte > 255)
                             throw err_format_exception("Invalid byte value in binary", p);
                         v2.push_back((char)byte);
@@ -409,7 +471,10 @@ namespace marshal {
                             throw err_format_exception("Invalid byte delimiter in binary", p);
                     }
                     auto begin = &v2[0];
-                    ret = eterm<Alloc>(binary<Alloc>(begin, v2.size(), alloc));
+                    if (tail)
+                        ret = eterm<Alloc>(bitstring<Alloc>(begin, (v2.size()-1)*8 + tail, alloc));
+                    else
+                        ret = eterm<Alloc>(binary<Alloc>(begin, v2.size(), alloc));
                     *fmt = end + 2;
                 }
                 break;
@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------
+/// \file  eterm_guard.hpp
+//----------------------------------------------------------------------------
+/// \brief Compiled guard expressions of patterns.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_ETERM_GUARD_HPP_
+#define _IMPL_ETERM_GUARD_HPP_
+
+#include <vector>
+#include <ctype.h>
+#include <stdarg.h>
+#include <eixx/eterm_exception.hpp>
+#include <eixx/marshal/eterm.hpp>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Guard of a pattern, such as <tt>"Qty > 0, is_integer(Px)"</tt>, that
+ * is compiled once into a small stack bytecode and evaluated over the
+ * variables bound by a successful match.
+ *
+ * The expression is a guard sequence in Erlang syntax.  Guards separated
+ * by ';' are tried in order, and the expressions of a guard separated by
+ * ',' must all be true.  Supported expressions are:
+ *   @li variables and literal terms in the eterm::format() syntax
+ *       (including "~i" style placeholders);
+ *   @li comparisons: ==, /=, =:=, =/=, <, =<, >, >=;
+ *   @li not, andalso, orelse and parentheses;
+ *   @li type tests: is_atom, is_binary, is_bitstring, is_boolean,
+ *       is_float, is_integer, is_list, is_map, is_number, is_pid,
+ *       is_port, is_reference, is_tuple;
+ *   @li functions: bit_size, byte_size, element, hd, is_map_key, length,
+ *       map_get, map_size, tuple_size.
+ *
+ * As in Erlang, an unbound variable or an invalid argument of a function
+ * makes the guard fail, in which case the next guard of the sequence is
+ * tried.  Evaluation doesn't allocate memory.
+ * <code>
+ *   static const eterm_guard<Alloc> g("Qty > 0, is_integer(Px)");
+ *   if (order.match(pattern, g, &binding)) ...
+ * </code>
+ */
+template <class Alloc>
+class eterm_guard
+{
+    enum opcode : uint8_t {
+        PUSH_VAR,       ///< Push the value of variable m_vars[arg]
+        PUSH_CONST,     ///< Push the literal m_consts[arg]
+        CMP,            ///< Replace two values with the result of comparison arg
+        NOT,            ///< Negate the boolean on the top
+        CALL,           ///< Replace the arguments with the result of function arg
+        JUMP_FALSE,     ///< andalso: jump to arg if the top is false, else pop it
+        JUMP_TRUE,      ///< orelse:  jump to arg if the top is true,  else pop it
+        RET             ///< End of a guard of the sequence
+    };
+
+    enum cmp_op : uint8_t { EQ, NE, EXACT_EQ, EXACT_NE, LT, LE, GT, GE };
+
+    enum bif : uint8_t {
+        IS_ATOM, IS_BINARY, IS_BITSTRING, IS_BOOLEAN, IS_FLOAT, IS_INTEGER,
+        IS_LIST, IS_MAP, IS_NUMBER, IS_PID, IS_PORT, IS_REFERENCE, IS_TUPLE,
+        BIT_SIZE, BYTE_SIZE, ELEMENT, HD, IS_MAP_KEY, LENGTH, MAP_GET,
+        MAP_SIZE, TUPLE_SIZE
+    };
+
+    struct instr {
+        opcode   op;
+        uint32_t arg;
+    };
+
+    /// Maximum depth of the evaluation stack.
+    static const int MAX_DEPTH = 16;
+
+    std::vector<instr>        m_code;
+    std::vector<uint32_t>     m_guards;   ///< Start of each guard of the sequence
+    std::vector<atom>         m_vars;
+    std::vector<eterm<Alloc>> m_consts;
+
+    /// Parser state
+    struct state {
+        const char*  p;
+        const char*  start;
+        va_list*     args;
+        const Alloc& alloc;
+        int          depth;
+    };
+
+    static void ws(state& s) { while (isspace(*s.p)) ++s.p; }
+    /// Skip the keyword \a a_word if it's next in the input.
+    static bool keyword(state& s, const char* a_word);
+    [[noreturn]] static void error(const state& s, const char* a_msg, const char* a_pos) {
+        throw err_format_exception(a_msg, a_pos, s.start);
+    }
+
+    void compile(const Alloc& a_alloc, const char** a_expr, va_list* a_args);
+    void parse(state& s);
+    void parse_guard  (state& s);
+    void parse_orelse (state& s);
+    void parse_andalso(state& s);
+    void parse_compare(state& s);
+    void parse_unary  (state& s);
+    void parse_primary(state& s);
+
+    void emit(state& s, opcode a_op, uint32_t a_arg, int a_stack_change);
+
+    /// Evaluate the guard starting at \a a_pc.
+    bool run(uint32_t a_pc, const varbind<Alloc>& a_binding) const;
+
+public:
+    /// Create an empty guard that always succeeds.
+    eterm_guard() {}
+
+    /**
+     * Compile the guard expression.
+     * @throw err_format_exception if the expression is invalid.
+     */
+    explicit eterm_guard(const char* a_expr, const Alloc& a_alloc = Alloc());
+    explicit eterm_guard(const std::string& a_expr, const Alloc& a_alloc = Alloc())
+        : eterm_guard(a_expr.c_str(), a_alloc) {}
+
+    /**
+     * Compile the guard expression pointed to by \a a_expr, taking the
+     * values of "~" placeholders from \a a_args (can be NULL if there
+     * are no placeholders).  On return \a a_expr points past the end of
+     * the expression.
+     * @throw err_format_exception if the expression is invalid.
+     */
+    eterm_guard(const Alloc& a_alloc, const char** a_expr, va_list* a_args);
+
+    /// Compile the guard expression with "~" placeholders
+    /// (see eterm::format()).
+    static eterm_guard<Alloc> format(const Alloc& a_alloc, const char* a_fmt, ...);
+    static eterm_guard<Alloc> format(const char* a_fmt, ...);
+
+    /// True if the guard has no expressions.
+    bool empty() const { return m_guards.empty(); }
+
+    /// Evaluate the guard over the variables bound in \a a_binding.
+    bool operator()(const varbind<Alloc>& a_binding) const {
+        for (uint32_t pc : m_guards)
+            if (run(pc, a_binding))
+                return true;
+        return m_guards.empty();
+    }
+};
+
+} // namespace marshal
+} // namespace eixx
+
+#include <eixx/marshal/eterm_guard.hxx>
+
+#endif // _IMPL_ETERM_GUARD_HPP_
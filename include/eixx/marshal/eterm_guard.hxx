@@ -0,0 +1,418 @@
+//----------------------------------------------------------------------------
+/// \file  eterm_guard.hxx
+//----------------------------------------------------------------------------
+/// \brief Implementation of eterm_guard class member functions.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <string.h>
+#include <eixx/marshal/am.hpp>
+
+namespace eixx {
+namespace marshal {
+
+namespace detail {
+
+    /// Truth value of a guard term (-1 if it's not a boolean).
+    template <class Alloc>
+    inline int guard_truth(const eterm<Alloc>& a) {
+        if (a.type() == BOOL) return a.to_bool();
+        if (a.type() == ATOM) return a.to_atom() == am_true ? 1 : a.to_atom() == am_false ? 0 : -1;
+        return -1;
+    }
+
+} // namespace detail
+
+template <class Alloc>
+eterm_guard<Alloc>::eterm_guard(const char* a_expr, const Alloc& a_alloc)
+{
+    if (const char* p = strchr(a_expr, '~'))
+        throw err_format_exception("Guard placeholders require arguments", p, a_expr);
+    compile(a_alloc, &a_expr, nullptr);
+}
+
+template <class Alloc>
+eterm_guard<Alloc>::eterm_guard(const Alloc& a_alloc, const char** a_expr, va_list* a_args)
+{
+    compile(a_alloc, a_expr, a_args);
+}
+
+template <class Alloc>
+eterm_guard<Alloc> eterm_guard<Alloc>::format(const Alloc& a_alloc, const char* a_fmt, ...)
+{
+    va_list ap;
+    va_start(ap, a_fmt);
+    try {
+        eterm_guard<Alloc> g(a_alloc, &a_fmt, &ap);
+        va_end(ap);
+        return g;
+    } catch (...) { va_end(ap); throw; }
+}
+
+template <class Alloc>
+eterm_guard<Alloc> eterm_guard<Alloc>::format(const char* a_fmt, ...)
+{
+    va_list ap;
+    va_start(ap, a_fmt);
+    try {
+        eterm_guard<Alloc> g(Alloc(), &a_fmt, &ap);
+        va_end(ap);
+        return g;
+    } catch (...) { va_end(ap); throw; }
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::compile(const Alloc& a_alloc, const char** a_expr, va_list* a_args)
+{
+    state s{*a_expr, *a_expr, a_args, a_alloc, 0};
+    parse(s);
+    ws(s);
+    if (*s.p)
+        error(s, "Invalid guard expression", s.p);
+    *a_expr = s.p;
+}
+
+template <class Alloc>
+bool eterm_guard<Alloc>::keyword(state& s, const char* a_word)
+{
+    ws(s);
+    size_t n = strlen(a_word);
+    if (strncmp(s.p, a_word, n) != 0 || isalnum(s.p[n]) || s.p[n] == '_' || s.p[n] == '@')
+        return false;
+    s.p += n;
+    return true;
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::emit(state& s, opcode a_op, uint32_t a_arg, int a_stack_change)
+{
+    s.depth += a_stack_change;
+    if (s.depth > MAX_DEPTH)
+        error(s, "Guard expression is too complex", s.p);
+    m_code.push_back(instr{a_op, a_arg});
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse(state& s)
+{
+    while (true) {
+        m_guards.push_back(uint32_t(m_code.size()));
+        parse_guard(s);
+        emit(s, RET, 0, -1);
+        ws(s);
+        if (*s.p != ';')
+            break;
+        ++s.p;
+    }
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse_guard(state& s)
+{
+    // "A, B" is evaluated as "A andalso B"
+    parse_orelse(s);
+    for (ws(s); *s.p == ','; ws(s)) {
+        ++s.p;
+        size_t jump = m_code.size();
+        emit(s, JUMP_FALSE, 0, -1);
+        parse_orelse(s);
+        m_code[jump].arg = uint32_t(m_code.size());
+    }
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse_orelse(state& s)
+{
+    parse_andalso(s);
+    while (keyword(s, "orelse")) {
+        size_t jump = m_code.size();
+        emit(s, JUMP_TRUE, 0, -1);
+        parse_andalso(s);
+        m_code[jump].arg = uint32_t(m_code.size());
+    }
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse_andalso(state& s)
+{
+    parse_compare(s);
+    while (keyword(s, "andalso")) {
+        size_t jump = m_code.size();
+        emit(s, JUMP_FALSE, 0, -1);
+        parse_compare(s);
+        m_code[jump].arg = uint32_t(m_code.size());
+    }
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse_compare(state& s)
+{
+    static const struct { const char* op; cmp_op code; } s_ops[] = {
+        {"=:=", EXACT_EQ}, {"=/=", EXACT_NE}, {"==", EQ}, {"/=", NE},
+        {"=<",  LE},       {">=",  GE},       {"<",  LT}, {">",  GT}
+    };
+
+    parse_unary(s);
+    ws(s);
+    for (auto& op : s_ops) {
+        size_t n = strlen(op.op);
+        if (strncmp(s.p, op.op, n) == 0) {
+            s.p += n;
+            parse_unary(s);
+            emit(s, CMP, op.code, -1);
+            return;
+        }
+    }
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse_unary(state& s)
+{
+    if (keyword(s, "not")) {
+        parse_unary(s);
+        emit(s, NOT, 0, 0);
+    } else
+        parse_primary(s);
+}
+
+template <class Alloc>
+void eterm_guard<Alloc>::parse_primary(state& s)
+{
+    // Names and arities of functions in the order of the bif enum
+    static const struct { const char* name; int arity; } s_bifs[] = {
+        {"is_atom",   1}, {"is_binary",  1}, {"is_bitstring", 1}, {"is_boolean",   1},
+        {"is_float",  1}, {"is_integer", 1}, {"is_list",      1}, {"is_map",       1},
+        {"is_number", 1}, {"is_pid",     1}, {"is_port",      1}, {"is_reference", 1},
+        {"is_tuple",  1}, {"bit_size",   1}, {"byte_size",    1}, {"element",      2},
+        {"hd",        1}, {"is_map_key", 2}, {"length",       1}, {"map_get",      2},
+        {"map_size",  1}, {"tuple_size", 1}
+    };
+    auto name = [](const char* p) {
+        while (isalnum(*p) || *p == '_' || *p == '@') ++p;
+        return p;
+    };
+
+    ws(s);
+    const char* start = s.p;
+
+    if (*s.p == '(') {
+        ++s.p;
+        parse_orelse(s);
+        ws(s);
+        if (*s.p != ')')
+            error(s, "Missing ')' in guard", s.p);
+        ++s.p;
+        return;
+    }
+
+    if (isupper(*s.p) || *s.p == '_') {
+        s.p = name(s.p);
+        if (s.p - start == 1 && *start == '_')
+            error(s, "Anonymous variable in guard", start);
+        atom v(std::string(start, s.p - start));
+        size_t i = 0;
+        while (i < m_vars.size() && m_vars[i] != v) ++i;
+        if (i == m_vars.size())
+            m_vars.push_back(v);
+        emit(s, PUSH_VAR, uint32_t(i), 1);
+        return;
+    }
+
+    if (islower(*s.p)) {
+        const char* end = name(s.p), *p = end;
+        while (isspace(*p)) ++p;
+        if (*p == '(') {
+            size_t len = end - start, f = 0, n = sizeof(s_bifs) / sizeof(s_bifs[0]);
+            while (f < n && !(strlen(s_bifs[f].name) == len && strncmp(s_bifs[f].name, start, len) == 0))
+                ++f;
+            if (f == n)
+                error(s, "Unknown guard function", start);
+            s.p = p + 1;
+            ws(s);
+            int argc = 0;
+            if (*s.p != ')')
+                while (true) {
+                    parse_orelse(s);
+                    ++argc;
+                    ws(s);
+                    if (*s.p != ',') break;
+                    ++s.p;
+                }
+            if (*s.p != ')')
+                error(s, "Missing ')' in guard function call", s.p);
+            ++s.p;
+            if (argc != s_bifs[f].arity)
+                error(s, "Invalid number of arguments of guard function", start);
+            emit(s, CALL, uint32_t(f), 1 - argc);
+            return;
+        }
+        state k{s.p, s.start, nullptr, s.alloc, 0};
+        if (keyword(k, "andalso") || keyword(k, "orelse") || keyword(k, "not"))
+            error(s, "Missing operand in guard", start);
+    }
+
+    if (*s.p == '\0' || *s.p == ',' || *s.p == ';' || *s.p == ')')
+        error(s, "Missing operand in guard", start);
+    if (*s.p == '~' && !s.args)
+        error(s, "Guard placeholders require arguments", start);
+
+    // Any other operand is a literal term
+    eterm<Alloc> t = eterm<Alloc>::format(s.alloc, &s.p, s.args);
+    if (detail::guard_truth(t) >= 0)
+        t = eterm<Alloc>(bool(detail::guard_truth(t)));
+    m_consts.push_back(t);
+    emit(s, PUSH_CONST, uint32_t(m_consts.size()-1), 1);
+}
+
+template <class Alloc>
+bool eterm_guard<Alloc>::run(uint32_t a_pc, const varbind<Alloc>& a_binding) const
+{
+    const eterm<Alloc>* st[MAX_DEPTH];
+    eterm<Alloc>        res[MAX_DEPTH];   // Results of operators and functions
+    int sp = 0;
+
+    auto set = [&st, &res](int i, const eterm<Alloc>& v) { res[i] = v; st[i] = &res[i]; };
+
+    for (uint32_t pc = a_pc; ; ++pc) {
+        const instr& in = m_code[pc];
+        switch (in.op) {
+            case PUSH_VAR:
+                // As in Erlang, an unbound variable fails the guard
+                if (!(st[sp] = a_binding.find(m_vars[in.arg])))
+                    return false;
+                ++sp;
+                break;
+            case PUSH_CONST:
+                st[sp++] = &m_consts[in.arg];
+                break;
+            case CMP: {
+                --sp;
+                bool exact = in.arg == EXACT_EQ || in.arg == EXACT_NE;
+                int  r     = st[sp-1]->compare(*st[sp], exact);
+                bool b;
+                switch (in.arg) {
+                    case EQ: case EXACT_EQ: b = r == 0; break;
+                    case NE: case EXACT_NE: b = r != 0; break;
+                    case LT:                b = r <  0; break;
+                    case LE:                b = r <= 0; break;
+                    case GT:                b = r >  0; break;
+                    default:                b = r >= 0; break;
+                }
+                set(sp-1, b);
+                break;
+            }
+            case NOT: {
+                int t = detail::guard_truth(*st[sp-1]);
+                if (t < 0) return false;
+                set(sp-1, !t);
+                break;
+            }
+            case JUMP_FALSE:
+            case JUMP_TRUE: {
+                int t = detail::guard_truth(*st[sp-1]);
+                if (t < 0) return false;
+                if (bool(t) == (in.op == JUMP_TRUE))
+                    pc = in.arg - 1;    // Leave the result on the stack
+                else
+                    --sp;
+                break;
+            }
+            case RET:
+                return detail::guard_truth(*st[sp-1]) == 1;
+            case CALL: {
+                const eterm<Alloc>& a = *st[sp-1];
+                eterm_type          t = a.type();
+                switch (in.arg) {
+                    case IS_ATOM:      set(sp-1, t == ATOM || t == BOOL);           break;
+                    case IS_BINARY:    set(sp-1, t == BINARY);                      break;
+                    case IS_BITSTRING: set(sp-1, a.is_bitstring());                 break;
+                    case IS_BOOLEAN:   set(sp-1, detail::guard_truth(a) >= 0);      break;
+                    case IS_FLOAT:     set(sp-1, t == DOUBLE);                      break;
+                    case IS_INTEGER:   set(sp-1, a.is_integer());                   break;
+                    case IS_LIST:      set(sp-1, t == LIST || t == STRING);         break;
+                    case IS_MAP:       set(sp-1, t == MAP);                         break;
+                    case IS_NUMBER:    set(sp-1, a.is_integer() || t == DOUBLE);    break;
+                    case IS_PID:       set(sp-1, t == PID);                         break;
+                    case IS_PORT:      set(sp-1, t == PORT);                        break;
+                    case IS_REFERENCE: set(sp-1, t == REF);                         break;
+                    case IS_TUPLE:     set(sp-1, t == TUPLE);                       break;
+                    case BIT_SIZE:
+                    case BYTE_SIZE: {
+                        if (!a.is_bitstring()) return false;
+                        auto b = a.to_bitstring();
+                        set(sp-1, long(in.arg == BIT_SIZE ? b.bit_size() : b.size()));
+                        break;
+                    }
+                    case HD:
+                        if (t == LIST && !a.to_list().empty())
+                            st[sp-1] = &*a.to_list().begin();
+                        else if (t == STRING && a.to_str().size())
+                            set(sp-1, long((unsigned char)a.to_str().c_str()[0]));
+                        else
+                            return false;
+                        break;
+                    case LENGTH:
+                        if      (t == LIST)   set(sp-1, long(a.to_list().length()));
+                        else if (t == STRING) set(sp-1, long(a.to_str().size()));
+                        else                  return false;
+                        break;
+                    case MAP_SIZE:
+                        if (t != MAP) return false;
+                        set(sp-1, long(a.to_map().size()));
+                        break;
+                    case TUPLE_SIZE:
+                        if (t != TUPLE) return false;
+                        set(sp-1, long(a.to_tuple().size()));
+                        break;
+                    case ELEMENT: {
+                        const eterm<Alloc>& n = *st[sp-2];
+                        if (t != TUPLE || n.type() != LONG ||
+                            n.to_long() < 1 || size_t(n.to_long()) > a.to_tuple().size())
+                            return false;
+                        st[sp-2] = &a.to_tuple()[size_t(n.to_long()-1)];
+                        --sp;
+                        break;
+                    }
+                    case IS_MAP_KEY:
+                    case MAP_GET: {
+                        if (t != MAP) return false;
+                        const eterm<Alloc>* v = a.to_map().find(*st[sp-2]);
+                        --sp;
+                        if (in.arg == IS_MAP_KEY)
+                            set(sp-1, v != nullptr);
+                        else if (v)
+                            st[sp-1] = v;
+                        else
+                            return false;
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
+
+} // namespace marshal
+} // namespace eixx
@@ -33,6 +33,7 @@ limitations under the License.
 #define _EI_MATCH_HPP_
 
 #include <eixx/marshal/eterm.hpp>
+#include <eixx/marshal/eterm_guard.hpp>
 #include <boost/function.hpp>
 #include <list>
 #include <stdarg.h>
@@ -48,7 +49,9 @@ class eterm_pattern_action;
  * Performs pattern match of a term against a list of registered
  * patterns.  Invokes a callback of a pattern on successful match.
  * If a match succeeded on any pattern the other patters are not 
- * checked
+ * checked.  A pattern may have a guard, in which case the pattern
+ * matches only if the guard succeeds, otherwise the next pattern
+ * is tried like in Erlang's receive.
  */
 template <class Alloc>
 class eterm_pattern_matcher {
@@ -138,6 +141,24 @@ public:
         return m_pattern_list.back();
     }
 
+    const eterm_pattern_action<Alloc>& 
+    push_back(const eterm_pattern_action<Alloc>& a_action) {
+        m_pattern_list.push_back(a_action);
+        return m_pattern_list.back();
+    }
+
+    /**
+     * Add a pattern with a guard to the end of the list of patterns.
+     * \a a_fun is called only if the guard succeeds on the variables
+     * bound by the pattern.
+     */
+    const eterm_pattern_action<Alloc>& 
+    push_back(const eterm<Alloc>& a_pattern, const eterm_guard<Alloc>& a_guard,
+              pattern_functor_t a_fun, long a_opaque=0) {
+        m_pattern_list.push_back(eterm_pattern_action<Alloc>(a_pattern, a_guard, a_fun, a_opaque));
+        return m_pattern_list.back();
+    }
+
     /**
      * Add a pattern to the beginning of the list.
      * The pattern is assign to a smart pointer.
@@ -154,6 +175,13 @@ public:
         return m_pattern_list.front();
     }
 
+    const eterm_pattern_action<Alloc>& 
+    push_front(const eterm<Alloc>& a_pattern, const eterm_guard<Alloc>& a_guard,
+               pattern_functor_t a_fun, long a_opaque=0) {
+        m_pattern_list.push_front(eterm_pattern_action<Alloc>(a_pattern, a_guard, a_fun, a_opaque));
+        return m_pattern_list.front();
+    }
+
     /**
      * Erase a pattern from list.
      * @param a_item is a pattern action reference returned by push_back()
@@ -218,6 +246,7 @@ class eterm_pattern_action {
         pattern_functor_t;
 
     eterm<Alloc>        m_pattern;
+    eterm_guard<Alloc>  m_guard;
     pattern_functor_t   m_fun;
     long                m_opaque;
 public:
@@ -254,6 +283,28 @@ public:
         BOOST_ASSERT(m_fun != NULL);
     }
 
+    /**
+     * Create a new pattern match functor with a guard.
+     * @param a_pattern pattern to match
+     * @param a_guard is the guard evaluated over the variables bound
+     *        by a successful match.
+     * @param a_fun is a functor to execute on successful match.
+     * @param a_opaque is an opaque long value passed to a_fun in callback.
+     */
+    template <typename Lambda>
+    eterm_pattern_action(
+        const eterm<Alloc>& a_pattern, const eterm_guard<Alloc>& a_guard,
+        const Lambda& a_fun, long a_opaque = 0)
+        : m_pattern(a_pattern), m_guard(a_guard), m_fun(a_fun), m_opaque(a_opaque)
+    {
+        BOOST_ASSERT(m_fun != NULL);
+    }
+
+    /**
+     * Create a new pattern match functor from a format string
+     * (see eterm::format()).  The pattern may be followed by a
+     * guard, e.g. <tt>"{order, Qty, Px} when Qty > ~i, is_integer(Px)"</tt>.
+     */
     eterm_pattern_action(
         const Alloc& a_alloc, pattern_functor_t& a_fun, long a_opaque,
         const char* a_pat_fmt, ...)
@@ -262,19 +313,28 @@ public:
         BOOST_ASSERT(m_fun != NULL);
         va_list ap;
         va_start(ap, a_pat_fmt);
-        try         { m_pattern = eterm<Alloc>::format(a_alloc, &a_pat_fmt, &ap); }
+        try {
+            m_pattern = eterm<Alloc>::format(a_alloc, &a_pat_fmt, &ap);
+            while (isspace(*a_pat_fmt)) ++a_pat_fmt;
+            if (strncmp(a_pat_fmt, "when", 4) == 0 && !isalnum(a_pat_fmt[4])) {
+                a_pat_fmt += 4;
+                m_guard = eterm_guard<Alloc>(a_alloc, &a_pat_fmt, &ap);
+            }
+        }
         catch (...) { va_end(ap); throw; }
         va_end(ap);
     }
 
     eterm_pattern_action(const eterm_pattern_action& a_rhs)
         : m_pattern(a_rhs.m_pattern)
+        , m_guard(a_rhs.m_guard)
         , m_fun(a_rhs.m_fun)
         , m_opaque(a_rhs.m_opaque)
     {}
 
     eterm_pattern_action(eterm_pattern_action&& a_rhs)
         : m_pattern(std::move(a_rhs.m_pattern))
+        , m_guard(std::move(a_rhs.m_guard))
         , m_fun(std::move(a_rhs.m_fun))
         , m_opaque(a_rhs.m_opaque)
     {}
@@ -282,6 +342,7 @@ public:
     void operator=(eterm_pattern_action&& a_rhs)
     {
         m_pattern = std::move(a_rhs.m_pattern);
+        m_guard   = std::move(a_rhs.m_guard);
         m_fun     = std::move(a_rhs.m_fun);
         m_opaque  = a_rhs.m_opaque;
     }
@@ -289,6 +350,7 @@ public:
     void operator=(const eterm_pattern_action& a_rhs)
     {
         m_pattern = a_rhs.m_pattern;
+        m_guard   = a_rhs.m_guard;
         m_fun     = a_rhs.m_fun;
         m_opaque  = a_rhs.m_opaque;
     }
@@ -299,12 +361,14 @@ public:
         varbind<Alloc> binding;
         if (a_binding)
             binding.merge(*a_binding);
-        if (m_pattern.match(a_term, &binding))
+        // A failing guard falls through to the next pattern
+        if (m_pattern.match(a_term, &binding) && m_guard(binding))
             return m_fun(m_pattern, binding, m_opaque);
         return false;
     }
 
     const eterm<Alloc>& pattern()   const { return m_pattern; }
+    const eterm_guard<Alloc>& guard() const { return m_guard; }
     long opaque()                   const { return m_opaque; }
     void opaque(long a_opaque)            { m_opaque = a_opaque; }
 
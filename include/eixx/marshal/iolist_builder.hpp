@@ -0,0 +1,210 @@
+//----------------------------------------------------------------------------
+/// \file  iolist_builder.hpp
+//----------------------------------------------------------------------------
+/// \brief Accumulator of binary fragments encoded as a single binary.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_IOLIST_BUILDER_HPP_
+#define _IMPL_IOLIST_BUILDER_HPP_
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <boost/assert.hpp>
+#include <eixx/eterm_exception.hpp>
+#include <eixx/marshal/binary.hpp>
+#include <eixx/marshal/endian.hpp>
+#include <ei.h>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Builder of a binary out of many fragments.
+ *
+ * The builder records pointer/length segments without copying the data.
+ * Borrowed memory (raw pointers and string views) must outlive the builder,
+ * whereas appended binaries are retained by reference count. Small pieces
+ * such as headers can be copied into the builder's own scratch buffer.
+ * The fragments are copied exactly once: either when encoding the builder
+ * (or a binary detached from it) as a single BINARY_EXT into an output
+ * buffer, or when producing a binary with one allocation of the exact size.
+ *
+ * Example:
+ * <code>
+ *   iolist_builder<Alloc> io;
+ *   io.put_be<uint32_t>(hdr_len).append(hdr).append(payload_bin);
+ *   // The fragments are copied into the message buffer by the encoder
+ *   eterm<Alloc> msg(tuple<Alloc>::make(am_data, io.detach()));
+ * </code>
+ */
+template <typename Alloc>
+class iolist_builder {
+    struct segment {
+        const char* data;   // NULL if the data is in m_scratch at offset
+        size_t      offset;
+        size_t      size;
+    };
+
+    std::vector<segment>        m_segments;
+    std::vector<binary<Alloc>>  m_retained;
+    std::string                 m_scratch;
+    size_t                      m_size;
+    Alloc                       m_alloc;
+
+    const char* data(const segment& s) const {
+        return s.data ? s.data : m_scratch.data() + s.offset;
+    }
+
+    void copy_to(char* s) const {
+        for (auto& seg : m_segments) {
+            memcpy(s, data(seg), seg.size);
+            s += seg.size;
+        }
+    }
+
+public:
+    explicit iolist_builder(const Alloc& a_alloc = Alloc())
+        : m_size(0), m_alloc(a_alloc)
+    {}
+
+    /// Append a fragment of memory owned by the caller. The memory must
+    /// remain valid until the builder is encoded or cleared.
+    iolist_builder& append(const char* a_data, size_t a_size) {
+        if (a_size == 0)
+            return *this;
+        // Coalesce adjacent fragments of the same memory region
+        segment* last = m_segments.empty() ? nullptr : &m_segments.back();
+        if (last && last->data && last->data + last->size == a_data)
+            last->size += a_size;
+        else
+            m_segments.push_back(segment{a_data, 0, a_size});
+        m_size += a_size;
+        return *this;
+    }
+
+    /// Append a fragment of memory owned by the caller.
+    iolist_builder& append(std::string_view a_str) {
+        return append(a_str.data(), a_str.size());
+    }
+
+    /// Append a binary. The binary's data is retained until the builder
+    /// is destroyed or cleared.
+    iolist_builder& append(const binary<Alloc>& a_bin) {
+        return append(a_bin, 0, a_bin.size());
+    }
+
+    /// Append a slice of a binary. The binary's data is retained until
+    /// the builder is destroyed or cleared.
+    /// @throw err_bad_argument if the slice is out of the binary's bounds.
+    iolist_builder& append(const binary<Alloc>& a_bin, size_t a_offset, size_t a_size) {
+        if (a_offset > a_bin.size() || a_size > a_bin.size() - a_offset)
+            throw err_bad_argument("Binary slice out of bounds", a_offset + a_size);
+        if (a_size == 0)
+            return *this;
+        m_retained.push_back(a_bin);
+        return append(a_bin.data() + a_offset, a_size);
+    }
+
+    /// Copy a small fragment (e.g. a header) into the builder's own
+    /// storage, so the source doesn't need to outlive the builder.
+    iolist_builder& copy(const char* a_data, size_t a_size) {
+        if (a_size == 0)
+            return *this;
+        size_t offset = m_scratch.size();
+        m_scratch.append(a_data, a_size);
+        if (!m_segments.empty() && !m_segments.back().data)
+            m_segments.back().size += a_size;
+        else
+            m_segments.push_back(segment{nullptr, offset, a_size});
+        m_size += a_size;
+        return *this;
+    }
+
+    /// Copy an integer in big-endian byte order into the builder's storage.
+    template <typename T>
+    iolist_builder& put_be(T a_value) {
+        char buf[sizeof(T)];
+        store_be<T>(buf, a_value);
+        return copy(buf, sizeof(T));
+    }
+
+    /// Total number of bytes accumulated.
+    size_t size()     const { return m_size; }
+    /// Number of non-contiguous fragments.
+    size_t segments() const { return m_segments.size(); }
+    bool   empty()    const { return m_size == 0; }
+
+    /// Remove all fragments and release retained binaries.
+    void clear() {
+        m_segments.clear();
+        m_retained.clear();
+        m_scratch.clear();
+        m_size = 0;
+    }
+
+    /// Produce a binary with a single allocation of the exact size.
+    binary<Alloc> to_binary() const {
+        binary<Alloc> bin(m_size, m_alloc);
+        if (m_size)
+            copy_to(bin.mutate());
+        return bin;
+    }
+
+    /**
+     * Move the fragments into a deferred binary without copying them and
+     * leave the builder empty.  The binary can be included in other terms,
+     * and encoding it copies the fragments straight into the output buffer.
+     * Borrowed memory must remain valid while the binary is referenced.
+     */
+    binary<Alloc> detach() {
+        if (m_size == 0)
+            return binary<Alloc>();
+        size_t size = m_size;
+        auto   p    = std::make_shared<iolist_builder>(std::move(*this));
+        clear();
+        return binary<Alloc>(size, [p](char* dst) { p->copy_to(dst); }, p->m_alloc);
+    }
+
+    /** Size of buffer needed to hold the encoded BINARY_EXT. */
+    size_t encode_size() const { return 5 + m_size; }
+
+    /** Encode accumulated fragments as a single BINARY_EXT. */
+    void encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t size) const {
+        if (m_size > UINT32_MAX)
+            throw err_encode_exception("BINARY_EXT length exceeds maximum");
+        char* s = buf + idx;
+        put8(s, ERL_BINARY_EXT);
+        put32be(s, (uint32_t)m_size);
+        copy_to(s);
+        idx += 5 + m_size;
+        BOOST_ASSERT((size_t)idx <= size);
+    }
+};
+
+} // namespace marshal
+} // namespace eixx
+
+#endif // _IMPL_IOLIST_BUILDER_HPP_
@@ -0,0 +1,141 @@
+//----------------------------------------------------------------------------
+/// \file  json.hpp
+//----------------------------------------------------------------------------
+/// \brief Streaming conversion between JSON text and Erlang external term format.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_JSON_HPP_
+#define _IMPL_JSON_HPP_
+
+#include <string>
+#include <eixx/eterm_exception.hpp>
+#include <eixx/marshal/eterm.hpp>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Rules of mapping between JSON values and Erlang terms:
+ * <pre>
+ *   JSON                 Erlang
+ *   object               map, or [{Key, Value}] list ([{}] if empty)
+ *   array                list
+ *   string               binary, or an existing atom
+ *   integer              integer (bignum if it doesn't fit in 64 bits)
+ *   fraction/exponent    float
+ *   true, false, null    true, false, null atoms
+ * </pre>
+ * Converting terms to JSON also accepts tuples (as arrays), other atoms
+ * (as strings), and integer, float or character list map keys (as
+ * strings holding the number or the characters).  Lists of small
+ * integers are arrays unless json_options::charlists_as_strings is set.
+ * Strings are expected to be UTF-8 and are not validated.  Duplicate keys
+ * of a JSON object are a parse error when objects are converted to maps,
+ * and are kept in order in property lists.
+ */
+struct json_options {
+    enum object_type { MAP, PROPLIST };
+    /// EXISTING_ATOM converts a string to an atom if such an atom already
+    /// exists, and to a binary otherwise, so that untrusted input can't
+    /// exhaust the atom table.
+    enum string_type { BINARY, EXISTING_ATOM };
+    /// FLOAT converts all numbers to floats.
+    enum number_type { AUTO, FLOAT };
+
+    object_type objects   = MAP;
+    string_type keys      = BINARY;     ///< Conversion of object keys
+    string_type strings   = BINARY;     ///< Conversion of other strings
+    number_type numbers   = AUTO;
+    int         max_depth = 512;        ///< Maximum nesting of arrays and objects
+    /// Write character lists encoded as STRING_EXT as Latin-1 strings
+    /// rather than arrays of integers.
+    bool        charlists_as_strings = false;
+};
+
+/**
+ * Transcode JSON text to Erlang external term format in a single pass,
+ * without building intermediate terms.  The result is appended to \a a_out.
+ * Only the bodies of strings are scanned with SSE2; there is no SIMD
+ * structural index or number parsing, and test-perf measures 0.3-0.7 GB/s
+ * on a single core VM, short of the 1 GB/s target.
+ * @param a_with_version if true, the term is preceded by the version byte.
+ * @throw err_parse_exception if the text is not a valid JSON value.
+ */
+inline void json_to_etf(const char* a_json, size_t a_size, std::string& a_out,
+                        const json_options& a_opts = json_options(), bool a_with_version = true);
+
+/**
+ * Transcode a term in Erlang external term format, optionally preceded
+ * by the version byte, at offset \a a_idx of \a a_buf to JSON text
+ * appended to \a a_out.  On return \a a_idx points past the term.
+ * @throw err_decode_exception if the term is malformed or can't be
+ *        represented in JSON (e.g. pids, references, funs or bitstrings).
+ */
+inline void etf_to_json(const char* a_buf, uintptr_t& a_idx, size_t a_size, std::string& a_out,
+                        const json_options& a_opts = json_options());
+
+/// Transcode a buffer holding a single term in external term format to JSON.
+inline void etf_to_json(const char* a_buf, size_t a_size, std::string& a_out,
+                        const json_options& a_opts = json_options())
+{
+    uintptr_t idx = 0;
+    etf_to_json(a_buf, idx, a_size, a_out, a_opts);
+    if (idx != a_size)
+        throw err_decode_exception("Unexpected data after term", idx);
+}
+
+/**
+ * Convert JSON text to a term.
+ * @throw err_parse_exception if the text is not a valid JSON value.
+ */
+template <class Alloc>
+eterm<Alloc> json_to_eterm(const char* a_json, size_t a_size,
+                           const json_options& a_opts = json_options(),
+                           const Alloc& a_alloc = Alloc())
+{
+    std::string buf;
+    json_to_etf(a_json, a_size, buf, a_opts);
+    return eterm<Alloc>(buf.data(), buf.size(), a_alloc);
+}
+
+/**
+ * Convert a term to JSON text.
+ * @throw err_decode_exception if the term can't be represented in JSON.
+ * @throw err_encode_exception if the term holds unbound variables.
+ */
+template <class Alloc>
+std::string eterm_to_json(const eterm<Alloc>& a_term, const json_options& a_opts = json_options())
+{
+    string<Alloc> buf = a_term.encode(0, false);
+    std::string   out;
+    etf_to_json(buf.c_str(), buf.size(), out, a_opts);
+    return out;
+}
+
+} // namespace marshal
+} // namespace eixx
+
+#include <eixx/marshal/json.hxx>
+
+#endif // _IMPL_JSON_HPP_
@@ -0,0 +1,865 @@
+//----------------------------------------------------------------------------
+/// \file  json.hxx
+//----------------------------------------------------------------------------
+/// \brief Implementation of the JSON transcoders.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string.h>
+#include <vector>
+#include <ei.h>
+#include <eixx/marshal/endian.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace eixx {
+namespace marshal {
+
+namespace detail {
+
+    static const uint8_t s_etf_version = 131;   // ERL_VERSION_MAGIC
+
+    /// Output written past the end of a string, which is grown as needed.
+    class json_buffer {
+        std::string& m_str;
+        size_t       m_start;
+        size_t       m_pos;
+        bool         m_done;
+    public:
+        json_buffer(std::string& a_str, size_t a_hint)
+            : m_str(a_str), m_start(a_str.size()), m_pos(m_start), m_done(false)
+        {
+            m_str.resize(m_pos + a_hint + 64);
+        }
+
+        /// Drop the output unless finish() was called.
+        ~json_buffer() { m_str.resize(m_done ? m_pos : m_start); }
+
+        void finish() { m_done = true; }
+
+        /// Make room for \a n bytes and return the pointer to write them to,
+        /// which is valid till the next call.
+        char* reserve(size_t n) {
+            if (m_pos + n > m_str.size())
+                m_str.resize(std::max(m_str.size() * 2, m_pos + n));
+            return &m_str[m_pos];
+        }
+
+        void   advance(size_t n)                 { m_pos += n; }
+        void   put(char c)                       { *reserve(1) = c; ++m_pos; }
+        void   write(const char* a_data, size_t n) {
+            memcpy(reserve(n), a_data, n);
+            m_pos += n;
+        }
+        size_t pos()     const                   { return m_pos; }
+        void   pos(size_t n)                     { m_pos = n; }
+        char*  at(size_t n)                      { return &m_str[n]; }
+    };
+
+#ifdef __SSE2__
+    /// Bit mask of quotes, backslashes and control characters among 16 bytes.
+    inline int json_special(__m128i v) {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i slash = _mm_set1_epi8('\\');
+        const __m128i ctrl  = _mm_set1_epi8(0x1F);
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+        return _mm_movemask_epi8(m);
+    }
+#endif
+
+    /// Copy bytes from \a a_p to \a a_out up to a quote, a backslash, a
+    /// control character or \a a_end, returning the pointer to that byte.
+    /// Bytes up to \a a_limit (>= \a a_end) may be read.
+    inline const char* json_copy_plain(const char* a_p, const char* a_end,
+                                       const char* a_limit, json_buffer& a_out) {
+#ifdef __SSE2__
+        // Store 16 bytes at a time and keep those preceding a special byte
+        while (a_limit - a_p >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_p));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(a_out.reserve(16)), v);
+            int mask = json_special(v);
+            if (a_end - a_p < 16)
+                mask |= 1 << (a_end - a_p);
+            if (mask) {
+                int n = __builtin_ctz(unsigned(mask));
+                a_out.advance(size_t(n));
+                return a_p + n;
+            }
+            a_out.advance(16);
+            a_p += 16;
+        }
+#else
+        (void)a_limit;
+#endif
+        const char* p = a_p;
+        while (p < a_end && uint8_t(*p) >= 0x20 && *p != '"' && *p != '\\')
+            ++p;
+        a_out.write(a_p, size_t(p - a_p));
+        return p;
+    }
+
+    /// JSON text to external term format transcoder.
+    class json_reader {
+        const char*         m_begin;
+        const char*         m_p;
+        const char*         m_end;
+        const json_options& m_opts;
+        json_buffer&        m_out;
+        // Offsets and sizes of the encoded keys of the objects being parsed
+        std::vector<std::pair<size_t, size_t>> m_keys;
+
+        [[noreturn]] void error(const char* a_msg, const char* a_pos) const {
+            size_t      line = 1;
+            const char* bol  = m_begin;
+            for (const char* p = m_begin; p < a_pos; ++p)
+                if (*p == '\n') { ++line; bol = p + 1; }
+            throw err_parse_exception(a_msg, line, size_t(a_pos - bol) + 1);
+        }
+
+        void skip_ws() {
+            while (m_p < m_end && uint8_t(*m_p) <= ' ' &&
+                   (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t'))
+                ++m_p;
+        }
+
+        /// Consume the character \a c following optional whitespace.
+        bool next(char c) {
+            skip_ws();
+            if (m_p == m_end || *m_p != c)
+                return false;
+            ++m_p;
+            return true;
+        }
+
+        void value(int a_depth);
+        void array(int a_depth);
+        void object(int a_depth);
+        void check_keys(size_t a_first, const char* a_obj);
+        void string(json_options::string_type a_type);
+        void literal(const char* a_word, size_t a_len);
+        void number();
+        void bignum(const char* a_digits, size_t a_len, bool a_neg);
+        void unicode();
+
+    public:
+        json_reader(const char* a_json, size_t a_size, const json_options& a_opts,
+                    json_buffer& a_out)
+            : m_begin(a_json), m_p(a_json), m_end(a_json + a_size)
+            , m_opts(a_opts), m_out(a_out)
+        {}
+
+        void parse() {
+            value(0);
+            skip_ws();
+            if (m_p != m_end)
+                error("Unexpected data after JSON value", m_p);
+        }
+    };
+
+    inline void json_reader::value(int a_depth)
+    {
+        skip_ws();
+        if (m_p == m_end)
+            error("Unexpected end of JSON input", m_p);
+        switch (*m_p) {
+            case '{': object(a_depth);        break;
+            case '[': array(a_depth);         break;
+            case '"': ++m_p; string(m_opts.strings); break;
+            case 't': literal("true",  4);    break;
+            case 'f': literal("false", 5);    break;
+            case 'n': literal("null",  4);    break;
+            default:  number();               break;
+        }
+    }
+
+    inline void json_reader::literal(const char* a_word, size_t a_len)
+    {
+        if (size_t(m_end - m_p) < a_len || memcmp(m_p, a_word, a_len) != 0)
+            error("Invalid JSON value", m_p);
+        m_p += a_len;
+        char* s = m_out.reserve(a_len + 2);
+        put8(s, ERL_SMALL_ATOM_UTF8_EXT);
+        put8(s, uint8_t(a_len));
+        memcpy(s, a_word, a_len);
+        m_out.advance(a_len + 2);
+    }
+
+    inline void json_reader::array(int a_depth)
+    {
+        if (a_depth >= m_opts.max_depth)
+            error("JSON value is nested too deep", m_p);
+        ++m_p;
+        if (next(']')) {
+            m_out.put(ERL_NIL_EXT);
+            return;
+        }
+        size_t   hdr = m_out.pos();
+        uint32_t n   = 0;
+        m_out.put(ERL_LIST_EXT);
+        m_out.advance(4);
+        do {
+            value(a_depth + 1);
+            ++n;
+        } while (next(','));
+        if (!next(']'))
+            error("Expected ',' or ']'", m_p);
+        m_out.put(ERL_NIL_EXT);
+        char* s = m_out.at(hdr + 1);
+        put32be(s, n);
+    }
+
+    inline void json_reader::object(int a_depth)
+    {
+        if (a_depth >= m_opts.max_depth)
+            error("JSON value is nested too deep", m_p);
+        const char* obj = m_p++;
+
+        bool     map = m_opts.objects == json_options::MAP;
+        size_t   first_key = m_keys.size();
+        size_t   hdr = m_out.pos();
+        uint32_t n   = 0;
+        m_out.put(map ? ERL_MAP_EXT : ERL_LIST_EXT);
+        m_out.advance(4);
+
+        if (next('}')) {
+            // An empty property list is [{}]
+            if (!map) {
+                n = 1;
+                m_out.put(ERL_SMALL_TUPLE_EXT);
+                m_out.put(0);
+                m_out.put(ERL_NIL_EXT);
+            }
+        } else {
+            do {
+                if (!next('"'))
+                    error("Expected object key", m_p);
+                if (!map) {
+                    m_out.put(ERL_SMALL_TUPLE_EXT);
+                    m_out.put(2);
+                }
+                size_t key = m_out.pos();
+                string(m_opts.keys);
+                if (map)
+                    m_keys.emplace_back(key, m_out.pos() - key);
+                if (!next(':'))
+                    error("Expected ':'", m_p);
+                value(a_depth + 1);
+                ++n;
+            } while (next(','));
+            if (!next('}'))
+                error("Expected ',' or '}'", m_p);
+            if (!map)
+                m_out.put(ERL_NIL_EXT);
+            else if (n > 1)
+                check_keys(first_key, obj);
+            m_keys.resize(first_key);
+        }
+
+        char* s = m_out.at(hdr + 1);
+        put32be(s, n);
+    }
+
+    inline void json_reader::check_keys(size_t a_first, const char* a_obj)
+    {
+        auto less = [this](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+            return a.second != b.second ? a.second < b.second
+                 : memcmp(m_out.at(a.first), m_out.at(b.first), a.second) < 0;
+        };
+        auto equal = [this](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+            return a.second == b.second && !memcmp(m_out.at(a.first), m_out.at(b.first), a.second);
+        };
+        auto begin = m_keys.begin() + ptrdiff_t(a_first);
+        std::sort(begin, m_keys.end(), less);
+        if (std::adjacent_find(begin, m_keys.end(), equal) != m_keys.end())
+            error("Duplicate object key", a_obj);
+    }
+
+    inline void json_reader::string(json_options::string_type a_type)
+    {
+        // Unescape the string right after a BINARY_EXT header
+        const char* start = m_p - 1;
+        size_t      hdr   = m_out.pos();
+        m_out.advance(5);
+
+        while (true) {
+            m_p = json_copy_plain(m_p, m_end, m_end, m_out);
+            if (m_p == m_end)
+                error("Unterminated string", start);
+            char c = *m_p++;
+            if (c == '"')
+                break;
+            if (c != '\\')
+                error("Control character in string", m_p - 1);
+            if (m_p == m_end)
+                error("Unterminated string", start);
+            switch (*m_p++) {
+                case '"':  m_out.put('"');  break;
+                case '\\': m_out.put('\\'); break;
+                case '/':  m_out.put('/');  break;
+                case 'b':  m_out.put('\b'); break;
+                case 'f':  m_out.put('\f'); break;
+                case 'n':  m_out.put('\n'); break;
+                case 'r':  m_out.put('\r'); break;
+                case 't':  m_out.put('\t'); break;
+                case 'u':  unicode();       break;
+                default:   error("Invalid escape sequence in string", m_p - 2);
+            }
+        }
+
+        size_t len = m_out.pos() - hdr - 5;
+        if (len > UINT32_MAX)
+            error("String is too long", start);
+        char* s = m_out.at(hdr);
+        if (a_type == json_options::EXISTING_ATOM && len <= 0xFFFF &&
+            atom::atom_table().try_lookup(s + 5, len) > 0)
+        {
+            // Replace the binary header with a shorter atom header
+            size_t sz = len > 0xFF ? 3 : 2;
+            if (sz == 3) { put8(s, ERL_ATOM_UTF8_EXT);       put16be(s, uint16_t(len)); }
+            else         { put8(s, ERL_SMALL_ATOM_UTF8_EXT); put8(s, uint8_t(len));     }
+            memmove(s, s + 5 - sz, len);
+            m_out.pos(hdr + sz + len);
+        } else {
+            put8(s, ERL_BINARY_EXT);
+            put32be(s, uint32_t(len));
+        }
+    }
+
+    inline void json_reader::unicode()
+    {
+        auto hex4 = [this](const char* p) {
+            if (m_end - p < 4)
+                error("Invalid unicode escape", p - 2);
+            uint32_t v = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = p[i];
+                int  d = c >= '0' && c <= '9' ? c - '0'
+                       : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10 : -1;
+                if (d < 0)
+                    error("Invalid unicode escape", p - 2);
+                v = v << 4 | uint32_t(d);
+            }
+            return v;
+        };
+
+        uint32_t cp = hex4(m_p);
+        m_p += 4;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            // A surrogate pair
+            if (m_end - m_p < 2 || m_p[0] != '\\' || m_p[1] != 'u')
+                error("Invalid unicode surrogate pair", m_p - 6);
+            uint32_t lo = hex4(m_p + 2);
+            if (lo < 0xDC00 || lo > 0xDFFF)
+                error("Invalid unicode surrogate pair", m_p - 6);
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            m_p += 6;
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF)
+            error("Invalid unicode surrogate pair", m_p - 6);
+
+        char* s = m_out.reserve(4);
+        size_t n;
+        if (cp < 0x80)         { s[0] = char(cp); n = 1; }
+        else if (cp < 0x800)   { s[0] = char(0xC0 | cp >> 6);  s[1] = char(0x80 | (cp & 0x3F)); n = 2; }
+        else if (cp < 0x10000) { s[0] = char(0xE0 | cp >> 12); s[1] = char(0x80 | (cp >> 6 & 0x3F));
+                                 s[2] = char(0x80 | (cp & 0x3F)); n = 3; }
+        else                   { s[0] = char(0xF0 | cp >> 18); s[1] = char(0x80 | (cp >> 12 & 0x3F));
+                                 s[2] = char(0x80 | (cp >> 6 & 0x3F)); s[3] = char(0x80 | (cp & 0x3F)); n = 4; }
+        m_out.advance(n);
+    }
+
+    inline void json_reader::number()
+    {
+        auto digit = [this]() { return m_p < m_end && *m_p >= '0' && *m_p <= '9'; };
+
+        const char* start = m_p;
+        bool        neg   = *m_p == '-';
+        if (neg)
+            ++m_p;
+        if (!digit())
+            error("Invalid JSON value", start);
+
+        const char* digits = m_p;
+        uint64_t    u      = 0;
+        if (*m_p == '0') {
+            ++m_p;
+            if (digit())
+                error("Leading zeros in number", start);
+        } else
+            for (; digit() && m_p - digits < 19; ++m_p)
+                u = u * 10 + uint64_t(*m_p - '0');
+        while (digit())
+            ++m_p;
+        size_t nd = m_p - digits;
+
+        bool fp = false;
+        if (m_p < m_end && *m_p == '.') {
+            ++m_p;
+            if (!digit())
+                error("Invalid number", start);
+            while (digit()) ++m_p;
+            fp = true;
+        }
+        if (m_p < m_end && (*m_p | 0x20) == 'e') {
+            ++m_p;
+            if (m_p < m_end && (*m_p == '+' || *m_p == '-'))
+                ++m_p;
+            if (!digit())
+                error("Invalid number", start);
+            while (digit()) ++m_p;
+            fp = true;
+        }
+
+        if (fp || m_opts.numbers == json_options::FLOAT) {
+            double d;
+            auto   r = std::from_chars(start, m_p, d);
+            if (r.ec != std::errc() || !std::isfinite(d))
+                error("Number is out of range", start);
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            char* s = m_out.reserve(9);
+            put8(s, NEW_FLOAT_EXT);
+            put64be(s, bits);
+            m_out.advance(9);
+            return;
+        }
+
+        if (nd > 19)
+            return bignum(digits, nd, neg);
+
+        char* s = m_out.reserve(11);
+        char* p = s;
+        if (!neg && u <= 0xFF) {
+            put8(p, ERL_SMALL_INTEGER_EXT);
+            put8(p, uint8_t(u));
+        } else if (u <= (neg ? uint64_t(1) << 31 : INT32_MAX)) {
+            put8(p, ERL_INTEGER_EXT);
+            put32be(p, uint32_t(neg ? 0 - u : u));
+        } else {
+            put8(p, ERL_SMALL_BIG_EXT);
+            char* n = p++;
+            put8(p, neg);
+            for (; u; u >>= 8)
+                put8(p, uint8_t(u));
+            *n = char(p - n - 2);
+        }
+        m_out.advance(p - s);
+    }
+
+    inline void json_reader::bignum(const char* a_digits, size_t a_len, bool a_neg)
+    {
+        // Convert the decimal digits to 32-bit limbs, 9 digits at a time
+        std::vector<uint32_t> limbs;
+        for (size_t i = 0; i < a_len; ) {
+            size_t   k   = std::min<size_t>(9, a_len - i);
+            uint32_t mul = 1, add = 0;
+            for (size_t j = 0; j < k; ++j, ++i) {
+                mul *= 10;
+                add  = add * 10 + uint32_t(a_digits[i] - '0');
+            }
+            uint64_t carry = add;
+            for (auto& l : limbs) {
+                uint64_t t = uint64_t(l) * mul + carry;
+                l     = uint32_t(t);
+                carry = t >> 32;
+            }
+            if (carry)
+                limbs.push_back(uint32_t(carry));
+        }
+
+        size_t n = limbs.size() * 4;
+        while (n && !uint8_t(limbs[(n-1) / 4] >> (8 * ((n-1) % 4))))
+            --n;
+        char* s = m_out.reserve(n + 6);
+        char* p = s;
+        if (n <= 0xFF) {
+            put8(p, ERL_SMALL_BIG_EXT);
+            put8(p, uint8_t(n));
+        } else {
+            put8(p, ERL_LARGE_BIG_EXT);
+            put32be(p, uint32_t(n));
+        }
+        put8(p, a_neg);
+        for (size_t i = 0; i < n; ++i)
+            put8(p, uint8_t(limbs[i / 4] >> (8 * (i % 4))));
+        m_out.advance(p - s);
+    }
+
+    /// External term format to JSON text transcoder.
+    class json_writer {
+        const char*         m_buf;
+        size_t              m_size;
+        const json_options& m_opts;
+        json_buffer&        m_out;
+
+        [[noreturn]] static void error(const char* a_msg, uintptr_t a_idx, long a_value = 0) {
+            throw err_decode_exception(a_msg, a_idx, a_value);
+        }
+
+        /// Pointer to \a n bytes at \a a_idx, which must be in the buffer.
+        const char* need(uintptr_t a_idx, size_t n) const {
+            if (a_idx > m_size || n > m_size - a_idx)
+                error("Truncated term", a_idx);
+            return m_buf + a_idx;
+        }
+
+        void string(const char* a_str, size_t a_len, bool a_latin1);
+        void escape(const char* a_str, size_t a_len, const char* a_limit);
+        void integer(uint64_t a_abs, bool a_neg, bool a_key);
+        void bignum(const char* a_le, size_t a_len, bool a_neg, bool a_key);
+        void real(double a_val, uintptr_t a_idx, bool a_key);
+        void pairs(uintptr_t& a_idx, uint32_t a_n, int a_depth);
+
+    public:
+        json_writer(const char* a_buf, size_t a_size, const json_options& a_opts,
+                    json_buffer& a_out)
+            : m_buf(a_buf), m_size(a_size), m_opts(a_opts), m_out(a_out)
+        {}
+
+        /// Write the term at \a a_idx, which is an object key if \a a_key is true.
+        void value(uintptr_t& a_idx, int a_depth, bool a_key = false);
+    };
+
+    inline void json_writer::escape(const char* a_str, size_t a_len, const char* a_limit)
+    {
+        static const char s_hex[] = "0123456789abcdef";
+        const char* p   = a_str;
+        const char* end = a_str + a_len;
+        m_out.put('"');
+        while ((p = json_copy_plain(p, end, a_limit, m_out)) != end) {
+            char  c = *p++;
+            char* s = m_out.reserve(6);
+            s[0] = '\\';
+            switch (c) {
+                case '"':  s[1] = '"';  break;
+                case '\\': s[1] = '\\'; break;
+                case '\b': s[1] = 'b';  break;
+                case '\f': s[1] = 'f';  break;
+                case '\n': s[1] = 'n';  break;
+                case '\r': s[1] = 'r';  break;
+                case '\t': s[1] = 't';  break;
+                default:
+                    memcpy(s + 1, "u00", 3);
+                    s[4] = s_hex[uint8_t(c) >> 4];
+                    s[5] = s_hex[uint8_t(c) & 0xF];
+                    m_out.advance(6);
+                    continue;
+            }
+            m_out.advance(2);
+        }
+        m_out.put('"');
+    }
+
+    inline void json_writer::string(const char* a_str, size_t a_len, bool a_latin1)
+    {
+        const char* p = a_str, *end = a_str + a_len;
+        if (!a_latin1)
+            return escape(a_str, a_len, m_buf + m_size);
+        while (p < end && uint8_t(*p) < 0x80)
+            ++p;
+        if (p == end)
+            return escape(a_str, a_len, m_buf + m_size);
+
+        // Convert Latin-1 characters to UTF-8
+        std::string s(a_str, p);
+        for (; p < end; ++p)
+            if (uint8_t(*p) < 0x80)
+                s += *p;
+            else {
+                s += char(0xC0 | uint8_t(*p) >> 6);
+                s += char(0x80 | (*p & 0x3F));
+            }
+        escape(s.data(), s.size(), s.data() + s.size());
+    }
+
+    inline void json_writer::integer(uint64_t a_abs, bool a_neg, bool a_key)
+    {
+        char* s = m_out.reserve(24);
+        char* p = s;
+        if (a_key) *p++ = '"';
+        if (a_neg && a_abs) *p++ = '-';
+        p = std::to_chars(p, s + 23, a_abs).ptr;
+        if (a_key) *p++ = '"';
+        m_out.advance(p - s);
+    }
+
+    inline void json_writer::bignum(const char* a_le, size_t a_len, bool a_neg, bool a_key)
+    {
+        while (a_len && !a_le[a_len-1])
+            --a_len;
+        if (a_len <= 8) {
+            uint64_t u = 0;
+            for (size_t i = a_len; i-- > 0; )
+                u = u << 8 | uint8_t(a_le[i]);
+            return integer(u, a_neg, a_key);
+        }
+
+        // Divide the 32-bit limbs by 10^9 to get the decimal digits
+        std::vector<uint32_t> limbs((a_len + 3) / 4);
+        for (size_t i = 0; i < a_len; ++i)
+            limbs[i / 4] |= uint32_t(uint8_t(a_le[i])) << (8 * (i % 4));
+        std::vector<uint32_t> chunks;
+        while (!limbs.empty()) {
+            uint64_t rem = 0;
+            for (size_t i = limbs.size(); i-- > 0; ) {
+                uint64_t t = rem << 32 | limbs[i];
+                limbs[i] = uint32_t(t / 1000000000);
+                rem      = t % 1000000000;
+            }
+            chunks.push_back(uint32_t(rem));
+            while (!limbs.empty() && !limbs.back())
+                limbs.pop_back();
+        }
+
+        char* s = m_out.reserve(chunks.size() * 9 + 4);
+        char* p = s;
+        if (a_key) *p++ = '"';
+        if (a_neg) *p++ = '-';
+        p = std::to_chars(p, p + 9, chunks.back()).ptr;
+        for (size_t i = chunks.size() - 1; i-- > 0; ) {
+            char d[9];
+            uint32_t c = chunks[i];
+            for (int j = 8; j >= 0; --j, c /= 10)
+                d[j] = char('0' + c % 10);
+            memcpy(p, d, 9);
+            p += 9;
+        }
+        if (a_key) *p++ = '"';
+        m_out.advance(p - s);
+    }
+
+    inline void json_writer::real(double a_val, uintptr_t a_idx, bool a_key)
+    {
+        if (!std::isfinite(a_val))
+            error("Non-finite float can't be represented in JSON", a_idx);
+        char* s = m_out.reserve(40);
+        char* p = s;
+        if (a_key) *p++ = '"';
+        char* b = p;
+        p = std::to_chars(p, s + 36, a_val).ptr;
+        // Keep the value a float when it's converted back
+        if (!memchr(b, '.', p - b) && !memchr(b, 'e', p - b)) {
+            *p++ = '.';
+            *p++ = '0';
+        }
+        if (a_key) *p++ = '"';
+        m_out.advance(p - s);
+    }
+
+    inline void json_writer::pairs(uintptr_t& a_idx, uint32_t a_n, int a_depth)
+    {
+        // [{Key, Value}] property list
+        m_out.put('{');
+        for (uint32_t i = 0; i < a_n; ++i) {
+            const char* s = need(a_idx, 2);
+            if (uint8_t(s[0]) != ERL_SMALL_TUPLE_EXT || s[1] != 2)
+                error("Expected {Key, Value} in property list", a_idx);
+            a_idx += 2;
+            if (i) m_out.put(',');
+            value(a_idx, a_depth + 1, true);
+            m_out.put(':');
+            value(a_idx, a_depth + 1);
+        }
+        m_out.put('}');
+    }
+
+    inline void json_writer::value(uintptr_t& a_idx, int a_depth, bool a_key)
+    {
+        uintptr_t   start = a_idx;
+        const char* s     = need(a_idx, 1);
+        uint8_t     tag   = uint8_t(*s);
+        ++a_idx;
+
+        switch (tag) {
+            case ERL_SMALL_INTEGER_EXT:
+                integer(uint8_t(*need(a_idx, 1)), false, a_key);
+                a_idx += 1;
+                return;
+            case ERL_INTEGER_EXT: {
+                s = need(a_idx, 4);
+                int32_t i = int32_t(get32be(s));
+                integer(i < 0 ? 0 - uint64_t(int64_t(i)) : uint64_t(i), i < 0, a_key);
+                a_idx += 4;
+                return;
+            }
+            case ERL_SMALL_BIG_EXT:
+            case ERL_LARGE_BIG_EXT: {
+                size_t n = tag == ERL_SMALL_BIG_EXT ? get8(s = need(a_idx, 1)) : get32be(s = need(a_idx, 4));
+                a_idx += tag == ERL_SMALL_BIG_EXT ? 1 : 4;
+                s = need(a_idx, n + 1);
+                bignum(s + 1, n, *s != 0, a_key);
+                a_idx += n + 1;
+                return;
+            }
+            case NEW_FLOAT_EXT: {
+                s = need(a_idx, 8);
+                uint64_t bits = get64be(s);
+                double   d;
+                memcpy(&d, &bits, sizeof(d));
+                real(d, start, a_key);
+                a_idx += 8;
+                return;
+            }
+            case ERL_FLOAT_EXT: {
+                char buf[32] = {0};
+                memcpy(buf, need(a_idx, 31), 31);
+                real(strtod(buf, nullptr), start, a_key);
+                a_idx += 31;
+                return;
+            }
+            case ERL_ATOM_EXT:
+            case ERL_SMALL_ATOM_EXT:
+            case ERL_ATOM_UTF8_EXT:
+            case ERL_SMALL_ATOM_UTF8_EXT: {
+                bool   small = tag == ERL_SMALL_ATOM_EXT || tag == ERL_SMALL_ATOM_UTF8_EXT;
+                size_t n     = small ? get8(s = need(a_idx, 1)) : get16be(s = need(a_idx, 2));
+                a_idx += small ? 1 : 2;
+                s = need(a_idx, n);
+                a_idx += n;
+                if (!a_key && ((n == 4 && (!memcmp(s, "true", 4) || !memcmp(s, "null", 4))) ||
+                               (n == 5 && !memcmp(s, "false", 5))))
+                    m_out.write(s, n);
+                else
+                    string(s, n, tag == ERL_ATOM_EXT || tag == ERL_SMALL_ATOM_EXT);
+                return;
+            }
+            case ERL_BINARY_EXT: {
+                size_t n = get32be(s = need(a_idx, 4));
+                a_idx += 4;
+                string(need(a_idx, n), n, false);
+                a_idx += n;
+                return;
+            }
+            case ERL_STRING_EXT: {
+                size_t n = get16be(s = need(a_idx, 2));
+                a_idx += 2;
+                s = need(a_idx, n);
+                a_idx += n;
+                if (a_key || m_opts.charlists_as_strings)
+                    string(s, n, true);
+                else {
+                    // A list of small integers, which is not necessarily text
+                    m_out.put('[');
+                    for (size_t i = 0; i < n; ++i) {
+                        if (i) m_out.put(',');
+                        integer(uint8_t(s[i]), false, false);
+                    }
+                    m_out.put(']');
+                }
+                return;
+            }
+            default:
+                break;
+        }
+
+        if (a_key)
+            error("Invalid JSON object key", start, tag);
+        if (a_depth >= m_opts.max_depth)
+            error("Term is nested too deep", start);
+
+        switch (tag) {
+            case ERL_NIL_EXT:
+                m_out.write("[]", 2);
+                return;
+            case ERL_LIST_EXT: {
+                uint32_t n = get32be(s = need(a_idx, 4));
+                a_idx += 4;
+                s = need(a_idx, 2);
+                if (m_opts.objects == json_options::PROPLIST && uint8_t(s[0]) == ERL_SMALL_TUPLE_EXT) {
+                    if (s[1] == 0 && n == 1) {
+                        m_out.write("{}", 2);
+                        a_idx += 2;
+                    } else
+                        pairs(a_idx, n, a_depth);
+                } else {
+                    m_out.put('[');
+                    for (uint32_t i = 0; i < n; ++i) {
+                        if (i) m_out.put(',');
+                        value(a_idx, a_depth + 1);
+                    }
+                    m_out.put(']');
+                }
+                if (uint8_t(*need(a_idx, 1)) != ERL_NIL_EXT)
+                    error("Improper list can't be represented in JSON", a_idx);
+                a_idx += 1;
+                return;
+            }
+            case ERL_SMALL_TUPLE_EXT:
+            case ERL_LARGE_TUPLE_EXT: {
+                uint32_t n = tag == ERL_SMALL_TUPLE_EXT ? get8(s = need(a_idx, 1)) : get32be(s = need(a_idx, 4));
+                a_idx += tag == ERL_SMALL_TUPLE_EXT ? 1 : 4;
+                m_out.put('[');
+                for (uint32_t i = 0; i < n; ++i) {
+                    if (i) m_out.put(',');
+                    value(a_idx, a_depth + 1);
+                }
+                m_out.put(']');
+                return;
+            }
+            case ERL_MAP_EXT: {
+                uint32_t n = get32be(s = need(a_idx, 4));
+                a_idx += 4;
+                m_out.put('{');
+                for (uint32_t i = 0; i < n; ++i) {
+                    if (i) m_out.put(',');
+                    value(a_idx, a_depth + 1, true);
+                    m_out.put(':');
+                    value(a_idx, a_depth + 1);
+                }
+                m_out.put('}');
+                return;
+            }
+            default:
+                error("Term can't be represented in JSON", start, tag);
+        }
+    }
+
+} // namespace detail
+
+inline void json_to_etf(const char* a_json, size_t a_size, std::string& a_out,
+                        const json_options& a_opts, bool a_with_version)
+{
+    detail::json_buffer out(a_out, a_size);
+    if (a_with_version)
+        out.put(char(detail::s_etf_version));
+    detail::json_reader(a_json, a_size, a_opts, out).parse();
+    out.finish();
+}
+
+inline void etf_to_json(const char* a_buf, uintptr_t& a_idx, size_t a_size, std::string& a_out,
+                        const json_options& a_opts)
+{
+    if (a_idx < a_size && uint8_t(a_buf[a_idx]) == detail::s_etf_version)
+        ++a_idx;
+    detail::json_buffer out(a_out, a_size - std::min<size_t>(a_idx, a_size));
+    detail::json_writer(a_buf, a_size, a_opts, out).value(a_idx, 0);
+    out.finish();
+}
+
+} // namespace marshal
+} // namespace eixx
@@ -32,6 +32,7 @@ limitations under the License.
 #include <boost/static_assert.hpp>
 #include <eixx/marshal/defaults.hpp>
 #include <eixx/marshal/visit_encode_size.hpp>
+#include <eixx/marshal/detail/array_variadic_init.hpp>
 #include <initializer_list>
 
 namespace eixx {
@@ -117,6 +118,15 @@ private:
 
     // For use only from constructors.
     void init(const eterm<Alloc> items[], size_t a_size, const Alloc& alloc);
+
+    /// Append a new cons cell to the list and return it. The node of
+    /// the returned cell is uninitialized.
+    cons_t* append_cons();
+
+    template <typename Tuple, size_t... I>
+    void push_back_all(Tuple&& a_args, std::index_sequence<I...>) {
+        (push_back(eterm<Alloc>(std::get<I>(std::move(a_args)))), ...);
+    }
 public:
     class iterator;
     typedef const iterator const_iterator;
@@ -180,6 +190,14 @@ public:
      */
     explicit list(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
 
+    /**
+     * Decode the list from a binary buffer reusing this list's storage
+     * and the storage of its elements where possible. Nothing is decoded
+     * if the storage is shared or too small for the new list.
+     * @return true if the list was decoded.
+     */
+    bool decode_into(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc);
+
     ~list() { release(); }
 
     /**
@@ -188,6 +206,9 @@ public:
      */
     void push_back(const eterm<Alloc>& a);
 
+    /// Add a term to list taking over its storage.
+    void push_back(eterm<Alloc>&& a);
+
     template <typename G>
     void push_back(const G& a) {
         eterm<Alloc> t(a);
@@ -203,10 +224,24 @@ public:
         header()->initialized = true;
     }
 
+    /**
+     * Prepare the list for modification of its elements. If the list's
+     * storage is shared with other terms, the list is copied (elements
+     * are shared with the original), otherwise it's modified in place.
+     */
+    list<Alloc>& mutate() {
+        if (m_blob && m_blob != empty_list() && !m_blob->unique()) {
+            list<Alloc> l(head(), int(length()), this->get_allocator());
+            std::swap(m_blob, l.m_blob);
+        }
+        return *this;
+    }
+
     /// Return list length. This method has O(1) complexity.
     size_t  length()        const { return  m_blob ?  header()->size :  0; }
     bool    empty()         const { return !m_blob || header()->size == 0; }
     bool    initialized()   const { return  m_blob && header()->initialized; }
+    int     use_count()     const { return  m_blob ? m_blob->use_count() : -1000000; }
 
     /// Return pointer to the N'th element in the list. This method has
     /// O(N) complexity.
@@ -270,91 +305,21 @@ public:
 
     std::ostream& dump(std::ostream& out, const varbind<Alloc>* vars = NULL) const;
 
-    static list<Alloc> make(const Alloc& a = Alloc()) {
-        return list<Alloc>(0, a);
-    }
-
-    template <class T1>
-    static list<Alloc> make(T1 t1, const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2>
-    static list<Alloc> make(T1 t1, T2 t2,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3>
-    static list<Alloc> make(T1 t1, T2 t2, T3 t3,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4>
-    static list<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5>
-    static list<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5, class T6>
-    static list<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, 
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5, class T6, class T7>
-    static list<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, T7 t7,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6),
-                             eterm<Alloc>::cast(t7) };
-        return list<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
-    static list<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, T7 t7, T8 t8,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6),
-                             eterm<Alloc>::cast(t7),
-                             eterm<Alloc>::cast(t8) };
-        return list<Alloc>(l, a);
+    /**
+     * Create a list from the given arguments. Each argument is forwarded
+     * directly into the list's storage, so temporary terms are moved
+     * without touching their reference counts. If the last argument is
+     * an allocator, it's used to allocate the list.
+     */
+    template <typename... Args>
+    static list<Alloc> make(Args&&... args) {
+        typedef detail::last_is_alloc<Alloc, Args...> has_alloc;
+        const size_t N = sizeof...(Args) - has_alloc::value;
+        auto l_args = std::forward_as_tuple(std::forward<Args>(args)...);
+        list<Alloc> l(int(N), detail::last_alloc<Alloc>(l_args, has_alloc()));
+        l.push_back_all(std::move(l_args), std::make_index_sequence<N>());
+        l.close();
+        return l;
     }
 };
 
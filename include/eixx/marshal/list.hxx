@@ -142,6 +142,44 @@ list<Alloc>::list(const char *buf, uintptr_t& idx, size_t size, const Alloc& a_a
     BOOST_ASSERT((size_t)idx <= size);
 }
 
+template <class Alloc>
+bool list<Alloc>::decode_into(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc)
+{
+    BOOST_ASSERT(idx <= INT_MAX);
+    if (!m_blob || m_blob == empty_list() || !m_blob->unique() || !initialized())
+        return false;
+    header_t* l_header = header();
+    // Cons cells allocated after construction are not reused
+    if (l_header->size > l_header->alloc_size)
+        return false;
+    int arity, i = (int)idx;
+    if (ei_decode_list_header(buf, &i, &arity) < 0)
+        throw err_decode_exception("Error decoding list header", idx);
+    if (arity == 0 || (unsigned int)arity > l_header->alloc_size)
+        return false;
+    idx = i;
+
+    cons_t*      hd = l_header->head;
+    unsigned int n  = l_header->size;
+    for (unsigned int j=arity; j < n; ++j)
+        hd[j].node.~eterm();
+    for (unsigned int j=n; j < (unsigned int)arity; ++j)
+        new (&hd[j].node) eterm<Alloc>();
+    for (int j=0; j < arity; ++j)
+        hd[j].next = hd+j+1;
+    l_header->size = arity;
+    l_header->tail = hd+arity-1;
+    l_header->tail->next = NULL;
+
+    for (int j=0; j < arity; ++j)
+        hd[j].node.decode_into(buf, idx, size, a_alloc);
+    if (*(buf+idx) != ERL_NIL_EXT)
+        throw err_decode_exception("Not a NIL list!", idx);
+    idx++;
+    BOOST_ASSERT((size_t)idx <= size);
+    return true;
+}
+
 template <class Alloc>
 void list<Alloc>::encode(char* buf, uintptr_t& idx, size_t size) const
 {
@@ -184,9 +222,8 @@ list<Alloc> list<Alloc>::tail(size_t idx) const
 }
 
 template <class Alloc>
-void list<Alloc>::push_back(const eterm<Alloc>& a)
+typename list<Alloc>::cons_t* list<Alloc>::append_cons()
 {
-    BOOST_ASSERT(a.initialized());
     if (unlikely(!m_blob)) {
         m_blob = new blob_t(sizeof(header_t) + sizeof(cons_t), this->get_allocator());
         header_t* hd = header();
@@ -195,20 +232,33 @@ void list<Alloc>::push_back(const eterm<Alloc>& a)
         hd->size = 1;
         hd->alloc_size = 1;
         cons_t* p = hd->tail;
-        new (&p->node) eterm<Alloc>(a);
         p->next = NULL;
-        return;
+        return p;
     }
     BOOST_ASSERT(!initialized());
     header_t* hd = header();
     bool has_space = hd->size < hd->alloc_size;
     cons_t* p = has_space ? &hd->head[hd->size] : this->get_t_allocator().allocate(1);
-    new (&p->node) eterm<Alloc>(a);
     p->next  = NULL;
     if (likely(hd->size > 0))
         hd->tail->next = p;
     hd->tail = p;
     hd->size++;
+    return p;
+}
+
+template <class Alloc>
+void list<Alloc>::push_back(const eterm<Alloc>& a)
+{
+    BOOST_ASSERT(a.initialized());
+    new (&append_cons()->node) eterm<Alloc>(a);
+}
+
+template <class Alloc>
+void list<Alloc>::push_back(eterm<Alloc>&& a)
+{
+    BOOST_ASSERT(a.initialized());
+    new (&append_cons()->node) eterm<Alloc>(std::move(a));
 }
 
 template <class Alloc>
@@ -43,11 +43,19 @@ namespace marshal {
 
 template <typename Alloc> class eterm;
 
+/// Order of map keys, in which an integer is less than a float of the same value.
+template <typename Alloc>
+struct map_key_less {
+    bool operator()(const eterm<Alloc>& a, const eterm<Alloc>& b) const {
+        return a.compare(b, true) < 0;
+    }
+};
+
 template <typename Alloc>
 class map {
 public:
     using MapAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const eterm<Alloc>, eterm<Alloc>>>;
-    using MapT     = std::map<eterm<Alloc>, eterm<Alloc>, std::less<eterm<Alloc>>, MapAlloc>;
+    using MapT     = std::map<eterm<Alloc>, eterm<Alloc>, map_key_less<Alloc>, MapAlloc>;
 protected:
     using BlobT    = blob<MapT, Alloc>;
 
@@ -67,6 +75,18 @@ protected:
         auto* m = m_blob->data();
         new  (m)  MapT();
     }
+
+    /// Make sure that the map's storage is not shared with other terms.
+    void detach() {
+        if (!m_blob)
+            initialize();
+        else if (!m_blob->unique()) {
+            auto p = new BlobT(1, m_blob->get_allocator());
+            new (p->data()) MapT(*m_blob->data());
+            release();
+            m_blob = p;
+        }
+    }
 public:
     using const_iterator = typename MapT::const_iterator;
     using iterator       = typename MapT::iterator;
@@ -139,14 +159,36 @@ public:
         return (it == m_blob->data()->end()) ? s_undefined : it->second;
     }
 
+    /// Get the value of the \a key (NULL if the map doesn't have it).
+    const eterm<Alloc>* find(const eterm<Alloc>& key) const {
+        if (!m_blob) return nullptr;
+        auto    it =  m_blob->data()->find(key);
+        return (it == m_blob->data()->end()) ? nullptr : &it->second;
+    }
+
+    /**
+     * Get mutable access to the underlying map. If the map's storage is
+     * shared with other terms, the map is copied (keys and values are
+     * shared with the original), otherwise it's modified in place.
+     */
+    MapT&       mutate() { detach(); return *m_blob->data(); }
+
     void        insert(const eterm<Alloc>& key, const eterm<Alloc>& val) {
-        if (!m_blob) initialize();
-        m_blob->data()->insert(std::make_pair(key, val));
+        mutate().insert(std::make_pair(key, val));
+    }
+
+    /// Insert the \a key or replace its value, copying the map first
+    /// if its storage is shared.
+    template <typename K, typename V>
+    map<Alloc>& insert_or_assign(K&& key, V&& val) {
+        mutate().insert_or_assign(eterm<Alloc>(std::forward<K>(key)), std::forward<V>(val));
+        return *this;
     }
 
     void        erase(const eterm<Alloc>& key) {
-        if (!m_blob) return;
-        m_blob->data()->erase(key);
+        if (!m_blob || m_blob->data()->find(key) == m_blob->data()->end())
+            return;
+        mutate().erase(key);
     }
 
     const_iterator begin()  const { return m_blob ? m_blob->data()->cbegin() : null().begin(); }
@@ -155,7 +197,7 @@ public:
     size_t      size()   const { return m_blob ? m_blob->data()->size() : 0; }
     bool        empty()  const { return !m_blob || m_blob->data()->empty();  }
 
-    void        clear()        { if (m_blob) m_blob->data().clear(); }
+    void        clear()        { if (!empty()) mutate().clear(); }
 
     // Use only for debugging
     int         use_count() const { return m_blob ? m_blob->use_count() : -1000000; }
@@ -171,26 +213,56 @@ public:
         return true;
     }
 
+    /// Compare maps by size, then by keys and then by values.
     bool operator<  (const map<Alloc>& rhs) const {
-        if (size() < rhs.size()) return true;
-        if (size() > rhs.size()) return false;
-        BOOST_ASSERT(size() == rhs.size());
-        auto it1  = begin();
-        auto it2  = rhs.begin();
-        auto end1 = end();
-        for (; it1 != end1; ++it1, ++it2) {
-            // 1. Is key1 < key2?
-            if (it1->first < it2->first)
-                return true;
-            if (it2->first < it1->first)
-                return false;
-            // 1. Is value1 < value2?
-            if (it1->second < it2->second)
-                return true;
-            if (it2->second < it1->second)
+        return eterm<Alloc>::compare(*this, rhs, false) < 0;
+    }
+
+    /**
+     * Match the map against a \a pattern.  As in Erlang, a map pattern is
+     * partial: each of its keys must be present in this map with a value
+     * matching the pattern's value, and other keys are ignored.  The keys
+     * are looked up in the map's order, so variables in the pattern's keys
+     * must be bound.
+     * @throw err_unbound_variable
+     */
+    bool match(const eterm<Alloc>& pattern, varbind<Alloc>* binding) const {
+        switch (pattern.type()) {
+            case VAR:   return pattern.match(eterm<Alloc>(*this), binding);
+            case MAP:   break;
+            default:    return false;
+        }
+        for (auto& kv : pattern.to_map()) {
+            eterm<Alloc> key;
+            const eterm<Alloc>* val = find(kv.first.subst(key, binding) ? key : kv.first);
+            if (!val || !val->match(kv.second, binding))
                 return false;
         }
-        return size() == 0;
+        return true;
+    }
+
+    /**
+     * Substitute bound variables in the keys and values of the map.
+     * @return true if any variable was substituted, in which case the
+     *         new map is stored in \a out.
+     * @throw err_unbound_variable
+     */
+    bool subst(eterm<Alloc>& out, const varbind<Alloc>* binding) const {
+        if (empty())
+            return false;
+        bool       changed = false;
+        map<Alloc> l_new(m_blob->get_allocator());
+        auto&      m = *l_new.m_blob->data();
+        for (auto& kv : *this) {
+            eterm<Alloc> key, val;
+            bool k = kv.first.subst(key, binding), v = kv.second.subst(val, binding);
+            changed = changed || k || v;
+            m.insert_or_assign(k ? key : kv.first, v ? val : kv.second);
+        }
+        if (!changed)
+            return false;
+        out = l_new;
+        return true;
     }
 
     /** Size of buffer needed to hold the encoded map. */
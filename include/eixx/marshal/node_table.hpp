@@ -0,0 +1,129 @@
+//----------------------------------------------------------------------------
+/// \file  node_table.hpp
+//----------------------------------------------------------------------------
+/// \brief A table of interned node identities (node name and creation)
+///        shared by pids, ports and refs.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _EIXX_NODE_TABLE_HPP_
+#define _EIXX_NODE_TABLE_HPP_
+
+#include <vector>
+#include <unordered_map>
+#include <boost/assert.hpp>
+#include <eixx/marshal/atom.hpp>
+#include <eixx/util/sync.hpp>
+
+namespace eixx {
+namespace marshal {
+
+    /// Non-garbage collected table of node identities. Every distinct pair
+    /// of node name and creation is assigned a 16-bit handle, so that pids,
+    /// ports and refs can carry their node as a small integer rather than
+    /// an atom plus a creation number.  Like the atom table, the instance
+    /// of this table is maintained statically and its content is never
+    /// cleared.  Handle 0 is reserved for the empty node.
+    template <typename Mutex = eixx::detail::mutex>
+    class basic_node_table {
+    public:
+        static const size_t s_capacity = 1 << 16;
+
+        struct entry {
+            atom     node;
+            uint32_t creation;
+        };
+
+        basic_node_table() {
+            m_nodes.reserve(s_capacity);
+            m_nodes.push_back(entry{atom(), 0});
+            m_index[key(atom(), 0)] = 0;
+        }
+
+        /// Process-wide instance of the node table.
+        static basic_node_table& instance() {
+            static basic_node_table s_node_table;
+            return s_node_table;
+        }
+
+        /// Returns the maximum number of node identities that can be stored.
+        size_t capacity()  const { return s_capacity;     }
+
+        /// Returns the current number of node identities in the table.
+        size_t allocated() const { return m_nodes.size(); }
+
+        /// Lookup a node identity by handle. The storage never reallocates,
+        /// so this call doesn't need to take the lock.
+        const entry& operator[] (uint16_t a_handle) const {
+            BOOST_ASSERT(a_handle < m_nodes.size());
+            return m_nodes[a_handle];
+        }
+
+        /// Lookup the handle of the (\a a_node, \a a_creation) pair. If the
+        /// pair is not present in the table - add it.
+        /// @throw std::runtime_error if the node table is full.
+        uint16_t lookup(const atom& a_node, uint32_t a_creation) {
+            // Messages tend to carry many pids of the same node, so remember
+            // the last hit per thread to avoid taking the lock.
+            static thread_local struct {
+                const basic_node_table* table;
+                uint64_t                key;
+                uint16_t                handle;
+            } s_last{nullptr, 0, 0};
+
+            uint64_t k = key(a_node, a_creation);
+            if (s_last.table == this && s_last.key == k)
+                return s_last.handle;
+
+            eixx::detail::lock_guard<Mutex> guard(m_lock);
+            auto it = m_index.find(k);
+            uint16_t h;
+            if (it != m_index.end())
+                h = it->second;
+            else {
+                if (m_nodes.size() == s_capacity)
+                    throw std::runtime_error("Node table is full!");
+                h = (uint16_t)m_nodes.size();
+                m_nodes.push_back(entry{a_node, a_creation});
+                m_index.emplace(k, h);
+            }
+            s_last = {this, k, h};
+            return h;
+        }
+
+    private:
+        static uint64_t key(const atom& a_node, uint32_t a_creation) {
+            return uint64_t(uint32_t(a_node.index())) << 32 | a_creation;
+        }
+
+        std::vector<entry>                      m_nodes;
+        std::unordered_map<uint64_t, uint16_t>  m_index;
+        Mutex                                   m_lock;
+    };
+
+    typedef basic_node_table<> node_table;
+
+} // namespace marshal
+} // namespace eixx
+
+#endif // _EIXX_NODE_TABLE_HPP_
@@ -35,6 +35,7 @@ limitations under the License.
 #include <eixx/eterm_exception.hpp>
 #include <eixx/marshal/atom.hpp>
 #include <eixx/marshal/config.hpp>
+#include <eixx/marshal/node_table.hpp>
 
 namespace eixx {
 namespace marshal {
@@ -43,52 +44,79 @@ namespace marshal {
  * Representation of erlang Pids.
  * A pid has 4 parameters, nodeName, id, serial and creation number
  *
+ * The node name and creation are interned in the node_table, so a pid
+ * whose id and serial fit in 28 and 19 bits respectively is stored
+ * inline in a single 64-bit word and copied without touching the heap:
+ *   | node handle:16 | serial:19 | id:28 | 0:1 |
+ * Wider values (possible with DFLAG_V4_NC) are stored in a reference
+ * counted blob, whose pointer is tagged with the lowest bit set.
  */
 template <class Alloc>
 class epid {
     struct pid_blob {
-        // creation is a special value that allows 
-        // distinguishing pid values between successive node restarts.
-        uint32_t id;        // only 15 bits may be used and the rest must be 0
-        uint32_t serial;    // only 13 bits may be used and the rest must be 0
-        uint32_t creation;
-        atom     node;
-
-        pid_blob(const atom& a_node, int a_id, int a_cre)
-            : id(a_id), serial(0), creation(a_cre), node(a_node)
-        {}
+        uint32_t id;
+        uint32_t serial;
+        uint16_t node;      // Handle in the node_table
 
-        pid_blob(const atom& a_node, int a_id, int serial, int a_cre)
-            : id(a_id), serial(serial), creation(a_cre), node(a_node)
+        pid_blob(uint16_t a_node, uint32_t a_id, uint32_t a_serial)
+            : id(a_id), serial(a_serial), node(a_node)
         {}
     };
 
-    BOOST_STATIC_ASSERT(sizeof(pid_blob) == sizeof(uint64_t)*2);
+    enum {
+          ID_BITS     = 28
+        , SERIAL_BITS = 19
+        , ID_SHIFT    = 1
+        , SER_SHIFT   = ID_SHIFT  + ID_BITS
+        , NODE_SHIFT  = SER_SHIFT + SERIAL_BITS
+    };
+
+    BOOST_STATIC_ASSERT(NODE_SHIFT == 48);
 
-    blob<pid_blob, Alloc>* m_blob;
+    uint64_t m_value;
+
+    bool                   is_wide() const { return m_value & 1; }
+    blob<pid_blob, Alloc>* wide()    const {
+        return reinterpret_cast<blob<pid_blob, Alloc>*>(m_value & ~uint64_t(1));
+    }
 
     void release() {
-        if (m_blob) {
+        if (is_wide()) {
             #ifdef EIXX_DEBUG
             std::cerr << "Releasing pid " << *this
-                      << " [addr=" << this << ", blob=" << m_blob
-                      << ", rc=" << m_blob->use_count() << ']' << std::endl;
+                      << " [addr=" << this << ", blob=" << wide()
+                      << ", rc=" << wide()->use_count() << ']' << std::endl;
             #endif
-            m_blob->release();
+            wide()->release();
         }
     }
 
+    void inc_rc() const { if (is_wide()) wide()->inc_rc(); }
+
     // Must only be called from constructor!
-    void init(const atom& node, int id, int serial, uint32_t creation, const Alloc& alloc)
+    void init(const atom& node, uint32_t id, uint32_t serial, uint32_t creation,
+              const Alloc& alloc)
     {
-        m_blob = new blob<pid_blob, Alloc>(1, alloc);
-        new (m_blob->data()) pid_blob(node, id, serial, creation);
+        uint16_t h = node_table::instance().lookup(node, creation);
+        if (id < (1u << ID_BITS) && serial < (1u << SERIAL_BITS)) {
+            m_value = uint64_t(h)      << NODE_SHIFT
+                    | uint64_t(serial) << SER_SHIFT
+                    | uint64_t(id)     << ID_SHIFT;
+            return;
+        }
+        auto p = new blob<pid_blob, Alloc>(1, alloc);
+        new (p->data()) pid_blob(h, id, serial);
+        m_value = reinterpret_cast<uint64_t>(p) | 1;
         #ifdef EIXX_DEBUG
         std::cerr << "Initialized pid " << *this
-                  << " [addr=" << this << ", blob=" << m_blob << ']' << std::endl;
+                  << " [addr=" << this << ", blob=" << p << ']' << std::endl;
         #endif
     }
 
+    uint16_t handle() const {
+        return is_wide() ? wide()->data()->node : uint16_t(m_value >> NODE_SHIFT);
+    }
+
     /// @throw err_decode_exception
     /// @throw err_bad_argument
     void decode(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc);
@@ -100,17 +128,16 @@ public:
     /// When true - include 'Creation' in printing to string/stream
     static bool display_creation() { return config::display_creation(); }
 
-    epid() : m_blob(nullptr) {}
+    epid() : m_value(0) {}
 
     /**
      * Create an Erlang pid from its components using provided allocator.
      * @param node the nodename.
-     * @param id an arbitrary number. Only the low order 15 bits will
-     * be used.
-     * @param serial another arbitrary number. Only the low order 13 bits
-     * will be used.
-     * @param creation yet another arbitrary number. Only the low order
-     * 2 bits will be used.
+     * @param id an arbitrary number. Values that don't fit in 28 bits
+     * are stored out of line.
+     * @param serial another arbitrary number. Values that don't fit in
+     * 19 bits are stored out of line.
+     * @param creation yet another arbitrary number.
      * @param a_alloc is the allocator to use.
      * @throw err_bad_argument if node is empty or greater than MAX_NODE_LENGTH
      **/
@@ -133,26 +160,25 @@ public:
         decode(buf, idx, size, a_alloc);
     }
 
-    epid(const epid& rhs) : m_blob(rhs.m_blob) {
-        if (m_blob) {
-            m_blob->inc_rc();
-            #ifdef EIXX_DEBUG
+    epid(const epid& rhs) : m_value(rhs.m_value) {
+        inc_rc();
+        #ifdef EIXX_DEBUG
+        if (is_wide())
             std::cerr << "Copied pid " << *this
-                    << " [addr=" << this << ", blob=" << m_blob
-                    << ", rc=" << m_blob->use_count() << ']' << std::endl;
-            #endif
-        }
+                    << " [addr=" << this << ", blob=" << wide()
+                    << ", rc=" << wide()->use_count() << ']' << std::endl;
+        #endif
     }
 
-    epid(epid&& rhs) : m_blob(rhs.m_blob) { rhs.m_blob = nullptr; }
+    epid(epid&& rhs) : m_value(rhs.m_value) { rhs.m_value = 0; }
 
     ~epid() { release(); }
 
     epid& operator= (const epid& rhs) {
         if (this != &rhs) {
             release();
-            m_blob = rhs.m_blob;
-            if (!m_blob) m_blob->inc_rc();
+            m_value = rhs.m_value;
+            inc_rc();
         }
         return *this;
     }
@@ -160,8 +186,8 @@ public:
     epid& operator= (epid&& rhs) {
         if (this != &rhs) {
             release();
-            m_blob = rhs.m_blob;
-            rhs.m_blob = nullptr;
+            m_value = rhs.m_value;
+            rhs.m_value = 0;
         }
         return *this;
     }
@@ -170,30 +196,47 @@ public:
      * Get the node name from the PID.
      * @return the node name from the PID.
      **/
-    atom node() const { return m_blob ? m_blob->data()->node : atom::null(); }
+    atom node() const { return node_table::instance()[handle()].node; }
 
     /**
      * Get the id number from the PID.
      * @return the id number from the PID.
      **/
-    int id() const { return m_blob ? m_blob->data()->id : 0; }
+    int id() const { return id_internal(); }
 
     /**
      * Get the serial number from the PID.
      * @return the serial number from the PID.
      **/
-    int serial() const { return m_blob ? m_blob->data()->serial : 0; }
+    int serial() const {
+        return is_wide() ? wide()->data()->serial
+                         : uint32_t(m_value >> SER_SHIFT) & ((1u << SERIAL_BITS)-1);
+    }
 
     /**
      * Get the creation number from the PID.
      * @return the creation number from the PID.
      **/
-    uint32_t creation() const { return m_blob ? m_blob->data()->creation : 0; }
+    uint32_t creation() const { return node_table::instance()[handle()].creation; }
+
+    uint32_t id_internal() const {
+        return is_wide() ? wide()->data()->id
+                         : uint32_t(m_value >> ID_SHIFT) & ((1u << ID_BITS)-1);
+    }
+
+    /// Returns true if the pid is stored inline (i.e. packed() uniquely
+    /// identifies it).
+    bool     is_packed() const { return !is_wide(); }
 
-    uint32_t id_internal() const { return m_blob ? m_blob->data()->id : 0; }
+    /// Packed 64-bit representation of the pid. Only meaningful as an
+    /// identity when is_packed() is true.
+    uint64_t packed()    const { return m_value; }
 
     bool operator== (const epid<Alloc>& rhs) const {
-        return ::memcmp(m_blob->data(), rhs.m_blob->data(), sizeof(pid_blob)) == 0;
+        if (m_value == rhs.m_value) return true;
+        if (!is_wide() || !rhs.is_wide()) return false;
+        const pid_blob* l = wide()->data(), *r = rhs.wide()->data();
+        return l->id == r->id && l->serial == r->serial && l->node == r->node;
     }
     bool operator!= (const epid<Alloc>& rhs) const { return !(*this == rhs); }
 
@@ -205,10 +248,18 @@ public:
         if (id_internal() < t2.id_internal())   return true;
         if (id_internal() > t2.id_internal())   return false;
         if (serial()      < t2.serial())        return true;
-        if (creation()    > t2.creation())      return false;
+        if (serial()      > t2.serial())        return false;
         if (creation()    < t2.creation())      return true;
         return false;
     }
+
+    size_t hash() const {
+        return is_wide()
+            ? std::hash<uint64_t>()(uint64_t(handle()) << NODE_SHIFT
+                                  ^ uint64_t(id_internal()) << 16 ^ serial())
+            : std::hash<uint64_t>()(m_value);
+    }
+
     size_t encode_size() const {
       return
           #ifndef ERL_NEW_PID_EXT
@@ -239,6 +290,11 @@ namespace std {
         return a.dump(out);
     }
 
+    template <typename Alloc>
+    struct hash<eixx::marshal::epid<Alloc>> {
+        size_t operator()(const eixx::marshal::epid<Alloc>& a) const { return a.hash(); }
+    };
+
 } // namespace std
 
 #include <eixx/marshal/pid.hxx>
@@ -34,40 +34,62 @@ limitations under the License.
 #include <eixx/eterm_exception.hpp>
 #include <eixx/marshal/atom.hpp>
 #include <eixx/marshal/config.hpp>
+#include <eixx/marshal/node_table.hpp>
 
 namespace eixx {
 namespace marshal {
 
 /**
- * Representation of erlang Pids.
+ * Representation of erlang Ports.
  * A port has 3 parameters, node name, id, and creation number
  *
+ * The node name and creation are interned in the node_table, so a port
+ * whose id fits in 47 bits is stored inline in a single 64-bit word:
+ *   | node handle:16 | id:47 | 0:1 |
+ * Wider ids are stored in a reference counted blob, whose pointer is
+ * tagged with the lowest bit set.
  */
 template <class Alloc>
 class port {
     struct port_blob {
-        uint32_t creation;
         uint64_t id;
-        atom     node;
+        uint16_t node;      // Handle in the node_table
 
-        port_blob(const atom& a_node, uint64_t a_id, uint32_t a_cre)
-            : creation(a_cre), id(a_id), node(a_node)
-        {}
+        port_blob(uint16_t a_node, uint64_t a_id) : id(a_id), node(a_node) {}
     };
 
-    blob<port_blob, Alloc>* m_blob;
+    enum { ID_BITS = 47, NODE_SHIFT = ID_BITS + 1 };
+
+    uint64_t m_value;
+
+    bool                    is_wide() const { return m_value & 1; }
+    blob<port_blob, Alloc>* wide()    const {
+        return reinterpret_cast<blob<port_blob, Alloc>*>(m_value & ~uint64_t(1));
+    }
 
     void release() {
-        if (m_blob)
-            m_blob->release();
+        if (is_wide())
+            wide()->release();
     }
 
+    void inc_rc() const { if (is_wide()) wide()->inc_rc(); }
+
     // Must only be called from constructor!
     void init(const atom& node, uint64_t id, uint32_t creation, 
               const Alloc& alloc)
     {
-        m_blob = new blob<port_blob, Alloc>(1, alloc);
-        new (m_blob->data()) port_blob(node, id, creation);
+        uint16_t h = node_table::instance().lookup(node, creation);
+        if (id < (uint64_t(1) << ID_BITS)) {
+            m_value = uint64_t(h) << NODE_SHIFT | id << 1;
+            return;
+        }
+        auto p = new blob<port_blob, Alloc>(1, alloc);
+        new (p->data()) port_blob(h, id);
+        m_value = reinterpret_cast<uint64_t>(p) | 1;
+    }
+
+    uint16_t handle() const {
+        return is_wide() ? wide()->data()->node : uint16_t(m_value >> NODE_SHIFT);
     }
 
 public:
@@ -76,20 +98,18 @@ public:
     /// When true - include 'Creation' in printing to string/stream
     static bool display_creation() { return config::display_creation(); }
 
-    port() : m_blob(nullptr) {}
+    port() : m_value(0) {}
 
     /**
      * Create an Erlang port from its components.
      * If node string size is greater than MAX_NODE_LENGTH or = 0,
      * the constructor throws an exception.
      * @param node the nodename.
-     * @param id an arbitrary number. Only the low order 18
-     * bits will be used.
-     * @param creation yet another arbitrary number. Only the low order
-     * 2 bits will be used.
+     * @param id an arbitrary number.
+     * @param creation yet another arbitrary number.
      * @throw err_bad_argument if node is empty or greater than MAX_NODE_LENGTH
      **/
-    port(const char* node, const int id, const uint32_t creation, const Alloc& a_alloc = Alloc())
+    port(const char* node, uint64_t id, const uint32_t creation, const Alloc& a_alloc = Alloc())
     {
         size_t n = strlen(node);
         detail::check_node_length(n);
@@ -97,7 +117,7 @@ public:
         init(l_node, id, creation, a_alloc);
     }
 
-    port(const atom& node, const int id, const uint32_t creation, const Alloc& a_alloc = Alloc())
+    port(const atom& node, uint64_t id, const uint32_t creation, const Alloc& a_alloc = Alloc())
     {
         detail::check_node_length(node.size());
         init(node, id, creation, a_alloc);
@@ -113,22 +133,22 @@ public:
      */
     port(const char *buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
 
-    port(const port& rhs) : m_blob(rhs.m_blob) { if (m_blob) m_blob->inc_rc(); }
-    port(port&& rhs)      : m_blob(rhs.m_blob) { rhs.m_blob = nullptr; }
+    port(const port& rhs) : m_value(rhs.m_value) { inc_rc(); }
+    port(port&& rhs)      : m_value(rhs.m_value) { rhs.m_value = 0; }
 
     ~port() { release(); }
 
     port& operator= (const port& rhs) {
         if (this != &rhs) {
-            release(); m_blob = rhs.m_blob;
-            if (m_blob) m_blob->inc_rc();
+            release(); m_value = rhs.m_value;
+            inc_rc();
         }
         return *this;
     }
 
     port& operator= (port&& rhs) {
         if (this != &rhs) {
-            release(); m_blob = rhs.m_blob; rhs.m_blob = nullptr;
+            release(); m_value = rhs.m_value; rhs.m_value = 0;
         }
         return *this;
     }
@@ -137,29 +157,30 @@ public:
      * Get the node name from the PORT.
      * @return the node name from the PORT.
      **/
-    atom node() const { return m_blob ? m_blob->data()->node : atom::null(); }
+    atom node() const { return node_table::instance()[handle()].node; }
 
     /**
      * Get the id number from the PORT.
      * @return the id number from the PORT.
      **/
-    uint64_t id() const { return m_blob ? m_blob->data()->id : 0; }
+    uint64_t id() const { return is_wide() ? wide()->data()->id : m_value >> 1 & ((uint64_t(1) << ID_BITS)-1); }
 
     /**
      * Get the creation number from the PORT.
      * @return the creation number from the PORT.
      **/
-    uint32_t creation() const { return m_blob ? m_blob->data()->creation : 0; }
+    uint32_t creation() const { return node_table::instance()[handle()].creation; }
 
     bool operator== (const port<Alloc>& t) const {
-        return id() == t.id() && node() == t.node() && creation() == t.creation();
+        return m_value == t.m_value
+            || (is_wide() && t.is_wide() && id() == t.id() && handle() == t.handle());
     }
 
     /// Less operator, needed for maps
     bool operator<(const port<Alloc>& rhs) const {
         int n = node().compare(rhs.node());
-        if (n > 0)                       return true;
-        if (n < 0)                       return false;
+        if (n < 0)                       return true;
+        if (n > 0)                       return false;
         if (id()   < rhs.id())           return true;
         if (id()   > rhs.id())           return false;
         if (creation() < rhs.creation()) return true;
@@ -168,8 +189,10 @@ public:
     }
 
     size_t encode_size() const {
-        return id() > 0x0fffffff ? 16 :
-            #if defined(ERL_V4_PORT_EXT) || defined(ERL_NEW_PORT_EXT)
+        return
+            #if defined(ERL_V4_PORT_EXT)
+                (id() > 0x0fffffff ? 16 : 12)
+            #elif defined(ERL_NEW_PORT_EXT)
                 12
             #else
                 9
@@ -112,19 +112,19 @@ void port<Alloc>::encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t size
         *s0 = ERL_V4_PORT_EXT;
         put64be(s, id());
         put32be(s, l_cre);
-    } else {
-#elif defined(ERL_NEW_PORT_EXT)
+    } else
+#endif
+    {
+#if defined(ERL_NEW_PORT_EXT)
         *s0 = ERL_NEW_PORT_EXT;
-        put32be(s, id() & 0x0fffffff /* 28 bits */);  
+        put32be(s, id() & 0x0fffffff /* 28 bits */);
         put32be(s, l_cre);
 #else
         *s0 = ERL_PORT_EXT;
         put32be(s, id() & 0x0fffffff /* 28 bits */);
         put8(s, l_cre & 0x03 /* 2 bits */);
 #endif
-#if defined(ERL_V4_PORT_EXT)
     }
-#endif
 
     idx += s-s0;
     BOOST_ASSERT((size_t)idx <= size);
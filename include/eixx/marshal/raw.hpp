@@ -0,0 +1,171 @@
+//----------------------------------------------------------------------------
+/// \file  raw.hpp
+//----------------------------------------------------------------------------
+/// \brief A class holding an opaque encoded term of Erlang external
+///        term format, which is not otherwise modeled by eterm.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_RAW_HPP_
+#define _IMPL_RAW_HPP_
+
+#include <eixx/marshal/defaults.hpp>
+#include <eixx/marshal/alloc_base.hpp>
+#include <eixx/marshal/varbind.hpp>
+#include <eixx/eterm_exception.hpp>
+#include <string.h>
+#include <ei.h>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Opaque term holding the exact encoded bytes (without the version
+ * byte) of a subterm whose tag is not modeled by eterm, such as funs
+ * or exports.  The bytes
+ * are reference counted and encoded back verbatim, so that terms can be
+ * forwarded without loss.
+ */
+template <class Alloc>
+class raw
+{
+    blob<char, Alloc>* m_blob;
+
+    void release() {
+        if (m_blob)
+            m_blob->release();
+    }
+
+public:
+    raw() : m_blob(nullptr) {}
+
+    /**
+     * Create a raw term from a buffer holding exactly one encoded term.
+     * @param data pointer to the encoded term (starting with its tag).
+     * @param size size of the encoded term in bytes.
+     * @param a_alloc is the allocator to use.
+     * @throw err_bad_argument if \a size is 0.
+     **/
+    raw(const char* data, size_t size, const Alloc& a_alloc = Alloc())
+        : m_blob(size ? new blob<char, Alloc>(size, a_alloc) : nullptr)
+    {
+        if (!size)
+            throw err_bad_argument("Empty raw term");
+        memcpy(m_blob->data(), data, size);
+    }
+
+    /**
+     * Capture the next encoded term in the buffer without interpreting it.
+     * @param buf is the buffer containing Erlang external term format.
+     * @param idx is the current offset in the buf buffer.
+     * @param size is the size of \a buf buffer.
+     * @param a_alloc is the allocator to use.
+     * @throw err_decode_exception
+     */
+    raw(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc()) {
+        BOOST_ASSERT(idx <= INT_MAX);
+        int end = (int)idx;
+        if (ei_skip_term(buf, &end) < 0 || (size_t)end > size || (uintptr_t)end == idx)
+            throw err_decode_exception("Error decoding raw term", idx);
+        size_t n = end - idx;
+        m_blob = new blob<char, Alloc>(n, a_alloc);
+        memcpy(m_blob->data(), buf + idx, n);
+        idx = end;
+    }
+
+    raw(const raw<Alloc>& rhs) : m_blob(rhs.m_blob) {
+        if (m_blob) m_blob->inc_rc();
+    }
+
+    raw(raw<Alloc>&& rhs) : m_blob(rhs.m_blob) { rhs.m_blob = nullptr; }
+
+    ~raw() { release(); }
+
+    raw& operator= (const raw& rhs) {
+        if (this != &rhs) {
+            release();
+            m_blob = rhs.m_blob;
+            if (m_blob) m_blob->inc_rc();
+        }
+        return *this;
+    }
+
+    raw& operator= (raw&& rhs) {
+        if (this != &rhs) {
+            release();
+            m_blob = rhs.m_blob;
+            rhs.m_blob = nullptr;
+        }
+        return *this;
+    }
+
+    /** External format tag of the term (e.g. ERL_NEW_FUN_EXT) */
+    uint8_t     tag()  const { return m_blob ? (uint8_t)m_blob->data()[0] : 0; }
+
+    /** Size of the encoded term in bytes */
+    size_t      size() const { return m_blob ? m_blob->size() : 0; }
+
+    /** Encoded term */
+    const char* data() const { return m_blob ? m_blob->data() : ""; }
+
+    // Use only for debugging
+    int         use_count() const { return m_blob ? m_blob->use_count() : -1000000; }
+
+    bool operator== (const raw<Alloc>& rhs) const {
+        return size() == rhs.size()
+            && (m_blob == rhs.m_blob || memcmp(data(), rhs.data(), size()) == 0);
+    }
+
+    /// Byte-wise lexicographical ordering of the encoded terms.
+    bool operator< (const raw<Alloc>& rhs) const {
+        int res = memcmp(data(), rhs.data(), std::min(size(), rhs.size()));
+        return res < 0 || (res == 0 && size() < rhs.size());
+    }
+
+    /** Encode the term to a flat buffer verbatim. */
+    void encode(char* buf, uintptr_t& idx, [[maybe_unused]] size_t size) const {
+        memcpy(buf + idx, data(), this->size());
+        idx += this->size();
+        BOOST_ASSERT((size_t)idx <= size);
+    }
+
+    /** Size of buffer needed to hold the encoded term. */
+    size_t encode_size() const { return size(); }
+
+    std::ostream& dump(std::ostream& out, const varbind<Alloc>* =NULL) const {
+        return out << "#Raw<" << int(tag()) << ',' << size() << '>';
+    }
+};
+
+} // namespace marshal
+} // namespace eixx
+
+namespace std {
+    template <typename Alloc>
+    ostream& operator<< (ostream& out, const eixx::marshal::raw<Alloc>& a) {
+        return a.dump(out);
+    }
+
+} // namespace std
+
+#endif // _IMPL_RAW_HPP_
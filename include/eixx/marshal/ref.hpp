@@ -35,6 +35,7 @@ limitations under the License.
 #include <boost/iterator/iterator_concepts.hpp>
 #include <eixx/marshal/atom.hpp>
 #include <eixx/marshal/config.hpp>
+#include <eixx/marshal/node_table.hpp>
 #include <eixx/eterm_exception.hpp>
 
 namespace eixx {
@@ -45,21 +46,23 @@ namespace detail {
 /**
  * Representation of erlang Pids.
  * A ref has 5 parameters, nodeName, three ids, and creation number
+ *
+ * Up to five id words don't fit in a machine word, so the ref keeps a
+ * reference counted blob, but the node name and creation are interned
+ * in the node_table and stored as a 16-bit handle.
  */
 template <class Alloc>
 class ref {
     enum { COUNT = 5 /* max of 5 when the DFLAG_V4_NC has been set */ };
 
     struct ref_blob {
-        atom     node;
-        uint16_t len;
         uint32_t ids[COUNT];
-        uint32_t creation;
+        uint16_t node;      // Handle in the node_table
+        uint16_t len;
 
-        ref_blob(const atom& a_node, const uint32_t* a_ids, uint16_t n, uint32_t a_cre)
+        ref_blob(uint16_t a_node, const uint32_t* a_ids, uint16_t n)
             : node(a_node)
             , len(n)
-            , creation(a_cre)
         {
             assert(n >= 3 && n <= COUNT);
 
@@ -70,16 +73,10 @@ class ref {
             while(i < COUNT)
                 ids[i++] = 0;
         }
-        template <int N>
-        ref_blob(const atom& node, uint32_t (&ids)[N], uint32_t creation)
-            : ref_blob(node, ids, N, creation)
-        {}
-
-        ref_blob(const atom& a_node, std::initializer_list<uint32_t> a_ids, uint32_t a_cre)
-            : ref_blob(node, &*a_ids.begin(), a_ids.size(), creation)
-        {}
     };
 
+    BOOST_STATIC_ASSERT(sizeof(ref_blob) == 24);
+
     blob<ref_blob, Alloc>* m_blob;
 
     // Must only be called from constructor!
@@ -88,8 +85,9 @@ class ref {
     {
         detail::check_node_length(a_node.size());
 
+        uint16_t h = node_table::instance().lookup(a_node, a_cre);
         m_blob = new blob<ref_blob, Alloc>(1, alloc);
-        new (m_blob->data()) ref_blob(a_node, a_ids, n, a_cre);
+        new (m_blob->data()) ref_blob(h, a_ids, n);
     }
 
     void release() {
@@ -183,7 +181,9 @@ public:
      * Get the node name from the REF.
      * @return the node name from the REF.
      */
-    atom node() const { return m_blob ? m_blob->data()->node : atom::null(); }
+    atom node() const {
+        return m_blob ? node_table::instance()[m_blob->data()->node].node : atom::null();
+    }
 
     /**
      * Get an id number from the REF.
@@ -211,9 +211,13 @@ public:
      * Get the creation number from the REF.
      * @return the creation number from the REF.
      */
-    uint32_t creation() const { return m_blob ? m_blob->data()->creation : 0; }
+    uint32_t creation() const {
+        return m_blob ? node_table::instance()[m_blob->data()->node].creation : 0;
+    }
 
     bool operator==(const ref<Alloc>& t) const {
+        if (m_blob == t.m_blob) return true;
+        if (!m_blob || !t.m_blob) return false;
         return ::memcmp(m_blob->data(), t.m_blob->data(), sizeof(ref_blob)) == 0;
     }
 
@@ -237,6 +241,14 @@ public:
         return false;
     }
 
+    size_t hash() const {
+        if (!m_blob)
+            return 0;
+        auto d = m_blob->data();
+        return std::hash<uint64_t>()(uint64_t(d->ids[1]) << 18 ^ d->ids[0]
+                                   ^ uint64_t(d->ids[2]) << 50 ^ uint64_t(d->node) << 32);
+    }
+
     size_t encode_size() const {
         return 1+2+(3+node().size()) + len()*4 +
             #ifdef ERL_NEWER_REFERENCE_EXT
@@ -271,6 +283,11 @@ namespace std {
         return out << '>';
     }
 
+    template <class Alloc>
+    struct hash<eixx::marshal::ref<Alloc>> {
+        size_t operator()(const eixx::marshal::ref<Alloc>& a) const { return a.hash(); }
+    };
+
 } // namespace std
 
 #include <eixx/marshal/ref.hxx>
@@ -107,6 +107,13 @@ public:
 
     string(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
 
+    /**
+     * Decode a STRING_EXT string from a binary buffer reusing this string's
+     * storage. Nothing is decoded if the storage is shared or too small.
+     * @return true if the string was decoded.
+     */
+    bool decode_into(const char* buf, uintptr_t& idx, size_t size);
+
     ~string() {
         release();
     }
@@ -257,6 +264,22 @@ string<Alloc>::string(const char* buf, uintptr_t& idx, [[maybe_unused]] size_t s
     idx += s-s0;
 }
 
+template <class Alloc>
+bool string<Alloc>::decode_into(const char* buf, uintptr_t& idx, [[maybe_unused]] size_t size)
+{
+    const char* s = buf + idx;
+    if (!m_blob || !m_blob->unique() || get8(s) != ERL_STRING_EXT)
+        return false;
+    size_t len = get16be(s);
+    if (len == 0 || !m_blob->resize(len+1))
+        return false;
+    memcpy(m_blob->data(), s, len);
+    m_blob->data()[len] = '\0';
+    idx += 3 + len;
+    BOOST_ASSERT((size_t)idx <= size);
+    return true;
+}
+
 } // namespace marshal
 } // namespace eixx
 
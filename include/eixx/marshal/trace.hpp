@@ -114,6 +114,9 @@ public:
     bool   initialized()    const { return tuple<Alloc>::initialized(); }
     size_t size()           const { return tuple<Alloc>::size(); }
 
+    /// The trace token as a 5-tuple.
+    const tuple<Alloc>& to_tuple() const { return *this; }
+
     bool operator== (const trace<Alloc>& rhs) const {
         return tuple<Alloc>::operator== (static_cast<const tuple<Alloc>&>(rhs));
     }
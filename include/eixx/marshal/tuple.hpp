@@ -36,6 +36,7 @@ limitations under the License.
 #include <eixx/marshal/varbind.hpp>
 #include <eixx/marshal/visit.hpp>
 #include <eixx/marshal/visit_encode_size.hpp>
+#include <eixx/marshal/detail/array_variadic_init.hpp>
 #include <ei.h>
 
 namespace eixx {
@@ -62,7 +63,7 @@ class tuple {
 
     void release(blob<eterm<Alloc>, Alloc>* p) {
         if (p && p->release(false)) {
-            for(size_t i=0, n=size(); i < n; i++)
+            for(size_t i=0, n=p->size()-1; i < n; i++)
                 p->data()[i].~eterm();
             p->free();
         }
@@ -126,6 +127,14 @@ public:
      */
     tuple(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc = Alloc());
 
+    /**
+     * Decode the tuple from a binary buffer reusing this tuple's storage
+     * and the storage of its elements where possible. Nothing is decoded
+     * if the storage is shared or its capacity is smaller than the arity.
+     * @return true if the tuple was decoded.
+     */
+    bool decode_into(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc);
+
     ~tuple() {
         release();
     }
@@ -186,6 +195,33 @@ public:
         return m_blob->data()[idx];
     }
 
+    /**
+     * Prepare the tuple for modification. If the tuple's storage is shared
+     * with other terms, the tuple is copied (elements are shared with the
+     * original), otherwise it's modified in place.
+     */
+    tuple<Alloc>& mutate() {
+        if (m_blob && !m_blob->unique()) {
+            tuple<Alloc> t(begin(), size(), m_blob->get_allocator());
+            std::swap(m_blob, t.m_blob);
+        }
+        return *this;
+    }
+
+    /**
+     * Replace the \a i'th element of the tuple, copying the tuple first
+     * if its storage is shared.
+     * @throw err_bad_argument if \a i is out of bounds.
+     */
+    template <typename T>
+    tuple<Alloc>& set(size_t i, T&& v) {
+        if (!m_blob || i >= get_init_size())
+            throw err_bad_argument("Index out of bounds", i);
+        mutate();
+        m_blob->data()[i] = std::forward<T>(v);
+        return *this;
+    }
+
     template <typename T>
     void push_back(const T& t) {
         BOOST_ASSERT(m_blob);
@@ -196,9 +232,20 @@ public:
         set_init_size(i+1);
     }
 
+    /// Add a term to the tuple taking over its storage.
+    void push_back(eterm<Alloc>&& t) {
+        BOOST_ASSERT(m_blob);
+        if (initialized())
+            throw err_invalid_term("Attempt to change immutable tuple!");
+        size_t i = get_init_size();
+        new (&m_blob->data()[i]) eterm<Alloc>(std::move(t));
+        set_init_size(i+1);
+    }
+
     size_t size() const { BOOST_ASSERT(m_blob); return m_blob->size()-1; } // Last element is filled size
 
     bool   initialized()   const   { return size() == get_init_size(); }
+    int    use_count()     const   { return m_blob ? m_blob->use_count() : -1000000; }
 
     iterator       begin()         { BOOST_ASSERT(m_blob); return m_blob->data();   }
     iterator       end()           { BOOST_ASSERT(m_blob); return &m_blob->data()[m_blob->size()-1]; }
@@ -221,130 +268,22 @@ public:
 
     std::ostream& dump(std::ostream& out, const varbind<Alloc>* vars = NULL) const;
 
-    template <class T1>
-    static tuple<Alloc> make(T1 t1, const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2>
-    static tuple<Alloc> make(T1 t1, T2 t2,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5, class T6>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, 
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4, class T5, class T6, class T7>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4, T5 t5, T6 t6, T7 t7,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6),
-                             eterm<Alloc>::cast(t7) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4,
-              class T5, class T6, class T7, class T8>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4,
-                             T5 t5, T6 t6, T7 t7, T8 t8,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6),
-                             eterm<Alloc>::cast(t7),
-                             eterm<Alloc>::cast(t8) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4,
-              class T5, class T6, class T7, class T8,
-              class T9>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4,
-                             T5 t5, T6 t6, T7 t7, T8 t8,
-                             T9 t9,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6),
-                             eterm<Alloc>::cast(t7),
-                             eterm<Alloc>::cast(t8),
-                             eterm<Alloc>::cast(t9) };
-        return tuple<Alloc>(l, a);
-    }
-
-    template <class T1, class T2, class T3, class T4,
-              class T5, class T6, class T7, class T8,
-              class T9, class T10>
-    static tuple<Alloc> make(T1 t1, T2 t2, T3 t3, T4 t4,
-                             T5 t5, T6 t6, T7 t7, T8 t8,
-                             T9 t9, T10 t10,
-        const Alloc& a = Alloc()) {
-        eterm<Alloc> l[] = { eterm<Alloc>::cast(t1),
-                             eterm<Alloc>::cast(t2),
-                             eterm<Alloc>::cast(t3),
-                             eterm<Alloc>::cast(t4),
-                             eterm<Alloc>::cast(t5),
-                             eterm<Alloc>::cast(t6),
-                             eterm<Alloc>::cast(t7),
-                             eterm<Alloc>::cast(t8),
-                             eterm<Alloc>::cast(t9),
-                             eterm<Alloc>::cast(t10) };
-        return tuple<Alloc>(l, a);
+    /**
+     * Create a tuple from the given arguments. Each argument is forwarded
+     * directly into the tuple's storage, so temporary terms are moved
+     * without touching their reference counts. If the last argument is
+     * an allocator, it's used to allocate the tuple.
+     */
+    template <typename... Args>
+    static tuple<Alloc> make(Args&&... args) {
+        typedef detail::last_is_alloc<Alloc, Args...> has_alloc;
+        const size_t N = sizeof...(Args) - has_alloc::value;
+        auto l_args = std::forward_as_tuple(std::forward<Args>(args)...);
+        tuple<Alloc> t(N, detail::last_alloc<Alloc>(l_args, has_alloc()));
+        detail::initialize(t.begin(), std::move(l_args), std::make_index_sequence<N>());
+        t.set_initialized();
+        return t;
     }
-
 };
 
 } // namespace marshal
@@ -51,6 +51,36 @@ tuple<Alloc>::tuple(const char* buf, uintptr_t& idx, size_t size, const Alloc& a
     BOOST_ASSERT((size_t)idx <= size);
 }
 
+template <class Alloc>
+bool tuple<Alloc>::decode_into(const char* buf, uintptr_t& idx, size_t size, const Alloc& a_alloc)
+{
+    BOOST_ASSERT(idx <= INT_MAX);
+    if (!m_blob || !m_blob->unique() || !initialized())
+        return false;
+    int arity, i = (int)idx;
+    if (ei_decode_tuple_header(buf, &i, &arity) < 0)
+        throw err_decode_exception("Error decoding tuple header", idx);
+    if (size_t(arity)+1 > m_blob->capacity())
+        return false;
+    idx = i;
+
+    // Drop the elements that don't exist in the new tuple, and
+    // initialize the slots that didn't exist in the old one.
+    size_t        n = this->size();
+    eterm<Alloc>* p = m_blob->data();
+    for (size_t j=arity; j < n; ++j)
+        p[j].~eterm();
+    m_blob->resize(arity+1);
+    for (size_t j=n; j < size_t(arity); ++j)
+        new (&p[j]) eterm<Alloc>();
+    set_init_size(arity);
+
+    for (int j=0; j < arity; ++j)
+        p[j].decode_into(buf, idx, size, a_alloc);
+    BOOST_ASSERT((size_t)idx <= size);
+    return true;
+}
+
 template <class Alloc>
 void tuple<Alloc>::encode(char* buf, uintptr_t& idx, size_t size) const
 {
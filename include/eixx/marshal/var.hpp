@@ -53,7 +53,9 @@ class var
     template <class Alloc>
     bool check_type(const eterm<Alloc>& t) const {
         return is_any() || m_type == UNDEFINED || t.type() == m_type
-            || (m_type == STRING && t.is_list() && t.to_list().empty());
+            || (m_type == STRING && t.is_list() && t.to_list().empty())
+            || (m_type == LONG   && t.type() == BIGINT)
+            || (m_type == BITSTRING && t.type() == BINARY);
     }
 
     eterm_type set(eterm_type t) { return m_name == am_ANY_ ? UNDEFINED : t; }
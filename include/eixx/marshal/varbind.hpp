@@ -32,6 +32,7 @@ limitations under the License.
 #include <string>
 #include <ostream>
 #include <map>
+#include <vector>
 #include <eixx/marshal/eterm.hpp>
 
 namespace eixx {
@@ -77,17 +78,21 @@ protected:
             typename std::allocator_traits<Alloc>::
                 template rebind_alloc<std::pair<const atom, eterm<Alloc>>>
         >;
+    using atom_vector_t =
+        std::vector<
+            atom, typename std::allocator_traits<Alloc>::template rebind_alloc<atom>
+        >;
 
 public:
     explicit varbind(const Alloc& a_alloc = Alloc())
-        : m_term_map(std::less<atom>(), a_alloc)
+        : m_term_map(std::less<atom>(), a_alloc), m_bound(a_alloc), m_scopes(0)
     {}
 
-    varbind(const varbind<Alloc>& rhs) : m_term_map(rhs.m_term_map)
+    varbind(const varbind<Alloc>& rhs) : m_term_map(rhs.m_term_map), m_scopes(0)
     {}
 
 #if __cplusplus >= 201103L
-    varbind(std::initializer_list<epair<Alloc>> a_list) {
+    varbind(std::initializer_list<epair<Alloc>> a_list) : m_scopes(0) {
         m_term_map.insert(a_list.begin(), a_list.end());
     }
 //     varbind(std::initializer_list<std::pair<atom, eterm<Alloc>> a_list) {
@@ -113,9 +118,41 @@ public:
 
     void bind(atom a_var_name, const eterm<Alloc>& a_term) {
         // bind only if is unbound
-        m_term_map.insert(std::make_pair(a_var_name, a_term));
+        if (m_term_map.insert(std::make_pair(a_var_name, a_term)).second && m_scopes)
+            m_bound.push_back(a_var_name);
     }
 
+    /**
+     * Scope of a tentative match.  The variables bound while the scope is
+     * alive are unbound when it is destroyed, unless commit() is called,
+     * so that a failed match (or its guard) leaves the binding unchanged
+     * without copying it.
+     */
+    class scope {
+        varbind& m_binding;
+        size_t   m_mark;
+        bool     m_commit;
+    public:
+        explicit scope(varbind& a_binding)
+            : m_binding(a_binding), m_mark(a_binding.m_bound.size()), m_commit(false)
+        { ++m_binding.m_scopes; }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+        ~scope() {
+            if (!m_commit)
+                for (size_t i = m_binding.m_bound.size(); i > m_mark; --i)
+                    m_binding.m_term_map.erase(m_binding.m_bound[i-1]);
+            // Variables committed in a nested scope stay recorded for the outer one
+            if (--m_binding.m_scopes == 0 || !m_commit)
+                m_binding.m_bound.resize(m_binding.m_scopes ? m_mark : 0);
+        }
+
+        /// Keep the variables bound in this scope.
+        void commit() { m_commit = true; }
+    };
+
     /**
      * Search for a variable by name
      * @param a_var_name variable to find
@@ -186,7 +223,10 @@ public:
     size_t count() const { return m_term_map.size(); }
 
 protected:
-    eterm_map_t m_term_map;
+    eterm_map_t   m_term_map;
+    /// Variables bound in the open scopes, in the order of binding
+    atom_vector_t m_bound;
+    size_t        m_scopes;
 };
 
 } // namespace marshal
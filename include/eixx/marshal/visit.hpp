@@ -36,6 +36,7 @@ namespace marshal {
 
     template <typename Alloc> class tuple;
     template <typename Alloc> class list;
+    template <typename Alloc> class map;
     class var;
 
     template <typename ResultType, typename Visitor>
@@ -0,0 +1,280 @@
+//----------------------------------------------------------------------------
+/// \file  visit_canonical.hpp
+//----------------------------------------------------------------------------
+/// \brief A visitor producing the canonical binary encoding of a term.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_VISIT_CANONICAL_HPP_
+#define _IMPL_VISIT_CANONICAL_HPP_
+
+#include <string.h>
+#include <eixx/marshal/visit.hpp>
+#include <eixx/marshal/endian.hpp>
+#include <eixx/eterm_exception.hpp>
+#include <eixx/util/siphash.hpp>
+#include <ei.h>
+
+namespace eixx {
+namespace marshal {
+
+/// Sink counting the number of bytes of canonical encoding.
+struct canonical_size_sink {
+    size_t size = 0;
+    void write(const void*, size_t n) { size += n; }
+};
+
+/// Sink storing canonical encoding in a buffer of sufficient size.
+struct canonical_buffer_sink {
+    char* pos;
+    explicit canonical_buffer_sink(char* a_buf) : pos(a_buf) {}
+    void write(const void* p, size_t n) { memcpy(pos, p, n); pos += n; }
+};
+
+/// Sink hashing canonical encoding without storing it.
+struct canonical_hash_sink {
+    util::siphash128 hasher;
+    void write(const void* p, size_t n) { hasher.update(p, n); }
+};
+
+/**
+ * Visitor writing a term in the canonical external term format to a
+ * \a Sink, which is any class with a write(const void*, size_t) method.
+ * Terms that are exactly equal (see eterm::compare()) produce the same
+ * bytes regardless of how they were constructed:
+ * <ul>
+ *   <li>integers use the smallest of SMALL_INTEGER_EXT, INTEGER_EXT and
+ *       SMALL_BIG_EXT;</li>
+ *   <li>floats use NEW_FLOAT_EXT with -0.0 stored as 0.0;</li>
+ *   <li>atoms and booleans use SMALL_ATOM_UTF8_EXT or ATOM_UTF8_EXT;</li>
+ *   <li>lists of integers 0..255 and strings use STRING_EXT when they
+ *       fit, and LIST_EXT otherwise;</li>
+ *   <li>map keys are written in the term order;</li>
+ *   <li>sequential trace tokens are written as tuples.</li>
+ * </ul>
+ */
+template <typename Alloc, typename Sink>
+class visit_eterm_canonical
+    : public static_visitor<visit_eterm_canonical<Alloc, Sink>, void> {
+
+    Sink& m_sink;
+
+    void put(const void* p, size_t n) const { m_sink.write(p, n); }
+
+    void put8(uint8_t n) const { put(&n, 1); }
+
+    void put16(uint16_t n) const {
+        char b[2], *s = b;
+        put16be(s, n);
+        put(b, sizeof(b));
+    }
+
+    void put32(uint32_t n) const {
+        char b[4], *s = b;
+        put32be(s, n);
+        put(b, sizeof(b));
+    }
+
+    void tag32(uint8_t a_tag, size_t a_len, const char* a_what) const {
+        if (a_len > UINT32_MAX)
+            throw err_encode_exception(std::string(a_what) + " length exceeds maximum");
+        put8(a_tag);
+        put32(uint32_t(a_len));
+    }
+
+    void atom_name(const char* a_name, size_t a_len) const {
+        if (a_len > UINT8_MAX) {
+            put8(ERL_ATOM_UTF8_EXT);
+            put16(uint16_t(a_len));
+        } else {
+            put8(ERL_SMALL_ATOM_UTF8_EXT);
+            put8(uint8_t(a_len));
+        }
+        put(a_name, a_len);
+    }
+
+    /// Write a term that has only one external representation.
+    template <typename T>
+    void verbatim(const T& a) const {
+        char buf[2048];
+        size_t n = a.encode_size();
+        if (n > sizeof(buf))
+            throw err_encode_exception("Term is too large for canonical encoding");
+        uintptr_t idx = 0;
+        a.encode(buf, idx, sizeof(buf));
+        put(buf, idx);
+    }
+
+    /// Return true if the list can be written as STRING_EXT.
+    static bool is_byte_list(const list<Alloc>& a) {
+        if (a.length() > UINT16_MAX)
+            return false;
+        for (auto it = a.begin(), e = a.end(); it != e; ++it)
+            if (it->type() != LONG || it->to_long() < 0 || it->to_long() > UINT8_MAX)
+                return false;
+        return true;
+    }
+
+public:
+    explicit visit_eterm_canonical(Sink& a_sink) : m_sink(a_sink) {}
+
+    void operator()(bool a) const {
+        if (a) atom_name("true", 4);
+        else   atom_name("false", 5);
+    }
+
+    void operator()(long a) const {
+        if (a >= 0 && a <= UINT8_MAX) {
+            put8(ERL_SMALL_INTEGER_EXT);
+            put8(uint8_t(a));
+        } else if (a >= INT32_MIN && a <= INT32_MAX) {
+            put8(ERL_INTEGER_EXT);
+            put32(uint32_t(a));
+        } else {
+            uint64_t n = a < 0 ? -uint64_t(a) : uint64_t(a);
+            uint8_t  digits[8], len = 0;
+            for (; n; n >>= 8)
+                digits[len++] = uint8_t(n);
+            put8(ERL_SMALL_BIG_EXT);
+            put8(len);
+            put8(a < 0);
+            put(digits, len);
+        }
+    }
+
+    void operator()(double a) const {
+        if (a == 0.0) a = 0.0; // -0.0 is equal to 0.0
+        uint64_t n;
+        memcpy(&n, &a, sizeof(n));
+        char b[8], *s = b;
+        put64be(s, n);
+        put8(NEW_FLOAT_EXT);
+        put(b, sizeof(b));
+    }
+
+    void operator()(const atom& a) const { atom_name(a.c_str(), a.size()); }
+
+    void operator()(const string<Alloc>& a) const {
+        size_t n = a.size();
+        if (n == 0)
+            put8(ERL_NIL_EXT);
+        else if (n <= UINT16_MAX) {
+            put8(ERL_STRING_EXT);
+            put16(uint16_t(n));
+            put(a.c_str(), n);
+        } else {
+            tag32(ERL_LIST_EXT, n, "LIST_EXT");
+            for (const char* p = a.c_str(), *e = p + n; p != e; ++p) {
+                put8(ERL_SMALL_INTEGER_EXT);
+                put8(uint8_t(*p));
+            }
+            put8(ERL_NIL_EXT);
+        }
+    }
+
+    void operator()(const binary<Alloc>& a) const {
+        tag32(ERL_BINARY_EXT, a.size(), "BINARY_EXT");
+        put(a.data(), a.size());
+    }
+
+    void operator()(const bitstring<Alloc>& a) const {
+        if (a.is_binary())
+            return (*this)(a.bin());
+        tag32(ERL_BIT_BINARY_EXT, a.size(), "BIT_BINARY_EXT");
+        put8(a.tail_bits());
+        put(a.data(), a.size() - 1);
+        put8(uint8_t(a.bits((a.size() - 1) * 8, a.tail_bits()) << (8 - a.tail_bits())));
+    }
+
+    void operator()(const epid<Alloc>& a) const { verbatim(a); }
+    void operator()(const port<Alloc>& a) const { verbatim(a); }
+    void operator()(const ref<Alloc>&  a) const { verbatim(a); }
+
+    void operator()(const tuple<Alloc>& a) const {
+        size_t n = a.size();
+        if (n > UINT8_MAX)
+            tag32(ERL_LARGE_TUPLE_EXT, n, "LARGE_TUPLE_EXT");
+        else {
+            put8(ERL_SMALL_TUPLE_EXT);
+            put8(uint8_t(n));
+        }
+        for (size_t i = 0; i < n; ++i)
+            this->apply_visitor(a[i]);
+    }
+
+    void operator()(const trace<Alloc>& a) const { (*this)(a.to_tuple()); }
+
+    void operator()(const list<Alloc>& a) const {
+        size_t n = a.length();
+        if (n == 0) {
+            put8(ERL_NIL_EXT);
+            return;
+        }
+        if (is_byte_list(a)) {
+            put8(ERL_STRING_EXT);
+            put16(uint16_t(n));
+            for (auto it = a.begin(), e = a.end(); it != e; ++it)
+                put8(uint8_t(it->to_long()));
+            return;
+        }
+        tag32(ERL_LIST_EXT, n, "LIST_EXT");
+        for (auto it = a.begin(), e = a.end(); it != e; ++it)
+            this->apply_visitor(*it);
+        put8(ERL_NIL_EXT);
+    }
+
+    void operator()(const map<Alloc>& a) const {
+        // Map keys are kept sorted in the exact term order
+        tag32(ERL_MAP_EXT, a.size(), "MAP_EXT");
+        for (auto& kv : a) {
+            this->apply_visitor(kv.first);
+            this->apply_visitor(kv.second);
+        }
+    }
+
+    void operator()(const bigint<Alloc>& a) const {
+        if (a.fits_int64())
+            return (*this)(long(a.to_int64()));
+        size_t n = a.byte_size();
+        if (n > UINT8_MAX)
+            tag32(ERL_LARGE_BIG_EXT, n, "LARGE_BIG_EXT");
+        else {
+            put8(ERL_SMALL_BIG_EXT);
+            put8(uint8_t(n));
+        }
+        put8(a.negative());
+        for (size_t i = 0; i < n; ++i)
+            put8(a.byte(i));
+    }
+
+    void operator()(const raw<Alloc>& a) const { put(a.data(), a.size()); }
+
+    void operator()(const var&) const {
+        throw err_encode_exception("Cannot encode vars!");
+    }
+};
+
+} // namespace marshal
+} // namespace eixx
+
+#endif // _IMPL_VISIT_CANONICAL_HPP_
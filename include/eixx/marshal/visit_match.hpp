@@ -31,6 +31,7 @@ limitations under the License.
 #include <eixx/marshal/visit.hpp>
 #include <eixx/marshal/tuple.hpp>
 #include <eixx/marshal/list.hpp>
+#include <eixx/marshal/map.hpp>
 #include <eixx/marshal/var.hpp>
 #include <ei.h>
 
@@ -49,6 +50,7 @@ public:
 
     bool operator()(const tuple<Alloc>& a) const { return a.match(m_pattern, m_binding); }
     bool operator()(const list<Alloc>&  a) const { return a.match(m_pattern, m_binding); }
+    bool operator()(const map<Alloc>&   a) const { return a.match(m_pattern, m_binding); }
     bool operator()(const var&          a) const { return a.match(m_pattern, m_binding); }
 
     template <typename T>
@@ -0,0 +1,305 @@
+//----------------------------------------------------------------------------
+/// \file  visit_phash2.hpp
+//----------------------------------------------------------------------------
+/// \brief A visitor computing a term's hash compatible with erlang:phash2/1.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _IMPL_VISIT_PHASH2_HPP_
+#define _IMPL_VISIT_PHASH2_HPP_
+
+#include <string.h>
+#include <vector>
+#include <eixx/marshal/visit.hpp>
+#include <eixx/eterm_exception.hpp>
+#include <ei.h>
+
+namespace eixx {
+namespace marshal {
+
+/**
+ * Visitor computing the portable hash of a term the same way as the
+ * make_hash2() function of the Erlang VM does, so that the value of
+ * erlang:phash2/1,2 can be reproduced for atoms, numbers, binaries,
+ * strings, lists, tuples and maps.  Pids, ports and references are
+ * hashed by their local numbers, and their hash shouldn't be relied upon
+ * to match across nodes.
+ */
+template <typename Alloc>
+class visit_eterm_phash2
+    : public static_visitor<visit_eterm_phash2<Alloc>, void> {
+
+    static const uint32_t HCONST = 0x9e3779b9;
+
+    static constexpr uint32_t hconst(uint32_t n) { return n * HCONST; }
+
+    mutable uint32_t m_hash;
+
+    static void mix(uint32_t& a, uint32_t& b, uint32_t& c) {
+        a -= b; a -= c; a ^= (c >> 13);
+        b -= c; b -= a; b ^= (a << 8);
+        c -= a; c -= b; c ^= (b >> 13);
+        a -= b; a -= c; a ^= (c >> 12);
+        b -= c; b -= a; b ^= (a << 16);
+        c -= a; c -= b; c ^= (b >> 5);
+        a -= b; a -= c; a ^= (c >> 3);
+        b -= c; b -= a; b ^= (a << 10);
+        c -= a; c -= b; c ^= (b >> 15);
+    }
+
+    void hash2(uint32_t x, uint32_t y, uint32_t k) const {
+        uint32_t a = k + x, b = k + y;
+        mix(a, b, m_hash);
+    }
+
+    void hash1(uint32_t x, uint32_t k) const { hash2(x, 0, k); }
+
+    static uint32_t atom_hash(const char* p, size_t len) {
+        uint32_t h = 0, g;
+        while (len--) {
+            uint8_t v = *p++;
+            // Latin1 characters are hashed by their code, not UTF-8 bytes
+            if (len && (v & 0xFE) == 0xC2 && (*p & 0xC0) == 0x80) {
+                v = (v << 6) | (*p++ & 0x3F);
+                len--;
+            }
+            h = (h << 4) + v;
+            if ((g = h & 0xf0000000)) {
+                h ^= (g >> 24);
+                h ^= g;
+            }
+        }
+        return h;
+    }
+
+    static uint32_t block_hash(const uint8_t* k, size_t length, uint32_t initval) {
+        uint32_t a = HCONST, b = HCONST, c = initval;
+        size_t   len = length;
+        auto le32 = [](const uint8_t* p) {
+            return p[0] | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+        };
+        for (; len >= 12; k += 12, len -= 12) {
+            a += le32(k); b += le32(k+4); c += le32(k+8);
+            mix(a, b, c);
+        }
+        c += (uint32_t)length;
+        switch (len) {
+            case 11: c += uint32_t(k[10]) << 24; [[fallthrough]];
+            case 10: c += uint32_t(k[9])  << 16; [[fallthrough]];
+            case 9:  c += uint32_t(k[8])  << 8;  [[fallthrough]];
+            case 8:  b += uint32_t(k[7])  << 24; [[fallthrough]];
+            case 7:  b += uint32_t(k[6])  << 16; [[fallthrough]];
+            case 6:  b += uint32_t(k[5])  << 8;  [[fallthrough]];
+            case 5:  b += k[4];                  [[fallthrough]];
+            case 4:  a += uint32_t(k[3])  << 24; [[fallthrough]];
+            case 3:  a += uint32_t(k[2])  << 16; [[fallthrough]];
+            case 2:  a += uint32_t(k[1])  << 8;  [[fallthrough]];
+            case 1:  a += k[0];
+        }
+        mix(a, b, c);
+        return c;
+    }
+
+    void nil() const {
+        if (m_hash == 0) m_hash = 3468870702u;
+        else             hash1(2, hconst(2));
+    }
+
+    void atom_name(const char* a_name, size_t a_len) const {
+        uint32_t h = atom_hash(a_name, a_len);
+        if (m_hash == 0) m_hash = h;
+        else             hash1(h, hconst(3));
+    }
+
+    /// Hash an integer magnitude given as little-endian 32-bit words
+    /// without a zero most significant word the way the emulator hashes
+    /// bignums: one word at a time, so that 32 and 64-bit VMs agree.
+    void bignum(const uint32_t* a_words, size_t a_n, bool a_neg) const {
+        uint32_t con = a_neg ? hconst(10) : hconst(11);
+        for (size_t i = 0; i < a_n; ++i)
+            hash1(a_words[i], con);
+    }
+
+    void hash_byte(uint32_t& sh, int& c, uint8_t a_byte) const {
+        sh = (sh << 8) + a_byte;
+        if (c == 3) {
+            hash1(sh, hconst(4));
+            c = 0; sh = 0;
+        } else
+            c++;
+    }
+
+public:
+    explicit visit_eterm_phash2(uint32_t a_hash = 0) : m_hash(a_hash) {}
+
+    /// Accumulated hash value
+    uint32_t hash() const { return m_hash; }
+
+    void operator()(bool a) const {
+        if (a) atom_name("true", 4);
+        else   atom_name("false", 5);
+    }
+
+    void operator()(long a) const {
+        if (a >= -(1l << 27) && a < (1l << 27)) {
+            if (a < 0) hash1(uint32_t(-a), HCONST);
+            hash1(uint32_t(a), HCONST);
+            return;
+        }
+        uint64_t t = a < 0 ? -uint64_t(a) : uint64_t(a);
+        uint32_t w[2] = {uint32_t(t), uint32_t(t >> 32)};
+        bignum(w, w[1] ? 2 : 1, a < 0);
+    }
+
+    void operator()(double a) const {
+        if (a == 0.0) a = 0.0; // -0.0 hashes as 0.0
+        // The emulator hashes the most significant word first
+        uint64_t w;
+        memcpy(&w, &a, sizeof(w));
+        hash2(uint32_t(w >> 32), uint32_t(w), hconst(12));
+    }
+
+    void operator()(const atom& a) const { atom_name(a.c_str(), a.size()); }
+
+    void operator()(const string<Alloc>& a) const {
+        // A string is a list of bytes
+        uint32_t sh = 0; int c = 0;
+        for (const char* p = a.c_str(), *e = p + a.size(); p != e; ++p)
+            hash_byte(sh, c, (uint8_t)*p);
+        if (c > 0)
+            hash1(sh, hconst(4));
+        nil();
+    }
+
+    void operator()(const binary<Alloc>& a) const {
+        uint32_t con = hconst(13) + m_hash;
+        m_hash = a.size() == 0
+               ? con : block_hash((const uint8_t*)a.data(), a.size(), con);
+    }
+
+    void operator()(const bitstring<Alloc>& a) const {
+        if (a.is_binary())
+            return (*this)(a.bin());
+        // Whole bytes are hashed as a binary followed by the tail bits
+        size_t n = a.size() - 1;
+        m_hash = block_hash((const uint8_t*)a.data(), n, hconst(13) + m_hash);
+        hash2(a.tail_bits(), uint32_t(a.bits(n * 8, a.tail_bits())), hconst(15));
+    }
+
+    void operator()(const epid<Alloc>& a) const { hash1(a.id(), hconst(5)); }
+    void operator()(const port<Alloc>& a) const { hash1(uint32_t(a.id()), hconst(6)); }
+    void operator()(const ref<Alloc>&  a) const { hash1(a.id(0), hconst(7)); }
+
+    void operator()(const tuple<Alloc>& a) const {
+        hash1(uint32_t(a.size()), hconst(9));
+        for (size_t i = 0, n = a.size(); i < n; ++i)
+            this->apply_visitor(a[i]);
+    }
+
+    void operator()(const list<Alloc>& a) const {
+        uint32_t sh = 0; int c = 0;
+        for (auto it = a.begin(), e = a.end(); it != e; ++it) {
+            if (it->type() == LONG && it->to_long() >= 0 && it->to_long() <= 255) {
+                hash_byte(sh, c, (uint8_t)it->to_long());
+                continue;
+            }
+            if (c > 0) {
+                hash1(sh, hconst(4));
+                c = 0; sh = 0;
+            }
+            this->apply_visitor(*it);
+        }
+        if (c > 0)
+            hash1(sh, hconst(4));
+        nil();
+    }
+
+    void operator()(const map<Alloc>& a) const {
+        hash1(uint32_t(a.size()), hconst(16));
+        if (a.size() == 0)
+            return;
+        // Pairs are combined with xor so that the order doesn't matter
+        uint32_t saved = m_hash, pairs = 0;
+        for (auto& kv : a) {
+            m_hash = 0;
+            this->apply_visitor(kv.first);
+            this->apply_visitor(kv.second);
+            pairs ^= m_hash;
+        }
+        m_hash = saved;
+        hash1(pairs, hconst(19));
+    }
+
+    void operator()(const trace<Alloc>& a) const {
+        // Sequential trace token is the {Flags, Label, Serial, From, Prev} tuple
+        hash1(5, hconst(9));
+        (*this)(a.flags());
+        (*this)(a.label());
+        (*this)(a.serial());
+        (*this)(a.from());
+        (*this)(a.prev());
+    }
+
+    void operator()(const bigint<Alloc>& a) const {
+        if (a.fits_int64())
+            return (*this)(long(a.to_int64()));
+        std::vector<uint32_t> w;
+        w.reserve(2 * a.size());
+        for (size_t i = 0, n = a.size(); i < n; ++i) {
+            w.push_back(uint32_t(a.limbs()[i]));
+            w.push_back(uint32_t(a.limbs()[i] >> 32));
+        }
+        if (!w.back())
+            w.pop_back();
+        bignum(w.data(), w.size(), a.negative());
+    }
+
+    void operator()(const raw<Alloc>& a) const {
+        auto p = (const uint8_t*)a.data();
+        size_t n, hdr;
+        switch (a.tag()) {
+            case ERL_SMALL_BIG_EXT: n = p[1]; hdr = 3; break;
+            case ERL_LARGE_BIG_EXT: n = uint32_t(p[1])<<24 | p[2]<<16 | p[3]<<8 | p[4]; hdr = 6; break;
+            default:
+                throw err_bad_argument("Cannot hash raw term with tag", int(a.tag()));
+        }
+        if (hdr + n > a.size())
+            throw err_invalid_term("Invalid bignum term");
+        bool neg = p[hdr-1] != 0;
+        p += hdr;
+        while (n && p[n-1] == 0) --n;
+        std::vector<uint32_t> w((n + 3) / 4, 0);
+        for (size_t i = 0; i < n; ++i)
+            w[i / 4] |= uint32_t(p[i]) << (8 * (i % 4));
+        bignum(w.data(), w.size(), neg);
+    }
+
+    void operator()(const var& a) const {
+        throw err_bad_argument("Cannot hash variable", a.name());
+    }
+};
+
+} // namespace marshal
+} // namespace eixx
+
+#endif // _IMPL_VISIT_PHASH2_HPP_
@@ -31,6 +31,8 @@ limitations under the License.
 #include <stdexcept>
 #include <functional>
 #include <limits>
+#include <memory>
+#include <vector>
 #include <boost/lockfree/queue.hpp>
 #include <boost/asio/system_timer.hpp>
 #include <boost/asio.hpp>
@@ -46,6 +48,12 @@ using namespace boost::system::errc;
 /**
  * Implements an asyncronous multiple-writer-single-reader queue
  * for use with BOOST ASIO.
+ *
+ * The queue may have several priority levels (level 0 being the most
+ * urgent), in which case items of higher levels are dequeued first.
+ * To avoid starvation of lower levels, after starvation_limit() items
+ * dequeued in a row from higher levels one item is taken from the
+ * lowest non-empty level.
  */
 template<typename T, typename Alloc = std::allocator<char>>
 struct async_queue : boost::enable_shared_from_this<async_queue<T, Alloc>>
@@ -59,13 +67,57 @@ struct async_queue : boost::enable_shared_from_this<async_queue<T, Alloc>>
 private:
     boost::asio::io_service&        m_io;
     queue_type                      m_queue;
+    std::vector<std::unique_ptr<queue_type>> m_levels; // Levels below m_queue
+    Alloc                           m_alloc;
     int                             m_batch_size;
+    unsigned                        m_starvation_limit;
+    unsigned                        m_run;  // Items dequeued in a row above the lowest level
     boost::asio::system_timer       m_timer;
 
     int dec_repeat_count(int n) {
         return n == std::numeric_limits<int>::max() || !n ? n : n-1;
     }
 
+    queue_type& level(size_t n) { return n ? *m_levels[n-1] : m_queue; }
+
+    bool pop(T& value) {
+        if (m_levels.empty())
+            return m_queue.pop(value);
+
+        if (m_starvation_limit && m_run >= m_starvation_limit) {
+            m_run = 0;
+            for (size_t i = m_levels.size(); i > 0; --i)
+                if (m_levels[i-1]->pop(value))
+                    return true;
+        }
+
+        for (size_t i = 0, n = levels(); i < n; ++i)
+            if (level(i).pop(value)) {
+                m_run = i == n-1 ? 0 : m_run+1;
+                return true;
+            }
+        return false;
+    }
+
+    bool has_data() const {
+        if (!m_queue.empty())
+            return true;
+        for (auto& q : m_levels)
+            if (!q->empty())
+                return true;
+        return false;
+    }
+
+    // Arm the timer to expire in \a d.  An infinite wait is set as an
+    // absolute time, as adding milliseconds::max() to the clock overflows
+    // and would make the timer fire immediately.
+    void expire_in(std::chrono::milliseconds d) {
+        if (d == std::chrono::milliseconds::max())
+            m_timer.expires_at(boost::asio::system_timer::time_point::max());
+        else
+            m_timer.expires_from_now(d);
+    }
+
     // Dequeue up to m_batch_size of items and for each one call
     // m_wait_handler
     template <typename Handler>
@@ -77,7 +129,7 @@ private:
         int  i = 0;        // Number of handler invocations
 
         T value;
-        while (i < m_batch_size && m_queue.pop(value)) {
+        while (i < m_batch_size && pop(value)) {
             i++;
             repeat_count = dec_repeat_count(repeat_count);
             if (!h(value, boost::system::error_code()))
@@ -91,7 +143,7 @@ private:
 
         // If we reached the batch size and queue has more data
         // to process - give up the time slice and reschedule the handler
-        if (i == m_batch_size && !m_queue.empty()) {
+        if (i == m_batch_size && has_data()) {
             m_io.post([pthis, h, repeat, repeat_count]() {
                 (*pthis)(h, boost::asio::error::operation_aborted, repeat, repeat_count);
             });
@@ -107,7 +159,7 @@ private:
         // If requested repeated timer, schedule new timer invocation
         if (repeat > std::chrono::milliseconds(0) && n > 0) {
             m_timer.cancel();
-            m_timer.expires_from_now(repeat);
+            expire_in(repeat);
             m_timer.async_wait(
                 [pthis, h, repeat, n]
                 (const boost::system::error_code& ec) {
@@ -128,7 +180,10 @@ public:
         int a_batch_size = 16, const Alloc& a_alloc = Alloc())
         : m_io(a_io)
         , m_queue(a_alloc)
+        , m_alloc(a_alloc)
         , m_batch_size(a_batch_size)
+        , m_starvation_limit(0)
+        , m_run(0)
         , m_timer(a_io)
     {}
 
@@ -140,19 +195,44 @@ public:
         cancel();
 
         T value;
-        while (m_queue.pop(value));
+        while (pop(value));
     }
 
     int  batch_size() const { return m_batch_size; }
     void batch_size(int sz) { m_batch_size = sz;   }
 
+    /// Number of priority levels of the queue.
+    size_t   levels()           const { return m_levels.size() + 1; }
+    /// Max number of items dequeued in a row from higher priority levels
+    /// while lower levels are waiting (0 - unlimited).
+    unsigned starvation_limit() const { return m_starvation_limit; }
+
+    /// Set the number of priority levels. Items of the removed levels are
+    /// moved to the new lowest level.  The call isn't synchronized with
+    /// enqueue(), so it must be made by the reader before any writer uses
+    /// the queue.
+    void levels(size_t a_levels, unsigned a_starvation_limit) {
+        if (!a_levels)
+            a_levels = 1;
+        while (levels() < a_levels)
+            m_levels.emplace_back(new queue_type(m_alloc));
+        T value;
+        for (; levels() > a_levels; m_levels.pop_back())
+            while (m_levels.back()->pop(value))
+                level(a_levels-1).push(value);
+        m_starvation_limit = a_starvation_limit;
+        m_run = 0;
+    }
+
     bool cancel() {
         boost::system::error_code ec;
         return m_timer.cancel(ec);
     }
 
-    bool enqueue(T const& data, bool notify = true) {
-        if (!m_queue.push(data))
+    /// Enqueue the \a data at the given priority \a a_level (the lowest
+    /// level is used if \a a_level is out of range).
+    bool enqueue(T const& data, bool notify = true, size_t a_level = 0) {
+        if (!level(std::min(a_level, levels()-1)).push(data))
             return false;
 
         if (!notify) return true;
@@ -164,7 +244,16 @@ public:
     }
 
     bool dequeue(T& value) {
-        return m_queue.pop(value);
+        return pop(value);
+    }
+
+    /// Dequeue an item from the lowest non-empty priority level, not
+    /// looking above the level \a a_min_level.
+    bool dequeue_lowest(T& value, size_t a_min_level = 0) {
+        for (size_t i = levels(); i > a_min_level; --i)
+            if (level(i-1).pop(value))
+                return true;
+        return false;
     }
 
     /// Call \a a_on_data handler asyncronously on next message in the queue.
@@ -184,7 +273,7 @@ public:
         int repeat_count = 0)
     {
         T value;
-        if (m_queue.pop(value)) {
+        if (pop(value)) {
             if (!a_on_data(value, boost::system::error_code()))
                 return true;
             if (repeat_count > 0) --repeat_count;
@@ -201,17 +290,17 @@ public:
                 : a_wait_duration;
 
         if (timeout == std::chrono::milliseconds(0))
-            m_io.post([this, &a_on_data, timeout, rep]() {
-                (*this->shared_from_this())(
-                    a_on_data, boost::system::error_code(), timeout, rep);
+            // The handler is copied, as the caller's one may be a temporary
+            m_io.post([pthis = this->shared_from_this(), a_on_data, timeout, rep]() {
+                (*pthis)(a_on_data, boost::system::error_code(), timeout, rep);
             });
         else {
             boost::system::error_code ec;
             m_timer.cancel(ec);
-            m_timer.expires_from_now(timeout);
+            expire_in(timeout);
             auto pthis = this->shared_from_this();
             m_timer.async_wait(
-                [pthis, &a_on_data, timeout, rep]
+                [pthis, a_on_data, timeout, rep]
                 (const boost::system::error_code& e) {
                     (*pthis)(a_on_data, e, timeout, rep);
                 }
@@ -29,6 +29,22 @@
 #define ERL_DEMONITOR_P     20
 #define ERL_MONITOR_P_EXIT  21
 
+// Control messages of OTP 23+ that aren't defined by older EI headers
+#ifndef ERL_SPAWN_REQUEST
+#define ERL_SPAWN_REQUEST     29
+#define ERL_SPAWN_REQUEST_TT  30
+#define ERL_SPAWN_REPLY       31
+#define ERL_SPAWN_REPLY_TT    32
+#endif
+#ifndef ERL_ALIAS_SEND
+#define ERL_ALIAS_SEND      33
+#define ERL_ALIAS_SEND_TT   34
+#endif
+#ifndef ERL_UNLINK_ID
+#define ERL_UNLINK_ID       35
+#define ERL_UNLINK_ID_ACK   36
+#endif
+
 namespace eixx {
 
 #if BOOST_VERSION >= 104800
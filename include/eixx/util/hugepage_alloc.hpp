@@ -0,0 +1,325 @@
+//----------------------------------------------------------------------------
+/// \file  hugepage_alloc.hpp
+//----------------------------------------------------------------------------
+/// \brief Allocator taking memory from NUMA-local 2MB hugepage arenas.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _EIXX_HUGEPAGE_ALLOC_HPP_
+#define _EIXX_HUGEPAGE_ALLOC_HPP_
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace eixx {
+namespace util {
+
+/**
+ * Memory arena made of 2MB regions backed by hugepages and bound to a
+ * NUMA node.  Regions are mapped with MAP_HUGETLB when hugepages are
+ * reserved in the system, and otherwise are 2MB-aligned regular mappings
+ * advised with MADV_HUGEPAGE to be backed by transparent hugepages.
+ *
+ * Blocks of up to 1MB are carved out of the regions and recycled through
+ * per-size free lists.  Larger blocks take spans of contiguous regions,
+ * which are kept on a free list when released and reused by blocks
+ * needing spans of the same length, so that buffers of large messages
+ * don't map and unmap memory on every allocation.  Memory is returned to
+ * the system only when the arena is destroyed.  Every region or span
+ * starts at a 2MB boundary with a header pointing to its arena, so a
+ * block can be freed by any thread without knowing where it was
+ * allocated.  The arena is thread-safe and must outlive all memory
+ * allocated from it.
+ */
+class hugepage_arena : private boost::noncopyable {
+    struct header {
+        hugepage_arena* arena;  ///< Owner of the region or span
+        size_t          size;   ///< Length of a span of a large block (0 - region)
+        header*         next;   ///< Next free span of the arena
+    };
+    static const size_t HEADER_SIZE = 64;
+public:
+    static const size_t REGION_SIZE = 2*1024*1024;
+    static const size_t MAX_SMALL   = REGION_SIZE / 2;
+
+    /// @param a_numa_node is the NUMA node to bind the memory to
+    ///        (-1 - don't bind).
+    /// @param a_hugetlb when false, MAP_HUGETLB isn't attempted.
+    explicit hugepage_arena(int a_numa_node = current_numa_node(), bool a_hugetlb = true)
+        : m_numa_node(a_numa_node), m_hugetlb(a_hugetlb)
+        , m_bound(a_numa_node >= 0 && a_numa_node < MAX_NUMA_NODES)
+        , m_cur(nullptr), m_end(nullptr), m_free_spans(nullptr)
+    {
+        for (auto& p : m_free) p = nullptr;
+    }
+
+    ~hugepage_arena() {
+        for (auto& r : m_regions)
+            ::munmap(r, REGION_SIZE);
+        for (auto& r : m_spans)
+            ::munmap(r, static_cast<header*>(r)->size);
+    }
+
+    /// Process-wide arena bound to the given NUMA node (-1 - unbound).
+    static hugepage_arena& for_node(int a_numa_node) {
+        static std::atomic<hugepage_arena*> s_arenas[MAX_NUMA_NODES+1];
+        static std::mutex                   s_mutex;
+        size_t i = a_numa_node >= 0 && a_numa_node < MAX_NUMA_NODES
+                 ? a_numa_node : MAX_NUMA_NODES;
+        auto p = s_arenas[i].load(std::memory_order_acquire);
+        if (!p) {
+            std::lock_guard<std::mutex> guard(s_mutex);
+            // Never destroyed, as static objects may release memory at exit
+            if (!(p = s_arenas[i].load(std::memory_order_relaxed)))
+                s_arenas[i].store(p = new hugepage_arena(i < MAX_NUMA_NODES ? int(i) : -1),
+                                  std::memory_order_release);
+        }
+        return *p;
+    }
+
+    /// Arena used by the allocations of the calling thread.  Unless set
+    /// with use(), it's the arena of the thread's NUMA node.
+    static hugepage_arena& local() {
+        hugepage_arena*& p = thread_arena();
+        if (!p)
+            p = &for_node(current_numa_node());
+        return *p;
+    }
+
+    /// Make the calling thread allocate memory from \a a_arena
+    /// (nullptr - from the arena of the thread's NUMA node).
+    static void use(hugepage_arena* a_arena) { thread_arena() = a_arena; }
+
+    /// NUMA node of the CPU the calling thread runs on (-1 if unknown).
+    static int current_numa_node() {
+#ifdef SYS_getcpu
+        unsigned cpu, node;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+            return int(node);
+#endif
+        return -1;
+    }
+
+    void* allocate(size_t n) {
+        if (n > MAX_SMALL)
+            return allocate_span(round_up(n + HEADER_SIZE, REGION_SIZE));
+
+        size_t cls = size_class(n), sz = class_size(cls);
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_free[cls]) {
+            void* p = m_free[cls];
+            m_free[cls] = *static_cast<void**>(p);
+            return p;
+        }
+        if (size_t(m_end - m_cur) < sz) {
+            m_regions.reserve(m_regions.size()+1);
+            auto hdr   = static_cast<header*>(map(REGION_SIZE));
+            hdr->arena = this;
+            hdr->size  = 0;
+            m_regions.push_back(hdr);
+            m_cur = reinterpret_cast<char*>(hdr) + HEADER_SIZE;
+            m_end = reinterpret_cast<char*>(hdr) + REGION_SIZE;
+        }
+        void* p = m_cur;
+        m_cur  += sz;
+        return p;
+    }
+
+    /// Release a block to the arena it was allocated from.
+    /// @param n must be the size that was passed to allocate().
+    static void deallocate(void* p, size_t n) noexcept {
+        if (!p)
+            return;
+        auto hdr = reinterpret_cast<header*>(uintptr_t(p) & ~uintptr_t(REGION_SIZE-1));
+        hugepage_arena* a = hdr->arena;
+        std::lock_guard<std::mutex> guard(a->m_mutex);
+        if (hdr->size) {
+            hdr->next       = a->m_free_spans;
+            a->m_free_spans = hdr;
+            return;
+        }
+        size_t cls = size_class(n);
+        *static_cast<void**>(p) = a->m_free[cls];
+        a->m_free[cls] = p;
+    }
+
+    /// NUMA node the memory is bound to (-1 - not bound).
+    int    numa_node() const { return m_bound ? m_numa_node : -1; }
+    /// True if the regions are backed by reserved (MAP_HUGETLB) hugepages.
+    bool   hugetlb()   const { return m_hugetlb; }
+    /// Number of 2MB regions mapped for small blocks.
+    size_t regions()   const { std::lock_guard<std::mutex> g(m_mutex); return m_regions.size(); }
+    /// Number of spans mapped for large blocks.
+    size_t spans()     const { std::lock_guard<std::mutex> g(m_mutex); return m_spans.size(); }
+
+private:
+    static const size_t MIN_SMALL = 16;
+    static const size_t NCLASSES  = 17;   // 16 .. 1MB
+    static const int    MAX_NUMA_NODES = 1024;
+
+    static hugepage_arena*& thread_arena() {
+        static thread_local hugepage_arena* s_arena = nullptr;
+        return s_arena;
+    }
+
+    static size_t page_size() {
+        static const size_t s_size = ::sysconf(_SC_PAGESIZE);
+        return s_size;
+    }
+
+    static size_t round_up(size_t n, size_t a) { return (n + a - 1) & ~(a - 1); }
+
+    static size_t size_class(size_t n) {
+        return n <= MIN_SMALL ? 0 : 64 - __builtin_clzll(n - 1) - 4;
+    }
+
+    static size_t class_size(size_t cls) { return MIN_SMALL << cls; }
+
+    /// Get a span of \a a_len bytes, reusing a released one of that length.
+    void* allocate_span(size_t a_len) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        for (header** pp = &m_free_spans; *pp; pp = &(*pp)->next)
+            if ((*pp)->size == a_len) {
+                header* hdr = *pp;
+                *pp = hdr->next;
+                return reinterpret_cast<char*>(hdr) + HEADER_SIZE;
+            }
+        m_spans.reserve(m_spans.size()+1);
+        auto hdr   = static_cast<header*>(map(a_len));
+        hdr->arena = this;
+        hdr->size  = a_len;
+        m_spans.push_back(hdr);
+        return reinterpret_cast<char*>(hdr) + HEADER_SIZE;
+    }
+
+    /// Map \a len bytes at a 2MB boundary.
+    void* map(size_t len) {
+        void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (m_hugetlb && len % REGION_SIZE == 0) {
+            p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            // No reserved hugepages - use transparent hugepages from now on
+            if (p == MAP_FAILED)
+                m_hugetlb = false;
+        }
+#endif
+        if (p == MAP_FAILED) {
+            // Over-allocate to align the mapping on the hugepage boundary
+            size_t total = len + REGION_SIZE - page_size();
+            char*  q = static_cast<char*>(::mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (q == MAP_FAILED)
+                throw std::bad_alloc();
+            char* a = reinterpret_cast<char*>(round_up(uintptr_t(q), REGION_SIZE));
+            if (a != q)
+                ::munmap(q, a - q);
+            if (a + len != q + total)
+                ::munmap(a + len, q + total - (a + len));
+            p = a;
+#ifdef MADV_HUGEPAGE
+            if (len >= REGION_SIZE)
+                ::madvise(p, len, MADV_HUGEPAGE);
+#endif
+        }
+        bind(p, len);
+        return p;
+    }
+
+    /// Bind memory to the arena's NUMA node.  Failures (e.g. a kernel
+    /// without NUMA support) are not fatal.
+    void bind(void* p, size_t len) {
+#ifdef SYS_mbind
+        static const int MPOL_BIND_MODE = 2;    // MPOL_BIND from <linux/mempolicy.h>
+        const  size_t    bits = 8*sizeof(unsigned long);
+        if (!m_bound)
+            return;
+        unsigned long mask[MAX_NUMA_NODES / bits] = {0};
+        mask[m_numa_node / bits] = 1ul << (m_numa_node % bits);
+        if (::syscall(SYS_mbind, p, len, MPOL_BIND_MODE, mask, sizeof(mask)*8 + 1, 0) < 0)
+            m_bound = false;
+#else
+        (void)p; (void)len;
+        m_bound = false;
+#endif
+    }
+
+    const int           m_numa_node;
+    std::atomic<bool>   m_hugetlb;
+    std::atomic<bool>   m_bound;
+    mutable std::mutex  m_mutex;
+    char*               m_cur;
+    char*               m_end;
+    void*               m_free[NCLASSES];
+    header*             m_free_spans;
+    std::vector<void*>  m_regions;
+    std::vector<void*>  m_spans;
+};
+
+/**
+ * Stateless allocator taking memory from hugepage arenas.  Memory is
+ * allocated from the arena of the calling thread (see hugepage_arena::local()),
+ * so the buffers of a connection or a mailbox are placed on the NUMA node
+ * of the thread that owns it, and can be released by any thread.
+ * To use it for a node, instantiate basic_otp_node with this allocator
+ * (or include <eixx/alloc_hugepage.hpp>).
+ */
+template <typename T>
+class hugepage_allocator {
+public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U> struct rebind { typedef hugepage_allocator<U> other; };
+
+    hugepage_allocator() noexcept {}
+    template <typename U>
+    hugepage_allocator(const hugepage_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(hugepage_arena::local().allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept { hugepage_arena::deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const hugepage_allocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const hugepage_allocator<U>&) const { return false; }
+};
+
+} // namespace util
+} // namespace eixx
+
+#endif // _EIXX_HUGEPAGE_ALLOC_HPP_
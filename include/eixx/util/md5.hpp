@@ -0,0 +1,144 @@
+//----------------------------------------------------------------------------
+/// \file  md5.hpp
+//----------------------------------------------------------------------------
+/// \brief Incremental MD5 (RFC 1321) used by the distribution handshake.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _EIXX_MD5_HPP_
+#define _EIXX_MD5_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+namespace eixx {
+namespace util {
+
+/**
+ * Incremental MD5.  The object is copyable, so the state after hashing
+ * a common prefix (e.g. a cookie) can be saved and reused to hash many
+ * messages starting with it.  MD5 is only used for the challenge digests
+ * of the Erlang distribution protocol.
+ */
+class md5 {
+public:
+    static const size_t DIGEST_SIZE = 16;
+
+    md5() : m_len(0) {
+        m_h[0] = 0x67452301; m_h[1] = 0xefcdab89;
+        m_h[2] = 0x98badcfe; m_h[3] = 0x10325476;
+    }
+
+    /// Hash the next \a a_size bytes of input.
+    md5& update(const void* a_data, size_t a_size) {
+        auto   p    = static_cast<const uint8_t*>(a_data);
+        size_t used = m_len & 63;
+        m_len += a_size;
+        if (used) {
+            size_t n = a_size < 64 - used ? a_size : 64 - used;
+            memcpy(m_buf + used, p, n);
+            if (used + n < 64)
+                return *this;
+            block(m_buf);
+            p += n; a_size -= n;
+        }
+        for (; a_size >= 64; p += 64, a_size -= 64)
+            block(p);
+        memcpy(m_buf, p, a_size);
+        return *this;
+    }
+
+    /// Finish hashing storing the digest in \a a_digest.  The hasher
+    /// must not be updated afterwards.
+    void digest(uint8_t a_digest[DIGEST_SIZE]) {
+        static const uint8_t s_pad[64] = {0x80};
+        uint64_t bits = m_len << 3;
+        size_t   used = m_len & 63;
+        update(s_pad, used < 56 ? 56 - used : 120 - used);
+        uint8_t  len[8];
+        for (int i=0; i < 8; i++)
+            len[i] = uint8_t(bits >> (8*i));
+        update(len, 8);
+        for (int i=0; i < 4; i++)
+            for (int j=0; j < 4; j++)
+                a_digest[4*i+j] = uint8_t(m_h[i] >> (8*j));
+    }
+
+    /// MD5 digest of \a a_size bytes of \a a_data.
+    static void digest(const void* a_data, size_t a_size, uint8_t a_digest[DIGEST_SIZE]) {
+        md5().update(a_data, a_size).digest(a_digest);
+    }
+
+private:
+    uint32_t m_h[4];
+    uint64_t m_len;         ///< Total number of bytes hashed
+    uint8_t  m_buf[64];     ///< Pending bytes of an incomplete block
+
+    static uint32_t rotl(uint32_t x, int c) { return (x << c) | (x >> (32 - c)); }
+
+    void block(const uint8_t* p) {
+        static const uint32_t s_k[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+            0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+            0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+            0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+            0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+            0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+            0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+            0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+            0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+        };
+        static const int s_r[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+        uint32_t m[16];
+        for (int i=0; i < 16; i++)
+            m[i] = uint32_t(p[4*i]) | uint32_t(p[4*i+1]) << 8
+                 | uint32_t(p[4*i+2]) << 16 | uint32_t(p[4*i+3]) << 24;
+
+        uint32_t a = m_h[0], b = m_h[1], c = m_h[2], d = m_h[3];
+        for (int i=0; i < 64; i++) {
+            uint32_t f;
+            int      g;
+            switch (i >> 4) {
+                case 0:  f = (b & c) | (~b & d); g = i;            break;
+                case 1:  f = (d & b) | (~d & c); g = (5*i + 1) & 15; break;
+                case 2:  f = b ^ c ^ d;          g = (3*i + 5) & 15; break;
+                default: f = c ^ (b | ~d);       g = (7*i) & 15;     break;
+            }
+            uint32_t t = d;
+            d = c;
+            c = b;
+            b = b + rotl(a + f + s_k[i] + m[g], s_r[(i >> 4) * 4 + (i & 3)]);
+            a = t;
+        }
+        m_h[0] += a; m_h[1] += b; m_h[2] += c; m_h[3] += d;
+    }
+};
+
+} // namespace util
+} // namespace eixx
+
+#endif // _EIXX_MD5_HPP_
@@ -0,0 +1,138 @@
+//----------------------------------------------------------------------------
+/// \file  siphash.hpp
+//----------------------------------------------------------------------------
+/// \brief Incremental SipHash-2-4 with 128-bit output.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+Copyright 2010 Serge Aleynikov <saleyn at gmail dot com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _EIXX_SIPHASH_HPP_
+#define _EIXX_SIPHASH_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+namespace eixx {
+namespace util {
+
+/// 128-bit hash value.
+struct hash128 {
+    uint64_t lo;
+    uint64_t hi;
+
+    bool operator==(const hash128& rhs) const { return lo == rhs.lo && hi == rhs.hi; }
+    bool operator!=(const hash128& rhs) const { return !(*this == rhs); }
+    bool operator< (const hash128& rhs) const {
+        return hi < rhs.hi || (hi == rhs.hi && lo < rhs.lo);
+    }
+
+    /// Store the hash as 16 bytes in the SipHash output byte order.
+    void to_bytes(uint8_t* a_out) const {
+        for (int i=0; i < 8; i++) {
+            a_out[i]   = uint8_t(lo >> (8*i));
+            a_out[i+8] = uint8_t(hi >> (8*i));
+        }
+    }
+};
+
+/**
+ * Incremental SipHash-2-4 computing a 128-bit digest.  Data can be
+ * supplied in any number of pieces with update(), and the result
+ * doesn't depend on how it was split.
+ */
+class siphash128 {
+    uint64_t m_v0, m_v1, m_v2, m_v3;
+    uint64_t m_tail;    ///< Pending bytes of an incomplete block
+    size_t   m_len;     ///< Total number of bytes hashed
+
+    static uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+    static uint64_t le64(const uint8_t* p) {
+        uint64_t n;
+        memcpy(&n, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        n = __builtin_bswap64(n);
+#endif
+        return n;
+    }
+
+    void round() {
+        m_v0 += m_v1; m_v1 = rotl(m_v1, 13); m_v1 ^= m_v0; m_v0 = rotl(m_v0, 32);
+        m_v2 += m_v3; m_v3 = rotl(m_v3, 16); m_v3 ^= m_v2;
+        m_v0 += m_v3; m_v3 = rotl(m_v3, 21); m_v3 ^= m_v0;
+        m_v2 += m_v1; m_v1 = rotl(m_v1, 17); m_v1 ^= m_v2; m_v2 = rotl(m_v2, 32);
+    }
+
+    void block(uint64_t m) {
+        m_v3 ^= m;
+        round(); round();
+        m_v0 ^= m;
+    }
+
+public:
+    /// @param a_k0 and \a a_k1 are the two little-endian halves of the key.
+    explicit siphash128(uint64_t a_k0 = 0, uint64_t a_k1 = 0)
+        : m_v0(a_k0 ^ 0x736f6d6570736575ull)
+        , m_v1(a_k1 ^ 0x646f72616e646f6dull ^ 0xee)
+        , m_v2(a_k0 ^ 0x6c7967656e657261ull)
+        , m_v3(a_k1 ^ 0x7465646279746573ull)
+        , m_tail(0), m_len(0)
+    {}
+
+    /// Hash the next \a a_size bytes of input.
+    void update(const void* a_data, size_t a_size) {
+        auto p = static_cast<const uint8_t*>(a_data);
+        size_t used = m_len & 7;
+        m_len += a_size;
+        if (used) {
+            for (; used < 8 && a_size; --a_size, ++used)
+                m_tail |= uint64_t(*p++) << (8*used);
+            if (used < 8)
+                return;
+            block(m_tail);
+            m_tail = 0;
+        }
+        for (; a_size >= 8; p += 8, a_size -= 8)
+            block(le64(p));
+        for (size_t i=0; i < a_size; i++)
+            m_tail |= uint64_t(p[i]) << (8*i);
+    }
+
+    /// Finish hashing.  The hasher must not be updated afterwards.
+    hash128 digest() {
+        block(m_tail | uint64_t(m_len) << 56);
+        hash128 h;
+        m_v2 ^= 0xee;
+        round(); round(); round(); round();
+        h.lo = m_v0 ^ m_v1 ^ m_v2 ^ m_v3;
+        m_v1 ^= 0xdd;
+        round(); round(); round(); round();
+        h.hi = m_v0 ^ m_v1 ^ m_v2 ^ m_v3;
+        return h;
+    }
+};
+
+} // namespace util
+} // namespace eixx
+
+#endif // _EIXX_SIPHASH_HPP_
@@ -23,6 +23,7 @@ limitations under the License.
 
 namespace eixx {
 
+    const atom am_alias             = atom("alias");
     const atom am_badarg            = atom("badarg");
     const atom am_badrpc            = atom("badrpc");
     const atom am_call              = atom("call");
@@ -31,18 +32,30 @@ namespace eixx {
     const atom am_error             = atom("error");
     const atom am_false             = atom("false");
     const atom am_format            = atom("format");
+    const atom am_gen_call          = atom("$gen_call");
     const atom am_gen_cast          = atom("$gen_cast");
+    const atom am_get_state         = atom("get_state");
     const atom am_io_lib            = atom("io_lib");
+    const atom am_is_auth           = atom("is_auth");
     const atom am_latin1            = atom("latin1");
+    const atom am_link              = atom("link");
+    const atom am_monitor           = atom("monitor");
+    const atom am_net_kernel        = atom("net_kernel");
     const atom am_noconnection      = atom("noconnection");
     const atom am_noproc            = atom("noproc");
     const atom am_normal            = atom("normal");
+    const atom am_notsup            = atom("notsup");
     const atom am_ok                = atom("ok");
     const atom am_request           = atom("request");
+    const atom am_resume            = atom("resume");
     const atom am_rex               = atom("rex");
     const atom am_rpc               = atom("rpc");
+    const atom am_suspend           = atom("suspend");
+    const atom am_system            = atom("system");
+    const atom am_timeout           = atom("timeout");
     const atom am_true              = atom("true");
     const atom am_undefined         = atom("undefined");
+    const atom am_unknown_system_msg = atom("unknown_system_msg");
     const atom am_unsupported       = atom("unsupported");
     const atom am_user              = atom("user");
 
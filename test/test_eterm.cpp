@@ -23,6 +23,7 @@ limitations under the License.
 #include "test_alloc.hpp"
 #include <eixx/eixx.hpp>
 #include <set>
+#include <fstream>
 #include <ei.h>
 
 using namespace eixx;
@@ -106,7 +107,7 @@ BOOST_AUTO_TEST_CASE( test_atom )
 
     {
         const uint8_t buf[] = {ERL_ATOM_UTF8_EXT,0,3,97,98,99};
-        int i = 0;
+        uintptr_t i = 0;
         atom atom((const char*)buf, i, sizeof(buf));
         BOOST_CHECK_EQUAL(6, i);
         BOOST_CHECK_EQUAL("abc", atom);
@@ -149,14 +150,14 @@ BOOST_AUTO_TEST_CASE( test_bool )
 
     {
         const uint8_t buf[] = {ERL_ATOM_UTF8_EXT,0,4,116,114,117,101};
-        int i = 0;
+        uintptr_t i = 0;
         eterm t((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(true, t.to_bool());
         BOOST_CHECK_EQUAL(std::string("true"), t.to_string());
     }
     {
         const uint8_t buf[] = {ERL_ATOM_UTF8_EXT,0,5,102,97,108,115,101};
-        int i = 0;
+        uintptr_t i = 0;
         eterm t((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(sizeof(buf), (size_t)i);
         BOOST_CHECK_EQUAL(false, t.to_bool());
@@ -179,7 +180,7 @@ BOOST_AUTO_TEST_CASE( test_binary )
 
     {
         const uint8_t buf[] = {ERL_BINARY_EXT,0,0,0,3,97,98,99};
-        int i = 0;
+        uintptr_t i = 0;
         binary term1((const char*)buf, i, sizeof(buf), alloc);
         i = 0;
         binary term2((const char*)buf, i, sizeof(buf), alloc);
@@ -189,6 +190,59 @@ BOOST_AUTO_TEST_CASE( test_binary )
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_bitstring )
+{
+    allocator_t alloc;
+    {
+        // <<1,2,5:3>>
+        const uint8_t buf[] = {ERL_BIT_BINARY_EXT,0,0,0,3,3,1,2,0xBF};
+        uintptr_t i = 0;
+        eterm et((const char*)buf, i, sizeof(buf), alloc);
+        BOOST_CHECK_EQUAL(sizeof(buf), i);
+        BOOST_REQUIRE_EQUAL(BITSTRING, et.type());
+        BOOST_CHECK(et.is_bitstring());
+        bitstring b = et.to_bitstring();
+        BOOST_CHECK_EQUAL(19u, b.bit_size());
+        BOOST_CHECK_EQUAL(3,   b.tail_bits());
+        BOOST_CHECK_EQUAL("<<1,2,5:3>>", et.to_string());
+        BOOST_CHECK(et == eterm::format("<<1,2,5:3>>"));
+        BOOST_CHECK_THROW(eterm::format("<<1,8:3>>"), err_format_exception);
+        BOOST_CHECK_THROW(eterm::format("<<1:3,2>>"), err_format_exception);
+
+        // The unused bits are zeroed when encoding
+        string s = et.encode(0, false);
+        BOOST_CHECK_EQUAL(sizeof(buf), s.size());
+        BOOST_CHECK_EQUAL(char(0xA0), s.c_str()[8]);
+        BOOST_CHECK(s == eterm::format("<<1,2,5:3>>").encode(0, false));
+        BOOST_CHECK(et.encode_canonical(0, false) == s);
+        BOOST_CHECK_EQUAL(et.phash2(), eterm::format("<<1,2,5:3>>").phash2());
+        BOOST_CHECK_NE(et.phash2(), eterm(binary{1,2,160}).phash2());
+    }
+    {
+        bitstring b("\xAB\xCD\xEF", 20);
+        BOOST_CHECK_EQUAL(0xABCDEu, b.bits(0, 20));
+        BOOST_CHECK_EQUAL(0xBCDu,   b.bits(4, 12));
+
+        // Byte-aligned sub-bitstrings share the memory
+        bitstring s1 = b.sub(8, 8);
+        BOOST_CHECK(s1.is_binary());
+        BOOST_CHECK_EQUAL(b.data() + 1, s1.data());
+        BOOST_CHECK_EQUAL(BINARY, eterm(s1).type());
+        BOOST_CHECK(eterm(s1) == eterm(binary{0xCD}));
+
+        bitstring s2 = b.sub(4, 12);
+        BOOST_CHECK_EQUAL(12u, s2.bit_size());
+        BOOST_CHECK_EQUAL("<<188,13:4>>", eterm(s2).to_string());
+        BOOST_CHECK_THROW(b.sub(10, 11), err_bad_argument);
+
+        BOOST_CHECK(eterm(binary{1,2}) < eterm::format("<<1,2,0:1>>"));
+        BOOST_CHECK(eterm::format("<<1,2,1:1>>") < eterm(binary{1,3}));
+        BOOST_CHECK(eterm::format("<<1:1>>") < eterm::format("<<2:2>>"));
+        BOOST_CHECK(eterm::format("<<1:2>>") != eterm::format("<<1:3>>"));
+        BOOST_CHECK(eterm(binary{1,2}).match(eterm::format("B::bitstring()")));
+    }
+}
+
 BOOST_AUTO_TEST_CASE( test_list )
 {
     allocator_t alloc;
@@ -344,14 +398,14 @@ BOOST_AUTO_TEST_CASE( test_double )
         const uint8_t buf[] = {ERL_FLOAT_EXT,49,46,48,48,48,48,48,48,48,
                                48,48,48,48,48,48,48,48,48,48,48,48,48,101,
                                43,48,48,0,0,0,0,0};
-        int i = 0;
+        uintptr_t i = 0;
         eterm term((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(32, i);
         BOOST_CHECK_EQUAL(1.0, term.to_double());
     }
     {
         const uint8_t buf[] = {NEW_FLOAT_EXT,63,240,0,0,0,0,0,0};
-        int i = 0;
+        uintptr_t i = 0;
         eterm term((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(9, i);
         BOOST_CHECK_EQUAL(1.0, term.to_double());
@@ -385,7 +439,7 @@ BOOST_AUTO_TEST_CASE( test_long )
     }
     {
         const uint8_t buf[] = {ERL_INTEGER_EXT,7,91,205,21};
-        int i = 0;
+        uintptr_t i = 0;
         eterm term((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(5, i);
         BOOST_CHECK_EQUAL (123456789,  term.to_long());
@@ -393,7 +447,7 @@ BOOST_AUTO_TEST_CASE( test_long )
     }
     {
         const uint8_t buf[] = {ERL_SMALL_BIG_EXT,4,1,210,2,150,73};
-        int i = 0;
+        uintptr_t i = 0;
         eterm term((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(7, i);
         BOOST_CHECK_EQUAL (-1234567890,  term.to_long());
@@ -401,6 +455,91 @@ BOOST_AUTO_TEST_CASE( test_long )
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_bigint )
+{
+    allocator_t alloc;
+    {
+        // 18446744073709551615 fits in 64 bits and is decoded inline
+        const uint8_t buf[] = {ERL_SMALL_BIG_EXT,8,0,255,255,255,255,255,255,255,255};
+        uintptr_t i = 0;
+        eterm term((const char*)buf, i, sizeof(buf), alloc);
+        BOOST_CHECK_EQUAL(sizeof(buf), i);
+        BOOST_CHECK_EQUAL(BIGINT, term.type());
+        BOOST_CHECK(term.is_integer());
+        BOOST_CHECK_EQUAL(-1000000, term.to_bigint().use_count());
+        BOOST_CHECK_EQUAL("18446744073709551615", term.to_string());
+        BOOST_CHECK_EQUAL(term, eterm(ULONG_MAX));
+        BOOST_CHECK_EQUAL(ULONG_MAX, term.to_bigint().to_uint64());
+        BOOST_CHECK_THROW(term.to_bigint().to_int64(), err_bad_argument);
+        string s = term.encode(0, false);
+        BOOST_CHECK(s == string((const char*)buf, sizeof(buf)));
+    }
+    {
+        // A bignum that fits in a long is a LONG
+        const uint8_t buf[] = {ERL_SMALL_BIG_EXT,8,1,0,0,0,0,0,0,0,128};
+        uintptr_t i = 0;
+        eterm term((const char*)buf, i, sizeof(buf), alloc);
+        BOOST_CHECK_EQUAL(LONG, term.type());
+        BOOST_CHECK_EQUAL(LONG_MIN, term.to_long());
+    }
+    {
+        // -(1 bsl 200) round-trips byte for byte
+        uint8_t buf[3 + 26] = {ERL_SMALL_BIG_EXT,26,1};
+        buf[sizeof(buf)-1] = 1;
+        uintptr_t i = 0;
+        eterm term((const char*)buf, i, sizeof(buf), alloc);
+        BOOST_CHECK_EQUAL(BIGINT, term.type());
+        BOOST_CHECK_EQUAL(2, term.to_bigint().use_count());
+        BOOST_CHECK_EQUAL("-1606938044258990275541962092341162602522202993782792835301376",
+                          term.to_string());
+        string s = term.encode(0, false);
+        BOOST_CHECK(s == string((const char*)buf, sizeof(buf)));
+        eterm copy(term);
+        BOOST_CHECK_EQUAL(term, copy);
+        BOOST_CHECK_EQUAL(term.phash2(), eterm::format("-1606938044258990275541962092341162602522202993782792835301376").phash2());
+    }
+    {
+        auto b = bigint::from_string("-123456789012345678901234567890");
+        BOOST_CHECK(b.negative());
+        BOOST_CHECK_EQUAL(2u, b.size());
+        BOOST_CHECK_EQUAL("-123456789012345678901234567890", b.to_string());
+        BOOST_CHECK_EQUAL("10000000000000000000000000000000000000",
+                          bigint::from_string("+10000000000000000000000000000000000000").to_string());
+        BOOST_CHECK_EQUAL("0", bigint::from_string("-0").to_string());
+        BOOST_CHECK_THROW(bigint::from_string("12a"), err_bad_argument);
+        BOOST_CHECK_THROW(bigint::from_string("-"),   err_bad_argument);
+
+        marshal::int128_t v = -(marshal::int128_t(1) << 100) + 12345;
+        BOOST_CHECK(bigint(v).to_int128() == v);
+        BOOST_CHECK(bigint(marshal::uint128_t(0) - 1).fits_uint128());
+        BOOST_CHECK(!bigint(marshal::uint128_t(0) - 1).fits_int128());
+        BOOST_CHECK_EQUAL(LONG, eterm(bigint(marshal::int128_t(-5))).type());
+    }
+    {
+        eterm big  = eterm::format("123456789012345678901234567890");
+        eterm nbig = eterm::format("-123456789012345678901234567890");
+        BOOST_CHECK_EQUAL(BIGINT, big.type());
+        BOOST_CHECK(big != nbig);
+        BOOST_CHECK(nbig < eterm(LONG_MIN));
+        BOOST_CHECK(eterm(LONG_MAX) < big);
+        BOOST_CHECK(nbig < big);
+        BOOST_CHECK(big < eterm(1e30));
+        BOOST_CHECK(eterm(1e29) < big);
+        BOOST_CHECK(big < eterm(atom("a")));
+        eterm p64(bigint(uint64_t(1) << 63));
+        BOOST_CHECK_EQUAL(0, p64.compare(eterm(9223372036854775808.0)));
+        BOOST_CHECK(p64.compare(eterm(9223372036854775808.0), true) < 0);
+        BOOST_CHECK(p64 != eterm(9223372036854775808.0));
+
+        eterm pat = eterm::format("X::int()");
+        varbind binding;
+        BOOST_CHECK(big.match(pat, &binding));
+        BOOST_CHECK_EQUAL(big, *binding["X"]);
+
+        BOOST_CHECK(big.encode_canonical(0) == big.encode(0));
+    }
+}
+
 BOOST_AUTO_TEST_CASE( test_string )
 {
     allocator_t alloc;
@@ -419,7 +558,7 @@ BOOST_AUTO_TEST_CASE( test_string )
 
     {
         const uint8_t buf[] = {ERL_STRING_EXT,0,3,97,98,99};
-        int i = 0;
+        uintptr_t i = 0;
         eterm term((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(6, i);
         BOOST_CHECK_EQUAL("abc", term.to_str());
@@ -490,7 +629,7 @@ BOOST_AUTO_TEST_CASE( test_map )
     {
         // #{1=>2, a => 3}
         const uint8_t buf[] = {ERL_MAP_EXT,0,0,0,2,97,1,97,2,100,0,1,97,97,3};
-        int i = 0;
+        uintptr_t i = 0;
         eterm term((const char*)buf, i, sizeof(buf), alloc);
         BOOST_CHECK_EQUAL(15, i);
         BOOST_CHECK(term.is_map());
@@ -619,6 +758,75 @@ BOOST_AUTO_TEST_CASE( test_ref )
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_node_table )
+{
+    auto& tab = marshal::node_table::instance();
+    auto  h1  = tab.lookup(atom("nt@host"), 1);
+    BOOST_CHECK_EQUAL(h1, tab.lookup(atom("nt@host"), 1));
+    auto  h2  = tab.lookup(atom("nt@host"), 2);
+    BOOST_CHECK_NE(h1, h2);
+    BOOST_CHECK_EQUAL(atom("nt@host"), tab[h2].node);
+    BOOST_CHECK_EQUAL(2u, tab[h2].creation);
+    BOOST_CHECK_EQUAL(atom(), tab[0].node);
+    BOOST_CHECK(tab.allocated() >= 3);
+
+    allocator_t alloc;
+    {
+        // Pids with small id/serial are packed in a single word
+        epid p1("nt@host", 10, 20, 1, alloc);
+        epid p2("nt@host", 10, 20, 1);
+        BOOST_CHECK(p1.is_packed());
+        BOOST_CHECK_EQUAL(p1.packed(), p2.packed());
+        BOOST_CHECK_EQUAL(std::hash<epid>()(p1), std::hash<epid>()(p2));
+        BOOST_CHECK_EQUAL(p1, p2);
+        BOOST_CHECK(!epid().packed());
+        BOOST_CHECK_EQUAL(atom(), epid().node());
+    }
+    {
+        // Wide pids (DFLAG_V4_NC) fall back to a heap blob
+        epid p1("nt@host", 0x7fffffff, 0x00ffffff, 2, alloc);
+        BOOST_CHECK(!p1.is_packed());
+        BOOST_CHECK_EQUAL(0x7fffffff, p1.id());
+        BOOST_CHECK_EQUAL(0x00ffffff, p1.serial());
+        BOOST_CHECK_EQUAL(2u, p1.creation());
+        epid p2 = p1;
+        BOOST_CHECK_EQUAL(p1, p2);
+        epid p3("nt@host", 0x7fffffff, 0x00ffffff, 2);
+        BOOST_CHECK_EQUAL(p1, p3);
+        BOOST_CHECK_EQUAL(std::hash<epid>()(p1), std::hash<epid>()(p3));
+        BOOST_CHECK_NE(p1, epid("nt@host", 0x7fffffff, 0x00ffffff, 1));
+
+        string s(eterm(p1).encode(0));
+        uintptr_t idx = 1;
+        eterm t((const char*)s.c_str(), idx, s.size());
+        BOOST_CHECK_EQUAL(eterm(p1), t);
+        BOOST_CHECK_EQUAL("#Pid<nt@host.2147483647.16777215,2>", t.to_string());
+    }
+    {
+        port p1("nt@host", 0x123456789ull, 1, alloc);
+        BOOST_CHECK_EQUAL(0x123456789ull, p1.id());
+        BOOST_CHECK_EQUAL(1u, p1.creation());
+        port p2("nt@host", 0xffffffffffffull, 1, alloc);
+        BOOST_CHECK_EQUAL(0xffffffffffffull, p2.id());
+        BOOST_CHECK_NE(p1, p2);
+        BOOST_CHECK(p1 < p2);
+
+        string s(eterm(p2).encode(0));
+        uintptr_t idx = 1;
+        eterm t((const char*)s.c_str(), idx, s.size());
+        BOOST_CHECK_EQUAL(eterm(p2), t);
+    }
+    {
+        ref r1(atom("nt@host"), 1, 2, 3, 1);
+        ref r2(atom("nt@host"), 1, 2, 3, 1);
+        BOOST_CHECK_EQUAL(r1, r2);
+        BOOST_CHECK_EQUAL(1u, r1.creation());
+        BOOST_CHECK_NE(r1, ref(atom("nt@host"), 1, 2, 3, 2));
+        BOOST_CHECK_NE(r1, ref());
+        BOOST_CHECK_EQUAL(ref(), ref());
+    }
+}
+
 BOOST_AUTO_TEST_CASE( test_tuple )
 {
     allocator_t alloc;
@@ -726,6 +934,340 @@ BOOST_AUTO_TEST_CASE( test_tuple3 )
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_tuple_move )
+{
+    allocator_t alloc;
+    {
+        // Temporaries are moved into the tuple without touching refcounts
+        string s("result", alloc);
+        eterm  r(ref(atom("abc@fc12"), 1, 2, 3, 0));
+        tuple  t = tuple::make(atom("reply"), std::move(r), eterm(std::move(s)), alloc);
+        BOOST_CHECK_EQUAL(3ul, t.size());
+        BOOST_CHECK(r.empty());
+        BOOST_CHECK_EQUAL(1, t[2].to_str().use_count());
+        BOOST_CHECK_EQUAL("{reply,#Ref<abc@fc12.1.2.3>,\"result\"}", eterm(t).to_string());
+    }
+    {
+        // A shared term passed with std::move gives its reference away
+        eterm inner(tuple::make(atom("ok"), 1));
+        eterm keep(inner);
+        BOOST_CHECK_EQUAL(2, keep.to_tuple().use_count());
+        tuple t = tuple::make(atom("reply"), std::move(inner));
+        BOOST_CHECK(inner.empty());
+        BOOST_CHECK_EQUAL(2, keep.to_tuple().use_count());
+        list  l = list::make(std::move(keep), atom("x"));
+        BOOST_CHECK_EQUAL(2, l.nth(0).to_tuple().use_count());
+    }
+    {
+        // Lvalues are still copied
+        string s("result", alloc);
+        tuple  t = tuple::make(1, s);
+        BOOST_CHECK_EQUAL(2, s.use_count());
+        BOOST_CHECK_EQUAL(1, t.use_count());
+    }
+    {
+        tuple t(2, alloc);
+        eterm e("abc");
+        t.push_back(std::move(e));
+        BOOST_CHECK(e.empty());
+        BOOST_CHECK(!t.initialized());
+        t.push_back(eterm(tuple::make(1, 2)));
+        BOOST_CHECK(t.initialized());
+        BOOST_CHECK_EQUAL(1, t[1].to_tuple().use_count());
+        BOOST_CHECK_EQUAL("{\"abc\",{1,2}}", eterm(t).to_string());
+    }
+    {
+        const tuple& t = tuple::make(1,2,3,4,5,6,7,8,9,10,11,12);
+        BOOST_CHECK_EQUAL(12ul, t.size());
+        BOOST_CHECK_EQUAL(12,   t[11].to_long());
+        BOOST_CHECK_EQUAL(0ul,  tuple::make(alloc).size());
+    }
+    {
+        list l = list::make(eterm("abc"), tuple::make(1, 2), 3, alloc);
+        BOOST_CHECK(l.initialized());
+        BOOST_CHECK_EQUAL(3ul, l.length());
+        BOOST_CHECK_EQUAL(1, l.nth(1).to_tuple().use_count());
+        BOOST_CHECK_EQUAL("[\"abc\",{1,2},3]", eterm(l).to_string());
+        BOOST_CHECK(list::make(alloc).initialized());
+        BOOST_CHECK_EQUAL(0ul, list::make().length());
+
+        list l2(2, alloc);
+        eterm e(tuple::make(1));
+        l2.push_back(std::move(e));
+        BOOST_CHECK(e.empty());
+        l2.close();
+        BOOST_CHECK_EQUAL("[{1}]", eterm(l2).to_string());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_mutate )
+{
+    allocator_t alloc;
+    {
+        // A uniquely owned tuple is modified in place
+        eterm t(tuple::make(1, 2, 3, alloc));
+        const eterm* p = &t.to_tuple()[0];
+        t.mutate<tuple>().set(1, atom("two"));
+        BOOST_CHECK_EQUAL(p, &t.to_tuple()[0]);
+        BOOST_CHECK_EQUAL("{1,two,3}", t.to_string());
+        BOOST_CHECK_THROW(t.mutate<tuple>().set(3, 4), err_bad_argument);
+        BOOST_CHECK_THROW(t.mutate<list>(), err_wrong_type);
+    }
+    {
+        // A shared tuple is copied, leaving the original intact
+        eterm inner(tuple::make(1, 2));
+        eterm t1(tuple::make(atom("rec"), inner, alloc));
+        eterm t2(t1);
+        BOOST_CHECK_EQUAL(2, t1.to_tuple().use_count());
+        tuple& t = t2.mutate<tuple>();
+        BOOST_CHECK_EQUAL(1, t1.to_tuple().use_count());
+        BOOST_CHECK_EQUAL(1, t.use_count());
+        BOOST_CHECK_EQUAL(3, inner.to_tuple().use_count());
+        t.set(0, atom("new"));
+        BOOST_CHECK_EQUAL("{rec,{1,2}}", t1.to_string());
+        BOOST_CHECK_EQUAL("{new,{1,2}}", t2.to_string());
+        // Nested mutation copies the inner tuple shared with t1
+        t[1].mutate<tuple>().set(0, 10);
+        BOOST_CHECK_EQUAL("{rec,{1,2}}", t1.to_string());
+        BOOST_CHECK_EQUAL("{new,{10,2}}", t2.to_string());
+    }
+    {
+        eterm l1(list::make(1, 2, 3, alloc));
+        eterm l2(l1);
+        for (auto& e : l2.mutate<list>())
+            e = e.to_long() * 10;
+        BOOST_CHECK_EQUAL("[1,2,3]",    l1.to_string());
+        BOOST_CHECK_EQUAL("[10,20,30]", l2.to_string());
+        BOOST_CHECK_EQUAL(1, l1.to_list().use_count());
+        eterm nil(list(nullptr));
+        BOOST_CHECK(nil.mutate<list>().empty());
+    }
+    {
+        map m1{{1, 2}, {"abc", 10}};
+        map m2(m1);
+        BOOST_CHECK_EQUAL(2, m1.use_count());
+        m2.insert_or_assign(1, 3).insert_or_assign(atom("x"), 4);
+        BOOST_CHECK_EQUAL(1, m1.use_count());
+        BOOST_CHECK_EQUAL(2, m1[1].to_long());
+        BOOST_CHECK_EQUAL(3, m2[1].to_long());
+        BOOST_CHECK_EQUAL(3ul, m2.size());
+        map m3(m2);
+        m3.erase(atom("x"));
+        BOOST_CHECK_EQUAL(3ul, m2.size());
+        BOOST_CHECK_EQUAL(2ul, m3.size());
+        eterm t(m3);
+        BOOST_CHECK_EQUAL(2, m3.use_count());
+        t.mutate<map>().clear();
+        BOOST_CHECK_EQUAL(2ul, m3.size());
+        BOOST_CHECK(t.to_map().empty());
+    }
+    {
+        binary b1{1, 2, 3};
+        binary b2(b1);
+        const char* p = b1.data();
+        b2.mutate()[0] = 9;
+        BOOST_CHECK_EQUAL(1, b1.data()[0]);
+        BOOST_CHECK_EQUAL(9, b2.data()[0]);
+        BOOST_CHECK(p != b2.data());
+        const char* q = b2.data();
+        b2.mutate()[1] = 8;
+        BOOST_CHECK_EQUAL(q, b2.data());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_iolist_builder )
+{
+    allocator_t alloc;
+    binary payload{1, 2, 3, 4, 5};
+    const char hdr[] = "abcdef";
+
+    iolist_builder io(alloc);
+    BOOST_CHECK(io.empty());
+    io.put_be<uint16_t>(0x0102).put_be<uint8_t>(3)
+      .append(hdr, 3).append(hdr+3, 3)
+      .append(std::string_view("xy"))
+      .append(payload)
+      .append(payload, 3, 2);
+    BOOST_CHECK_THROW(io.append(payload, 4, 2), err_bad_argument);
+    BOOST_CHECK_EQUAL(3, payload.use_count());
+    // Header bytes are coalesced, as are the adjacent fragments of hdr
+    BOOST_CHECK_EQUAL(5ul,  io.segments());
+    BOOST_CHECK_EQUAL(18ul, io.size());
+
+    const uint8_t expect[] = {1,2,3,'a','b','c','d','e','f','x','y',1,2,3,4,5,4,5};
+    binary b = io.to_binary();
+    BOOST_REQUIRE_EQUAL(18ul, b.size());
+    BOOST_CHECK(memcmp(expect, b.data(), b.size()) == 0);
+    BOOST_CHECK(io.encode_size() == eterm(b).encode_size(0, false));
+
+    std::string buf(io.encode_size(), '\0');
+    uintptr_t idx = 0;
+    io.encode(&buf[0], idx, buf.size());
+    BOOST_CHECK_EQUAL(buf.size(), idx);
+    idx = 0;
+    eterm t(buf.c_str(), idx, buf.size(), alloc);
+    BOOST_CHECK(t.is_binary());
+    BOOST_CHECK(t.to_binary() == b);
+
+    io.clear();
+    BOOST_CHECK_EQUAL(1, payload.use_count());
+    BOOST_CHECK_EQUAL(0ul, io.to_binary().size());
+
+    // A detached builder is encoded inside other terms without copying
+    // the fragments into an intermediate binary
+    io.copy("ab", 2).append(payload);
+    binary d = io.detach();
+    BOOST_CHECK(io.empty());
+    BOOST_CHECK(d.deferred());
+    BOOST_CHECK_EQUAL(7ul, d.size());
+    eterm msg(tuple::make(atom("data"), d, 1));
+    d = binary();
+    BOOST_CHECK_EQUAL(2, payload.use_count());
+    eterm expect_msg(tuple::make(atom("data"), binary{'a','b',1,2,3,4,5}, 1));
+    BOOST_CHECK(msg.encode(0) == expect_msg.encode(0));
+    BOOST_CHECK(msg == expect_msg);
+    msg = eterm();
+    BOOST_CHECK_EQUAL(1, payload.use_count());
+}
+
+BOOST_AUTO_TEST_CASE( test_binary_deferred )
+{
+    allocator_t alloc;
+    int gathered = 0;
+    {
+        binary b(3, [&](char* dst) { ++gathered; memcpy(dst, "xyz", 3); }, alloc);
+        BOOST_CHECK(b.deferred());
+        BOOST_CHECK_EQUAL(3ul, b.size());
+        eterm t(list::make(b));
+        string s = t.encode(0, false);
+        BOOST_CHECK_EQUAL(std::string("l\0\0\0\1m\0\0\0\3xyzj", 14), std::string(s.c_str(), s.size()));
+        BOOST_CHECK_EQUAL(1, gathered);
+        // Accessing the data gathers it once
+        BOOST_CHECK_EQUAL(std::string("xyz"), std::string(b.data(), b.size()));
+        BOOST_CHECK(b.data() == t.to_list().nth(0).to_binary().data());
+        BOOST_CHECK_EQUAL(2, gathered);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_binary_external )
+{
+    allocator_t alloc;
+    static const char s_data[] = "0123456789abcdef";
+    int released = 0;
+    {
+        binary b(s_data, 16, [&](const char* p, size_t n) {
+            BOOST_CHECK_EQUAL(s_data, p);
+            BOOST_CHECK_EQUAL(16ul, n);
+            released++;
+        }, alloc);
+        BOOST_CHECK(b.external());
+        BOOST_CHECK_EQUAL(s_data, b.data());
+        BOOST_CHECK_EQUAL(16ul, b.size());
+        {
+            eterm t(b);
+            BOOST_CHECK_EQUAL(2, b.use_count());
+            binary s = b.slice(10, 6);
+            BOOST_CHECK_EQUAL(s_data+10, s.data());
+            BOOST_CHECK_EQUAL("<<\"abcdef\">>", eterm(s).to_string());
+            BOOST_CHECK_THROW(b.slice(10, 7), err_bad_argument);
+            // External data is encoded with a single copy
+            const uint8_t expect[] = {131,109,0,0,0,6,'a','b','c','d','e','f'};
+            BOOST_CHECK(eterm(s).encode(0).equal(expect));
+        }
+        BOOST_CHECK_EQUAL(1, b.use_count());
+        BOOST_CHECK_EQUAL(0, released);
+
+        // Mutation copies the external data
+        binary m(b);
+        m.mutate()[0] = 'x';
+        BOOST_CHECK(!m.external());
+        BOOST_CHECK_EQUAL('0', s_data[0]);
+        BOOST_CHECK_EQUAL('x', m.data()[0]);
+    }
+    BOOST_CHECK_EQUAL(1, released);
+
+    {
+        // Decoded binaries point into the pinned receive buffer
+        const uint8_t bytes[] = {131,104,2,109,0,0,0,3,1,2,3,109,0,0,0,1,4};
+        binary buf((const char*)bytes, sizeof(bytes), alloc);
+        eterm t;
+        {
+            binary::pinned_scope pin(buf, 2);
+            t = eterm(buf.data(), buf.size(), alloc);
+        }
+        BOOST_CHECK_EQUAL("{<<1,2,3>>,<<4>>}", t.to_string());
+        BOOST_CHECK(t.to_tuple()[0].to_binary().external());
+        BOOST_CHECK_EQUAL(buf.data()+8, t.to_tuple()[0].to_binary().data());
+        BOOST_CHECK(!t.to_tuple()[1].to_binary().external());
+        BOOST_CHECK_EQUAL(2, buf.use_count());
+        eterm t2(buf.data(), buf.size(), alloc);
+        BOOST_CHECK(!t2.to_tuple()[0].to_binary().external());
+    }
+
+    {
+        const char* file = "test_binary_map_file.tmp";
+        { std::ofstream f(file); f << std::string(5000, 'a') << "hello"; }
+        binary b = binary::map_file(file, 5000);
+        BOOST_CHECK(b.external());
+        BOOST_CHECK_EQUAL("<<\"hello\">>", eterm(b).to_string());
+        BOOST_CHECK_EQUAL(5005ul, binary::map_file(file).size());
+        BOOST_CHECK_EQUAL("<<\"ah\">>", eterm(binary::map_file(file, 4999, 2)).to_string());
+        BOOST_CHECK_THROW(binary::map_file(file, 5000, 6), std::runtime_error);
+        BOOST_CHECK_THROW(binary::map_file("/no/such/file"), std::runtime_error);
+        ::unlink(file);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_phash2 )
+{
+    // erlang:phash2([], 1 bsl 32)
+    eterm nil = eterm::format("[]");
+    BOOST_CHECK_EQUAL(3468870702u,        nil.phash2(uint64_t(1) << 32));
+    BOOST_CHECK_EQUAL(3468870702u & ((1u << 27)-1), nil.phash2());
+    BOOST_CHECK_EQUAL(3468870702u % 1000, nil.phash2(1000));
+    BOOST_CHECK_EQUAL(0u,                 nil.phash2(1));
+    BOOST_CHECK_THROW(nil.phash2(0),                       err_bad_argument);
+    BOOST_CHECK_THROW(nil.phash2((uint64_t(1) << 32) + 1), err_bad_argument);
+
+    // erlang:phash2(Term, 1 bsl 32)
+    auto h = [](const eterm& t) { return t.phash2(uint64_t(1) << 32); };
+    BOOST_CHECK_EQUAL(97u,         h(eterm(atom("a"))));
+    BOOST_CHECK_EQUAL(7258927u,    h(eterm(atom("hello"))));
+    BOOST_CHECK_EQUAL(3175731469u, h(eterm(0)));
+    BOOST_CHECK_EQUAL(539485162u,  h(eterm(1)));
+    BOOST_CHECK_EQUAL(1117813597u, h(eterm(-1)));
+    BOOST_CHECK_EQUAL(2163430133u, h(eterm(123456789)));
+    BOOST_CHECK_EQUAL(3578467979u, h(eterm(1l << 40)));
+    BOOST_CHECK_EQUAL(1484659842u, h(eterm::format("18446744073709551616")));   // 1 bsl 64
+    BOOST_CHECK_EQUAL(81744520u,   h(eterm::format("-1180591620717411303424"))); // -1 bsl 70
+    BOOST_CHECK_EQUAL(1484659842u, h(eterm(bigint(marshal::uint128_t(1) << 64))));
+    BOOST_CHECK_EQUAL(3029937084u, h(eterm(1.0)));
+    BOOST_CHECK_EQUAL(3731709215u, h(eterm(3.14)));
+    BOOST_CHECK_EQUAL(221703996u,  h(eterm::format("{}")));
+    BOOST_CHECK_EQUAL(4098956996u, h(eterm::format("{a,1}")));
+    BOOST_CHECK_EQUAL(147926629u,  h(eterm(binary())));
+    BOOST_CHECK_EQUAL(4167228639u, h(eterm(binary{1,2,3})));
+    BOOST_CHECK_EQUAL(519996486u,  h(eterm("abc")));
+    BOOST_CHECK_EQUAL(1401795262u, h(eterm(map{{atom("a"), 1}})));
+    BOOST_CHECK_EQUAL(2614250u,    eterm(1).phash2());
+
+    // Strings are lists of bytes
+    BOOST_CHECK_EQUAL(eterm::format("[97,98,99,100,101]").phash2(),
+                      eterm("abcde").phash2());
+    BOOST_CHECK_NE(eterm::format("[97,98,99,100,300]").phash2(),
+                   eterm("abcde").phash2());
+    BOOST_CHECK_EQUAL(eterm(0.0).phash2(), eterm(-0.0).phash2());
+    BOOST_CHECK_EQUAL(eterm(true).phash2(), eterm(atom("true")).phash2());
+    BOOST_CHECK_NE(eterm(1l).phash2(), eterm(-1l).phash2());
+    BOOST_CHECK_NE(eterm(1l << 40).phash2(), eterm(-(1l << 40)).phash2());
+
+    map m{{1, atom("a")}, {atom("b"), 2}};
+    eterm t = eterm::format("{1,a,b,2}");
+    BOOST_CHECK_NE(eterm(m).phash2(), t.phash2());
+    BOOST_CHECK_EQUAL(t.phash2(), eterm::format("{1,a,b,2}").phash2());
+    BOOST_CHECK_THROW(eterm::format("{1,X}").phash2(), err_bad_argument);
+}
+
 BOOST_AUTO_TEST_CASE( test_trace )
 {
     allocator_t alloc;
@@ -881,3 +1423,133 @@ BOOST_AUTO_TEST_CASE( test_cast2 )
 }
 
 
+
+BOOST_AUTO_TEST_CASE( test_eterm_compare )
+{
+    allocator_t alloc;
+    uint32_t ids[] = {1, 2, 3};
+
+    // number < atom < reference < port < pid < tuple < map < list < binary
+    const eterm ordered[] = {
+        eterm(-5), eterm(1.5), eterm(2), eterm(atom("abc")), eterm(false),
+        eterm(atom("truck")), eterm(ref("a@host", ids, 0, alloc)),
+        eterm(port("a@host", 1, 0, alloc)), eterm(epid("a@host", 1, 0, 0, alloc)),
+        eterm::format("{z}"), eterm::format("{a, b}"),
+        eterm(map{{eterm(1), eterm(2)}}), eterm(list(nullptr)), eterm("ab"),
+        eterm::format("[97, 99]"), eterm(binary{1, 2}), eterm(binary{1, 2, 0}),
+        eterm(binary{2})
+    };
+    const size_t n = sizeof(ordered)/sizeof(ordered[0]);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j) {
+            int expect = i < j ? -1 : i > j ? 1 : 0;
+            int res    = ordered[i].compare(ordered[j]);
+            BOOST_CHECK_MESSAGE((res > 0) - (res < 0) == expect,
+                ordered[i] << " vs " << ordered[j] << ": " << res);
+            BOOST_CHECK_EQUAL(i < j, ordered[i] < ordered[j]);
+        }
+
+    // Numbers are compared by value, unless the exact order is requested
+    BOOST_CHECK_EQUAL(0, eterm(1).compare(eterm(1.0)));
+    BOOST_CHECK(eterm(1).compare(eterm(1.0), true) < 0);
+    BOOST_CHECK(eterm(1.0).compare(eterm(1), true) > 0);
+    BOOST_CHECK(eterm(9007199254740993l).compare(eterm(9007199254740992.0)) > 0);
+    BOOST_CHECK(eterm(LONG_MAX).compare(eterm(1e19)) < 0);
+
+    // Strings are lists of characters
+    BOOST_CHECK_EQUAL(0, eterm("ab").compare(eterm::format("[97, 98]")));
+    BOOST_CHECK(eterm("ab").compare(eterm::format("[97, 98, 0]")) < 0);
+    BOOST_CHECK(eterm::format("[97, b]").compare(eterm("ab")) > 0);
+
+    // Shared storage
+    eterm t = eterm::format("{a, [1, 2], <<\"x\">>}");
+    eterm t2(t);
+    BOOST_CHECK_EQUAL(0, t.compare(t2));
+    BOOST_CHECK(t == t2);
+
+    // Map keys: integers and floats of the same value are different keys
+    map m;
+    m.insert(eterm(1),   eterm(atom("int")));
+    m.insert(eterm(1.0), eterm(atom("float")));
+    BOOST_CHECK_EQUAL(2u, m.size());
+    BOOST_CHECK_EQUAL(LONG, m.begin()->first.type());
+    BOOST_CHECK(eterm(map{{eterm(1), eterm(2)}}) < eterm(map{{eterm(1.0), eterm(1)}}));
+    BOOST_CHECK(eterm(map{{eterm(1), eterm(1)}}) < eterm(map{{eterm(1), eterm(2)}}));
+
+    // All integer keys sort before float keys, as in Erlang
+    BOOST_CHECK(eterm(2).compare(eterm(1.0), true) < 0);
+    BOOST_CHECK(eterm(bigint(uint64_t(1) << 63)).compare(eterm(1e30), true) < 0);
+    BOOST_CHECK(eterm(map{{eterm(2), eterm(atom("a"))}}) <
+                eterm(map{{eterm(1.0), eterm(atom("a"))}}));
+    BOOST_CHECK_EQUAL("#{2 => b,1.0 => a}",
+                      eterm::format("#{1.0 => a, 2 => b}").to_string());
+}
+
+BOOST_AUTO_TEST_CASE( test_eterm_canonical )
+{
+    auto bytes = [](const eterm& t) {
+        auto s = t.encode_canonical(0);
+        return std::vector<uint8_t>(s.c_str(), s.c_str() + s.size());
+    };
+    auto check = [&](const eterm& t, std::vector<uint8_t> expect) {
+        auto got = bytes(t);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expect.begin(), expect.end(), got.begin(), got.end());
+    };
+
+    // term_to_binary(#{a => 1, b => [1,2]})
+    map m1, m2;
+    m1.insert(eterm(atom("a")), eterm(1));
+    m1.insert(eterm(atom("b")), eterm::format("[1, 2]"));
+    m2.insert(eterm(atom("b")), eterm(list::make(1, 2)));
+    m2.insert(eterm(atom("a")), eterm(1));
+    check(eterm(m1), {131,116,0,0,0,2,119,1,'a',97,1,119,1,'b',107,0,2,1,2});
+    BOOST_CHECK(bytes(eterm(m1)) == bytes(eterm(m2)));
+    BOOST_CHECK(eterm(m1).content_hash() == eterm(m2).content_hash());
+
+    // Smallest integer encoding
+    check(eterm(255),        {131,97,255});
+    check(eterm(300),        {131,98,0,0,1,44});
+    check(eterm(-1),         {131,98,255,255,255,255});
+    check(eterm(1l << 40),   {131,110,6,0,0,0,0,0,0,1});
+    check(eterm(-(1l << 32)),{131,110,5,1,0,0,0,0,1});
+    check(eterm(1.5),        {131,70,0x3f,0xf8,0,0,0,0,0,0});
+    check(eterm(-0.0),       {131,70,0,0,0,0,0,0,0,0});
+
+    // Equal terms of different types have the same representation
+    check(eterm(true),       {131,119,4,'t','r','u','e'});
+    BOOST_CHECK(bytes(eterm(true)) == bytes(eterm(atom("true"))));
+    BOOST_CHECK(bytes(eterm("ab")) == bytes(eterm::format("[97, 98]")));
+    BOOST_CHECK(eterm("ab").content_hash() == eterm::format("[97, 98]").content_hash());
+    check(eterm(""),         {131,106});
+    check(eterm::format("[a, 300]"), {131,108,0,0,0,2,119,1,'a',98,0,0,1,44,106});
+
+    // The hash is SipHash-2-4-128 of the canonical encoding
+    eterm t = tuple::make(atom("ok"), eterm::format("[1, 2.5, \"abc\"]"), binary{1, 2, 3},
+                          map{{eterm(atom("x")), eterm(tuple::make(atom("y")))}});
+    auto enc = t.encode_canonical(0);
+    util::siphash128 h;
+    h.update(enc.c_str(), enc.size());
+    BOOST_CHECK(h.digest() == t.content_hash());
+    BOOST_CHECK(t == eterm(enc.c_str(), enc.size()));
+    BOOST_CHECK(t.content_hash() != eterm(tuple::make(atom("ok"), eterm::format("[1, 2.5, \"abd\"]"),
+                        binary{1, 2, 3}, map{{eterm(atom("x")), eterm(tuple::make(atom("y")))}})).content_hash());
+    BOOST_CHECK(eterm(1).content_hash() != eterm(1.0).content_hash());
+
+    // Packet header
+    auto p = t.encode_canonical(2);
+    BOOST_CHECK_EQUAL(enc.size() + 2, p.size());
+    BOOST_CHECK_EQUAL(enc.size(), size_t((uint8_t)p.c_str()[0] << 8 | (uint8_t)p.c_str()[1]));
+
+    // Reference vector of SipHash-2-4-128 with key 00..0f
+    uint8_t msg[15], out[16];
+    for (int i=0; i < 15; i++) msg[i] = uint8_t(i);
+    util::siphash128 h2(0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull);
+    h2.update(msg, 7);
+    h2.update(msg+7, 8);
+    h2.digest().to_bytes(out);
+    const uint8_t expect[] = {0x54,0x93,0xe9,0x99,0x33,0xb0,0xa8,0x11,
+                              0x7e,0x08,0xec,0x0f,0x97,0xcf,0xc3,0xd9};
+    BOOST_CHECK_EQUAL_COLLECTIONS(expect, expect+16, out, out+16);
+
+    BOOST_CHECK_THROW(eterm::format("{X}").content_hash(), err_encode_exception);
+}
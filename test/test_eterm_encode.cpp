@@ -31,7 +31,7 @@ BOOST_AUTO_TEST_CASE( test_encode_string )
     string s(t.encode(0));
     const uint8_t expect[] = {131,107,0,3,97,98,99};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     string t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(3ul, t1.size());
     eterm et(t1);
@@ -48,7 +48,7 @@ BOOST_AUTO_TEST_CASE( test_encode_atom )
     string s(a.encode(0));
     const uint8_t expect[] = {131,119,0,3,97,98,99};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     atom t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(3ul, t1.size());
     BOOST_CHECK_EQUAL("abc", eterm(t1).to_string());
@@ -79,7 +79,7 @@ BOOST_AUTO_TEST_CASE( test_encode_double )
     string s(t.encode(0));
     const uint8_t expect[] = {131,70,64,200,28,214,230,49,248,161};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     eterm t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(d, t1.to_double());
 }
@@ -92,7 +92,7 @@ BOOST_AUTO_TEST_CASE( test_encode_emptylist )
     string s(t.encode(0));
     const uint8_t expect[] = {131,106};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     eterm t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(LIST, t1.type());
     BOOST_CHECK_EQUAL(0ul, t1.to_list().length());
@@ -112,7 +112,7 @@ BOOST_AUTO_TEST_CASE( test_encode_list )
     const uint8_t expect[] = {131,108,0,0,0,4,ERL_ATOM_UTF8_EXT,0,3,97,98,99,
                               107,0,2,101,102,97,1,107,0,2,103,104,106};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     list t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(4ul, t1.length());
     std::string str(eterm(t1).to_string());
@@ -127,7 +127,7 @@ BOOST_AUTO_TEST_CASE( test_encode_long )
         string s(t.encode(0));
         const uint8_t expect[] = {131,97,123};
         BOOST_CHECK(s.equal(expect));
-        int idx = 1;  // skipping the magic byte
+        uintptr_t idx = 1;  // skipping the magic byte
         eterm t1((const char*)expect, idx, sizeof(expect));
         BOOST_CHECK_EQUAL(d, t1.to_long());
     }
@@ -137,7 +137,7 @@ BOOST_AUTO_TEST_CASE( test_encode_long )
         string s(t.encode(0));
         const uint8_t expect[] = {131,98,0,0,48,57};
         BOOST_CHECK(s.equal(expect));
-        int idx = 1;  // skipping the magic byte
+        uintptr_t idx = 1;  // skipping the magic byte
         eterm t1((const char*)expect, idx, sizeof(expect));
         BOOST_CHECK_EQUAL(d, t1.to_long());
     }
@@ -155,7 +155,7 @@ BOOST_AUTO_TEST_CASE( test_encode_long )
         const uint8_t expect[] = {131,110,4,0,0x78,0x56,0x34,0x12};
 #endif // EIXX_SIZEOF_LONG >= 8
         BOOST_CHECK(s.equal(expect));
-        int idx = 1;  // skipping the magic byte
+        uintptr_t idx = 1;  // skipping the magic byte
         eterm t1((const char*)expect, idx, sizeof(expect));
         BOOST_CHECK_EQUAL(d, t1.to_long());
     }
@@ -171,14 +171,14 @@ BOOST_AUTO_TEST_CASE( test_encode_pid )
         const uint8_t expect[] = 
             {131,88,118,0,9,116,101,115,116,64,104,111,115,116,0,0,0,1,0,0,0,2,0,0,0,0};
         BOOST_CHECK(s.equal(expect));
-        int idx = 1;  // skipping the magic byte
+        uintptr_t idx = 1;  // skipping the magic byte
         eterm pid(epid((const char*)expect, idx, sizeof(expect)));
         BOOST_CHECK_EQUAL(eterm(pid), t);
     }
     {
         const uint8_t expect[] =
             {131,88,118,0,9,116,101,115,116,64,104,111,115,116,0,0,0,1,0,0,0,2,0,0,0,3};
-        int idx = 1;  // skipping the magic byte
+        uintptr_t idx = 1;  // skipping the magic byte
         epid decode_pid((const char*)expect, idx, sizeof(expect));
         epid expect_pid("test@host", 1, 2, 3);
         BOOST_CHECK_EQUAL(expect_pid, decode_pid);
@@ -192,9 +192,9 @@ BOOST_AUTO_TEST_CASE( test_encode_port )
     string s(t.encode(0));
     //std::cout << s.to_binary_string() << std::endl;
     const uint8_t expect[] =
-        {131,102,ERL_ATOM_UTF8_EXT,0,9,116,101,115,116,64,104,111,115,116,0,0,0,1,0};
+        {131,89,ERL_ATOM_UTF8_EXT,0,9,116,101,115,116,64,104,111,115,116,0,0,0,1,0,0,0,0};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     eterm t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(t1, t);
 }
@@ -209,7 +209,7 @@ BOOST_AUTO_TEST_CASE( test_encode_ref )
     const uint8_t expect[] =
         {131,90,0,3,100,0,9,116,101,115,116,64,104,111,115,116,0,0,0,0,0,0,0,1,0,0,0,2,0,0,0,3};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     ref t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(eterm(t1), t);
     {
@@ -217,7 +217,7 @@ BOOST_AUTO_TEST_CASE( test_encode_ref )
         //std::cout << string(eterm(t).encode(0)).to_binary_string() << std::endl;
         const uint8_t expect[] =
             {131,90,0,3,118,0,8,97,98,99,64,102,99,49,50,0,0,0,2,0,0,3,225,0,0,0,0,0,0,0,0};
-        int idx = 1;  // skipping the magic byte
+        uintptr_t idx = 1;  // skipping the magic byte
         ref t1((const char*)expect, idx, sizeof(expect));
         BOOST_CHECK_EQUAL(t1, t);
     }
@@ -246,7 +246,7 @@ BOOST_AUTO_TEST_CASE( test_encode_tuple )
                               104,4,ERL_ATOM_UTF8_EXT,0,1,97,107,0,2,120,120,70,64,94,198,102,
                               102,102,102,102,97,5,107,0,2,103,104};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     tuple t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(5ul, t1.size());
     BOOST_CHECK_EQUAL("{abc,\"ef\",1,{a,\"xx\",123.1,5},\"gh\"}", eterm(t1).to_string());
@@ -262,7 +262,7 @@ BOOST_AUTO_TEST_CASE( test_encode_trace )
     const uint8_t expect[] = 
         {131,104,5,97,1,97,2,97,3,88,118,0,8,97,98,99,64,102,99,49,50,0,0,0,96,0,0,0,0,0,0,0,3,97,4};
     BOOST_CHECK(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     trace t1((const char*)expect, idx, sizeof(expect));
     BOOST_CHECK_EQUAL(5ul, t1.size());
     BOOST_CHECK_EQUAL(1,   t1.flags());
@@ -273,6 +273,40 @@ BOOST_AUTO_TEST_CASE( test_encode_trace )
     BOOST_CHECK_EQUAL("{1,2,3,#Pid<abc@fc12.96.0,3>,4}", eterm(t1).to_string());
 }
 
+BOOST_AUTO_TEST_CASE( test_encode_raw )
+{
+    // {fun m:f/2, <<5:3>>, 1 bsl 72}
+    const uint8_t expect[] =
+        {131,104,3,
+         113,119,1,109,119,1,102,97,2,      // EXPORT_EXT
+         77,0,0,0,1,3,160,                  // BIT_BINARY_EXT
+         110,10,0,0,0,0,0,0,0,0,0,0,1};     // SMALL_BIG_EXT
+    eterm t((const char*)expect, sizeof(expect));
+    BOOST_REQUIRE(t.is_tuple());
+    const tuple& tup = t.to_tuple();
+    BOOST_REQUIRE(tup[0].is_raw());
+    BOOST_CHECK_EQUAL(ERL_EXPORT_EXT, tup[0].to_raw().tag());
+    BOOST_CHECK_EQUAL(9ul, tup[0].to_raw().size());
+    BOOST_CHECK_EQUAL(BITSTRING, tup[1].type());
+    BOOST_CHECK(tup[2].is_bigint());
+    BOOST_CHECK_EQUAL("{#Raw<113,9>,<<5:3>>,4722366482869645213696}", t.to_string());
+
+    // Re-encoded verbatim
+    BOOST_CHECK_EQUAL(sizeof(expect), t.encode_size(0, true));
+    string s(t.encode(0));
+    BOOST_CHECK(s.equal(expect));
+
+    raw r((const char*)expect+3, 9);
+    BOOST_CHECK(r == tup[0].to_raw());
+    BOOST_CHECK(eterm(r) == tup[0]);
+    BOOST_CHECK(!(eterm(r) == tup[1]));
+    BOOST_CHECK(raw((const char*)expect+12, 7) < r);
+    BOOST_CHECK_THROW(raw(nullptr, 0), err_bad_argument);
+
+    uintptr_t idx = 3;
+    BOOST_CHECK_THROW(raw((const char*)expect, idx, 8), err_decode_exception);
+}
+
 BOOST_AUTO_TEST_CASE( test_encode_rpc )
 {
     static const unsigned char s_expected[] = {
@@ -209,3 +209,189 @@ BOOST_AUTO_TEST_CASE( test_eterm_mfa_format_bad )
     BOOST_REQUIRE_THROW(eterm::format(m, f, args, "a:b(~i,~i]", 10, 20), err_format_exception);
     BOOST_REQUIRE_THROW(eterm::format(m, f, args, "a:b([[~i,20],]", 10), err_format_exception);
 }
+
+BOOST_AUTO_TEST_CASE( test_consult_parser )
+{
+    static const char s_text[] =
+        "% Routing table\n"
+        "{route, 'eu-west', [1, -2, 16#ff, 2#101, $a, $\\n]}.\n"
+        "{limits, #{max => 1.5e3, min => -0.25}}. % trailing comment\n"
+        "<<\"bin\\x41\">>. <<1,2,\"ab\">>. <<>>.\n"
+        "\"str\\tX\". [a | [b]]. {}. [].\n"
+        "{var, X}.\n";
+
+    consult_parser p(s_text, sizeof(s_text)-1);
+    eterm t;
+
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK(t == eterm::format("{route, 'eu-west', [1, -2, 255, 5, 97, 10]}"));
+    BOOST_REQUIRE(p.next(t));
+    BOOST_REQUIRE_EQUAL(MAP, t.to_tuple()[1].type());
+    const map& m = t.to_tuple()[1].to_map();
+    BOOST_CHECK_EQUAL(2u, m.size());
+    BOOST_CHECK_EQUAL(1500.0, m[eterm(atom("max"))].to_double());
+    BOOST_CHECK_EQUAL(-0.25,  m[eterm(atom("min"))].to_double());
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK_EQUAL("binA", std::string(t.to_binary().data(), t.to_binary().size()));
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK_EQUAL(std::string("\1\2ab"), std::string(t.to_binary().data(), t.to_binary().size()));
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK_EQUAL(0u, t.to_binary().size());
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK_EQUAL("str\tX", t.to_str());
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK(t == eterm::format("[a, b]"));
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK_EQUAL(0u, t.to_tuple().size());
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK(t.to_list().empty());
+    BOOST_REQUIRE(p.next(t));
+    BOOST_CHECK_EQUAL(VAR, t.to_tuple()[1].type());
+    BOOST_CHECK_EQUAL(6u, p.line());
+    BOOST_CHECK(!p.next(t));
+
+    // Integers that don't fit in a long are bignums
+    {
+        static const char s_big[] =
+            "-9223372036854775808. 9223372036854775808. -99999999999999999999. "
+            "16#10000000000000000.";
+        consult_parser b(s_big, sizeof(s_big)-1);
+        BOOST_REQUIRE(b.next(t));
+        BOOST_CHECK_EQUAL(LONG_MIN, t.to_long());
+        BOOST_REQUIRE(b.next(t));
+        BOOST_CHECK_EQUAL(BIGINT, t.type());
+        BOOST_CHECK(t == eterm(bigint(marshal::uint128_t(1) << 63)));
+        BOOST_REQUIRE(b.next(t));
+        BOOST_CHECK(t == eterm(bigint::from_string("-99999999999999999999")));
+        BOOST_REQUIRE(b.next(t));
+        BOOST_CHECK(t == eterm(bigint(marshal::uint128_t(1) << 64)));
+    }
+
+    auto error_at = [](const char* a_text, size_t a_line, size_t a_col) {
+        consult_parser p(a_text, strlen(a_text));
+        eterm t;
+        try {
+            while (p.next(t));
+            BOOST_ERROR("Expected parse error in: " << a_text);
+        } catch (err_parse_exception& e) {
+            BOOST_CHECK_EQUAL(a_line, e.line());
+            BOOST_CHECK_EQUAL(a_col,  e.column());
+        }
+    };
+    error_at("{a, b}",                      1, 7);
+    error_at("ok.\n{a b}.",                 2, 4);
+    error_at("ok.\n\n  \"abc",              3, 3);
+    error_at("[1, 2 | a].",                 1, 9);
+    error_at("<<256>>.",                    1, 3);
+    error_at("#{a => 1 b}.",                1, 10);
+    error_at("ok.ok.",                      1, 4);
+}
+
+BOOST_AUTO_TEST_CASE( test_json )
+{
+    auto to_json = [](const eterm& t, const json_options& o = json_options()) {
+        return eterm_to_json(t, o);
+    };
+
+    eterm t = json_to_eterm(" {\"a\": [1, -2, 3.5, true, null], \"b\": {\"c\": \"x\\n\\u00e9\\ud83d\\ude00\"}, \"d\": []} ");
+    BOOST_REQUIRE_EQUAL(MAP, t.type());
+    const map& m = t.to_map();
+    BOOST_CHECK_EQUAL(3u, m.size());
+    BOOST_CHECK(m[eterm(binary("a"))] == eterm(list::make(1, -2, 3.5, true, atom("null"))));
+    BOOST_CHECK(m[eterm(binary("d"))] == eterm(list(0)));
+    const eterm& s = m[eterm(binary("b"))].to_map()[eterm(binary("c"))];
+    BOOST_CHECK_EQUAL(std::string("x\n\xc3\xa9\xf0\x9f\x98\x80"),
+                      std::string(s.to_binary().data(), s.to_binary().size()));
+    BOOST_CHECK_EQUAL(std::string("\"x\\n\xc3\xa9\xf0\x9f\x98\x80\""), to_json(s));
+    json_options latin1;
+    latin1.charlists_as_strings = true;
+    BOOST_CHECK_EQUAL(std::string("\"\xc3\xa9\""), to_json(eterm(string("\xe9")), latin1));
+
+    // Integers of all sizes round-trip
+    const char* nums = "[0,255,256,-1,2147483647,-2147483648,2147483648,"
+                       "9223372036854775807,-18446744073709551615,"
+                       "123456789012345678901234567890,-0.001,2.0]";
+    t = json_to_eterm(nums, strlen(nums));
+    BOOST_CHECK_EQUAL(std::string(nums), to_json(t));
+    BOOST_CHECK_EQUAL(BIGINT, t.to_list().nth(9).type());
+    BOOST_CHECK_EQUAL(std::string("[1,2.0]"), to_json(eterm::format("{1, 2.0}")));
+
+    json_options o;
+    o.numbers = json_options::FLOAT;
+    BOOST_CHECK_EQUAL(DOUBLE, json_to_eterm("7", o).type());
+
+    // Strings as existing atoms
+    o = json_options();
+    o.keys = o.strings = json_options::EXISTING_ATOM;
+    t = json_to_eterm("{\"ok\": [\"error\", \"no_such_atom_in_json_test\"]}", o);
+    BOOST_CHECK(t.to_map()[eterm(atom("ok"))] ==
+                eterm(list::make(atom("error"), binary("no_such_atom_in_json_test"))));
+
+    // Objects as property lists
+    o = json_options();
+    o.objects = json_options::PROPLIST;
+    t = json_to_eterm("{\"a\": {}, \"b\": 1}", o);
+    BOOST_CHECK(t == eterm(list::make(tuple::make(binary("a"), list::make(tuple(0))),
+                                      tuple::make(binary("b"), 1))));
+    BOOST_CHECK_EQUAL(std::string("{\"a\":{},\"b\":1}"), to_json(t, o));
+
+    // Atoms, character lists and number keys become strings
+    BOOST_CHECK_EQUAL(std::string("{\"1\":\"abc\",\"k\":\"q\\\"\\u0001\"}"),
+                      to_json(eterm(map{{eterm(1),         eterm(atom("abc"))},
+                                        {eterm(atom("k")), eterm(string("q\"\1"))}}), latin1));
+
+    // Character lists are arrays of integers by default, as Erlang encodes
+    // [1,2,3] and [200,65,66] as STRING_EXT
+    std::string out;
+    etf_to_json("\x83k\0\3\1\2\3", 7, out);
+    BOOST_CHECK_EQUAL("[1,2,3]", out);
+    out.clear();
+    etf_to_json("\x83k\0\3\xc8\x41\x42", 7, out);
+    BOOST_CHECK_EQUAL("[200,65,66]", out);
+    BOOST_CHECK_EQUAL("{\"ab\":[97,98]}", to_json(eterm(map{{eterm(string("ab")), eterm(string("ab"))}})));
+
+    // Transcoding appends to the output
+    std::string etf("x"), json("y");
+    json_to_etf("[\"a\"]", 5, etf);
+    etf_to_json(etf.data() + 1, etf.size() - 1, json);
+    BOOST_CHECK_EQUAL(std::string("y[\"a\"]"), json);
+
+    // [1 | 2] can't be built as a term
+    BOOST_CHECK_THROW(etf_to_json("\x83l\0\0\0\1a\1a\2", 10, json), err_decode_exception);
+    BOOST_CHECK_THROW(to_json(eterm(epid("a@b", 1, 2, 0))), err_decode_exception);
+    BOOST_CHECK_THROW(to_json(eterm::format("#{[1] => 2}")), err_decode_exception);
+    BOOST_CHECK_THROW(etf_to_json(etf.data() + 1, etf.size() - 2, json), err_decode_exception);
+
+    auto error_at = [](const char* a_json, size_t a_line, size_t a_col) {
+        std::string out;
+        try {
+            json_to_etf(a_json, strlen(a_json), out);
+            BOOST_ERROR("Expected parse error in: " << a_json);
+        } catch (err_parse_exception& e) {
+            BOOST_CHECK_EQUAL(a_line, e.line());
+            BOOST_CHECK_EQUAL(a_col,  e.column());
+        }
+        BOOST_CHECK(out.empty());
+    };
+    error_at("",                    1, 1);
+    error_at("[1, 2",               1, 6);
+    error_at("{\"a\" 1}",           1, 6);
+    error_at("[01]",                1, 2);
+    error_at("\n  \"ab\tc\"",       2, 6);
+    error_at("\"\\x\"",             1, 2);
+    error_at("\"\\ud800\"",         1, 2);
+    error_at("tru",                 1, 1);
+    error_at("1e999",               1, 1);
+    error_at("{} x",                1, 4);
+    error_at("[[[1]]]x",            1, 8);
+    error_at("{\"a\": {\"b\": 1, \"c\": 2, \"b\": 3}}", 1, 7);
+
+    // Duplicate keys are kept in property lists
+    o = json_options();
+    o.objects = json_options::PROPLIST;
+    BOOST_CHECK_EQUAL(2u, json_to_eterm("{\"a\": 1, \"a\": 2}", o).to_list().length());
+
+    o = json_options();
+    o.max_depth = 2;
+    BOOST_CHECK_THROW(json_to_eterm("[[[1]]]", o), err_parse_exception);
+}
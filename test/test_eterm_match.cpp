@@ -496,3 +496,227 @@ BOOST_AUTO_TEST_CASE( test_eterm_var_match )
     BOOST_REQUIRE(eterm(ref())          .match(eterm::format("B::ref()")));
     BOOST_REQUIRE(eterm(ref())          .match(eterm::format("B::reference()")));
 }
+
+BOOST_AUTO_TEST_CASE( test_match_map )
+{
+    eterm msg = eterm::format(
+        "#{type => order, id => 12, px => 1.5, sym => #{ticker => ibm, exch => nyse}}");
+    BOOST_CHECK_EQUAL(MAP, msg.type());
+    BOOST_CHECK_EQUAL(4u, msg.to_map().size());
+    BOOST_CHECK_EQUAL(0u, eterm::format("#{}").to_map().size());
+
+    varbind vb;
+    BOOST_REQUIRE(msg.match(eterm::format("#{type := order, id := Id}"), &vb));
+    BOOST_CHECK_EQUAL(12, vb["Id"]->to_long());
+
+    // Nested patterns
+    vb.clear();
+    BOOST_REQUIRE(msg.match(eterm::format("#{sym := #{ticker := T}, px := Px}"), &vb));
+    BOOST_CHECK_EQUAL(atom("ibm"), vb["T"]->to_atom());
+    BOOST_CHECK_EQUAL(1.5, vb["Px"]->to_double());
+    BOOST_CHECK(msg.match(eterm::format("{_, #{}}"), nullptr) == false);
+    BOOST_CHECK(msg.match(eterm::format("#{}")));
+    BOOST_CHECK(msg.match(eterm::format("M")));
+
+    // Missing keys and mismatching values
+    BOOST_CHECK(!msg.match(eterm::format("#{type := order, qty := Q}")));
+    BOOST_CHECK(!msg.match(eterm::format("#{type := cancel}")));
+    BOOST_CHECK(!msg.match(eterm::format("#{sym := #{ticker := msft}}")));
+    BOOST_CHECK(!msg.match(eterm::format("{type, order}")));
+    BOOST_CHECK(!eterm::format("{a, b}").match(eterm::format("#{}")));
+
+    // Bound variables: in values they must be equal, in keys they're looked up
+    varbind b2{{"Id", 13}};
+    BOOST_CHECK(!msg.match(eterm::format("#{id := Id}"), &b2));
+    varbind b3{{"K", atom("id")}};
+    BOOST_CHECK(msg.match(eterm::format("#{K := V}"), &b3));
+    BOOST_CHECK_EQUAL(12, b3["V"]->to_long());
+    BOOST_CHECK_THROW(msg.match(eterm::format("#{K := V}")), err_unbound_variable);
+
+    // Substitution of map templates
+    eterm tmpl = eterm::format("#{type => reply, id => Id, Key => [Px]}");
+    varbind b4{{"Id", 12}, {"Key", atom("px")}, {"Px", 1.5}};
+    eterm out;
+    BOOST_REQUIRE(tmpl.subst(out, &b4));
+    BOOST_CHECK_EQUAL("#{id => 12,px => [1.5],type => reply}", out.to_string());
+    BOOST_CHECK(!msg.subst(out, &b4));
+    BOOST_CHECK_THROW(tmpl.subst(out, &vb), err_unbound_variable);
+
+    BOOST_CHECK_THROW(eterm::format("#{a = 1}"),  err_format_exception);
+    BOOST_CHECK_THROW(eterm::format("#{a => 1"),  err_format_exception);
+    BOOST_CHECK_THROW(eterm::format("#(a => 1)"), err_format_exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_bit_pattern )
+{
+    {
+        bit_pattern p("<<Ver:4, Flags:12, Len:16, Body:Len/binary, _/bits>>");
+        BOOST_REQUIRE_EQUAL(4u, p.var_count());
+        BOOST_CHECK_EQUAL(3, p.var_index(atom("Body")));
+
+        binary pkt{0x1F, 0xFF, 0, 3, 'a', 'b', 'c', 0xF0};
+        eterm v[4];
+        BOOST_REQUIRE(p.match(pkt, v));
+        BOOST_CHECK_EQUAL(1,     v[0].to_long());
+        BOOST_CHECK_EQUAL(0xFFF, v[1].to_long());
+        BOOST_CHECK_EQUAL(3,     v[2].to_long());
+        BOOST_REQUIRE(v[3].is_binary());
+        BOOST_CHECK_EQUAL(pkt.data() + 4, v[3].to_binary().data());
+        BOOST_CHECK_EQUAL("<<\"abc\">>", v[3].to_string());
+
+        // Body is shorter than Len
+        BOOST_CHECK(!p.match(binary{0x10, 0, 0, 5, 'a'}, v));
+
+        // '_' can't be built
+        BOOST_CHECK_THROW(p.build(v), err_bad_argument);
+        bit_pattern q("<<Ver:4, Flags:12, Len:16, Body:Len/binary>>");
+        bitstring b = q.build({1, 0xFFF, 3, binary("abc", 3)});
+        BOOST_CHECK(eterm(b) == eterm(binary{0x1F, 0xFF, 0, 3, 'a', 'b', 'c'}));
+        BOOST_CHECK_THROW(q.build({1, 2, 3, 4}), err_bad_argument);
+        BOOST_CHECK_THROW(q.build({1, 2, 4, binary("abc", 3)}), err_bad_argument);
+    }
+    {
+        bit_pattern p("A:3, B:5/signed, C:16/little, D:12/little, F:32/float, G:64/float-little, U/utf8");
+        bitstring b = p.build({5, -3, 0x1234, 0x123, 1.5, -2.25, 0x20AC});
+        BOOST_CHECK_EQUAL(3+5+16+12+32+64+24u, b.bit_size());
+        BOOST_CHECK_EQUAL(0x34u, b.bits(8, 8));
+        BOOST_CHECK_EQUAL(0x23u, b.bits(24, 8));
+        BOOST_CHECK_EQUAL(0x1u,  b.bits(32, 4));
+
+        eterm v[7];
+        BOOST_REQUIRE(p.match(b, v));
+        BOOST_CHECK_EQUAL(5,      v[0].to_long());
+        BOOST_CHECK_EQUAL(-3,     v[1].to_long());
+        BOOST_CHECK_EQUAL(0x1234, v[2].to_long());
+        BOOST_CHECK_EQUAL(0x123,  v[3].to_long());
+        BOOST_CHECK_EQUAL(1.5,    v[4].to_double());
+        BOOST_CHECK_EQUAL(-2.25,  v[5].to_double());
+        BOOST_CHECK_EQUAL(0x20AC, v[6].to_long());
+        BOOST_CHECK(!p.match(b.sub(0, b.bit_size() - 8), v));
+    }
+    {
+        // Literals, strings, repeated variables and the size given by the caller
+        bit_pattern p("<<\"GET\", 1:8, N:Size, N:Size, Rest/binary>>");
+        varbind vb;
+        vb.bind("Size", eterm(4));
+        BOOST_CHECK(p.match(eterm(binary{'G','E','T',1,0x77,'x'}), &vb));
+        BOOST_CHECK_EQUAL(7, vb["N"]->to_long());
+        BOOST_CHECK_EQUAL("<<120>>", vb["Rest"]->to_string());
+        varbind size{{"Size", 4}};
+        BOOST_CHECK(!p.match(eterm(binary{'G','E','T',1,0x78}), &size));
+        BOOST_CHECK(!p.match(eterm(binary{'P','U','T',1,0x77}), &size));
+        BOOST_CHECK(!p.match(eterm(binary{'G','E','T',1,0x77}), &vb));
+        BOOST_CHECK(size.find("N") == nullptr);
+        BOOST_CHECK_THROW(p.match(eterm(binary{'G','E','T',1,0x77})), err_unbound_variable);
+
+        varbind vb2;
+        vb2.bind("Size", eterm(8));
+        vb2.bind("N", eterm(255));
+        vb2.bind("Rest", eterm(binary{}));
+        BOOST_CHECK(eterm(p.build(vb2)) == eterm(binary{'G','E','T',1,255,255}));
+    }
+    {
+        bit_pattern p("X:64/signed, Y:64");
+        eterm v[2];
+        BOOST_REQUIRE(p.match(p.build({-1l, -1l}), v));
+        BOOST_CHECK_EQUAL(-1, v[0].to_long());
+        BOOST_CHECK_EQUAL(BIGINT, v[1].type());
+        BOOST_CHECK_EQUAL("18446744073709551615", v[1].to_string());
+        BOOST_CHECK(p.build({1, v[1]}).bits(64, 64) == ~0ull);
+    }
+    BOOST_CHECK_THROW(bit_pattern("<<A:65>>"),         err_format_exception);
+    BOOST_CHECK_THROW(bit_pattern("<<A:16/float>>"),   err_format_exception);
+    BOOST_CHECK_THROW(bit_pattern("<<A:8/utf8>>"),     err_format_exception);
+    BOOST_CHECK_THROW(bit_pattern("<<A/foo>>"),        err_format_exception);
+    BOOST_CHECK_THROW(bit_pattern("<<A, B"),           err_format_exception);
+    BOOST_CHECK_EQUAL(0u, bit_pattern("<<>>").build({}).bit_size());
+}
+
+BOOST_AUTO_TEST_CASE( test_guard )
+{
+    eterm order = eterm::format("{order, 10, 1.5, {ibm, nyse}}");
+    eterm pat   = eterm::format("{order, Qty, Px, Sym}");
+    varbind vb;
+
+    BOOST_CHECK(order.match(pat, eterm_guard("Qty > 0, is_float(Px)"), &vb));
+    BOOST_CHECK_EQUAL(10, vb["Qty"]->to_long());
+    vb.clear();
+    BOOST_CHECK(!order.match(pat, eterm_guard("Qty > 0, is_integer(Px)"), &vb));
+    BOOST_CHECK(vb.find("Qty") == nullptr);
+
+    // Only the variables bound by a failed match are unbound
+    vb.bind("Px", eterm(1.5));
+    vb.bind("Other", atom("x"));
+    BOOST_CHECK(!order.match(pat, eterm_guard("Qty < 0"), &vb));
+    BOOST_CHECK_EQUAL(2u, vb.count());
+    BOOST_CHECK(order.match(pat, eterm_guard("Qty > 0"), &vb));
+    BOOST_CHECK_EQUAL(4u, vb.count());
+    vb.clear();
+
+    auto check = [&](const char* a_guard) {
+        varbind b;
+        return order.match(pat, eterm_guard(a_guard), &b);
+    };
+    BOOST_CHECK(check("Qty == 10.0"));
+    BOOST_CHECK(!check("Qty =:= 10.0"));
+    BOOST_CHECK(check("Qty =/= 10.0, Qty /= 11"));
+    BOOST_CHECK(check("Qty >= 10 andalso Px =< 1.5 andalso Px < 2"));
+    BOOST_CHECK(check("Qty < 0 orelse Px > 1"));
+    BOOST_CHECK(check("not (Qty < 0)"));
+    BOOST_CHECK(!check("not Qty"));
+    BOOST_CHECK(check("tuple_size(Sym) == 2, element(1, Sym) == ibm"));
+    BOOST_CHECK(check("element(2, Sym) =:= nyse, is_atom(element(2, Sym))"));
+    BOOST_CHECK(check("Sym == {ibm, nyse}"));
+    BOOST_CHECK(check("is_number(Qty), is_integer(Qty), not is_tuple(Qty), is_tuple(Sym)"));
+    BOOST_CHECK(check("true, not false"));
+    // Errors and unbound variables fail the guard, and the next guard is tried
+    BOOST_CHECK(!check("element(3, Sym) == ibm"));
+    BOOST_CHECK(!check("map_size(Sym) == 0"));
+    BOOST_CHECK(!check("Unbound == 1"));
+    BOOST_CHECK(check("element(3, Sym) == ibm; Qty == 10"));
+    BOOST_CHECK(!check("element(3, Sym) == ibm orelse Qty == 10"));
+    BOOST_CHECK(check("Qty == 5; Qty == 10"));
+
+    {
+        varbind b{{"M", eterm(map{{eterm(atom("a")), eterm(1)},
+                                  {eterm(atom("b")), eterm::format("[1,2,3]")}})},
+                  {"B", eterm::format("<<1,2,3:4>>")}};
+        BOOST_CHECK((eterm_guard(
+            "is_map(M), map_size(M) == 2, is_map_key(a, M), not is_map_key(c, M), "
+            "map_get(a, M) == 1, length(map_get(b, M)) == 3, hd(map_get(b, M)) == 1, "
+            "is_bitstring(B), not is_binary(B), bit_size(B) == 20, byte_size(B) == 3"))(b));
+    }
+
+    {
+        auto g = eterm_guard::format("X > ~i, X < ~i", 1, 3);
+        BOOST_CHECK(g(varbind{{"X", 2}}));
+        BOOST_CHECK(!g(varbind{{"X", 3}}));
+        BOOST_CHECK(eterm_guard()(varbind()));
+    }
+
+    // Failing guards fall through to the next pattern
+    eterm_pattern_matcher etm;
+    int last = 0;
+    auto fun = [&last](const eterm&, const varbind&, long opaque) {
+        last = int(opaque);
+        return true;
+    };
+    etm.push_back(eterm::format("{order, Qty, Px}"), eterm_guard("Qty > 0, is_integer(Px)"), fun, 1);
+    eterm_pattern_matcher::pattern_functor_t f(fun);
+    etm.push_back(eterm_pattern_action(allocator_t(), f, 2, "{order, Qty, Px} when Qty > ~i", 0));
+    etm.push_back(eterm::format("{order, _, _}"), fun, 3);
+
+    BOOST_CHECK_EQUAL(1, etm.match(eterm::format("{order, 5, 10}")));
+    BOOST_CHECK_EQUAL(2, etm.match(eterm::format("{order, 5, 1.5}")));
+    BOOST_CHECK_EQUAL(2, last);
+    BOOST_CHECK_EQUAL(3, etm.match(eterm::format("{order, -5, 10}")));
+    BOOST_CHECK_EQUAL(0, etm.match(eterm::format("{cancel, 1}")));
+
+    BOOST_CHECK_THROW(eterm_guard("X >"),               err_format_exception);
+    BOOST_CHECK_THROW(eterm_guard("foo(X)"),            err_format_exception);
+    BOOST_CHECK_THROW(eterm_guard("element(X)"),        err_format_exception);
+    BOOST_CHECK_THROW(eterm_guard("_ == 1"),            err_format_exception);
+    BOOST_CHECK_THROW(eterm_guard("X == ~i"),           err_format_exception);
+    BOOST_CHECK_THROW(eterm_guard("(X == 1"),           err_format_exception);
+    BOOST_CHECK_THROW(eterm_guard("X == 1 Y"),          err_format_exception);
+}
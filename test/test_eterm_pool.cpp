@@ -20,6 +20,7 @@ limitations under the License.
 #include <boost/test/unit_test.hpp>
 #include "test_alloc.hpp"
 #include <eixx/eixx.hpp>
+#include <eixx/util/hugepage_alloc.hpp>
 
 using namespace eixx;
 
@@ -47,7 +48,7 @@ BOOST_AUTO_TEST_CASE( test_encode_double_t )
     string s(t.encode(0));
     const uint8_t expect[] = {131,70,64,200,28,214,230,49,248,161};
     BOOST_REQUIRE(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     eterm t1((const char*)expect, idx, sizeof(expect));
     BOOST_REQUIRE_EQUAL(d, t1.to_double());
 }
@@ -59,9 +60,56 @@ BOOST_AUTO_TEST_CASE( test_encode_long_t )
     string s(t.encode(0));
     const uint8_t expect[] = {131,97,123};
     BOOST_REQUIRE(s.equal(expect));
-    int idx = 1;  // skipping the magic byte
+    uintptr_t idx = 1;  // skipping the magic byte
     eterm t1((const char*)expect, idx, sizeof(expect));
     BOOST_REQUIRE_EQUAL(d, t1.to_long());
 }
 
+BOOST_AUTO_TEST_CASE( test_hugepage_alloc )
+{
+    typedef util::hugepage_allocator<char> halloc;
+    typedef marshal::eterm<halloc>         eterm_t;
+    util::hugepage_arena arena(-1);
+    util::hugepage_arena::use(&arena);
+    BOOST_CHECK_EQUAL(&arena, &util::hugepage_arena::local());
+    BOOST_CHECK_EQUAL(-1, arena.numa_node());
+    {
+        eterm_t t(marshal::tuple<halloc>::make(atom("ok"), marshal::binary<halloc>("abc", 3),
+                                               marshal::list<halloc>::make(1, 2)));
+        BOOST_CHECK_EQUAL(1u, arena.regions());
+        auto s = t.encode(0);
+        eterm_t t1(s.c_str(), s.size());
+        BOOST_CHECK(t == t1);
+    }
+
+    // Freed blocks are reused by allocations of the same size class
+    void* p = arena.allocate(100);
+    util::hugepage_arena::deallocate(p, 100);
+    BOOST_CHECK_EQUAL(p, arena.allocate(128));
+
+    // Blocks above 64KB are carved out of the regions too
+    const size_t m = 2*64*1024;
+    char* b = halloc().allocate(m);
+    memset(b, 1, m);
+    halloc().deallocate(b, m);
+    BOOST_CHECK_EQUAL(b, halloc().allocate(m));
+    BOOST_CHECK_EQUAL(1u, arena.regions());
+    BOOST_CHECK_EQUAL(0u, arena.spans());
 
+    // Larger blocks take spans of regions, which are reused once released
+    const size_t n = 3*util::hugepage_arena::MAX_SMALL;
+    char* q = halloc().allocate(n);
+    memset(q, 1, n);
+    halloc().deallocate(q, n);
+    BOOST_CHECK_EQUAL(q, halloc().allocate(n));
+    BOOST_CHECK_EQUAL(1u, arena.spans());
+
+    // Blocks are returned to the arena they came from
+    std::vector<char, halloc> v(1000, 'x');
+    const char* data = v.data();
+    util::hugepage_arena::use(nullptr);
+    BOOST_CHECK_NE(&arena, &util::hugepage_arena::local());
+    v.clear();
+    v.shrink_to_fit();
+    BOOST_CHECK_EQUAL(data, arena.allocate(1000));
+}
@@ -25,8 +25,11 @@ limitations under the License.
 using namespace eixx;
 using eixx::marshal::eterm;
 using eixx::marshal::list;
+using eixx::marshal::tuple;
+using eixx::marshal::binary;
 
 static int g_alloc_count;
+static int g_alloc_total;
 
 template <class T>
 struct counted_alloc : public std::allocator<char> {
@@ -52,6 +55,7 @@ struct counted_alloc : public std::allocator<char> {
 
     pointer allocate(size_t n) {
         ++g_alloc_count;
+        ++g_alloc_total;
         return static_cast<pointer>(::operator new(n * sizeof(T)));
     }
 
@@ -136,3 +140,62 @@ BOOST_AUTO_TEST_CASE( test_refc_list )
     }
     BOOST_CHECK_EQUAL(2, g_alloc_count);
 }
+
+BOOST_AUTO_TEST_CASE( test_refc_decode_into )
+{
+    using my_alloc = counted_alloc<char>;
+    using term     = eterm<my_alloc>;
+    my_alloc alloc;
+
+    auto encode = [&](const char* px, const char* bin) {
+        term t = tuple<my_alloc>::make(
+            term::format(alloc, "{md, ~s, [{~f, ~i}, {~f, ~i}]}", "EUR/USD", 1.2, 10, 1.3, 20),
+            binary<my_alloc>(bin, strlen(bin), alloc), px, alloc);
+        return t.encode(0).to_str();
+    };
+
+    const std::string b1 = encode("abc", "xyz");
+    const std::string b2 = encode("def", "uvw");
+    const std::string b3 = encode("a",   "");
+    const std::string b4 = encode("abcd", "xyz");
+
+    {
+        term t(b1.c_str(), b1.size(), alloc);
+
+        // Returns the number of allocations made by decode_into()
+        auto decode_into = [&](term& a_term, const std::string& a_buf) {
+            int n = g_alloc_total;
+            a_term.decode_into(a_buf.c_str(), a_buf.size(), alloc);
+            return g_alloc_total - n;
+        };
+
+        // Same shape - no allocations
+        BOOST_CHECK_EQUAL(0, decode_into(t, b2));
+        BOOST_CHECK_EQUAL(
+            "{{md,\"EUR/USD\",[{1.2,10},{1.3,20}]},<<\"uvw\">>,\"def\"}", t.to_string());
+
+        // Shorter strings and binaries fit in the existing storage
+        BOOST_CHECK_EQUAL(0, decode_into(t, b3));
+        BOOST_CHECK_EQUAL(
+            "{{md,\"EUR/USD\",[{1.2,10},{1.3,20}]},<<>>,\"a\"}", t.to_string());
+
+        // Longer string - only the string's blob and data are reallocated
+        BOOST_CHECK_EQUAL(2, decode_into(t, b4));
+        BOOST_CHECK_EQUAL(
+            "{{md,\"EUR/USD\",[{1.2,10},{1.3,20}]},<<\"xyz\">>,\"abcd\"}", t.to_string());
+
+        // Shared terms are not modified
+        term t2(t);
+        t.decode_into(b2.c_str(), b2.size(), alloc);
+        BOOST_CHECK_EQUAL(
+            "{{md,\"EUR/USD\",[{1.2,10},{1.3,20}]},<<\"xyz\">>,\"abcd\"}", t2.to_string());
+        BOOST_CHECK_EQUAL(
+            "{{md,\"EUR/USD\",[{1.2,10},{1.3,20}]},<<\"uvw\">>,\"def\"}", t.to_string());
+
+        // Different shape
+        term t3(1);
+        t3.decode_into(b1.c_str(), b1.size(), alloc);
+        BOOST_CHECK(t3 == term(b1.c_str(), b1.size(), alloc));
+    }
+    BOOST_CHECK_EQUAL(2, g_alloc_count);
+}
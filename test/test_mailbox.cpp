@@ -61,3 +61,352 @@ BOOST_AUTO_TEST_CASE( test_mailbox )
     }
     //std::cerr << "mailbox count " << node.registry().count() << std::endl;
 }
+
+BOOST_AUTO_TEST_CASE( test_mailbox_overload )
+{
+    boost::asio::io_service io;
+    otp_node node(io, "a");
+    otp_mailbox::pointer mbox(node.create_mailbox());
+
+    auto deliver = [&](const eterm& msg) {
+        transport_msg tm;
+        tm.set_send(mbox->self(), msg);
+        mbox->deliver(tm);
+    };
+    auto next = [&]() {
+        std::unique_ptr<transport_msg> p(mbox->receive());
+        return p ? p->msg() : eterm();
+    };
+
+    size_t drops = 0;
+    connect::overload_policy<allocator_t> policy;
+    policy.max_length = 3;
+    mbox->overload(policy, [&](otp_mailbox&, const transport_msg&) { drops++; });
+
+    // Drop newest
+    for (long i = 0; i < 5; ++i) deliver(eterm(i));
+    BOOST_CHECK_EQUAL(3u, mbox->length());
+    BOOST_CHECK_EQUAL(2u, mbox->dropped());
+    BOOST_CHECK_EQUAL(2u, drops);
+    BOOST_CHECK_EQUAL(0,  next().to_long());
+    BOOST_CHECK_EQUAL(2u, mbox->length());
+    mbox->clear();
+    BOOST_CHECK_EQUAL(0u, mbox->length());
+
+    // Drop oldest
+    policy.action = connect::overload_action::DROP_OLDEST;
+    mbox->overload(policy);
+    for (long i = 0; i < 5; ++i) deliver(eterm(i));
+    BOOST_CHECK_EQUAL(4u, mbox->dropped());
+    BOOST_CHECK_EQUAL(2,  next().to_long());
+    BOOST_CHECK_EQUAL(3,  next().to_long());
+    BOOST_CHECK_EQUAL(4,  next().to_long());
+    BOOST_CHECK(next().empty());
+
+    // Sample 1 in 2 messages above the limit
+    policy.action      = connect::overload_action::SAMPLE;
+    policy.sample_rate = 2;
+    mbox->overload(policy);
+    for (long i = 0; i < 7; ++i) deliver(eterm(i));
+    BOOST_CHECK_EQUAL(5u, mbox->length());
+    BOOST_CHECK_EQUAL(6u, mbox->dropped());
+    mbox->clear();
+
+    // Drop stale {tick, _} updates, but keep everything else
+    policy.action  = connect::overload_action::DROP_IF;
+    policy.drop_if = [](const transport_msg& tm) {
+        static const eterm s_tick = eterm::format("{tick, _}");
+        return tm.msg().match(s_tick);
+    };
+    mbox->overload(policy);
+    for (long i = 0; i < 3; ++i) deliver(eterm(i));
+    deliver(eterm::format("{tick, 1}"));
+    deliver(eterm::format("{order, 1}"));
+    BOOST_CHECK_EQUAL(4u, mbox->length());
+    BOOST_CHECK_EQUAL(7u, mbox->dropped());
+    mbox->clear();
+
+    // Limit by estimated bytes
+    connect::overload_policy<allocator_t> bytes;
+    bytes.max_bytes = 100;
+    mbox->overload(bytes);
+    deliver(eterm(binary(std::string(60, 'a'))));
+    deliver(eterm(binary(std::string(60, 'b'))));
+    BOOST_CHECK_EQUAL(1u,  mbox->length());
+    BOOST_CHECK_EQUAL(65u, mbox->bytes());
+    BOOST_CHECK_EQUAL(65u, mbox->dropped_bytes());
+    next();
+    BOOST_CHECK_EQUAL(0u,  mbox->bytes());
+
+    // Signals are never shed
+    mbox->overload(policy);
+    for (long i = 0; i < 3; ++i) deliver(eterm(i));
+    transport_msg exit;
+    exit.set_exit(mbox->self(), mbox->self(), atom("shutdown"));
+    mbox->deliver(exit);
+    BOOST_CHECK_EQUAL(4u, mbox->length());
+    BOOST_CHECK_EQUAL(8u, mbox->dropped());
+    mbox->clear();
+
+    // Nor are the messages of the top priority level evicted
+    policy.action = connect::overload_action::DROP_OLDEST;
+    mbox->overload(policy);
+    mbox->priorities(2);
+    mbox->deliver(exit);
+    for (long i = 0; i < 5; ++i) deliver(eterm(i));
+    BOOST_CHECK_EQUAL(3u, mbox->length());
+    {
+        std::unique_ptr<transport_msg> p(mbox->receive());
+        BOOST_REQUIRE(p);
+        BOOST_CHECK_EQUAL(transport_msg::EXIT, p->type());
+    }
+    BOOST_CHECK_EQUAL(3,  next().to_long());
+    BOOST_CHECK_EQUAL(4,  next().to_long());
+}
+
+BOOST_AUTO_TEST_CASE( test_mailbox_priority )
+{
+    boost::asio::io_service io;
+    otp_node node(io, "a");
+    otp_mailbox::pointer mbox(node.create_mailbox());
+    BOOST_CHECK_EQUAL(1u, mbox->priorities());
+
+    auto deliver = [&](const eterm& msg) {
+        transport_msg tm;
+        tm.set_send(mbox->self(), msg);
+        mbox->deliver(tm);
+    };
+    auto next = [&]() {
+        std::unique_ptr<transport_msg> p(mbox->receive());
+        return p ? p->msg() : eterm();
+    };
+
+    // Exit signals bypass queued data messages by default
+    mbox->priorities(2);
+    for (long i = 0; i < 3; ++i) deliver(eterm(i));
+    transport_msg exit;
+    exit.set_exit(mbox->self(), mbox->self(), atom("shutdown"));
+    mbox->deliver(exit);
+    BOOST_CHECK_EQUAL(4u, mbox->length());
+    {
+        std::unique_ptr<transport_msg> p(mbox->receive());
+        BOOST_REQUIRE(p);
+        BOOST_CHECK_EQUAL(transport_msg::EXIT, p->type());
+    }
+    BOOST_CHECK_EQUAL(0, next().to_long());
+    mbox->clear();
+
+    // User classifier with a starvation guard of 2 messages
+    mbox->priorities(3, [](int, const eterm& a_head) -> size_t {
+        static const atom s_ctrl("ctrl"), s_info("info");
+        return a_head.type() != ATOM ? 2 : a_head.to_atom() == s_ctrl ? 0
+             : a_head.to_atom() == s_info ? 1 : 2;
+    }, 2);
+    BOOST_CHECK_EQUAL(3u, mbox->priorities());
+    deliver(eterm(1));
+    deliver(eterm(2));
+    for (long i = 0; i < 3; ++i) deliver(eterm::format("{ctrl, ~i}", i));
+    deliver(eterm::format("{info, 1}"));
+
+    BOOST_CHECK(next() == eterm::format("{ctrl, 0}"));
+    BOOST_CHECK(next() == eterm::format("{ctrl, 1}"));
+    BOOST_CHECK_EQUAL(1, next().to_long());      // Starvation guard
+    BOOST_CHECK(next() == eterm::format("{ctrl, 2}"));
+    BOOST_CHECK(next() == eterm::format("{info, 1}"));
+    BOOST_CHECK_EQUAL(2, next().to_long());
+    BOOST_CHECK(next().empty());
+    BOOST_CHECK_EQUAL(0u, mbox->length());
+}
+
+namespace {
+    struct counter_server : public otp_gen_server {
+        long              count = 0;
+        otp_gen_server::from_type pending;
+
+        explicit counter_server(otp_node& a_node) : otp_gen_server(a_node) {}
+
+        connect::gen_action handle_call(const eterm& a_req, from_type& a_from) override {
+            static const atom s_add("add"), s_later("later");
+            if (a_req.type() == TUPLE && a_req.to_tuple()[0] == s_add)
+                reply(a_from, count += a_req.to_tuple()[1].to_long());
+            else if (a_req == s_later)
+                pending = a_from;
+            else {
+                reply(a_from, am_ok);
+                return connect::gen_action::HIBERNATE;
+            }
+            return connect::gen_action::CONTINUE;
+        }
+
+        connect::gen_action handle_cast(const eterm& a_req) override {
+            static const atom s_stop("stop");
+            if (a_req == s_stop)
+                return connect::gen_action::STOP;
+            count = a_req.to_long();
+            return connect::gen_action::CONTINUE;
+        }
+
+        eterm state() const override { return eterm(count); }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_gen_server )
+{
+    boost::asio::io_service io;
+    otp_node node(io, "a");
+    otp_mailbox::pointer client(node.create_mailbox());
+    counter_server server(node);
+
+    auto send = [&](const eterm& msg) {
+        transport_msg tm;
+        tm.set_send(server.self(), msg);
+        server.mailbox().deliver(tm);
+    };
+    auto call = [&](const eterm& tag, const eterm& req) {
+        send(tuple::make(am_gen_call, tuple::make(client->self(), tag), req));
+    };
+    auto next = [&]() {
+        std::unique_ptr<transport_msg> p(client->receive());
+        return p ? p->msg() : eterm();
+    };
+
+    ref r1(node.nodename(), 1, 0, 0, 0), r2(node.nodename(), 2, 0, 0, 0);
+    call(r1, tuple::make(atom("add"), 5));
+    call(r2, tuple::make(atom("add"), 2));
+    BOOST_CHECK_EQUAL(2u, server.poll());
+    BOOST_CHECK(next() == tuple::make(r1, 5));
+    BOOST_CHECK(next() == tuple::make(r2, 7));
+    BOOST_CHECK_EQUAL(2u, server.pooled());
+
+    // Reply tuples are reused once the receiver released them
+    call(r1, tuple::make(atom("add"), 1));
+    server.poll();
+    BOOST_CHECK_EQUAL(2u, server.pooled());
+    BOOST_CHECK(next() == tuple::make(r1, 8));
+
+    // Deferred reply with an alias tag is sent through the alias
+    ref   l_alias = client->alias();
+    eterm alias   = list::make(am_alias, l_alias);
+    call(alias, atom("later"));
+    server.poll();
+    BOOST_CHECK(next().empty());
+    BOOST_REQUIRE(server.pending.valid());
+    BOOST_CHECK(server.pending.tag() == alias);
+    server.reply(server.pending, atom("done"));
+    BOOST_CHECK(!server.pending.valid());
+    {
+        std::unique_ptr<transport_msg> p(client->receive());
+        BOOST_REQUIRE(p);
+        BOOST_CHECK_EQUAL(transport_msg::ALIAS_SEND, p->type());
+        BOOST_CHECK(p->msg() == tuple::make(alias, atom("done")));
+    }
+    BOOST_CHECK_THROW(server.reply(server.pending, am_ok), err_bad_argument);
+
+    // A late reply to a caller that deactivated the alias is dropped
+    call(alias, atom("later"));
+    server.poll();
+    BOOST_CHECK(client->unalias(l_alias));
+    server.reply(server.pending, atom("done"));
+    BOOST_CHECK(next().empty());
+
+    // Casts and sys:get_state/1
+    send(tuple::make(am_gen_cast, 10));
+    send(tuple::make(am_system, tuple::make(client->self(), r1), am_get_state));
+    server.poll();
+    BOOST_CHECK(next() == tuple::make(r1, 10));
+
+    // Messages are held while suspended
+    send(tuple::make(am_system, tuple::make(client->self(), r1), am_suspend));
+    call(r2, tuple::make(atom("add"), 1));
+    send(tuple::make(am_system, tuple::make(client->self(), r1), am_get_state));
+    server.poll();
+    BOOST_CHECK(server.suspended());
+    BOOST_CHECK(next() == tuple::make(r1, am_ok));
+    BOOST_CHECK(next() == tuple::make(r1, 10));
+    BOOST_CHECK(next().empty());
+    send(tuple::make(am_system, tuple::make(client->self(), r1), am_resume));
+    server.poll();
+    BOOST_CHECK(!server.suspended());
+    BOOST_CHECK(next() == tuple::make(r1, am_ok));
+    BOOST_CHECK(next() == tuple::make(r2, 11));
+
+    // Hibernation releases pooled reply tuples
+    call(r1, atom("hibernate"));
+    server.poll();
+    BOOST_CHECK(next() == tuple::make(r1, am_ok));
+    BOOST_CHECK_EQUAL(0u, server.pooled());
+
+    // Asynchronous processing until a callback stops the server
+    server.start();
+    call(r1, tuple::make(atom("add"), 1));
+    send(tuple::make(am_gen_cast, atom("stop")));
+    call(r2, tuple::make(atom("add"), 1));
+    io.poll();
+    BOOST_CHECK(next() == tuple::make(r1, 12));
+    BOOST_CHECK(next().empty());
+    BOOST_CHECK_EQUAL(1u, server.mailbox().length());
+}
+
+BOOST_AUTO_TEST_CASE( test_gen_server_call )
+{
+    boost::asio::io_service io;
+    otp_node node(io, "a");
+    otp_mailbox::pointer client(node.create_mailbox());
+    counter_server server(node);
+    BOOST_REQUIRE(server.mailbox().reg(atom("counter")));
+    server.start();
+
+    // Synchronous calls by pid and by name
+    BOOST_CHECK_EQUAL(2,  node.call(server.self(), tuple::make(atom("add"), 2)).to_long());
+    BOOST_CHECK_EQUAL(5,  node.call(atom("counter"), tuple::make(atom("add"), 3)).to_long());
+    BOOST_CHECK_EQUAL(6,  client->call(tuple::make(atom("counter"), node.nodename()),
+                                       tuple::make(atom("add"), 1)).to_long());
+    BOOST_CHECK_THROW(node.call(atom("none"), am_ok), err_no_process);
+    BOOST_CHECK_THROW(client->call(eterm(1), am_ok), err_bad_argument);
+
+    // Many calls in flight from one mailbox
+    const int N = 1000;
+    int replies = 0;
+    long sum = 0;
+    for (int i = 0; i < N; ++i)
+        client->async_call(server.self(), tuple::make(atom("add"), 1),
+            [&](connect::call_status s, const eterm& r) {
+                BOOST_REQUIRE_EQUAL(int(connect::call_status::OK), int(s));
+                ++replies;
+                sum = std::max(sum, r.to_long());
+            });
+    BOOST_CHECK_EQUAL(size_t(N), client->pending_calls());
+    while (replies < N)
+        io.run_one();
+    BOOST_CHECK_EQUAL(6+N, sum);
+    BOOST_CHECK_EQUAL(0u, client->pending_calls());
+    BOOST_CHECK_EQUAL(0u, client->length());
+
+    // A reply arriving after the timeout is discarded
+    BOOST_CHECK_THROW(client->call(server.self(), atom("later"), std::chrono::milliseconds(10)),
+                      err_timeout);
+    BOOST_REQUIRE(server.pending.valid());
+    server.reply(server.pending, am_ok);
+    BOOST_CHECK_EQUAL(0u, client->length());
+
+    // 'DOWN' of the server fails the call
+    connect::call_status status = connect::call_status::OK;
+    eterm reason;
+    ref r = client->async_call(server.self(), atom("later"),
+        [&](connect::call_status s, const eterm& a) { status = s; reason = a; });
+    transport_msg down;
+    down.set_monitor_exit(server.self(), client->self(), r, atom("killed"));
+    client->deliver(down);
+    io.poll();
+    BOOST_CHECK(status == connect::call_status::DOWN);
+    BOOST_CHECK(reason == atom("killed"));
+    BOOST_CHECK_EQUAL(0u, client->pending_calls());
+    BOOST_CHECK_EQUAL(0u, client->length());
+
+    // Other refs of the node are not taken for replies
+    transport_msg tm;
+    tm.set_send(client->self(), tuple::make(node.create_ref(), am_ok));
+    client->deliver(tm);
+    BOOST_CHECK_EQUAL(1u, client->length());
+    server.stop();
+}
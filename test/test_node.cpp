@@ -26,6 +26,10 @@ limitations under the License.
 ***** END LICENSE BLOCK *****
 */
 
+#include <atomic>
+#include <future>
+#include <thread>
+#include <eixx/util/md5.hpp>
 #include <eixx/util/async_wait_timeout.hpp>
 #include <boost/test/unit_test.hpp>
 #include "test_alloc.hpp"
@@ -54,3 +58,651 @@ BOOST_AUTO_TEST_CASE( test_node )
     BOOST_REQUIRE(l_same);
     BOOST_REQUIRE_EQUAL(std::string(), l_resolved);
 }
+
+BOOST_AUTO_TEST_CASE( test_node_ring )
+{
+    typedef connect::basic_node_ring<allocator_t, detail::mutex> node_ring;
+    const atom a("a@host"), b("b@host"), c("c@host");
+
+    node_ring ring(16);
+    BOOST_CHECK(ring.route(eterm(1l)).empty());
+    BOOST_CHECK(ring.add(a, true));
+    BOOST_CHECK(ring.add(b, true));
+    BOOST_CHECK(ring.add(c, true));
+    BOOST_CHECK(!ring.add(c));
+    BOOST_CHECK_EQUAL(3u, ring.size());
+
+    std::map<atom, int> counts;
+    std::vector<atom>   owners;
+    for (long i = 0; i < 300; ++i) {
+        atom o = ring.owner(eterm(i));
+        BOOST_CHECK_EQUAL(o, ring.route(eterm(i)));
+        owners.push_back(o);
+        counts[o]++;
+    }
+    BOOST_CHECK_EQUAL(3u, counts.size());
+
+    // Keys of a down node are re-routed, and all others stay in place
+    ring.set_up(b, false);
+    for (long i = 0; i < 300; ++i) {
+        atom r = ring.route(eterm(i));
+        BOOST_CHECK_EQUAL(owners[i], ring.owner(eterm(i)));
+        if (owners[i] == b) BOOST_CHECK_NE(b, r);
+        else                BOOST_CHECK_EQUAL(owners[i], r);
+    }
+    ring.set_up(b, true);
+    BOOST_CHECK(ring.remove(b));
+    for (long i = 0; i < 300; ++i)
+        if (owners[i] != b)
+            BOOST_CHECK_EQUAL(owners[i], ring.owner(eterm(i)));
+
+    ring.set_up(a, false);
+    ring.set_up(c, false);
+    BOOST_CHECK(ring.route(eterm(1l)).empty());
+
+    // Messages are sent to the live local node when the owner is down
+    boost::asio::io_service io;
+    otp_node node(io, "a");
+    otp_mailbox::pointer mbox(node.create_mailbox(atom("srv")));
+    BOOST_CHECK(node.ring_add(node.nodename()));
+    BOOST_CHECK(node.ring_add(b));
+    BOOST_CHECK(node.ring().is_up(node.nodename()));
+    BOOST_CHECK(!node.ring().is_up(b));
+    for (long i = 0; i < 10; ++i) {
+        BOOST_CHECK_EQUAL(node.nodename(), node.send_by_key(eterm(i), atom("srv"), eterm(i)));
+        std::unique_ptr<transport_msg> msg(mbox->receive());
+        BOOST_REQUIRE(msg);
+        BOOST_CHECK_EQUAL(i, msg->msg().to_long());
+    }
+    node.ring().set_up(node.nodename(), false);
+    BOOST_CHECK_THROW(node.send_by_key(eterm(1l), atom("srv"), eterm(1l)), err_connection);
+}
+
+BOOST_AUTO_TEST_CASE( test_link_stats )
+{
+    using us = connect::link_stats::usecs;
+    connect::link_stats s;
+    BOOST_CHECK_EQUAL(0u, s.probes_acked);
+    BOOST_CHECK(s.idle() >= connect::link_stats::clock::duration(0));
+
+    s.add_rtt(us(800));
+    BOOST_CHECK_EQUAL(800, s.avg_rtt.count());
+    s.add_rtt(us(1600));
+    BOOST_CHECK_EQUAL(900, s.avg_rtt.count());
+    s.add_rtt(us(0));
+    s.add_rtt(us(1l << 40));
+    BOOST_CHECK_EQUAL(4u,   s.probes_acked);
+    BOOST_CHECK_EQUAL(0,    s.min_rtt.count());
+    BOOST_CHECK_EQUAL(1l << 40, s.max_rtt.count());
+    BOOST_CHECK_EQUAL(1l << 40, s.last_rtt.count());
+    BOOST_CHECK_EQUAL(1u,   s.histogram[0]);
+    BOOST_CHECK_EQUAL(1u,   s.histogram[9]);    // 800us
+    BOOST_CHECK_EQUAL(1u,   s.histogram[10]);   // 1600us
+    BOOST_CHECK_EQUAL(1u,   s.histogram[connect::link_stats::HISTOGRAM_SIZE-1]);
+}
+
+namespace {
+
+/// In-process fake Erlang node.  It answers the epmd port query reporting
+/// the given distribution version and performs the OTP 23+ handshake as
+/// the accepting side, after which distribution frames are exchanged with
+/// blocking reads and writes.
+struct fake_peer {
+    typedef boost::asio::ip::tcp tcp;
+
+    boost::asio::io_service io;
+    tcp::acceptor           epmd;
+    tcp::acceptor           listener;
+    tcp::socket             sock;
+    std::string             name;
+    std::string             cookie;
+    uint16_t                version;        ///< Dist version reported by epmd
+    char                    tag;            ///< Tag of the received send_name
+    uint64_t                flags;          ///< Flags of the connecting node
+    uint32_t                creation;       ///< Creation of the connecting node
+    bool                    complement;     ///< Complement was received
+    bool                    digest_ok;      ///< Challenge reply digest matched
+
+    fake_peer(const std::string& a_name, const std::string& a_cookie, uint16_t a_version)
+        : epmd    (io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+        , listener(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+        , sock(io), name(a_name), cookie(a_cookie), version(a_version)
+        , tag(0), flags(0), creation(0), complement(false), digest_ok(false)
+    {}
+
+    uint16_t epmd_port() const { return epmd.local_endpoint().port(); }
+
+    static std::string digest(uint32_t a_challenge, const std::string& a_cookie) {
+        std::string s = a_cookie + std::to_string(a_challenge);
+        unsigned char d[16];
+        util::md5::digest(s.c_str(), s.size(), d);
+        return std::string(reinterpret_cast<char*>(d), 16);
+    }
+
+    std::string read(size_t n) {
+        std::string s(n, '\0');
+        boost::asio::read(sock, boost::asio::buffer(&s[0], n));
+        return s;
+    }
+
+    std::string read_packet16() {
+        std::string h = read(2);
+        const char* p = h.c_str();
+        return read(get16be(p));
+    }
+
+    void write_packet16(const std::string& a_data) {
+        char h[2], *w = h;
+        put16be(w, static_cast<uint16_t>(a_data.size()));
+        boost::asio::write(sock, boost::asio::buffer(std::string(h, 2) + a_data));
+    }
+
+    /// Serve the epmd query and the handshake of one connection.
+    void handshake() {
+        {
+            tcp::socket s(io);
+            epmd.accept(s);
+            char req[256];
+            boost::asio::read(s, boost::asio::buffer(req, 2));
+            const char* p = req;
+            boost::asio::read(s, boost::asio::buffer(req, get16be(p)));
+
+            std::string alive = name.substr(0, name.find('@'));
+            char  resp[256], *w = resp;
+            put8(w, EI_EPMD_PORT2_RESP);
+            put8(w, 0);
+            put16be(w, listener.local_endpoint().port());
+            put8(w, 77);                        // normal node
+            put8(w, 0);                         // tcp/ip v4
+            put16be(w, version);
+            put16be(w, EI_DIST_5);
+            put16be(w, static_cast<uint16_t>(alive.size()));
+            memcpy(w, alive.c_str(), alive.size()); w += alive.size();
+            put16be(w, 0);
+            boost::asio::write(s, boost::asio::buffer(resp, w - resp));
+        }
+
+        listener.accept(sock);
+
+        std::string name_msg = read_packet16();
+        const char* p = name_msg.c_str();
+        tag = get8(p);
+        if (tag == 'n') {
+            get16be(p);
+            flags = get32be(p);
+        } else {
+            flags    = get64be(p);
+            creation = get32be(p);
+        }
+
+        write_packet16("sok");
+
+        const uint32_t l_challenge = 0x12345678;
+        std::string ch(1 + 8 + 4 + 4 + 2 + name.size(), '\0');
+        char* w = &ch[0];
+        put8(w, 'N');
+        put64be(w, connect::LOCAL_FLAGS);
+        put32be(w, l_challenge);
+        put32be(w, 1);
+        put16be(w, static_cast<uint16_t>(name.size()));
+        memcpy(w, name.c_str(), name.size());
+        write_packet16(ch);
+
+        std::string reply = read_packet16();
+        if (reply[0] == 'c') {
+            complement = true;
+            p = reply.c_str() + 1;
+            flags   |= uint64_t(get32be(p)) << 32;
+            creation = get32be(p);
+            reply    = read_packet16();
+        }
+        BOOST_REQUIRE_EQUAL('r', reply[0]);
+        p = reply.c_str() + 1;
+        uint32_t l_their_challenge = get32be(p);
+        digest_ok = reply.substr(5, 16) == digest(l_challenge, cookie);
+
+        write_packet16('a' + digest(l_their_challenge, cookie));
+    }
+
+    /// Send a distribution message with the control term \a a_cntrl.
+    void send(const eterm& a_cntrl, const eterm& a_msg = eterm()) {
+        std::string s("p");
+        auto c = a_cntrl.encode(0);
+        s.append(c.c_str(), c.size());
+        if (!a_msg.empty()) {
+            auto m = a_msg.encode(0);
+            s.append(m.c_str(), m.size());
+        }
+        char h[4], *w = h;
+        put32be(w, static_cast<uint32_t>(s.size()));
+        boost::asio::write(sock, boost::asio::buffer(std::string(h, 4) + s));
+    }
+
+    /// Receive the next distribution message skipping ticks.
+    tuple recv(eterm* a_msg = nullptr) {
+        std::string s;
+        while (s.empty()) {
+            std::string h = read(4);
+            const char* p = h.c_str();
+            s = read(get32be(p));
+        }
+        BOOST_REQUIRE_EQUAL('p', s[0]);
+        BOOST_REQUIRE_EQUAL(char(ERL_VERSION_MAGIC), s[1]);
+        uintptr_t idx = 2;
+        eterm cntrl(s.c_str(), idx, s.size());
+        if (a_msg && idx < s.size()) {
+            ++idx;
+            *a_msg = eterm(s.c_str(), idx, s.size());
+        }
+        return cntrl.to_tuple();
+    }
+};
+
+transport_msg* wait_msg(otp_mailbox& a_mbox) {
+    for (int i = 0; i < 2000; ++i) {
+        if (transport_msg* m = a_mbox.receive())
+            return m;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return nullptr;
+}
+
+template <typename Pred>
+bool wait_until(Pred a_pred) {
+    for (int i = 0; i < 2000 && !a_pred(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return a_pred();
+}
+
+/// Node connected to a fake_peer.  The node's io_service is run by a
+/// separate thread, while the test plays the role of the peer.
+struct peer_session {
+    fake_peer                       peer;
+    epid                            peer_pid;
+    boost::asio::io_service         io;
+    boost::asio::io_service::work   work;
+    otp_node                        node;
+    std::thread                     thr;
+
+    explicit peer_session(uint16_t a_version)
+        : peer("peer@127.0.0.1", "cookie", a_version)
+        , peer_pid(peer.name.c_str(), 1, 0, 1)
+        , work(io)
+        , node(io, "eixx@127.0.0.1", "cookie")
+    {
+        ::setenv("ERL_EPMD_PORT", std::to_string(peer.epmd_port()).c_str(), 1);
+
+        std::promise<std::string> l_connected;
+        auto l_status = l_connected.get_future();
+        bool l_done   = false;
+        node.connect([&](otp_connection*, const std::string& err) {
+            if (!l_done) { l_done = true; l_connected.set_value(err); }
+        }, atom(peer.name), atom("cookie"));
+
+        thr = std::thread([this] { io.run(); });
+
+        peer.handshake();
+        BOOST_REQUIRE(l_status.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        BOOST_REQUIRE_EQUAL("", l_status.get());
+    }
+
+    ~peer_session() {
+        io.stop();
+        thr.join();
+        ::unsetenv("ERL_EPMD_PORT");
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( test_md5 )
+{
+    auto hex = [](const std::string& s) {
+        uint8_t d[16];
+        util::md5::digest(s.c_str(), s.size(), d);
+        char buf[33];
+        for (int i=0; i < 16; i++)
+            snprintf(buf + 2*i, 3, "%02x", d[i]);
+        return std::string(buf);
+    };
+    // RFC 1321 test suite
+    BOOST_CHECK_EQUAL("d41d8cd98f00b204e9800998ecf8427e", hex(""));
+    BOOST_CHECK_EQUAL("0cc175b9c0f1b6a831c399e269772661", hex("a"));
+    BOOST_CHECK_EQUAL("900150983cd24fb0d6963f7d28e17f72", hex("abc"));
+    BOOST_CHECK_EQUAL("f96b697d7cb7938d525a2f31aaf161d0", hex("message digest"));
+    BOOST_CHECK_EQUAL("c3fcd3d76192e4007dfb496cca67e13b", hex("abcdefghijklmnopqrstuvwxyz"));
+    BOOST_CHECK_EQUAL("d174ab98d277d9f5a5611c2c9f419d9f",
+        hex("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"));
+    BOOST_CHECK_EQUAL("57edf4a22be3c955ac49da2e2107b67a",
+        hex("1234567890123456789012345678901234567890"
+            "1234567890123456789012345678901234567890"));
+
+    // Chunked updates and a copied midstate give the same digest
+    std::string s(200, 'x');
+    for (size_t i=0; i < s.size(); i++) s[i] = char(i * 7);
+    uint8_t expect[16], out[16];
+    util::md5::digest(s.c_str(), s.size(), expect);
+    for (size_t split : {0, 1, 55, 56, 63, 64, 65, 128, 199}) {
+        util::md5 prefix;
+        prefix.update(s.c_str(), split);
+        util::md5 m(prefix);
+        m.update(s.c_str() + split, s.size() - split);
+        m.digest(out);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expect, expect+16, out, out+16);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_node_handshake )
+{
+    for (uint16_t l_version : {uint16_t(EI_DIST_6), uint16_t(EI_DIST_5)}) {
+        BOOST_TEST_MESSAGE("Handshake with a peer of dist version " << l_version);
+
+        peer_session s(l_version);
+        fake_peer&   peer     = s.peer;
+        otp_node&    node     = s.node;
+        const epid&  peer_pid = s.peer_pid;
+        otp_mailbox::pointer mbox(node.create_mailbox(atom("mbox")));
+
+        BOOST_CHECK_EQUAL(l_version == EI_DIST_6 ? 'N' : 'n', peer.tag);
+        BOOST_CHECK_EQUAL(l_version == EI_DIST_5, peer.complement);
+        BOOST_CHECK(peer.digest_ok);
+        BOOST_CHECK(peer.flags & DFLAG_HANDSHAKE_23);
+        BOOST_CHECK(peer.flags & DFLAG_UNLINK_ID);
+        BOOST_CHECK(peer.flags & DFLAG_ALIAS);
+        BOOST_CHECK_EQUAL(node.creation(), peer.creation);
+        BOOST_CHECK(node.remote_flags(atom(peer.name)) & DFLAG_ALIAS);
+
+        eterm l_marker = atom("marker");
+        auto  send_marker = [&] {
+            peer.send(tuple::make(long(ERL_SEND), atom(), mbox->self()), l_marker);
+        };
+        std::unique_ptr<transport_msg> m;
+
+        // Messages sent to an explicit alias are delivered until unalias()
+        ref l_alias = mbox->alias();
+        peer.send(tuple::make(long(ERL_ALIAS_SEND), peer_pid, l_alias), atom("hello"));
+        m.reset(wait_msg(*mbox));
+        BOOST_REQUIRE(m);
+        BOOST_CHECK_EQUAL(transport_msg::ALIAS_SEND, m->type());
+        BOOST_CHECK_EQUAL(peer_pid, m->sender_pid());
+        BOOST_CHECK_EQUAL(atom("hello"), m->msg().to_atom());
+        BOOST_CHECK(mbox->unalias(l_alias));
+        BOOST_CHECK(!mbox->unalias(l_alias));
+        peer.send(tuple::make(long(ERL_ALIAS_SEND), peer_pid, l_alias), atom("lost"));
+        send_marker();
+        m.reset(wait_msg(*mbox));
+        BOOST_REQUIRE(m);
+        BOOST_CHECK_EQUAL(l_marker, m->msg());
+
+        // A reply alias is deactivated by the first message
+        l_alias = mbox->alias(connect::alias_mode::REPLY);
+        peer.send(tuple::make(long(ERL_ALIAS_SEND), peer_pid, l_alias), atom("reply"));
+        peer.send(tuple::make(long(ERL_ALIAS_SEND), peer_pid, l_alias), atom("lost"));
+        send_marker();
+        m.reset(wait_msg(*mbox));
+        BOOST_REQUIRE(m);
+        BOOST_CHECK_EQUAL(atom("reply"), m->msg().to_atom());
+        m.reset(wait_msg(*mbox));
+        BOOST_REQUIRE(m);
+        BOOST_CHECK_EQUAL(l_marker, m->msg());
+
+        // Messages can be sent to an alias of a remote process
+        ref l_peer_alias(atom(peer.name), {1, 2, 3}, 1);
+        mbox->send(l_peer_alias, atom("to_alias"));
+        eterm l_msg;
+        tuple l_cntrl = peer.recv(&l_msg);
+        BOOST_CHECK_EQUAL(ERL_ALIAS_SEND, l_cntrl[0].to_long());
+        BOOST_CHECK_EQUAL(mbox->self(), l_cntrl[1].to_pid());
+        BOOST_CHECK_EQUAL(l_peer_alias, l_cntrl[2].to_ref());
+        BOOST_CHECK_EQUAL(atom("to_alias"), l_msg.to_atom());
+        BOOST_CHECK_THROW(mbox->send(ref(atom("none@host"), {1, 2, 3}, 1), atom("lost")),
+                          err_connection);
+
+        // Unlinking initiated by the peer is acknowledged
+        peer.send(tuple::make(long(ERL_LINK), peer_pid, mbox->self()));
+        BOOST_CHECK(wait_until([&] { return mbox->linked(peer_pid); }));
+        peer.send(tuple::make(long(ERL_UNLINK_ID), 7l, peer_pid, mbox->self()));
+        l_cntrl = peer.recv();
+        BOOST_CHECK_EQUAL(ERL_UNLINK_ID_ACK, l_cntrl[0].to_long());
+        BOOST_CHECK_EQUAL(7, l_cntrl[1].to_long());
+        BOOST_CHECK_EQUAL(mbox->self(), l_cntrl[2].to_pid());
+        BOOST_CHECK_EQUAL(peer_pid, l_cntrl[3].to_pid());
+        BOOST_CHECK(!mbox->linked(peer_pid));
+        while ((m.reset(mbox->receive()), m));  // LINK and UNLINK_ID signals
+
+        // Exits arriving before the peer acknowledges our unlink are dropped
+        mbox->link(peer_pid);
+        l_cntrl = peer.recv();
+        BOOST_CHECK_EQUAL(ERL_LINK, l_cntrl[0].to_long());
+        mbox->unlink(peer_pid);
+        BOOST_CHECK(mbox->unlinking(peer_pid));
+        l_cntrl = peer.recv();
+        BOOST_REQUIRE_EQUAL(ERL_UNLINK_ID, l_cntrl[0].to_long());
+        long l_id = l_cntrl[1].to_long();
+        BOOST_CHECK_EQUAL(mbox->self(), l_cntrl[2].to_pid());
+        BOOST_CHECK_EQUAL(peer_pid, l_cntrl[3].to_pid());
+        peer.send(tuple::make(long(ERL_EXIT), peer_pid, mbox->self(), atom("crash")));
+        send_marker();
+        m.reset(wait_msg(*mbox));
+        BOOST_REQUIRE(m);
+        BOOST_CHECK_EQUAL(l_marker, m->msg());
+        peer.send(tuple::make(long(ERL_UNLINK_ID_ACK), l_id, peer_pid, mbox->self()));
+        BOOST_CHECK(wait_until([&] { return !mbox->unlinking(peer_pid); }));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_node_probe )
+{
+    using ms = std::chrono::milliseconds;
+
+    peer_session s(EI_DIST_6);
+    fake_peer&   peer = s.peer;
+    otp_node&    node = s.node;
+    const atom   l_peer(peer.name);
+    auto&        con  = node.connection(l_peer);
+
+    // The connection's state is accessed from the node's I/O thread
+    auto stats = [&] {
+        std::promise<connect::link_stats> p;
+        s.io.post([&] { p.set_value(con.stats()); });
+        return p.get_future().get();
+    };
+    s.io.post([&] { con.set_probe(ms(20), ms(300)); });
+
+    // The probe is a net_kernel call answered like net_adm:ping/1
+    eterm l_msg;
+    tuple l_cntrl = peer.recv(&l_msg);
+    BOOST_REQUIRE_EQUAL(ERL_REG_SEND, l_cntrl[0].to_long());
+    BOOST_CHECK_EQUAL(am_net_kernel, l_cntrl[3].to_atom());
+    const tuple& l_call = l_msg.to_tuple();
+    BOOST_REQUIRE_EQUAL(3u, l_call.size());
+    BOOST_CHECK_EQUAL(am_gen_call, l_call[0].to_atom());
+    BOOST_CHECK_EQUAL(am_is_auth,  l_call[2].to_tuple()[0].to_atom());
+    const tuple& l_from = l_call[1].to_tuple();
+    BOOST_CHECK_EQUAL(0u, stats().probes_acked);
+
+    // The reply is consumed by the connection and updates the RTT
+    peer.send(tuple::make(long(ERL_SEND), atom(), l_from[0].to_pid()),
+              tuple::make(l_from[1], atom("yes")));
+    BOOST_CHECK(wait_until([&] { return stats().probes_acked == 1; }));
+    connect::link_stats l_stats = stats();
+    BOOST_CHECK(l_stats.probes_sent >= 1u);
+    BOOST_CHECK(l_stats.last_rtt > connect::link_stats::usecs(0));
+    BOOST_CHECK(l_stats.last_rtt == l_stats.min_rtt);
+    BOOST_CHECK(l_stats.last_rtt == l_stats.avg_rtt);
+
+    // Unanswered probes and a silent peer exceed the deadline, and the
+    // link is closed
+    BOOST_CHECK(node.connected(l_peer));
+    BOOST_CHECK(wait_until([&] { return !node.connected(l_peer); }));
+}
+
+BOOST_AUTO_TEST_CASE( test_node_shed )
+{
+    peer_session s(EI_DIST_6);
+    fake_peer&   peer     = s.peer;
+    otp_node&    node     = s.node;
+    const epid&  peer_pid = s.peer_pid;
+    otp_mailbox::pointer mbox(node.create_mailbox(atom("mbox")));
+
+    std::atomic<size_t> l_decoded(0);
+    connect::overload_policy<allocator_t> policy;
+    policy.max_bytes = 100;
+    mbox->overload(policy, [&](otp_mailbox&, const transport_msg& tm) {
+        if (tm.has_msg()) ++l_decoded;
+    });
+
+    // The second message is shed by its wire size before it is decoded
+    auto reg_send = [&](char c) {
+        peer.send(tuple::make(long(ERL_REG_SEND), peer_pid, atom(), atom("mbox")),
+                  binary(std::string(60, c)));
+    };
+    reg_send('a');
+    reg_send('b');
+    BOOST_CHECK(wait_until([&] { return mbox->dropped() == 1; }));
+    BOOST_CHECK_EQUAL(1u,  mbox->length());
+    BOOST_CHECK_EQUAL(65u, mbox->bytes());
+    BOOST_CHECK_EQUAL(65u, mbox->dropped_bytes());
+    BOOST_CHECK_EQUAL(0u,  l_decoded.load());
+
+    std::unique_ptr<transport_msg> m(wait_msg(*mbox));
+    BOOST_REQUIRE(m);
+    BOOST_CHECK_EQUAL(eterm(binary(std::string(60, 'a'))), m->msg());
+    BOOST_CHECK_EQUAL(0u, mbox->bytes());
+}
+
+BOOST_AUTO_TEST_CASE( test_node_spawn )
+{
+    typedef std::pair<connect::call_status, eterm> result;
+
+    peer_session s(EI_DIST_6);
+    fake_peer&   peer     = s.peer;
+    otp_node&    node     = s.node;
+    const epid&  peer_pid = s.peer_pid;
+    otp_mailbox::pointer mbox(node.create_mailbox(atom("mbox")));
+    BOOST_CHECK(peer.flags & DFLAG_SPAWN);
+
+    auto spawn_request = [&](const list& a_opts, std::promise<result>& a_res,
+                             const epid* a_gleader = nullptr) {
+        return mbox->spawn_request(atom(peer.name), atom("mod"), atom("fun"),
+            list{eterm(1l), eterm(2l)}, a_opts,
+            [&a_res](connect::call_status a_status, const eterm& a_result) {
+                a_res.set_value(result(a_status, a_result));
+            }, std::chrono::milliseconds(5000), a_gleader);
+    };
+    auto get = [](std::promise<result>& a_res) {
+        auto f = a_res.get_future();
+        BOOST_REQUIRE(f.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        return f.get();
+    };
+
+    // The spawned process is linked and monitored as requested
+    std::promise<result> l_res;
+    ref l_req = spawn_request(list{am_link, am_monitor}, l_res);
+    eterm l_args;
+    tuple l_cntrl = peer.recv(&l_args);
+    BOOST_CHECK_EQUAL(ERL_SPAWN_REQUEST, l_cntrl[0].to_long());
+    BOOST_CHECK_EQUAL(l_req, l_cntrl[1].to_ref());
+    BOOST_CHECK_EQUAL(mbox->self(), l_cntrl[2].to_pid());
+    BOOST_CHECK_EQUAL(mbox->self(), l_cntrl[3].to_pid());   // Group leader
+    BOOST_CHECK_EQUAL(eterm(tuple::make(atom("mod"), atom("fun"), 2l)), l_cntrl[4]);
+    BOOST_CHECK_EQUAL(eterm(list{am_link, am_monitor}), l_cntrl[5]);
+    BOOST_CHECK_EQUAL(eterm(list{eterm(1l), eterm(2l)}), l_args);
+
+    epid l_new(peer.name.c_str(), 2, 0, 1);
+    peer.send(tuple::make(long(ERL_SPAWN_REPLY), l_req, mbox->self(), 3l, l_new));
+    result r = get(l_res);
+    BOOST_CHECK(r.first == connect::call_status::OK);
+    BOOST_CHECK_EQUAL(eterm(l_new), r.second);
+    BOOST_CHECK(mbox->linked(l_new));
+    BOOST_CHECK_EQUAL(0u, mbox->pending_calls());
+
+    // The 'DOWN' message of the monitor is queued
+    peer.send(tuple::make(long(ERL_MONITOR_P_EXIT), l_new, mbox->self(), l_req, am_normal));
+    std::unique_ptr<transport_msg> m(wait_msg(*mbox));
+    BOOST_REQUIRE(m);
+    BOOST_CHECK_EQUAL(transport_msg::MONITOR_P_EXIT, m->type());
+    BOOST_CHECK_EQUAL(l_req, m->get_ref());
+
+    // Errors are passed to the handler
+    std::promise<result> l_err;
+    epid l_user(peer.name.c_str(), 3, 0, 1);
+    l_req   = spawn_request(list(0), l_err, &l_user);
+    l_cntrl = peer.recv();
+    BOOST_CHECK_EQUAL(l_user, l_cntrl[3].to_pid());
+    BOOST_CHECK_EQUAL(eterm(list(0)), l_cntrl[5]);
+    peer.send(tuple::make(long(ERL_SPAWN_REPLY), l_req, mbox->self(), 0l, am_badarg));
+    r = get(l_err);
+    BOOST_CHECK(r.first == connect::call_status::DOWN);
+    BOOST_CHECK_EQUAL(eterm(am_badarg), r.second);
+
+    // Spawn requests of the peer are rejected without a factory
+    ref l_peer_req(atom(peer.name), {1, 2, 3}, 1);
+    auto peer_spawn = [&](const list& a_opts) {
+        peer.send(tuple::make(long(ERL_SPAWN_REQUEST), l_peer_req, peer_pid, peer_pid,
+                              tuple::make(atom("m"), atom("f"), 1l), a_opts),
+                  list{eterm(42l)});
+        return peer.recv();
+    };
+    l_cntrl = peer_spawn(list{am_link});
+    BOOST_CHECK_EQUAL(ERL_SPAWN_REPLY, l_cntrl[0].to_long());
+    BOOST_CHECK_EQUAL(l_peer_req, l_cntrl[1].to_ref());
+    BOOST_CHECK_EQUAL(peer_pid, l_cntrl[2].to_pid());
+    BOOST_CHECK_EQUAL(0, l_cntrl[3].to_long());
+    BOOST_CHECK_EQUAL(eterm(am_notsup), l_cntrl[4]);
+
+    // ... and served by a mailbox made by the factory
+    list l_spawn_args;
+    node.on_spawn_request = [&](otp_node& n, const epid& a_from, const atom& a_mod,
+                                const atom& a_fun, const list& a_args) -> otp_mailbox* {
+        if (a_from != peer_pid || a_mod != atom("m") || a_fun != atom("f"))
+            return nullptr;
+        l_spawn_args = a_args;
+        return n.create_mailbox();
+    };
+    l_cntrl = peer_spawn(list{am_link, eterm(tuple::make(am_monitor, list(0)))});
+    BOOST_CHECK_EQUAL(3, l_cntrl[3].to_long());
+    BOOST_REQUIRE_EQUAL(PID, l_cntrl[4].type());
+    BOOST_CHECK_EQUAL(eterm(list{eterm(42l)}), eterm(l_spawn_args));
+    otp_mailbox::pointer l_spawned(node.get_mailbox(l_cntrl[4].to_pid()));
+    BOOST_REQUIRE(l_spawned);
+    BOOST_CHECK(l_spawned->linked(peer_pid));
+
+    // The link and the monitor of the requester are triggered on exit
+    l_spawned.reset();
+    l_cntrl = peer.recv();
+    BOOST_CHECK_EQUAL(ERL_EXIT, l_cntrl[0].to_long());
+    BOOST_CHECK_EQUAL(peer_pid, l_cntrl[2].to_pid());
+    l_cntrl = peer.recv();
+    BOOST_CHECK_EQUAL(ERL_MONITOR_P_EXIT, l_cntrl[0].to_long());
+    BOOST_CHECK_EQUAL(l_peer_req, l_cntrl[3].to_ref());
+
+    // Requests the factory returns NULL for are rejected with badarg
+    l_peer_req = ref(atom(peer.name), {1, 2, 4}, 1);
+    peer.send(tuple::make(long(ERL_SPAWN_REQUEST), l_peer_req, peer_pid, peer_pid,
+                          tuple::make(atom("m"), atom("g"), 0l), list(0)), list(0));
+    l_cntrl = peer.recv();
+    BOOST_CHECK_EQUAL(eterm(am_badarg), l_cntrl[4]);
+}
+
+BOOST_AUTO_TEST_CASE( test_node_spawn_local )
+{
+    boost::asio::io_service io;
+    otp_node node(io, "a@localhost");
+    otp_mailbox::pointer mbox(node.create_mailbox());
+
+    BOOST_CHECK_THROW(mbox->spawn(node.nodename(), atom("m"), atom("f"), list(0), list(0)),
+                      err_bad_argument);
+
+    otp_mailbox::pointer l_spawned;
+    node.on_spawn_request = [&](otp_node& n, const epid&, const atom&, const atom&,
+                                const list&) -> otp_mailbox* {
+        l_spawned.reset(n.create_mailbox());
+        return l_spawned.get();
+    };
+    epid l_pid = mbox->spawn(node.nodename(), atom("m"), atom("f"), list(0), list{am_link});
+    BOOST_REQUIRE(l_spawned);
+    BOOST_CHECK_EQUAL(l_spawned->self(), l_pid);
+    BOOST_CHECK(mbox->linked(l_pid));
+    BOOST_CHECK(l_spawned->linked(mbox->self()));
+}
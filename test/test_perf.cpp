@@ -4,6 +4,14 @@
 #include <stdio.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <linux/perf_event.h>
+#include <algorithm>
+#include <random>
+#include <eixx/util/hugepage_alloc.hpp>
 
 /// Prevent variable optimization by the compiler
 #ifdef _MSC_VER
@@ -26,12 +34,17 @@ public:
 
     void restart() { begin(); }
 
-    void sample(const char* title, bool restart = true, size_t out = 0) {
+    /// Seconds elapsed since the last restart
+    double elapsed() {
         getrusage(RUSAGE_THREAD, &end);
-        double diff = (double)(end.ru_utime.tv_sec  - start.ru_utime.tv_sec +
-                               end.ru_stime.tv_sec  - start.ru_stime.tv_sec) +
-                      (double)(end.ru_utime.tv_usec - start.ru_utime.tv_usec +
-                               end.ru_stime.tv_usec - start.ru_stime.tv_usec)/1000000.0;
+        return (double)(end.ru_utime.tv_sec  - start.ru_utime.tv_sec +
+                        end.ru_stime.tv_sec  - start.ru_stime.tv_sec) +
+               (double)(end.ru_utime.tv_usec - start.ru_utime.tv_usec +
+                        end.ru_stime.tv_usec - start.ru_stime.tv_usec)/1000000.0;
+    }
+
+    void sample(const char* title, bool restart = true, size_t out = 0) {
+        double diff = elapsed();
         g_size += out;
 
         // out is used merely to trick the optimizer
@@ -44,6 +57,61 @@ public:
     }
 };
 
+/// Counter of data TLB misses of the calling thread, if supported.
+class tlb_counter {
+    int m_fd;
+public:
+    tlb_counter() {
+        perf_event_attr a;
+        memset(&a, 0, sizeof(a));
+        a.size           = sizeof(a);
+        a.type           = PERF_TYPE_HW_CACHE;
+        a.config         = PERF_COUNT_HW_CACHE_DTLB
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        a.disabled       = 1;
+        a.exclude_kernel = 1;
+        a.exclude_hv     = 1;
+        m_fd = int(syscall(SYS_perf_event_open, &a, 0, -1, -1, 0));
+    }
+    ~tlb_counter() { if (m_fd >= 0) close(m_fd); }
+
+    void start() {
+        if (m_fd < 0) return;
+        ioctl(m_fd, PERF_EVENT_IOC_RESET,  0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    /// @return the number of misses since start() or -1 if not available.
+    long long stop() {
+        long long n;
+        if (m_fd < 0) return -1;
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        return read(m_fd, &n, sizeof(n)) == sizeof(n) ? n : -1;
+    }
+};
+
+/// Scattered reads of binaries allocated with the \a Alloc allocator.
+template <typename Alloc>
+void tlb_sample(timer& t, const char* title, const std::vector<uint32_t>& order) {
+    std::vector<marshal::eterm<Alloc>> terms;
+    terms.reserve(order.size());
+    char data[200] = {1};
+    for (size_t j=0; j < order.size(); j++)
+        terms.emplace_back(marshal::binary<Alloc>(data, sizeof(data)));
+    tlb_counter tlb;
+    size_t sum = 0;
+    t.restart();
+    tlb.start();
+    for (auto j : order)
+        sum += terms[j].to_binary().data()[0];
+    long long misses = tlb.stop();
+    t.sample(title, true, sum);
+    if (misses >= 0)
+        printf("%30s | %9.3f per read\n", "dTLB misses", double(misses) / double(order.size()));
+    else
+        printf("%30s | unavailable\n", "dTLB misses");
+}
 
 int main(int argc, char* argv[]) {
     for(int i=1; i < argc-1 && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
@@ -105,6 +173,18 @@ int main(int argc, char* argv[]) {
             { eterm et(tup); size += et.encode_size(); }
         t.sample("Tuple2", true, size);
     }
+    {
+        // Build {reply, Ref, Result} moving the temporary result in
+        atom am_reply("reply");
+        atom am_ok("ok");
+        uint32_t ids[] = {1, 2, 3};
+        ref  r(atom("a@host"), ids, 0);
+        for (int j=0; j < iterations; j++) {
+            auto x = tuple::make(am_reply, r, tuple::make(am_ok, j));
+            size  += x.size();
+        }
+        t.sample("Tuple3 (move)", true, size);
+    }
     for (int j=0; j < iterations; j++)
         { list t(l); size += eterm(t).encode_size(); }
     t.sample("List1", true, size);
@@ -176,6 +256,28 @@ int main(int argc, char* argv[]) {
         iterations *= 10;
     }
 
+    {
+        const string buf = eterm(tuple::make(am_md, xchg, instr,
+                             list::make(tuple::make(am_q,
+                                list::make(tuple::make(1.2345, 100000)),
+                                list::make(tuple::make(1.2355, 200000)))),
+                             "abcdefg")).encode(0);
+        iterations /= 10;
+        for (int j=0, e = iterations; j < e; j++) {
+            eterm x(buf.c_str(), buf.size());
+            size += x.type();
+        }
+        t.sample("Decode", true, size);
+
+        eterm x(buf.c_str(), buf.size());
+        for (int j=0, e = iterations; j < e; j++) {
+            x.decode_into(buf.c_str(), buf.size());
+            size += x.type();
+        }
+        t.sample("Decode into", true, size);
+        iterations *= 10;
+    }
+
     {
         static const eterm s_pattern = eterm::format("V");
         static atom  am_var("V");
@@ -209,6 +311,84 @@ int main(int argc, char* argv[]) {
         iterations *= 10;
     }
 
+    {
+        std::string text;
+        iterations /= 10;
+        for (int j=0, e = iterations; j < e; j++)
+            text += "{route, 'eu-west-1', 16#ff, [{\"host-1\", 8080, 1.5e-3}, "
+                    "{\"host-2\", 8081, 2.0}], #{weight => 10, tags => [a, b]}, "
+                    "<<\"payload\">>}. % comment\n";
+        t.restart();
+        consult_parser p(text.data(), text.size());
+        for (eterm x; p.next(x); )
+            size += x.type();
+        double secs = t.elapsed();
+        t.sample("Consult parser", true, size);
+        printf("%30s | %9.1f MB/s\n", "Consult parser throughput",
+               secs > 0 ? (double)text.size() / secs / 1000000.0 : 0.0);
+        iterations *= 10;
+    }
+
+    {
+        std::string text("[");
+        iterations /= 10;
+        for (int j=0, e = iterations; j < e; j++)
+            text += "{\"route\": \"eu-west-1\", \"port\": 8080, \"weight\": 1.5e-3, "
+                    "\"hosts\": [\"host-1\", \"host-2\"], \"active\": true, "
+                    "\"note\": \"line\\nbreak \\u00e9\"},\n";
+        text.back() = ']';
+        text[text.size()-2] = ' ';
+        std::string etf, json;
+        etf.reserve(text.size() * 2);
+        json.reserve(text.size());
+        t.restart();
+        json_to_etf(text.data(), text.size(), etf);
+        double secs = t.elapsed();
+        t.sample("JSON to ETF", true, etf.size());
+        printf("%30s | %9.1f MB/s\n", "JSON to ETF throughput",
+               secs > 0 ? (double)text.size() / secs / 1000000.0 : 0.0);
+        t.restart();
+        etf_to_json(etf.data(), etf.size(), json);
+        secs = t.elapsed();
+        t.sample("ETF to JSON", true, json.size());
+        printf("%30s | %9.1f MB/s\n", "ETF to JSON throughput",
+               secs > 0 ? (double)json.size() / secs / 1000000.0 : 0.0);
+        size += json.size();
+        iterations *= 10;
+    }
+
+    {
+        static const atom s_atoms[] = { atom("alpha"), atom("beta"), atom("gamma") };
+        std::vector<eterm> terms;
+        terms.reserve(iterations);
+        unsigned n = 1;
+        for (int j=0, e = iterations; j < e; j++) {
+            n = n * 1103515245 + 12345;
+            switch (j % 6) {
+                case 0: terms.emplace_back(long(n % 100000));             break;
+                case 1: terms.emplace_back(double(n % 100000) / 7);       break;
+                case 2: terms.emplace_back(s_atoms[n % 3]);               break;
+                case 3: terms.emplace_back(tuple::make(s_atoms[n % 3], long(n % 1000))); break;
+                case 4: terms.emplace_back(binary(std::to_string(n % 10000))); break;
+                case 5: terms.emplace_back(list::make(long(n % 100), s_atoms[n % 3])); break;
+            }
+        }
+        t.restart();
+        std::sort(terms.begin(), terms.end());
+        t.sample("Sort mixed terms", true, terms.front().type());
+    }
+
+    {
+        iterations /= 10;
+        std::vector<uint32_t> order(iterations);
+        for (size_t j=0; j < order.size(); j++)
+            order[j] = uint32_t(j);
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        tlb_sample<std::allocator<char>>(t, "Scattered reads (std)", order);
+        tlb_sample<util::hugepage_allocator<char>>(t, "Scattered reads (hugepage)", order);
+        iterations *= 10;
+    }
+
     if (g_size == 0)
         std::cerr << "No iterations performed!" << std::endl;
 